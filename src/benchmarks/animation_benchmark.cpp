@@ -0,0 +1,297 @@
+// Plays back skeletal animation of a crowd of characters, comparing
+// Animation::apply() per character to Animation_evaluator, which the editor
+// uses for playback. The evaluator is measured with one evaluator per
+// character, and with one evaluator driving all characters as instances,
+// both at the same time and at per character times. Sampled local
+// transforms are compared to Animation::apply(), and targets outside a
+// scene are checked to have up to date world transforms.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_scene/animation.hpp"
+#include "erhe_scene/animation_evaluator.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Animation;
+using erhe::scene::Animation_evaluator;
+using erhe::scene::Animation_path;
+using erhe::scene::Node;
+
+constexpr int   s_joint_count     = 50;
+constexpr int   s_keyframe_count  = 60;
+constexpr float s_frame_rate      = 30.0f;
+constexpr float s_clip_duration   = static_cast<float>(s_keyframe_count - 1) / s_frame_rate;
+
+class Character
+{
+public:
+    std::shared_ptr<Node>              root;
+    std::vector<std::shared_ptr<Node>> joints;
+    std::shared_ptr<Animation>         animation;
+};
+
+// Chain of joints, each with translation, rotation and scale channels
+// sharing timestamps, as exported by glTF tools
+auto make_character(const std::shared_ptr<Node>& parent, const int index) -> Character
+{
+    Character character;
+    character.root = std::make_shared<Node>("character");
+    character.root->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{static_cast<float>(index), 0.0f, 0.0f}});
+    if (parent) {
+        character.root->set_parent(parent);
+    }
+    std::shared_ptr<Node> joint_parent = character.root;
+    for (int j = 0; j < s_joint_count; ++j) {
+        auto joint = std::make_shared<Node>("joint");
+        joint->set_parent(joint_parent);
+        character.joints.push_back(joint);
+        joint_parent = ((j % 10) == 9) ? character.root : joint; // a few limbs
+    }
+
+    std::vector<float> timestamps;
+    for (int k = 0; k < s_keyframe_count; ++k) {
+        timestamps.push_back(static_cast<float>(k) / s_frame_rate);
+    }
+
+    character.animation = std::make_shared<Animation>("clip");
+    Animation& animation = *character.animation.get();
+    for (int j = 0; j < s_joint_count; ++j) {
+        for (const Animation_path path : {Animation_path::TRANSLATION, Animation_path::ROTATION, Animation_path::SCALE}) {
+            std::vector<float> values;
+            for (int k = 0; k < s_keyframe_count; ++k) {
+                const float phase = 0.1f * static_cast<float>(k) + 0.37f * static_cast<float>(j + index);
+                switch (path) {
+                    case Animation_path::TRANSLATION: {
+                        values.insert(values.end(), {0.0f, 1.0f + 0.05f * std::sin(phase), 0.0f});
+                        break;
+                    }
+                    case Animation_path::ROTATION: {
+                        const float half_angle = 0.25f * std::sin(phase);
+                        values.insert(values.end(), {std::sin(half_angle), 0.0f, 0.0f, std::cos(half_angle)});
+                        break;
+                    }
+                    case Animation_path::SCALE: {
+                        const float scale = 1.0f + 0.01f * std::cos(phase);
+                        values.insert(values.end(), {scale, scale, scale});
+                        break;
+                    }
+                    default: break;
+                }
+            }
+            erhe::scene::Animation_sampler sampler{erhe::scene::Animation_interpolation_mode::LINEAR};
+            sampler.set(std::vector<float>{timestamps}, std::move(values));
+            animation.channels.push_back(
+                erhe::scene::Animation_channel{
+                    .path           = path,
+                    .sampler_index  = animation.samplers.size(),
+                    .target         = character.joints[j],
+                    .start_position = 0,
+                    .value_offset   = 0
+                }
+            );
+            animation.samplers.push_back(std::move(sampler));
+        }
+    }
+    return character;
+}
+
+auto get_channel_targets(const Character& character) -> std::vector<std::shared_ptr<Node>>
+{
+    std::vector<std::shared_ptr<Node>> targets;
+    for (const auto& channel : character.animation->channels) {
+        targets.push_back(channel.target);
+    }
+    return targets;
+}
+
+// Translation, rotation and scale of joint transforms as matrix columns
+auto get_local_transforms(const std::vector<Character>& characters) -> std::vector<glm::mat4>
+{
+    std::vector<glm::mat4> result;
+    for (const Character& character : characters) {
+        for (const auto& joint : character.joints) {
+            const erhe::scene::Trs_transform& transform = joint->parent_from_node_transform();
+            const glm::quat rotation = transform.get_rotation();
+            result.push_back(
+                glm::mat4{
+                    glm::vec4{transform.get_translation(), 0.0f},
+                    glm::vec4{rotation.x, rotation.y, rotation.z, rotation.w},
+                    glm::vec4{transform.get_scale(), 0.0f},
+                    glm::vec4{0.0f}
+                }
+            );
+        }
+    }
+    return result;
+}
+
+auto max_difference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b) -> float
+{
+    if (a.size() != b.size()) {
+        return std::numeric_limits<float>::infinity();
+    }
+    float result = 0.0f;
+    for (std::size_t i = 0, end = a.size(); i < end; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            const glm::vec4 d = glm::abs(a[i][c] - b[i][c]);
+            result = std::max(result, std::max(std::max(d.x, d.y), std::max(d.z, d.w)));
+        }
+    }
+    return result;
+}
+
+// Time of frame for character, spread so characters are not in sync
+auto get_time(const int frame, const std::size_t character_index) -> float
+{
+    return std::fmod(static_cast<float>(frame) / 60.0f + 0.013f * static_cast<float>(character_index), s_clip_duration);
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const int character_count = options.quick ? 20 : 200;
+    const int frame_count     = options.quick ? 10 : 120;
+    const int repeat_count    = options.quick ? 1  : 3;
+
+    erhe::concurrency::Thread_pool thread_pool{std::max(1u, std::thread::hardware_concurrency() - 1)};
+
+    benchmarks::Benchmark_scene host{"animation_benchmark"};
+    erhe::scene::Scene& scene = host.get_scene();
+    std::vector<Character> characters;
+    for (int i = 0; i < character_count; ++i) {
+        characters.push_back(make_character(host.get_root_node(), i));
+    }
+    scene.update_node_transforms();
+
+    std::vector<std::unique_ptr<Animation_evaluator>> evaluators;
+    for (const Character& character : characters) {
+        evaluators.push_back(std::make_unique<Animation_evaluator>(*character.animation.get()));
+        evaluators.back()->add_instance();
+    }
+
+    // One clip driving every character, as for a crowd sharing animation
+    Animation_evaluator crowd_evaluator{*characters.front().animation.get()};
+    for (const Character& character : characters) {
+        const std::vector<std::shared_ptr<Node>> targets = get_channel_targets(character);
+        crowd_evaluator.add_instance(targets);
+    }
+    std::vector<float> crowd_times(characters.size());
+
+    const auto frame_time = [](const int frame) { return std::fmod(static_cast<float>(frame) / 60.0f, s_clip_duration); };
+
+    const double apply_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        for (int frame = 0; frame < frame_count; ++frame) {
+            for (const Character& character : characters) {
+                character.animation->apply(frame_time(frame));
+            }
+            scene.update_node_transforms();
+        }
+    });
+    const std::vector<glm::mat4> apply_transforms = get_local_transforms(characters);
+
+    const double evaluator_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        for (int frame = 0; frame < frame_count; ++frame) {
+            for (const auto& evaluator : evaluators) {
+                evaluator->apply(frame_time(frame));
+            }
+            scene.update_node_transforms();
+        }
+    });
+    checks.check(max_difference(get_local_transforms(characters), apply_transforms) < 1e-5f, "evaluator matches Animation::apply()");
+
+    // Same clip at per character times. Animation::apply() can only play
+    // a clip on its own targets, so the first clip is retargeted to each
+    // character before it is applied, as the crowd evaluator binds it.
+    Animation& clip = *characters.front().animation.get();
+    const std::vector<std::shared_ptr<Node>> clip_targets = get_channel_targets(characters.front());
+    const auto retarget = [&clip](const std::vector<std::shared_ptr<Node>>& targets) {
+        for (std::size_t c = 0, end = clip.channels.size(); c < end; ++c) {
+            clip.channels[c].target = targets[c];
+        }
+    };
+    std::vector<std::vector<std::shared_ptr<Node>>> character_targets;
+    for (const Character& character : characters) {
+        character_targets.push_back(get_channel_targets(character));
+    }
+    const double apply_phased_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        for (int frame = 0; frame < frame_count; ++frame) {
+            for (std::size_t i = 0, end = characters.size(); i < end; ++i) {
+                retarget(character_targets[i]);
+                clip.apply(get_time(frame, i));
+            }
+            scene.update_node_transforms();
+        }
+    });
+    retarget(clip_targets);
+    const std::vector<glm::mat4> apply_phased_transforms = get_local_transforms(characters);
+
+    const double crowd_phased_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        for (int frame = 0; frame < frame_count; ++frame) {
+            for (std::size_t i = 0, end = characters.size(); i < end; ++i) {
+                crowd_times[i] = get_time(frame, i);
+            }
+            crowd_evaluator.apply(crowd_times, &thread_pool);
+            scene.update_node_transforms(&thread_pool);
+        }
+    });
+    checks.check(max_difference(get_local_transforms(characters), apply_phased_transforms) < 1e-5f, "crowd evaluator matches Animation::apply()");
+
+    const double crowd_synced_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        for (int frame = 0; frame < frame_count; ++frame) {
+            crowd_evaluator.apply(frame_time(frame), &thread_pool);
+            scene.update_node_transforms(&thread_pool);
+        }
+    });
+
+    // Targets outside scene get world transforms from apply()
+    Character detached = make_character(std::shared_ptr<Node>{}, 0);
+    Animation_evaluator detached_evaluator{*detached.animation.get()};
+    detached_evaluator.add_instance();
+    detached_evaluator.apply(0.5f);
+    float detached_error = 0.0f;
+    for (const auto& joint : detached.joints) {
+        const glm::mat4 expected = joint->get_parent_node()->world_from_node() * joint->parent_from_node();
+        detached_error = std::max(detached_error, max_difference({expected}, {joint->world_from_node()}));
+    }
+    checks.check(detached_error < 1e-5f, "detached targets have world transforms updated");
+
+    const std::size_t joint_total = static_cast<std::size_t>(character_count) * s_joint_count;
+    const auto per_frame = [frame_count](const double seconds) { return 1000.0 * seconds / frame_count; };
+    fmt::print(
+        "animation benchmark: {} characters, {} joints, {} channels, {} keyframes, {} groups per clip\n",
+        character_count, joint_total, joint_total * 3, s_keyframe_count, evaluators.front()->get_group_count()
+    );
+    fmt::print("includes Scene::update_node_transforms()         ms/frame\n");
+    fmt::print("Animation::apply(), clip per character           {:8.3f}\n", per_frame(apply_seconds));
+    fmt::print("Animation_evaluator per character                {:8.3f}  ({:.2f}x)\n", per_frame(evaluator_seconds), apply_seconds / evaluator_seconds);
+    fmt::print("Animation::apply(), shared clip, phased          {:8.3f}\n", per_frame(apply_phased_seconds));
+    fmt::print("Animation_evaluator instances, phased            {:8.3f}  ({:.2f}x)\n", per_frame(crowd_phased_seconds), apply_phased_seconds / crowd_phased_seconds);
+    fmt::print("Animation_evaluator instances, same time         {:8.3f}  ({:.2f}x)\n", per_frame(crowd_synced_seconds), apply_phased_seconds / crowd_synced_seconds);
+
+    return checks.get_exit_code();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
+#include <limits>
+#include <string_view>
+
+namespace benchmarks {
+
+// Command line options shared by all benchmarks
+class Options
+{
+public:
+    bool quick{false}; // --quick: reduced problem sizes, used by ctest
+};
+
+inline auto parse_options(const int argc, char** argv) -> Options
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view{argv[i]} == "--quick") {
+            options.quick = true;
+        }
+    }
+    return options;
+}
+
+class Stopwatch
+{
+public:
+    Stopwatch()
+        : m_start{std::chrono::steady_clock::now()}
+    {
+    }
+
+    void restart()
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    [[nodiscard]] auto seconds() const -> double
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    [[nodiscard]] auto milliseconds() const -> double
+    {
+        return seconds() * 1000.0;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Process CPU time in seconds, summed over all threads
+[[nodiscard]] inline auto process_cpu_seconds() -> double
+{
+    return static_cast<double>(std::clock()) / static_cast<double>(CLOCKS_PER_SEC);
+}
+
+// Runs f repeat_count times, returns fastest run in seconds
+template <typename F>
+[[nodiscard]] auto measure_min(const int repeat_count, F&& f) -> double
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeat_count; ++i) {
+        Stopwatch stopwatch;
+        f();
+        best = std::min(best, stopwatch.seconds());
+    }
+    return best;
+}
+
+// Counts failed checks; main() returns get_exit_code()
+class Checks
+{
+public:
+    void check(const bool condition, const std::string_view message)
+    {
+        if (!condition) {
+            fmt::print(stderr, "FAILED: {}\n", message);
+            ++m_failure_count;
+        }
+    }
+
+    [[nodiscard]] auto get_exit_code() const -> int
+    {
+        if (m_failure_count > 0) {
+            fmt::print(stderr, "{} check(s) failed\n", m_failure_count);
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    int m_failure_count{0};
+};
+
+} // namespace benchmarks
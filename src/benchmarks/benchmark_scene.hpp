@@ -0,0 +1,48 @@
+#pragma once
+
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_host.hpp"
+#include "erhe_scene/scene_message_bus.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace benchmarks {
+
+// Minimal Scene_host, the editor equivalent is Scene_root. Nodes parented
+// to get_root_node() are registered to the scene and take part in
+// Scene::update_node_transforms().
+class Benchmark_scene
+    : public erhe::scene::Scene_host
+{
+public:
+    explicit Benchmark_scene(const std::string_view name)
+        : m_scene{std::make_shared<erhe::scene::Scene>(m_message_bus, name, this)}
+    {
+    }
+
+    [[nodiscard]] auto get_scene    () -> erhe::scene::Scene&                 { return *m_scene.get(); }
+    [[nodiscard]] auto get_root_node() -> std::shared_ptr<erhe::scene::Node> { return m_scene->get_root_node(); }
+
+    // Implements Item_host
+    auto get_host_name() const -> const char* override { return "Benchmark_scene"; }
+
+    // Implements Scene_host
+    auto get_hosted_scene () -> erhe::scene::Scene* override                          { return m_scene.get(); }
+    void register_node    (const std::shared_ptr<erhe::scene::Node>&   node)   override { if (m_scene) { m_scene->register_node    (node); } }
+    void unregister_node  (const std::shared_ptr<erhe::scene::Node>&   node)   override { if (m_scene) { m_scene->unregister_node  (node); } }
+    void register_camera  (const std::shared_ptr<erhe::scene::Camera>& camera) override { if (m_scene) { m_scene->register_camera  (camera); } }
+    void unregister_camera(const std::shared_ptr<erhe::scene::Camera>& camera) override { if (m_scene) { m_scene->unregister_camera(camera); } }
+    void register_mesh    (const std::shared_ptr<erhe::scene::Mesh>&   mesh)   override { if (m_scene) { m_scene->register_mesh    (mesh); } }
+    void unregister_mesh  (const std::shared_ptr<erhe::scene::Mesh>&   mesh)   override { if (m_scene) { m_scene->unregister_mesh  (mesh); } }
+    void register_skin    (const std::shared_ptr<erhe::scene::Skin>&   skin)   override { if (m_scene) { m_scene->register_skin    (skin); } }
+    void unregister_skin  (const std::shared_ptr<erhe::scene::Skin>&   skin)   override { if (m_scene) { m_scene->unregister_skin  (skin); } }
+    void register_light   (const std::shared_ptr<erhe::scene::Light>&  light)  override { if (m_scene) { m_scene->register_light   (light); } }
+    void unregister_light (const std::shared_ptr<erhe::scene::Light>&  light)  override { if (m_scene) { m_scene->unregister_light (light); } }
+
+private:
+    erhe::scene::Scene_message_bus      m_message_bus;
+    std::shared_ptr<erhe::scene::Scene> m_scene;
+};
+
+} // namespace benchmarks
@@ -0,0 +1,257 @@
+// Counts bytes written per frame to primitive and draw indirect buffers
+// when a few nodes move each frame. The GL buffers are not used; entries
+// are tracked with erhe::renderer::Persistent_block_entries, which
+// Primitive_buffer and Draw_indirect_buffer use for change detection, and
+// bytes are counted as those count them. Compared are full rewrite each
+// frame, persistent blocks matched by update() call order, and persistent
+// blocks keyed by pass and mesh span. The outline pass draws selected
+// meshes every other frame, which shifts the call order of the passes
+// after it.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_renderer/persistent_block_entries.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+#include "erhe_scene/transform.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Mesh;
+using erhe::scene::Node;
+
+// std430 Primitive struct: two mat4, vec4, uint, float, float, uint
+constexpr std::size_t s_entry_size   = 160;
+constexpr std::size_t s_command_size = 20; // Draw_elements_indirect_command
+constexpr std::size_t s_slot_count   = 4;  // Multi_buffer::s_frame_resources_count
+
+using Mesh_span = std::vector<std::shared_ptr<Mesh>>;
+
+class Entry
+{
+public:
+    const Mesh* mesh  {nullptr};
+    uint64_t    serial{0};
+
+    [[nodiscard]] auto operator==(const Entry& other) const -> bool = default;
+};
+
+class Block
+{
+public:
+    erhe::renderer::Persistent_block_entries<Entry, s_slot_count>       entries;
+    erhe::renderer::Persistent_block_entries<const Mesh*, s_slot_count> commands; // stands for draw commands, which follow meshes
+};
+
+class Key
+{
+public:
+    std::size_t pass{0};
+    std::size_t span{0};
+
+    [[nodiscard]] auto operator==(const Key& other) const -> bool = default;
+};
+
+class Key_hash
+{
+public:
+    [[nodiscard]] auto operator()(const Key& key) const noexcept -> std::size_t
+    {
+        return (key.pass * 1000003u) ^ key.span;
+    }
+};
+
+class Write_counts
+{
+public:
+    std::size_t primitive_bytes{0};
+    std::size_t command_bytes  {0};
+};
+
+// Primitive_buffer::update_persistent() writes changed entries, and
+// Draw_indirect_buffer::update_persistent() writes the range of changed
+// commands
+void update_block(Block& block, const Mesh_span& meshes, const uint64_t frame, const std::size_t slot, Write_counts& counts)
+{
+    const std::size_t count = meshes.size();
+    block.entries .resize(count, frame);
+    block.commands.resize(count, frame);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Mesh* mesh = meshes[i].get();
+        block.entries .update(i, Entry{.mesh = mesh, .serial = mesh->get_node()->node_data.transforms.world_from_node_serial}, frame);
+        block.commands.update(i, mesh, frame);
+    }
+
+    counts.primitive_bytes += block.entries .get_dirty_range(slot).changed_count * s_entry_size;
+    counts.command_bytes   += block.commands.get_dirty_range(slot).entry_count() * s_command_size;
+    block.entries .set_written(slot, frame);
+    block.commands.set_written(slot, frame);
+}
+
+class Pass
+{
+public:
+    std::string                   name;
+    const std::vector<Mesh_span>* spans            {nullptr};
+    bool                          every_other_frame{false};
+};
+
+class Result
+{
+public:
+    Write_counts full;
+    Write_counts call_order;
+    Write_counts keyed;
+    double       detect_ms{0.0};
+};
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const std::size_t span_count    = options.quick ? 4   : 16;
+    const std::size_t span_size     = options.quick ? 250 : 1250;
+    const std::size_t moving_stride = 100; // every 100th node moves every frame
+    const uint64_t    frame_count   = options.quick ? 32  : 240;
+    const uint64_t    warmup_frames = 2 * s_slot_count;
+
+    benchmarks::Benchmark_scene host{"buffer update"};
+    erhe::scene::Scene&         scene = host.get_scene();
+
+    // Group per span, so that sibling scans stay short
+    std::vector<Mesh_span>             spans(span_count);
+    std::vector<std::shared_ptr<Node>> moving_nodes;
+    std::vector<Mesh_span>             selection(1);
+    std::size_t                        selection_moving_count = 0;
+    std::size_t                        node_index = 0;
+    for (std::size_t span_index = 0; span_index < span_count; ++span_index) {
+        auto group = std::make_shared<Node>("group");
+        group->set_parent(host.get_root_node());
+        for (std::size_t i = 0; i < span_size; ++i, ++node_index) {
+            auto node = std::make_shared<Node>("node");
+            node->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{static_cast<float>(i), static_cast<float>(span_index), 0.0f}});
+            node->set_parent(group);
+            auto mesh = std::make_shared<Mesh>("mesh");
+            node->attach(mesh);
+            spans[span_index].push_back(mesh);
+            const bool moving = (node_index % moving_stride) == 0;
+            if (moving) {
+                moving_nodes.push_back(node);
+            }
+            if ((span_index == 0) && (i < 150)) {
+                selection.front().push_back(mesh);
+                selection_moving_count += moving ? 1 : 0;
+            }
+        }
+    }
+    scene.update_node_transforms();
+
+    const std::vector<Pass> passes{
+        Pass{.name = "opaque",    .spans = &spans                                },
+        Pass{.name = "outline",   .spans = &selection, .every_other_frame = true },
+        Pass{.name = "wireframe", .spans = &spans                                },
+        Pass{.name = "id",        .spans = &spans                                }
+    };
+
+    Result                                   result;
+    std::vector<Block>                       call_order_blocks;
+    std::unordered_map<Key, Block, Key_hash> keyed_blocks;
+    benchmarks::Stopwatch                    stopwatch;
+    double                                   detect_seconds{0.0};
+    for (uint64_t frame = 1; frame <= frame_count; ++frame) {
+        const std::size_t slot = frame % s_slot_count;
+        for (std::size_t i = 0, end = moving_nodes.size(); i < end; ++i) {
+            const float t = static_cast<float>(frame) * 0.01f;
+            moving_nodes[i]->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{t, static_cast<float>(i), 1.0f}});
+        }
+        scene.update_node_transforms();
+
+        const bool   measured = frame > warmup_frames;
+        Write_counts full;
+        Write_counts call_order;
+        Write_counts keyed;
+        std::size_t  call_index = 0;
+        stopwatch.restart();
+        for (std::size_t pass_index = 0, pass_end = passes.size(); pass_index < pass_end; ++pass_index) {
+            if (passes[pass_index].every_other_frame && ((frame % 2) == 0)) {
+                continue;
+            }
+            const std::vector<Mesh_span>& pass_spans = *passes[pass_index].spans;
+            for (std::size_t span_index = 0, span_end = pass_spans.size(); span_index < span_end; ++span_index) {
+                const Mesh_span& meshes = pass_spans[span_index];
+                full.primitive_bytes += meshes.size() * s_entry_size;
+                full.command_bytes   += meshes.size() * s_command_size;
+
+                if (call_index >= call_order_blocks.size()) {
+                    call_order_blocks.resize(call_index + 1);
+                }
+                update_block(call_order_blocks[call_index++], meshes, frame, slot, call_order);
+                update_block(keyed_blocks[Key{.pass = pass_index, .span = span_index}], meshes, frame, slot, keyed);
+            }
+        }
+        detect_seconds += stopwatch.seconds();
+
+        if (measured) {
+            result.full      .primitive_bytes += full      .primitive_bytes;
+            result.full      .command_bytes   += full      .command_bytes;
+            result.call_order.primitive_bytes += call_order.primitive_bytes;
+            result.call_order.command_bytes   += call_order.command_bytes;
+            result.keyed     .primitive_bytes += keyed     .primitive_bytes;
+            result.keyed     .command_bytes   += keyed     .command_bytes;
+        }
+    }
+    const uint64_t measured_frames = frame_count - warmup_frames;
+    // Both delta variants run in the loop, so halve for the time of one
+    result.detect_ms = 0.5 * 1000.0 * detect_seconds / static_cast<double>(frame_count);
+
+    const std::size_t mesh_count = span_count * span_size;
+    fmt::print(
+        "{} meshes in {} spans, {} moving, outline of {} meshes every other frame\n",
+        mesh_count, span_count, moving_nodes.size(), selection.front().size()
+    );
+    fmt::print("{:<24} {:>16} {:>16} {:>12}\n", "update", "primitive B/frame", "command B/frame", "total KiB");
+    auto print_row = [&](const char* label, const Write_counts& counts) {
+        const double primitive = static_cast<double>(counts.primitive_bytes) / static_cast<double>(measured_frames);
+        const double command   = static_cast<double>(counts.command_bytes  ) / static_cast<double>(measured_frames);
+        fmt::print("{:<24} {:>16.0f} {:>16.0f} {:>12.1f}\n", label, primitive, command, (primitive + command) / 1024.0);
+    };
+    print_row("full rewrite",         result.full);
+    print_row("blocks by call order", result.call_order);
+    print_row("blocks by pass + span", result.keyed);
+    fmt::print("change detection {:.3f} ms/frame\n", result.detect_ms);
+
+    // Keyed blocks rewrite only moved entries: each frame three passes draw
+    // all moving nodes, and the outline pass draws selected moving nodes
+    // every other frame.
+    const double expected_keyed = static_cast<double>(s_entry_size) * (
+        3.0 * static_cast<double>(moving_nodes.size()) +
+        0.5 * static_cast<double>(selection_moving_count)
+    );
+    const double      keyed_per_frame      = static_cast<double>(result.keyed.primitive_bytes) / static_cast<double>(measured_frames);
+
+    benchmarks::Checks checks;
+    checks.check(result.keyed.command_bytes == 0, "keyed blocks rewrite draw commands of static spans");
+    checks.check(keyed_per_frame <= expected_keyed * 1.01, "keyed blocks write more than moved entries");
+    checks.check(result.keyed.primitive_bytes < result.call_order.primitive_bytes, "keyed blocks do not write less than call order blocks");
+    checks.check(result.call_order.primitive_bytes < result.full.primitive_bytes, "call order blocks do not write less than full rewrite");
+    return checks.get_exit_code();
+}
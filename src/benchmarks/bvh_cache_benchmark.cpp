@@ -0,0 +1,257 @@
+// Measures the BVH cache for a one million triangle mesh: content key
+// hashing with per-float FNV (the old cache key) against XXH64 over the raw
+// index and vertex buffers, and cache loads with stream deserialization
+// and rebuilt precomputed triangles (the old cache format) against the
+// memory mapped cache entry used in place.
+//
+// Node contents are synthetic; the cache treats nodes as plain data. The
+// entry is written to the cache directory configured in erhe.ini
+// (default cache/bvh) with a fixed key, so reruns replace it.
+
+#include "benchmark.hpp"
+
+#include "erhe_file/file_log.hpp"
+#include "erhe_hash/hash.hpp"
+#include "erhe_hash/xxh64.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_raytrace/bvh/bvh_cache.hpp"
+#include "erhe_raytrace/raytrace_log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+using erhe::raytrace::Bvh_node;
+using erhe::raytrace::Bvh_precomputed_tri;
+
+constexpr uint64_t c_entry_key = 0xbe4c000000000011ull;
+
+class Mesh
+{
+public:
+    explicit Mesh(const uint32_t grid_size)
+    {
+        for (uint32_t y = 0; y <= grid_size; ++y) {
+            for (uint32_t x = 0; x <= grid_size; ++x) {
+                positions.push_back(glm::vec3{static_cast<float>(x), static_cast<float>(y), 0.01f * static_cast<float>((x * y) % 7)});
+            }
+        }
+        const auto vertex = [grid_size](const uint32_t x, const uint32_t y) { return y * (grid_size + 1) + x; };
+        for (uint32_t y = 0; y < grid_size; ++y) {
+            for (uint32_t x = 0; x < grid_size; ++x) {
+                indices.insert(indices.end(), {vertex(x, y), vertex(x + 1, y), vertex(x + 1, y + 1)});
+                indices.insert(indices.end(), {vertex(x, y), vertex(x + 1, y + 1), vertex(x, y + 1)});
+            }
+        }
+    }
+
+    [[nodiscard]] auto triangle_count() const -> std::size_t { return indices.size() / 3; }
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t>  indices;
+};
+
+// Old cache key: FNV one byte at a time, per float of each triangle corner
+auto hash_fnv_per_float(const Mesh& mesh) -> uint64_t
+{
+    uint64_t hash_code{erhe::hash::c_seed};
+    for (const uint32_t index : mesh.indices) {
+        const glm::vec3 p = mesh.positions[index];
+        hash_code = erhe::hash::hash(p.x, p.y, p.z, hash_code);
+    }
+    return hash_code;
+}
+
+// New cache key: XXH64 over raw index and vertex buffers
+auto hash_xxh64(const Mesh& mesh) -> uint64_t
+{
+    uint64_t hash_code = erhe::hash::xxh64(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    return erhe::hash::xxh64(mesh.positions.data(), mesh.positions.size() * sizeof(glm::vec3), hash_code);
+}
+
+auto precompute(const glm::vec3 p0, const glm::vec3 p1, const glm::vec3 p2) -> Bvh_precomputed_tri
+{
+    const glm::vec3 e1 = p0 - p1;
+    const glm::vec3 e2 = p2 - p0;
+    const glm::vec3 n  = glm::cross(e1, e2);
+    Bvh_precomputed_tri result;
+    static_assert(sizeof(Bvh_precomputed_tri) >= 4 * sizeof(glm::vec3));
+    const glm::vec3 values[4]{p0, e1, e2, n};
+    std::memcpy(&result, values, sizeof(values));
+    return result;
+}
+
+// Old cache format: counts and elements written one value at a time, as
+// bvh::v2 stream serialization does
+void write_stream_format(const std::filesystem::path& path, const std::vector<Bvh_node>& nodes, const std::vector<std::size_t>& primitive_ids)
+{
+    std::ofstream out{path, std::ofstream::binary | std::ofstream::trunc};
+    const uint64_t node_count = nodes.size();
+    out.write(reinterpret_cast<const char*>(&node_count), sizeof(node_count));
+    for (const Bvh_node& node : nodes) {
+        out.write(reinterpret_cast<const char*>(&node), sizeof(node));
+    }
+    const uint64_t primitive_count = primitive_ids.size();
+    out.write(reinterpret_cast<const char*>(&primitive_count), sizeof(primitive_count));
+    for (const std::size_t primitive_id : primitive_ids) {
+        out.write(reinterpret_cast<const char*>(&primitive_id), sizeof(primitive_id));
+    }
+}
+
+// Old cache load: stream deserialization, then precomputed triangles rebuilt from mesh
+auto load_stream_format(const std::filesystem::path& path, const Mesh& mesh) -> std::vector<Bvh_precomputed_tri>
+{
+    std::ifstream in{path, std::ifstream::binary};
+    uint64_t node_count{0};
+    in.read(reinterpret_cast<char*>(&node_count), sizeof(node_count));
+    std::vector<Bvh_node> nodes;
+    nodes.reserve(node_count);
+    for (uint64_t i = 0; i < node_count; ++i) {
+        Bvh_node node;
+        in.read(reinterpret_cast<char*>(&node), sizeof(node));
+        nodes.push_back(node);
+    }
+    uint64_t primitive_count{0};
+    in.read(reinterpret_cast<char*>(&primitive_count), sizeof(primitive_count));
+    std::vector<std::size_t> primitive_ids;
+    primitive_ids.reserve(primitive_count);
+    for (uint64_t i = 0; i < primitive_count; ++i) {
+        std::size_t primitive_id{0};
+        in.read(reinterpret_cast<char*>(&primitive_id), sizeof(primitive_id));
+        primitive_ids.push_back(primitive_id);
+    }
+    std::vector<Bvh_precomputed_tri> triangles;
+    triangles.reserve(primitive_ids.size());
+    for (const std::size_t primitive_id : primitive_ids) {
+        const std::size_t i = 3 * primitive_id;
+        triangles.push_back(precompute(mesh.positions[mesh.indices[i]], mesh.positions[mesh.indices[i + 1]], mesh.positions[mesh.indices[i + 2]]));
+    }
+    return triangles;
+}
+
+// Reads every byte once, so that mapped pages are faulted in
+auto touch(const std::span<const std::byte> bytes) -> uint64_t
+{
+    uint64_t sum = 0;
+    for (std::size_t i = 0, end = bytes.size(); i < end; i += sizeof(uint64_t)) {
+        uint64_t value;
+        std::memcpy(&value, bytes.data() + i, std::min(sizeof(uint64_t), end - i));
+        sum += value;
+    }
+    return sum;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::file::initialize_logging();
+    erhe::raytrace::initialize_logging();
+
+    // 708 x 708 quads, two triangles each, is just over one million triangles
+    const uint32_t grid_size    = options.quick ? 64 : 708;
+    const int      repeat_count = options.quick ? 1 : 3;
+
+    const Mesh mesh{grid_size};
+    const std::size_t triangle_count = mesh.triangle_count();
+    const double      mesh_bytes     = static_cast<double>(mesh.indices.size() * sizeof(uint32_t) + mesh.positions.size() * sizeof(glm::vec3));
+    fmt::print("mesh: {} triangles, {} vertices, {:.1f} MB\n", triangle_count, mesh.positions.size(), mesh_bytes / (1024.0 * 1024.0));
+
+    uint64_t fnv_key   = 0;
+    uint64_t xxh64_key = 0;
+    const double fnv_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        fnv_key = hash_fnv_per_float(mesh);
+    });
+    const double xxh64_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        xxh64_key = hash_xxh64(mesh);
+    });
+    fmt::print("key   FNV per float {:8.2f} ms   XXH64 over buffers {:7.2f} ms ({:.1f} GB/s)\n",
+        1000.0 * fnv_seconds, 1000.0 * xxh64_seconds, mesh_bytes / xxh64_seconds / 1e9
+    );
+    checks.check((fnv_key != 0) && (xxh64_key != 0), "content keys computed");
+
+    // Synthetic BVH: about two nodes per triangle, primitive ids in reverse order
+    std::vector<Bvh_node> nodes(2 * triangle_count);
+    for (std::size_t i = 0, end = nodes.size(); i < end; ++i) {
+        const float value = static_cast<float>(i);
+        nodes[i].bounds      = {value, value, value, value + 1.0f, value + 1.0f, value + 1.0f};
+        nodes[i].index.value = static_cast<decltype(nodes[i].index.value)>(i);
+    }
+    std::vector<std::size_t>         primitive_ids(triangle_count);
+    std::vector<Bvh_precomputed_tri> triangles;
+    triangles.reserve(triangle_count);
+    for (std::size_t i = 0; i < triangle_count; ++i) {
+        primitive_ids[i] = triangle_count - 1 - i;
+        const std::size_t t = 3 * primitive_ids[i];
+        triangles.push_back(precompute(mesh.positions[mesh.indices[t]], mesh.positions[mesh.indices[t + 1]], mesh.positions[mesh.indices[t + 2]]));
+    }
+    const erhe::raytrace::Aabb bounds{glm::vec3{0.0f}, glm::vec3{static_cast<float>(grid_size), static_cast<float>(grid_size), 1.0f}};
+
+    if (!erhe::raytrace::bvh_cache_is_enabled()) {
+        fmt::print("BVH cache is disabled in erhe.ini, skipping load measurements\n");
+        return checks.get_exit_code();
+    }
+
+    const benchmarks::Stopwatch store_stopwatch;
+    const bool store_ok = erhe::raytrace::bvh_cache_store(c_entry_key, bounds, nodes, primitive_ids, triangles);
+    const double store_seconds = store_stopwatch.seconds();
+    checks.check(store_ok, "cache entry stored");
+
+    const std::filesystem::path stream_path = std::filesystem::temp_directory_path() / "erhe_bvh_cache_benchmark.stream";
+    write_stream_format(stream_path, nodes, primitive_ids);
+
+    std::size_t stream_triangle_count = 0;
+    const double stream_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        stream_triangle_count = load_stream_format(stream_path, mesh).size();
+    });
+    std::filesystem::remove(stream_path);
+
+    const erhe::raytrace::Bvh_cache_statistics before = erhe::raytrace::get_bvh_cache_statistics();
+    bool     contents_match = true;
+    uint64_t touch_sum      = 0;
+    double   map_seconds    = std::numeric_limits<double>::max();
+    const double mapped_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        const benchmarks::Stopwatch map_stopwatch;
+        const std::optional<erhe::raytrace::Bvh_cache_entry> entry = erhe::raytrace::bvh_cache_load(c_entry_key);
+        map_seconds = std::min(map_seconds, map_stopwatch.seconds());
+        if (!entry.has_value()) {
+            contents_match = false;
+            return;
+        }
+        touch_sum += touch(std::as_bytes(entry->nodes));
+        touch_sum += touch(std::as_bytes(entry->primitive_ids));
+        touch_sum += touch(std::as_bytes(entry->triangles));
+        contents_match = contents_match &&
+            (entry->nodes.size()         == nodes.size()) &&
+            (entry->primitive_ids.size() == primitive_ids.size()) &&
+            (entry->triangles.size()     == triangles.size()) &&
+            (std::memcmp(entry->triangles.data(), triangles.data(), triangles.size() * sizeof(Bvh_precomputed_tri)) == 0);
+    });
+    const bool missing_is_miss = !erhe::raytrace::bvh_cache_load(c_entry_key + 1).has_value();
+    const erhe::raytrace::Bvh_cache_statistics after = erhe::raytrace::get_bvh_cache_statistics();
+
+    fmt::print("store  {:8.2f} ms\n", 1000.0 * store_seconds);
+    fmt::print("load   stream + precompute {:8.2f} ms   mapped {:6.3f} ms, mapped + read all {:7.2f} ms\n",
+        1000.0 * stream_seconds, 1000.0 * map_seconds, 1000.0 * mapped_seconds
+    );
+    fmt::print("cache  hits {} misses {} stores {} evictions {} (checksum {:x})\n",
+        after.hit_count, after.miss_count, after.store_count, after.evict_count, touch_sum
+    );
+
+    checks.check(stream_triangle_count == triangle_count,                         "stream format loads all triangles");
+    checks.check(contents_match,                                                  "mapped entry matches stored data");
+    checks.check(missing_is_miss,                                                 "unknown key is a miss");
+    checks.check(after.hit_count  - before.hit_count  == std::size_t(repeat_count), "every load of stored key is a hit");
+    checks.check(after.miss_count - before.miss_count == 1,                       "miss is counted");
+
+    return checks.get_exit_code();
+}
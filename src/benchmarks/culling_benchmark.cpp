@@ -0,0 +1,329 @@
+// Culls a grid of meshes with Mesh_culler against synthetic perspective
+// and orthographic cameras, serially and with thread pool. Visible lists,
+// per mesh visibility and statistics are checked against a reference which
+// transforms all eight box corners and tests them with Frustum_planes.
+// Also reports primitive buffer entries written for shadow maps, which
+// Shadow_renderer writes once for all lights instead of once per light.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_item/item.hpp"
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_math/math_util.hpp"
+#include "erhe_primitive/geometry_mesh.hpp"
+#include "erhe_primitive/primitive.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/mesh_culler.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Mesh;
+using erhe::scene::Mesh_culler;
+using erhe::scene::Node;
+
+constexpr float s_spacing = 4.0f;
+
+class Synthetic_camera
+{
+public:
+    std::string name;
+    glm::mat4   clip_from_world;
+};
+
+// Right handed view looking down -Z from position, rotated around Y by yaw
+auto make_view(const glm::vec3 position, const float yaw) -> glm::mat4
+{
+    const float c = std::cos(yaw);
+    const float s = std::sin(yaw);
+    glm::mat4 world_from_view{1.0f};
+    world_from_view[0] = glm::vec4{   c, 0.0f,   -s, 0.0f};
+    world_from_view[1] = glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
+    world_from_view[2] = glm::vec4{   s, 0.0f,    c, 0.0f};
+    world_from_view[3] = glm::vec4{position, 1.0f};
+
+    // Inverse of rigid transform: transpose rotation, rotate translation
+    glm::mat4 view_from_world{1.0f};
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            view_from_world[column][row] = world_from_view[row][column];
+        }
+    }
+    for (int row = 0; row < 3; ++row) {
+        view_from_world[3][row] = -(
+            world_from_view[row][0] * position.x +
+            world_from_view[row][1] * position.y +
+            world_from_view[row][2] * position.z
+        );
+    }
+    return view_from_world;
+}
+
+// Minus one to one depth range, as glm::perspective()
+auto make_perspective(const float fov_y, const float aspect, const float z_near, const float z_far) -> glm::mat4
+{
+    const float f = 1.0f / std::tan(0.5f * fov_y);
+    glm::mat4 m{0.0f};
+    m[0][0] = f / aspect;
+    m[1][1] = f;
+    m[2][2] = (z_far + z_near) / (z_near - z_far);
+    m[2][3] = -1.0f;
+    m[3][2] = 2.0f * z_far * z_near / (z_near - z_far);
+    return m;
+}
+
+auto make_orthographic(const float half_width, const float half_height, const float z_near, const float z_far) -> glm::mat4
+{
+    glm::mat4 m{1.0f};
+    m[0][0] = 1.0f / half_width;
+    m[1][1] = 1.0f / half_height;
+    m[2][2] = -2.0f / (z_far - z_near);
+    m[3][2] = -(z_far + z_near) / (z_far - z_near);
+    return m;
+}
+
+// Reference: world box of transformed corners. Returns -1 when box is
+// within epsilon of a plane, where float rounding may go either way.
+auto reference_visibility(const erhe::math::Frustum_planes& frustum, const Mesh& mesh) -> int
+{
+    const erhe::math::Bounding_box& box = mesh.get_primitives().front().geometry_primitive->gl_geometry_mesh.bounding_box;
+    const glm::mat4 world_from_node = mesh.get_node()->world_from_node();
+    glm::vec3 world_min{std::numeric_limits<float>::max()};
+    glm::vec3 world_max{std::numeric_limits<float>::lowest()};
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 local{
+            ((corner & 1) != 0) ? box.max.x : box.min.x,
+            ((corner & 2) != 0) ? box.max.y : box.min.y,
+            ((corner & 4) != 0) ? box.max.z : box.min.z
+        };
+        const glm::vec3 world = glm::vec3{world_from_node * glm::vec4{local, 1.0f}};
+        world_min = glm::min(world_min, world);
+        world_max = glm::max(world_max, world);
+    }
+    const glm::vec3 center      = 0.5f * (world_min + world_max);
+    const glm::vec3 half_extent = 0.5f * (world_max - world_min);
+    for (const glm::vec4& plane : frustum.planes) {
+        const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        const float radius   = std::abs(plane.x) * half_extent.x + std::abs(plane.y) * half_extent.y + std::abs(plane.z) * half_extent.z;
+        const float scale    = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (std::abs(distance + radius) < 1.0e-3f * scale) {
+            return -1;
+        }
+    }
+    return frustum.intersects(center, half_extent) ? 1 : 0;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const int grid_size    = options.quick ? 20 : 46; // meshes per grid axis
+    const int repeat_count = options.quick ? 1  : 10;
+    const int light_count  = 4;
+
+    erhe::concurrency::Thread_pool thread_pool{std::max(1u, std::thread::hardware_concurrency() - 1)};
+
+    benchmarks::Benchmark_scene host{"culling_benchmark"};
+
+    // Unit boxes, a few scaled; every 97th mesh has no bounds, every 101st
+    // mesh is hidden
+    erhe::primitive::Geometry_mesh box_mesh;
+    box_mesh.bounding_box.min = glm::vec3{-0.5f};
+    box_mesh.bounding_box.max = glm::vec3{ 0.5f};
+    const auto box_primitive       = std::make_shared<erhe::primitive::Geometry_primitive>(erhe::primitive::Geometry_mesh{box_mesh});
+    const auto unbounded_primitive = std::make_shared<erhe::primitive::Geometry_primitive>(erhe::primitive::Geometry_mesh{});
+
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    std::size_t expected_unbounded = 0;
+    std::size_t expected_filtered  = 0;
+    for (int z = 0; z < grid_size; ++z) {
+        auto group = std::make_shared<Node>("group");
+        group->set_parent(host.get_root_node());
+        for (int y = 0; y < grid_size; ++y) {
+            for (int x = 0; x < grid_size; ++x) {
+                const std::size_t index = meshes.size();
+                const float       scale = ((index % 7) == 0) ? 3.0f : 1.0f;
+                auto node = std::make_shared<Node>("node");
+                node->set_parent_from_node(
+                    erhe::scene::Trs_transform{
+                        glm::vec3{
+                            s_spacing * static_cast<float>(x - grid_size / 2),
+                            s_spacing * static_cast<float>(y - grid_size / 2),
+                            s_spacing * static_cast<float>(z - grid_size / 2)
+                        },
+                        glm::quat{1.0f, 0.0f, 0.0f, 0.0f},
+                        glm::vec3{scale}
+                    }
+                );
+                node->set_parent(group);
+                node->enable_flag_bits(erhe::Item_flags::visible);
+                auto mesh = std::make_shared<Mesh>("mesh");
+                const bool unbounded = (index % 97) == 0;
+                const bool hidden    = !unbounded && ((index % 101) == 0);
+                mesh->add_primitive(
+                    erhe::primitive::Primitive{
+                        .material           = {},
+                        .geometry_primitive = unbounded ? unbounded_primitive : box_primitive
+                    }
+                );
+                node->attach(mesh); // attachment gets visibility of node
+                if (hidden) {
+                    mesh->set_flag_bits(erhe::Item_flags::visible, false);
+                }
+                meshes.push_back(mesh);
+                expected_unbounded += unbounded ? 1 : 0;
+                expected_filtered  += hidden    ? 1 : 0;
+            }
+        }
+    }
+    host.get_scene().update_node_transforms();
+
+    // Two spans, as content and tool mesh layers
+    const std::size_t split = meshes.size() / 3;
+    const std::vector<Mesh_culler::Mesh_span> mesh_spans{
+        Mesh_culler::Mesh_span{meshes.data(), split},
+        Mesh_culler::Mesh_span{meshes.data() + split, meshes.size() - split}
+    };
+    const erhe::Item_filter filter{
+        .require_all_bits_set           = erhe::Item_flags::visible,
+        .require_at_least_one_bit_set   = 0u,
+        .require_all_bits_clear         = 0u,
+        .require_at_least_one_bit_clear = 0u
+    };
+
+    const float extent = s_spacing * static_cast<float>(grid_size) * 0.5f;
+    std::vector<Synthetic_camera> cameras{
+        {"inside, 60 deg",   make_perspective(1.047f, 16.0f / 9.0f, 0.1f, 1000.0f) * make_view(glm::vec3{0.0f}, 0.3f)},
+        {"outside, 90 deg",  make_perspective(1.571f, 1.0f,         0.1f, 1000.0f) * make_view(glm::vec3{0.0f, 0.0f, 2.5f * extent}, 0.0f)},
+        {"corner, 30 deg",   make_perspective(0.524f, 1.0f,         0.1f, 1000.0f) * make_view(glm::vec3{extent, 0.0f, extent}, 0.785f)},
+        {"looking away",     make_perspective(1.047f, 1.0f,         0.1f, 1000.0f) * make_view(glm::vec3{0.0f, 0.0f, 2.0f * extent}, 3.1416f)},
+    };
+    std::vector<Synthetic_camera> lights;
+    for (int i = 0; i < light_count; ++i) {
+        const float yaw = 1.5708f * static_cast<float>(i);
+        const glm::vec3 position{2.0f * extent * std::sin(yaw), 0.0f, 2.0f * extent * std::cos(yaw)};
+        lights.push_back(
+            Synthetic_camera{
+                "light " + std::to_string(i),
+                make_orthographic(0.4f * extent, 0.4f * extent, 0.1f, 4.0f * extent) * make_view(position, yaw)
+            }
+        );
+    }
+
+    Mesh_culler culler;
+    Mesh_culler parallel_culler;
+    fmt::print("culling benchmark: {} meshes, {} unbounded, {} hidden\n", meshes.size(), expected_unbounded, expected_filtered);
+    fmt::print("camera               visible   culled   serial ms   pool ms   ns/mesh\n");
+
+    std::size_t light_visible_total = 0;
+    std::vector<std::vector<uint8_t>> any_light_visibility(mesh_spans.size());
+    for (std::size_t span_index = 0; span_index < mesh_spans.size(); ++span_index) {
+        any_light_visibility[span_index].assign(mesh_spans[span_index].size(), 0);
+    }
+    std::vector<Synthetic_camera> all_cameras = cameras;
+    all_cameras.insert(all_cameras.end(), lights.begin(), lights.end());
+    for (const Synthetic_camera& camera : all_cameras) {
+        const double serial_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            culler.cull(camera.clip_from_world, mesh_spans, filter);
+        });
+        const double pool_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            parallel_culler.cull(camera.clip_from_world, mesh_spans, filter, &thread_pool);
+        });
+        const std::vector<Mesh_culler::Mesh_span>& visible_spans   = culler.cull(camera.clip_from_world, mesh_spans, filter);
+        const std::vector<Mesh_culler::Mesh_span>& parallel_spans  = parallel_culler.cull(camera.clip_from_world, mesh_spans, filter, &thread_pool);
+        const erhe::scene::Culling_statistics&     statistics      = culler.get_statistics();
+
+        // Output lists and visibility agree with reference, and serial and
+        // parallel culling give same lists
+        const erhe::math::Frustum_planes frustum{camera.clip_from_world};
+        std::size_t mismatch_count = 0;
+        for (std::size_t span_index = 0; span_index < mesh_spans.size(); ++span_index) {
+            const Mesh_culler::Mesh_span&  input      = mesh_spans[span_index];
+            const std::span<const uint8_t> visibility = culler.get_visibility(span_index);
+            checks.check(visibility.size() == input.size(), "visibility has entry per input mesh");
+            checks.check(
+                std::equal(visible_spans[span_index].begin(), visible_spans[span_index].end(), parallel_spans[span_index].begin(), parallel_spans[span_index].end()),
+                "serial and parallel culling agree"
+            );
+            std::size_t output_index = 0;
+            for (std::size_t i = 0; i < input.size(); ++i) {
+                const Mesh& mesh      = *input[i];
+                const bool  in_output = (output_index < visible_spans[span_index].size()) && (visible_spans[span_index][output_index].get() == &mesh);
+                output_index += in_output ? 1 : 0;
+                if (in_output != (visibility[i] != 0)) {
+                    ++mismatch_count;
+                    continue;
+                }
+                const int expected =
+                    !filter(mesh.get_flag_bits())
+                        ? 0
+                        : (mesh.get_primitives().front().geometry_primitive == unbounded_primitive)
+                            ? 1
+                            : reference_visibility(frustum, mesh);
+                if ((expected >= 0) && ((expected == 1) != in_output)) {
+                    ++mismatch_count;
+                }
+            }
+            checks.check(output_index == visible_spans[span_index].size(), "output lists keep input order");
+        }
+        checks.check(mismatch_count == 0, "culling matches reference for " + camera.name);
+        checks.check(statistics.mesh_count == meshes.size(), "statistics count all meshes");
+        checks.check(statistics.visible_mesh_count + statistics.culled_mesh_count + statistics.filtered_mesh_count == meshes.size(), "statistics add up");
+        checks.check(statistics.unbounded_mesh_count == expected_unbounded, "unbounded meshes are kept");
+        checks.check(statistics.filtered_mesh_count == expected_filtered, "hidden meshes are filtered");
+
+        if (camera.name.starts_with("light")) {
+            light_visible_total += statistics.visible_mesh_count;
+            for (std::size_t span_index = 0; span_index < mesh_spans.size(); ++span_index) {
+                const std::span<const uint8_t> visibility = culler.get_visibility(span_index);
+                for (std::size_t i = 0; i < visibility.size(); ++i) {
+                    any_light_visibility[span_index][i] |= visibility[i];
+                }
+            }
+        }
+        fmt::print(
+            "{:<18} {:10} {:8} {:11.3f} {:9.3f} {:9.1f}\n",
+            camera.name, statistics.visible_mesh_count, statistics.culled_mesh_count,
+            1000.0 * serial_seconds, 1000.0 * pool_seconds,
+            1.0e9 * serial_seconds / static_cast<double>(meshes.size())
+        );
+    }
+
+    // Shadow_renderer entries per frame: before, primitives and draws were
+    // written per light for meshes visible to that light. Now primitives are
+    // written once for meshes visible to any light, and each light writes
+    // draws for those, with zero instance count when not visible.
+    std::size_t any_light_visible = 0;
+    for (const std::vector<uint8_t>& visibility : any_light_visibility) {
+        any_light_visible += static_cast<std::size_t>(std::count(visibility.begin(), visibility.end(), uint8_t{1}));
+    }
+    checks.check(any_light_visible <= light_visible_total, "shared shadow primitives do not exceed per light primitives");
+    fmt::print(
+        "shadow maps, {} lights: primitive entries per light {}, shared {}; draw commands per light {}, shared {}\n",
+        light_count, light_visible_total, any_light_visible, light_visible_total, light_count * any_light_visible
+    );
+
+    return checks.get_exit_code();
+}
@@ -0,0 +1,158 @@
+// Measures Geometry::build_edges() and find_edge() on million polygon
+// meshes: a closed quad grid (torus topology) and a triangle soup with
+// random point indices, which is non-manifold and inconsistently wound.
+
+#include "benchmark.hpp"
+
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_log/log.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+
+using erhe::geometry::Edge;
+using erhe::geometry::Geometry;
+using erhe::geometry::Point_id;
+
+// width x height quads, wrapping in both directions
+void make_torus_grid(Geometry& geometry, const uint32_t width, const uint32_t height)
+{
+    geometry.reserve_points  (width * height);
+    geometry.reserve_polygons(width * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            geometry.make_point(static_cast<float>(x), static_cast<float>(y), 0.0f);
+        }
+    }
+    const auto point = [width, height](const uint32_t x, const uint32_t y) -> Point_id {
+        return (y % height) * width + (x % width);
+    };
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            geometry.make_polygon({point(x, y), point(x + 1, y), point(x + 1, y + 1), point(x, y + 1)});
+        }
+    }
+}
+
+void make_triangle_soup(Geometry& geometry, const uint32_t point_count, const uint32_t triangle_count)
+{
+    std::mt19937                            random{12345u};
+    std::uniform_int_distribution<Point_id> point_distribution{0, point_count - 1};
+    geometry.reserve_points  (point_count);
+    geometry.reserve_polygons(triangle_count);
+    for (uint32_t i = 0; i < point_count; ++i) {
+        geometry.make_point(static_cast<float>(i), 0.0f, 0.0f);
+    }
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const Point_id a = point_distribution(random);
+        const Point_id b = point_distribution(random);
+        const Point_id c = point_distribution(random);
+        geometry.make_polygon({a, b, c});
+    }
+}
+
+class Edge_statistics
+{
+public:
+    std::size_t edge_count        {0};
+    std::size_t half_edge_count   {0}; // sum of edge polygon counts
+    std::size_t two_polygon_edges {0};
+    std::size_t failed_find_count {0};
+    double      build_seconds     {0.0};
+    double      find_seconds      {0.0};
+};
+
+template <typename Make>
+auto measure(const int repeat_count, Make&& make) -> Edge_statistics
+{
+    Edge_statistics statistics;
+    statistics.build_seconds = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeat_count; ++i) {
+        Geometry geometry{"edge_benchmark"};
+        make(geometry);
+        const benchmarks::Stopwatch stopwatch;
+        geometry.build_edges();
+        statistics.build_seconds = std::min(statistics.build_seconds, stopwatch.seconds());
+
+        if (i + 1 < repeat_count) {
+            continue;
+        }
+
+        statistics.edge_count = geometry.get_edge_count();
+        for (const Edge& edge : geometry.edges) {
+            statistics.half_edge_count += edge.polygon_count;
+            if (edge.polygon_count == 2) {
+                ++statistics.two_polygon_edges;
+            }
+        }
+
+        // First lookup builds the index, it is included in the time
+        const benchmarks::Stopwatch find_stopwatch;
+        for (const Edge& edge : geometry.edges) {
+            const std::optional<Edge> found = geometry.find_edge(edge.b, edge.a);
+            if (!found.has_value() || (found->first_edge_polygon_id != edge.first_edge_polygon_id)) {
+                ++statistics.failed_find_count;
+            }
+        }
+        statistics.find_seconds = find_stopwatch.seconds();
+    }
+    return statistics;
+}
+
+void print(const char* name, const std::size_t polygon_count, const Edge_statistics& statistics)
+{
+    fmt::print(
+        "{:14} {:8} polygons {:8} edges  build_edges {:8.2f} ms ({:6.1f} ns/polygon)  find_edge {:6.1f} ns/lookup\n",
+        name,
+        polygon_count,
+        statistics.edge_count,
+        1000.0 * statistics.build_seconds,
+        1e9 * statistics.build_seconds / static_cast<double>(polygon_count),
+        1e9 * statistics.find_seconds / static_cast<double>(std::max(statistics.edge_count, std::size_t{1}))
+    );
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::geometry::initialize_logging();
+
+    const uint32_t grid_size      = options.quick ? 128 : 1024; // 1M quads
+    const uint32_t soup_points    = options.quick ? 4096 : 500'000;
+    const uint32_t soup_triangles = options.quick ? 16384 : 1'000'000;
+    const int      repeat_count   = options.quick ? 1 : 3;
+
+    const std::size_t grid_polygons = std::size_t{grid_size} * grid_size;
+    const Edge_statistics grid = measure(repeat_count, [grid_size](Geometry& geometry) {
+        make_torus_grid(geometry, grid_size, grid_size);
+    });
+    print("torus grid", grid_polygons, grid);
+
+    // Closed quad mesh with torus topology: V - E + F = 0, every edge has two polygons
+    checks.check(grid.edge_count        == 2 * grid_polygons, "torus grid edge count");
+    checks.check(grid.two_polygon_edges == grid.edge_count,   "torus grid edges have two polygons");
+    checks.check(grid.half_edge_count   == 4 * grid_polygons, "torus grid half edge count");
+    checks.check(grid.failed_find_count == 0,                 "torus grid find_edge finds every edge");
+
+    const Edge_statistics soup = measure(repeat_count, [soup_points, soup_triangles](Geometry& geometry) {
+        make_triangle_soup(geometry, soup_points, soup_triangles);
+    });
+    print("triangle soup", soup_triangles, soup);
+
+    // Degenerate corners (repeated point) do not produce half edges
+    checks.check(soup.half_edge_count   <= 3 * std::size_t{soup_triangles}, "triangle soup half edge count");
+    checks.check(soup.edge_count        <= soup.half_edge_count,            "triangle soup edge count");
+    checks.check(soup.failed_find_count == 0,                               "triangle soup find_edge finds every edge");
+
+    return checks.get_exit_code();
+}
@@ -0,0 +1,243 @@
+// Writes a GLB file with position accessors to a temporary file, and loads
+// it with the previous read and copy path and with erhe::gltf::Gltf_file,
+// which memory maps the file. The previous path read the whole file to a
+// std::string, and copied it to a parser member before cgltf_parse(), so
+// the copy here follows that. Each load runs in a forked process, and
+// reports load time and ru_maxrss after opening and after reading all
+// accessors. Mapped file pages read count towards resident size as well.
+
+#include "benchmark.hpp"
+
+#include "erhe_file/file.hpp"
+#include "erhe_file/file_log.hpp"
+#include "erhe_gltf/gltf_file.hpp"
+#include "erhe_gltf/gltf_log.hpp"
+#include "erhe_log/log.hpp"
+
+extern "C" {
+    #include "cgltf.h"
+}
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t s_vertex_count_per_mesh = 65536;
+
+class Glb_file
+{
+public:
+    std::filesystem::path path;
+    std::size_t           byte_count   {0};
+    std::size_t           mesh_count   {0};
+    double                position_sum {0.0};
+};
+
+void write_u32(std::FILE* file, const uint32_t value)
+{
+    std::fwrite(&value, sizeof(value), 1, file);
+}
+
+[[nodiscard]] auto write_glb(const std::filesystem::path& path, const std::size_t mesh_count) -> Glb_file
+{
+    Glb_file result{.path = path, .mesh_count = mesh_count};
+
+    const std::size_t view_byte_count = s_vertex_count_per_mesh * 3 * sizeof(float);
+    const std::size_t bin_byte_count  = mesh_count * view_byte_count;
+    std::string buffer_views;
+    std::string accessors;
+    std::string meshes;
+    for (std::size_t i = 0; i < mesh_count; ++i) {
+        const char* separator = (i > 0) ? "," : "";
+        buffer_views += fmt::format(R"({}{{"buffer":0,"byteOffset":{},"byteLength":{}}})", separator, i * view_byte_count, view_byte_count);
+        accessors    += fmt::format(R"({}{{"bufferView":{},"componentType":5126,"count":{},"type":"VEC3"}})", separator, i, s_vertex_count_per_mesh);
+        meshes       += fmt::format(R"({}{{"primitives":[{{"attributes":{{"POSITION":{}}},"mode":0}}]}})", separator, i);
+    }
+    std::string json = fmt::format(
+        R"({{"asset":{{"version":"2.0"}},"buffers":[{{"byteLength":{}}}],"bufferViews":[{}],"accessors":[{}],"meshes":[{}]}})",
+        bin_byte_count, buffer_views, accessors, meshes
+    );
+    while ((json.size() % 4) != 0) {
+        json.push_back(' ');
+    }
+
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (file == nullptr) {
+        return result;
+    }
+    const std::size_t byte_count = 12 + 8 + json.size() + 8 + bin_byte_count;
+    write_u32(file, 0x46546C67u); // glTF
+    write_u32(file, 2);
+    write_u32(file, static_cast<uint32_t>(byte_count));
+    write_u32(file, static_cast<uint32_t>(json.size()));
+    write_u32(file, 0x4E4F534Au); // JSON
+    std::fwrite(json.data(), 1, json.size(), file);
+    write_u32(file, static_cast<uint32_t>(bin_byte_count));
+    write_u32(file, 0x004E4942u); // BIN
+
+    std::vector<float> positions(s_vertex_count_per_mesh * 3);
+    for (std::size_t i = 0; i < mesh_count; ++i) {
+        for (std::size_t j = 0; j < positions.size(); ++j) {
+            positions[j] = static_cast<float>((i + j) % 1024);
+            result.position_sum += static_cast<double>(positions[j]);
+        }
+        std::fwrite(positions.data(), sizeof(float), positions.size(), file);
+    }
+    std::fclose(file);
+    result.byte_count = byte_count;
+    return result;
+}
+
+[[nodiscard]] auto get_max_rss_mib() -> double
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) / 1024.0; // ru_maxrss is in KiB
+}
+
+[[nodiscard]] auto read_positions(const cgltf_data* data) -> double
+{
+    double sum = 0.0;
+    for (cgltf_size i = 0; i < data->accessors_count; ++i) {
+        const cgltf_accessor* accessor = &data->accessors[i];
+        float value[3];
+        for (cgltf_size j = 0; j < accessor->count; ++j) {
+            cgltf_accessor_read_float(accessor, j, &value[0], 3);
+            sum += static_cast<double>(value[0]) + static_cast<double>(value[1]) + static_cast<double>(value[2]);
+        }
+    }
+    return sum;
+}
+
+class Result
+{
+public:
+    bool   ok              {false};
+    double open_ms         {0.0};
+    double open_max_rss_mib{0.0};
+    double total_ms        {0.0};
+    double max_rss_mib     {0.0};
+    double position_sum    {0.0};
+};
+
+[[nodiscard]] auto load_read_and_copy(const std::filesystem::path& path) -> Result
+{
+    Result result;
+    benchmarks::Stopwatch stopwatch;
+    const std::optional<std::string> file_contents = erhe::file::read("GLTF file", path);
+    if (!file_contents.has_value()) {
+        return result;
+    }
+    const std::string   contents = file_contents.value();
+    const cgltf_options options{};
+    cgltf_data*         data = nullptr;
+    if (cgltf_parse(&options, contents.data(), contents.size(), &data) != cgltf_result_success) {
+        return result;
+    }
+    const std::string path_string = erhe::file::to_string(path);
+    if (cgltf_load_buffers(&options, data, path_string.c_str()) == cgltf_result_success) {
+        result.open_ms          = stopwatch.milliseconds();
+        result.open_max_rss_mib = get_max_rss_mib();
+        result.position_sum     = read_positions(data);
+        result.total_ms         = stopwatch.milliseconds();
+        result.max_rss_mib      = get_max_rss_mib();
+        result.ok               = true;
+    }
+    cgltf_free(data);
+    return result;
+}
+
+[[nodiscard]] auto load_mapped(const std::filesystem::path& path) -> Result
+{
+    Result result;
+    benchmarks::Stopwatch stopwatch;
+    erhe::gltf::Gltf_file file;
+    if (!file.open(path, true)) {
+        return result;
+    }
+    result.open_ms          = stopwatch.milliseconds();
+    result.open_max_rss_mib = get_max_rss_mib();
+    result.position_sum     = read_positions(file.get_data());
+    result.total_ms         = stopwatch.milliseconds();
+    result.max_rss_mib      = get_max_rss_mib();
+    result.ok               = true;
+    return result;
+}
+
+// Runs load in a child process, so that ru_maxrss is not shared between loads
+template <typename F>
+[[nodiscard]] auto run_forked(F&& load) -> Result
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return {};
+    }
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        const Result result = load();
+        const bool   ok     = write(fds[1], &result, sizeof(result)) == static_cast<ssize_t>(sizeof(result));
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    Result result;
+    if (read(fds[0], &result, sizeof(result)) != static_cast<ssize_t>(sizeof(result))) {
+        result = Result{};
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        result.ok = false;
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::file::initialize_logging();
+    erhe::gltf::initialize_logging();
+
+    // 768 KiB of positions per mesh
+    const std::size_t mesh_count = options.quick ? 16 : 1365;
+    const Glb_file    glb_file   = write_glb(std::filesystem::temp_directory_path() / "erhe_gltf_load_benchmark.glb", mesh_count);
+
+    const Result read_and_copy = run_forked([&]() { return load_read_and_copy(glb_file.path); });
+    const Result mapped        = run_forked([&]() { return load_mapped(glb_file.path); });
+    std::filesystem::remove(glb_file.path);
+
+    constexpr double mib = 1024.0 * 1024.0;
+    fmt::print("{} meshes, {:.1f} MiB GLB\n", mesh_count, static_cast<double>(glb_file.byte_count) / mib);
+    fmt::print("{:<14} {:>8} {:>14} {:>9} {:>13}\n", "", "open ms", "open RSS MiB", "total ms", "peak RSS MiB");
+    const auto print_row = [](const char* label, const Result& result) {
+        fmt::print(
+            "{:<14} {:>8.1f} {:>14.1f} {:>9.1f} {:>13.1f}\n",
+            label, result.open_ms, result.open_max_rss_mib, result.total_ms, result.max_rss_mib
+        );
+    };
+    print_row("read and copy", read_and_copy);
+    print_row("mapped",        mapped);
+
+    benchmarks::Checks checks;
+    checks.check(glb_file.byte_count > 0,                          "GLB file was not written");
+    checks.check(read_and_copy.ok,                                 "read and copy load failed");
+    checks.check(mapped.ok,                                        "mapped load failed");
+    checks.check(read_and_copy.position_sum == glb_file.position_sum, "read and copy positions differ");
+    checks.check(mapped.position_sum == glb_file.position_sum,     "mapped positions differ");
+    checks.check(mapped.open_max_rss_mib < read_and_copy.open_max_rss_mib, "mapped open is not smaller than read and copy");
+    return checks.get_exit_code();
+}
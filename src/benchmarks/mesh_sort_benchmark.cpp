@@ -0,0 +1,266 @@
+// Sorts meshes of four mesh layer spans with Mesh_sorter, and counts draw
+// ranges and material changes before and after sorting. Then walks the
+// camera slowly through the scene, sorting on every frame and with order
+// reuse, and counts full sorts and list positions which changed from the
+// previous frame; renderers rewrite buffer entries of those. Output order
+// is checked: opaque materials form one run each, translucent meshes come
+// last and back to front, and kept orders still satisfy both.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_item/item.hpp"
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_primitive/material.hpp"
+#include "erhe_primitive/primitive.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/mesh_sorter.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Mesh;
+using erhe::scene::Mesh_sorter;
+using erhe::scene::Node;
+
+constexpr std::size_t s_material_count = 24;
+
+class Order_check
+{
+public:
+    bool        materials_grouped{true};
+    bool        translucent_last {true};
+    bool        back_to_front    {true};
+    std::size_t material_changes {0};
+};
+
+auto material_of(const Mesh& mesh) -> uint32_t
+{
+    return mesh.get_primitives().front().material->material_buffer_index;
+}
+
+auto check_order(const Mesh_sorter::Mesh_span sorted, const glm::vec3 view_position) -> Order_check
+{
+    Order_check        result;
+    std::set<uint32_t> finished_materials;
+    bool               in_translucent               {false};
+    uint32_t           previous_material            {0};
+    float              previous_translucent_distance{0.0f};
+    for (std::size_t i = 0, end = sorted.size(); i < end; ++i) {
+        const Mesh&     mesh        = *sorted[i];
+        const bool      translucent = (mesh.get_flag_bits() & erhe::Item_flags::translucent) != 0;
+        const uint32_t  material    = material_of(mesh);
+        const glm::vec3 delta       = glm::vec3{mesh.get_node()->position_in_world()} - view_position;
+        const float     distance    = glm::dot(delta, delta);
+        if ((i > 0) && (material != previous_material)) {
+            ++result.material_changes;
+        }
+        if (translucent) {
+            // Keys keep 15 mantissa bits of squared distance
+            if (in_translucent && (distance > previous_translucent_distance * (1.0f + 1.0f / 16384.0f))) {
+                result.back_to_front = false;
+            }
+            in_translucent                = true;
+            previous_translucent_distance = distance;
+        } else {
+            if (in_translucent) {
+                result.translucent_last = false;
+            }
+            if ((i > 0) && (material != previous_material)) {
+                if (finished_materials.count(material) != 0) {
+                    result.materials_grouped = false;
+                }
+                finished_materials.insert(previous_material);
+            }
+        }
+        previous_material = material;
+    }
+    return result;
+}
+
+class Walk_result
+{
+public:
+    std::size_t frames_sorted            {0};
+    std::size_t frames_translucent_sorted{0};
+    std::size_t changed_positions        {0};
+    bool        all_orders_valid         {true};
+    double      ms_per_frame             {0.0};
+};
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const std::size_t group_count = options.quick ? 8  : 64;
+    const std::size_t group_size  = 300;
+    const std::size_t span_count  = 4;
+    const int         frame_count = options.quick ? 30 : 240;
+    const float       camera_step = 0.05f;
+
+    std::vector<std::shared_ptr<erhe::primitive::Material>> materials;
+    for (std::size_t i = 0; i < s_material_count; ++i) {
+        auto material = std::make_shared<erhe::primitive::Material>();
+        material->material_buffer_index = static_cast<uint32_t>(i);
+        materials.push_back(material);
+    }
+
+    // Meshes are spread to spans as mesh layers would hold them, with
+    // materials interleaved, so that input order changes material often
+    benchmarks::Benchmark_scene                     host{"mesh sort"};
+    std::vector<std::vector<std::shared_ptr<Mesh>>> span_meshes(span_count);
+    std::size_t                                     translucent_count = 0;
+    std::size_t                                     mesh_index        = 0;
+    for (std::size_t group_index = 0; group_index < group_count; ++group_index) {
+        auto group = std::make_shared<Node>("group");
+        group->set_parent(host.get_root_node());
+        for (std::size_t i = 0; i < group_size; ++i, ++mesh_index) {
+            auto node = std::make_shared<Node>("node");
+            node->set_parent_from_node(
+                erhe::scene::Trs_transform{
+                    glm::vec3{
+                        static_cast<float>(i % 20) * 2.0f,
+                        static_cast<float>(group_index),
+                        static_cast<float>(i / 20) * 2.0f
+                    }
+                }
+            );
+            node->set_parent(group);
+            node->enable_flag_bits(erhe::Item_flags::visible);
+            auto mesh = std::make_shared<Mesh>("mesh");
+            mesh->add_primitive(
+                erhe::primitive::Primitive{
+                    .material           = materials[(mesh_index * 7) % s_material_count],
+                    .geometry_primitive = {}
+                }
+            );
+            node->attach(mesh);
+            if ((mesh_index % 10) == 0) {
+                mesh->enable_flag_bits(erhe::Item_flags::translucent);
+                ++translucent_count;
+            }
+            span_meshes[mesh_index % span_count].push_back(mesh);
+        }
+    }
+    host.get_scene().update_node_transforms();
+
+    std::vector<Mesh_sorter::Mesh_span> spans;
+    for (const auto& meshes : span_meshes) {
+        spans.emplace_back(meshes);
+    }
+    const erhe::Item_filter filter{
+        .require_all_bits_set           = erhe::Item_flags::visible,
+        .require_at_least_one_bit_set   = 0u,
+        .require_all_bits_clear         = 0u,
+        .require_at_least_one_bit_clear = 0u
+    };
+
+    benchmarks::Checks checks;
+
+    // Single sort - draw ranges and material changes
+    const glm::vec3 start_position{19.0f, static_cast<float>(group_count) * 0.5f, -10.0f};
+    Mesh_sorter     sorter;
+    const auto      sorted     = sorter.sort(start_position, spans, filter);
+    const auto      statistics = sorter.get_statistics();
+    const auto      order      = check_order(sorted, start_position);
+    const double    sort_ms    = 1000.0 * benchmarks::measure_min(
+        options.quick ? 2 : 10,
+        [&]() {
+            sorter.set_resort_distance(0.0f);
+            sorter.sort(start_position, spans, filter);
+        }
+    );
+    checks.check(statistics.mesh_count == mesh_index,        "sorted list does not have all meshes");
+    checks.check(statistics.input_range_count == span_count, "input draw ranges");
+    checks.check(statistics.output_range_count == 1,         "output draw ranges");
+    checks.check(order.materials_grouped,                    "opaque materials are not grouped");
+    checks.check(order.translucent_last,                     "translucent meshes are not last");
+    checks.check(order.back_to_front,                        "translucent meshes are not back to front");
+    checks.check(order.material_changes == statistics.output_material_changes, "material change count");
+
+    fmt::print("{} meshes ({} translucent), {} materials, {} spans\n", mesh_index, translucent_count, s_material_count, span_count);
+    fmt::print("{:<24} {:>12} {:>18}\n", "", "draw ranges", "material changes");
+    fmt::print("{:<24} {:>12} {:>18}\n", "input",  statistics.input_range_count,  statistics.input_material_changes);
+    fmt::print("{:<24} {:>12} {:>18}\n", "sorted", statistics.output_range_count, statistics.output_material_changes);
+    fmt::print("sort {:.3f} ms\n", sort_ms);
+
+    // Camera walk
+    const auto walk = [&](const float resort_distance) -> Walk_result {
+        Walk_result        result;
+        Mesh_sorter        walk_sorter;
+        std::vector<Mesh*> previous_list;
+        std::vector<Mesh*> list;
+        walk_sorter.set_resort_distance(resort_distance);
+        benchmarks::Stopwatch stopwatch;
+        double                seconds{0.0};
+        for (int frame = 0; frame < frame_count; ++frame) {
+            const glm::vec3 view_position = start_position + glm::vec3{camera_step * static_cast<float>(frame), 0.0f, 0.0f};
+            stopwatch.restart();
+            const auto walk_sorted = walk_sorter.sort(view_position, spans, filter);
+            seconds += stopwatch.seconds();
+
+            const auto& walk_statistics = walk_sorter.get_statistics();
+            if (walk_statistics.translucent_resorted) {
+                ++result.frames_translucent_sorted;
+            } else if (!walk_statistics.order_reused) {
+                ++result.frames_sorted;
+            }
+            list.clear();
+            for (const auto& mesh : walk_sorted) {
+                list.push_back(mesh.get());
+            }
+            if (frame > 0) {
+                for (std::size_t i = 0, end = list.size(); i < end; ++i) {
+                    result.changed_positions += (list[i] != previous_list[i]) ? 1 : 0;
+                }
+            }
+            std::swap(list, previous_list);
+
+            const auto walk_order = check_order(walk_sorted, view_position);
+            if (!walk_order.materials_grouped || !walk_order.translucent_last || !walk_order.back_to_front) {
+                result.all_orders_valid = false;
+            }
+        }
+        result.ms_per_frame = 1000.0 * seconds / static_cast<double>(frame_count);
+        return result;
+    };
+
+    const Walk_result every_frame = walk(0.0f);
+    const Walk_result reuse       = walk(1.0f);
+    fmt::print("camera walk of {} frames, {} units per frame\n", frame_count, camera_step);
+    const auto print_walk = [&](const char* label, const Walk_result& result) {
+        fmt::print(
+            "{:<20} {:>12} {:>18} {:>20.1f} {:>10.3f}\n",
+            label,
+            result.frames_sorted,
+            result.frames_translucent_sorted,
+            static_cast<double>(result.changed_positions) / static_cast<double>(frame_count - 1),
+            result.ms_per_frame
+        );
+    };
+    fmt::print("{:<20} {:>12} {:>18} {:>20} {:>10}\n", "", "full sorts", "translucent sorts", "changed pos / frame", "ms/frame");
+    print_walk("sort every frame", every_frame);
+    print_walk("reuse within 1 unit", reuse);
+
+    checks.check(every_frame.all_orders_valid, "orders sorted every frame are not valid");
+    checks.check(reuse.all_orders_valid,       "kept orders are not valid");
+    checks.check(reuse.frames_sorted < every_frame.frames_sorted, "order is not reused");
+    checks.check(reuse.changed_positions < every_frame.changed_positions, "reuse does not keep list positions");
+    return checks.get_exit_code();
+}
@@ -0,0 +1,258 @@
+// Connects 1000 clients to erhe::net::Server over loopback, and measures
+// messages per second received by the server and latency from client send
+// to server receive handler, with epoll and select() poll backends. Clients
+// run in a forked process, so that server sockets stay below FD_SETSIZE
+// for select(). Clients write packet headers like erhe::net::Socket.
+//
+// Then checks that a client sending a packet larger than the configured
+// receive buffer is disconnected, instead of the connection stalling with
+// full receive buffer.
+
+#include "benchmark.hpp"
+
+#include "erhe_log/log.hpp"
+#include "erhe_net/net_log.hpp"
+#include "erhe_net/net_os.hpp"
+#include "erhe_net/server.hpp"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using erhe::net::Poll_backend;
+using erhe::net::Server;
+
+constexpr uint32_t s_header_magic = 0x45'72'68'65u; // "Erhe", as in erhe::net::Packet_header
+constexpr int      s_port         = 34561;
+
+class Message
+{
+public:
+    int64_t  send_time_ns{0};
+    uint32_t client      {0};
+    uint32_t sequence    {0};
+    uint8_t  padding[48] {};
+};
+
+class Packet
+{
+public:
+    uint32_t magic {s_header_magic};
+    uint32_t length{sizeof(Message)};
+    Message  message;
+};
+
+[[nodiscard]] auto now_ns() -> int64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+[[nodiscard]] auto connect_to_server() -> SOCKET
+{
+    const SOCKET socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(s_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        closesocket(socket);
+        return INVALID_SOCKET;
+    }
+    return socket;
+}
+
+[[nodiscard]] auto send_all(const SOCKET socket, const void* const data, const std::size_t byte_count) -> bool
+{
+    const uint8_t* bytes     = static_cast<const uint8_t*>(data);
+    std::size_t    remaining = byte_count;
+    while (remaining > 0) {
+        const ssize_t result = ::send(socket, bytes, remaining, MSG_NOSIGNAL);
+        if (result <= 0) {
+            return false;
+        }
+        bytes     += result;
+        remaining -= static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+// Client process. Each round, every client sends one message.
+[[nodiscard]] auto run_clients(const std::size_t client_count, const std::size_t round_count) -> int
+{
+    std::vector<SOCKET> sockets;
+    for (std::size_t i = 0; i < client_count; ++i) {
+        const SOCKET socket = connect_to_server();
+        if (socket == INVALID_SOCKET) {
+            return 1;
+        }
+        sockets.push_back(socket);
+    }
+    Packet packet;
+    for (std::size_t round = 0; round < round_count; ++round) {
+        for (std::size_t i = 0; i < client_count; ++i) {
+            packet.message.send_time_ns = now_ns();
+            packet.message.client       = static_cast<uint32_t>(i);
+            packet.message.sequence     = static_cast<uint32_t>(round);
+            if (!send_all(sockets[i], &packet, sizeof(packet))) {
+                return 1;
+            }
+        }
+    }
+    for (const SOCKET socket : sockets) {
+        closesocket(socket);
+    }
+    return 0;
+}
+
+class Result
+{
+public:
+    std::size_t received_count{0};
+    std::size_t max_clients   {0};
+    double      messages_per_s{0.0};
+    double      p50_us        {0.0};
+    double      p99_us        {0.0};
+    bool        ok            {false};
+};
+
+[[nodiscard]] auto run(const Poll_backend poll_backend, const std::size_t client_count, const std::size_t round_count) -> Result
+{
+    Result               result;
+    const std::size_t    expected_count = client_count * round_count;
+    std::vector<int64_t> latencies_ns;
+    latencies_ns.reserve(expected_count);
+    int64_t first_send_ns   {std::numeric_limits<int64_t>::max()};
+    int64_t last_receive_ns {0};
+
+    Server server{poll_backend};
+    server.set_receive_handler(
+        [&](const uint8_t* const data, const std::size_t length) {
+            if (length != sizeof(Message)) {
+                return;
+            }
+            Message message;
+            std::memcpy(&message, data, sizeof(Message));
+            last_receive_ns = now_ns();
+            first_send_ns   = std::min(first_send_ns, message.send_time_ns);
+            latencies_ns.push_back(last_receive_ns - message.send_time_ns);
+        }
+    );
+    if (!server.listen("127.0.0.1", s_port)) {
+        return result;
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        _exit(run_clients(client_count, round_count));
+    }
+
+    const int64_t timeout_ns = now_ns() + 60'000'000'000;
+    while ((latencies_ns.size() < expected_count) && (now_ns() < timeout_ns)) {
+        server.poll(10);
+        result.max_clients = std::max(result.max_clients, server.get_client_count());
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    server.disconnect();
+
+    result.received_count = latencies_ns.size();
+    result.ok = WIFEXITED(status) && (WEXITSTATUS(status) == 0) && (result.received_count == expected_count);
+    if (latencies_ns.empty()) {
+        return result;
+    }
+    result.messages_per_s = static_cast<double>(latencies_ns.size()) * 1.0e9 / static_cast<double>(std::max<int64_t>(1, last_receive_ns - first_send_ns));
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    result.p50_us = static_cast<double>(latencies_ns[latencies_ns.size() / 2]) / 1000.0;
+    result.p99_us = static_cast<double>(latencies_ns[(latencies_ns.size() * 99) / 100]) / 1000.0;
+    return result;
+}
+
+// Sends a packet which does not fit to server receive buffer. Returns true
+// if server closes the connection.
+[[nodiscard]] auto oversized_packet_disconnects() -> bool
+{
+    constexpr std::size_t receive_buffer_size = 64 * 1024;
+
+    Server server{Poll_backend::epoll};
+    server.set_buffer_sizes(receive_buffer_size, receive_buffer_size);
+    if (!server.listen("127.0.0.1", s_port)) {
+        return false;
+    }
+    const SOCKET socket = connect_to_server();
+    if (socket == INVALID_SOCKET) {
+        return false;
+    }
+    erhe::net::set_socket_option(socket, erhe::net::Socket_option::NonBlocking, true);
+
+    std::vector<uint8_t> packet(8 + 4 * receive_buffer_size);
+    const uint32_t header[2]{s_header_magic, static_cast<uint32_t>(packet.size() - 8)};
+    std::memcpy(packet.data(), header, sizeof(header));
+
+    std::size_t   sent_byte_count{0};
+    bool          seen_client    {false};
+    bool          disconnected   {false};
+    const int64_t timeout_ns = now_ns() + 5'000'000'000;
+    while (!disconnected && (now_ns() < timeout_ns)) {
+        if (sent_byte_count < packet.size()) {
+            const ssize_t result = ::send(socket, packet.data() + sent_byte_count, packet.size() - sent_byte_count, MSG_NOSIGNAL);
+            if (result > 0) {
+                sent_byte_count += static_cast<std::size_t>(result);
+            }
+        }
+        server.poll(1);
+        seen_client  = seen_client || (server.get_client_count() > 0);
+        disconnected = seen_client && (server.get_client_count() == 0);
+    }
+    closesocket(socket);
+    return disconnected;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::net::initialize_logging();
+
+    // Server and client processes each have a socket per client
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    const std::size_t client_count = options.quick ? 100 : 1000;
+    const std::size_t round_count  = options.quick ? 10  : 100;
+
+    const Result epoll  = run(Poll_backend::epoll,  client_count, round_count);
+    const Result select = run(Poll_backend::select, client_count, round_count);
+    const bool   oversized_closed = oversized_packet_disconnects();
+
+    fmt::print("{} clients, {} messages of {} bytes each\n", client_count, round_count, sizeof(Packet));
+    fmt::print("{:<8} {:>10} {:>14} {:>10} {:>10}\n", "", "clients", "messages/s", "p50 us", "p99 us");
+    const auto print_row = [](const char* label, const Result& result) {
+        fmt::print("{:<8} {:>10} {:>14.0f} {:>10.1f} {:>10.1f}\n", label, result.max_clients, result.messages_per_s, result.p50_us, result.p99_us);
+    };
+    print_row("epoll",  epoll);
+    print_row("select", select);
+    fmt::print("oversized packet {}\n", oversized_closed ? "closed connection" : "did not close connection");
+
+    benchmarks::Checks checks;
+    checks.check(epoll.ok,  "epoll server did not receive all messages");
+    checks.check(select.ok, "select server did not receive all messages");
+    checks.check(oversized_closed, "packet larger than receive buffer did not close connection");
+    return checks.get_exit_code();
+}
@@ -0,0 +1,148 @@
+// Writes a Wavefront OBJ quad grid with positions, texture coordinates and
+// normals to a temporary file, and parses it with editor's
+// parse_obj_geometry(), serially and with a thread pool. Parse throughput
+// covers reading text to vertex and face arrays; total includes building
+// geometries and their post processing. The file also has faces with
+// invalid vertex indices, which must be skipped as whole faces.
+
+#include "benchmark.hpp"
+
+#include "editor_log.hpp"
+#include "parsers/wavefront_obj.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_file/file_log.hpp"
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_log/log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class Obj_file
+{
+public:
+    std::filesystem::path path;
+    std::size_t           valid_face_count  {0};
+    std::size_t           invalid_face_count{0};
+};
+
+[[nodiscard]] auto write_grid(const std::filesystem::path& path, const std::size_t size) -> Obj_file
+{
+    Obj_file    result{.path = path};
+    std::FILE*  file = std::fopen(path.string().c_str(), "wb");
+    if (file == nullptr) {
+        return result;
+    }
+    const std::size_t vertex_row = size + 1;
+    std::string       line;
+    for (std::size_t y = 0; y <= size; ++y) {
+        for (std::size_t x = 0; x <= size; ++x) {
+            const float u = static_cast<float>(x) / static_cast<float>(size);
+            const float v = static_cast<float>(y) / static_cast<float>(size);
+            line = fmt::format("v {:.6f} {:.6f} {:.6f}\nvt {:.6f} {:.6f}\nvn 0 0 1\n", u * 10.0f, v * 10.0f, 0.01f * static_cast<float>((x * y) % 7), u, v);
+            std::fwrite(line.data(), 1, line.size(), file);
+        }
+    }
+    for (std::size_t y = 0; y < size; ++y) {
+        if ((y % 64) == 0) {
+            line = fmt::format("g rows_{}\n", y);
+            std::fwrite(line.data(), 1, line.size(), file);
+        }
+        for (std::size_t x = 0; x < size; ++x) {
+            const std::size_t a = y * vertex_row + x + 1;
+            const std::size_t b = a + 1;
+            const std::size_t c = b + vertex_row;
+            const std::size_t d = a + vertex_row;
+            line = fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2} {3}/{3}/{3}\n", a, b, c, d);
+            std::fwrite(line.data(), 1, line.size(), file);
+            ++result.valid_face_count;
+        }
+    }
+
+    // Out of range, unparseable and zero position indices, and out of
+    // range normal index
+    const char* invalid_faces =
+        "f 1 2 999999999\n"
+        "f 1 x 3\n"
+        "f 0 1 2\n"
+        "f 1//1 2//2 3//999999999\n";
+    std::fwrite(invalid_faces, 1, std::char_traits<char>::length(invalid_faces), file);
+    result.invalid_face_count = 4;
+    std::fclose(file);
+    return result;
+}
+
+class Result
+{
+public:
+    editor::Obj_parse_statistics statistics;
+    std::size_t                  polygon_count{0};
+};
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::file::initialize_logging();
+    erhe::geometry::initialize_logging();
+    editor::initialize_logging();
+
+    // Full run writes a file over 1 GiB, and needs some 4.5 GiB of memory
+    const std::size_t grid_size    = options.quick ? 100 : 2700;
+    const std::size_t worker_count = std::max<std::size_t>(1, std::thread::hardware_concurrency() - 1);
+
+    const Obj_file obj_file = write_grid(std::filesystem::temp_directory_path() / "erhe_obj_parse_benchmark.obj", grid_size);
+
+    erhe::concurrency::Thread_pool thread_pool{worker_count};
+    const auto run = [&](erhe::concurrency::Thread_pool* const pool) -> Result {
+        Result     result;
+        const auto geometries = editor::parse_obj_geometry(obj_file.path, pool, &result.statistics);
+        for (const auto& geometry : geometries) {
+            result.polygon_count += geometry->get_polygon_count();
+        }
+        return result;
+    };
+    const Result serial   = run(nullptr);
+    const Result parallel = run(&thread_pool);
+    std::filesystem::remove(obj_file.path);
+
+    constexpr double mib = 1024.0 * 1024.0;
+    fmt::print(
+        "{} x {} quad grid, {:.1f} MiB, {} workers\n",
+        grid_size, grid_size, static_cast<double>(serial.statistics.byte_count) / mib, worker_count
+    );
+    fmt::print("{:<12} {:>8} {:>10} {:>10} {:>10}\n", "", "chunks", "parse ms", "MiB/s", "total ms");
+    const auto print_row = [&](const char* label, const Result& result) {
+        const editor::Obj_parse_statistics& statistics = result.statistics;
+        fmt::print(
+            "{:<12} {:>8} {:>10.1f} {:>10.1f} {:>10.1f}\n",
+            label,
+            statistics.chunk_count,
+            statistics.parse_ms,
+            (statistics.parse_ms > 0.0) ? 1000.0 * static_cast<double>(statistics.byte_count) / mib / statistics.parse_ms : 0.0,
+            statistics.total_ms
+        );
+    };
+    print_row("serial",      serial);
+    print_row("thread pool", parallel);
+
+    benchmarks::Checks checks;
+    checks.check(serial.statistics.byte_count > 0,                                   "OBJ file was not parsed");
+    checks.check(serial.statistics.face_count == obj_file.valid_face_count + obj_file.invalid_face_count, "face count");
+    checks.check(serial.statistics.invalid_face_count == obj_file.invalid_face_count, "invalid faces are not skipped");
+    checks.check(serial.polygon_count == obj_file.valid_face_count,                  "polygon count");
+    checks.check(parallel.statistics.face_count == serial.statistics.face_count,      "thread pool face count differs");
+    checks.check(parallel.statistics.invalid_face_count == serial.statistics.invalid_face_count, "thread pool invalid face count differs");
+    checks.check(parallel.polygon_count == serial.polygon_count,                     "thread pool polygon count differs");
+    return checks.get_exit_code();
+}
@@ -0,0 +1,255 @@
+// Sweeps thread counts over the loops converted to parallel_for():
+// polygon normals and centroids of a synthetic sphere, world transforms of
+// a synthetic scene and sampling of an animation targeting its nodes.
+// Results of each thread count are compared to the serial results.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_geometry/shapes/sphere.hpp"
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_scene/animation.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::concurrency::Scheduling;
+using erhe::concurrency::Thread_pool;
+using erhe::geometry::Polygon_id;
+using erhe::geometry::Property_map;
+
+class Synthetic_scene
+{
+public:
+    Synthetic_scene(const int root_count, const int fanout)
+    {
+        const std::shared_ptr<erhe::scene::Node> scene_root = host.get_root_node();
+        for (int r = 0; r < root_count; ++r) {
+            auto root = std::make_shared<erhe::scene::Node>("root");
+            root->set_parent(scene_root);
+            roots.push_back(root);
+            nodes.push_back(root);
+            for (int c = 0; c < fanout; ++c) {
+                auto child = std::make_shared<erhe::scene::Node>("child");
+                child->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{static_cast<float>(c), 1.0f, 0.0f}});
+                child->set_parent(root);
+                nodes.push_back(child);
+                for (int g = 0; g < fanout; ++g) {
+                    auto leaf = std::make_shared<erhe::scene::Node>("leaf");
+                    leaf->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{0.0f, static_cast<float>(g), 1.0f}});
+                    leaf->set_parent(child);
+                    nodes.push_back(leaf);
+                    leaves.push_back(leaf);
+                }
+            }
+        }
+        host.get_scene().update_node_transforms();
+    }
+
+    // Moves all roots, which makes every node dirty
+    void move_roots(const float t)
+    {
+        for (std::size_t i = 0, end = roots.size(); i < end; ++i) {
+            roots[i]->set_parent_from_node(
+                erhe::scene::Trs_transform{glm::vec3{t, static_cast<float>(i), 0.0f}}
+            );
+        }
+    }
+
+    benchmarks::Benchmark_scene                     host{"parallel_loops_benchmark"};
+    std::vector<std::shared_ptr<erhe::scene::Node>> roots;
+    std::vector<std::shared_ptr<erhe::scene::Node>> nodes;
+    std::vector<std::shared_ptr<erhe::scene::Node>> leaves;
+};
+
+// Translation, rotation and scale channels for each target node
+auto make_animation(
+    const std::vector<std::shared_ptr<erhe::scene::Node>>& targets,
+    const int                                              keyframe_count
+) -> std::shared_ptr<erhe::scene::Animation>
+{
+    using erhe::scene::Animation_path;
+    auto  animation_shared = std::make_shared<erhe::scene::Animation>("parallel_loops_benchmark");
+    auto& animation        = *animation_shared;
+    for (const auto& target : targets) {
+        for (const Animation_path path : {Animation_path::TRANSLATION, Animation_path::ROTATION, Animation_path::SCALE}) {
+            const std::size_t  component_count = erhe::scene::get_component_count(path);
+            std::vector<float> timestamps;
+            std::vector<float> values;
+            for (int k = 0; k < keyframe_count; ++k) {
+                timestamps.push_back(static_cast<float>(k));
+                for (std::size_t c = 0; c < component_count; ++c) {
+                    values.push_back(((path == Animation_path::ROTATION) && (c == 3)) ? 1.0f : 0.01f * static_cast<float>(k + c));
+                }
+            }
+            erhe::scene::Animation_sampler sampler{erhe::scene::Animation_interpolation_mode::LINEAR};
+            sampler.set(std::move(timestamps), std::move(values));
+            animation.channels.push_back(
+                erhe::scene::Animation_channel{
+                    .path           = path,
+                    .sampler_index  = animation.samplers.size(),
+                    .target         = target,
+                    .start_position = 0,
+                    .value_offset   = 0
+                }
+            );
+            animation.samplers.push_back(std::move(sampler));
+        }
+    }
+    return animation_shared;
+}
+
+auto get_world_transforms(const Synthetic_scene& scene) -> std::vector<glm::mat4>
+{
+    std::vector<glm::mat4> result;
+    result.reserve(scene.nodes.size());
+    for (const auto& node : scene.nodes) {
+        result.push_back(node->world_from_node());
+    }
+    return result;
+}
+
+auto get_parent_transforms(const Synthetic_scene& scene) -> std::vector<glm::mat4>
+{
+    std::vector<glm::mat4> result;
+    result.reserve(scene.leaves.size());
+    for (const auto& node : scene.leaves) {
+        result.push_back(node->parent_from_node());
+    }
+    return result;
+}
+
+class Results
+{
+public:
+    double normals_seconds  {0.0};
+    double centroids_seconds{0.0};
+    double scene_seconds    {0.0};
+    double animation_seconds{0.0};
+};
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::geometry::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const unsigned int slice_count    = options.quick ? 64  : 1024;
+    const unsigned int stack_division = options.quick ? 16  : 256;
+    const int          root_count     = options.quick ? 32  : 1024;
+    const int          fanout         = 8;
+    const int          keyframe_count = 64;
+    const int          frame_count    = options.quick ? 4 : 32;
+    const int          repeat_count   = options.quick ? 1 : 5;
+
+    // 1, 2, 4, ... threads, at least up to two so ctest covers the parallel path
+    std::vector<std::size_t> thread_counts;
+    const std::size_t max_thread_count = std::max(2u, std::thread::hardware_concurrency());
+    for (std::size_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+        thread_counts.push_back(thread_count);
+    }
+
+    erhe::geometry::Geometry sphere = erhe::geometry::shapes::make_sphere(1.0, slice_count, stack_division);
+    const auto* const point_locations = sphere.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations);
+    if (point_locations == nullptr) {
+        fmt::print(stderr, "sphere has no point locations\n");
+        return 1;
+    }
+
+    Synthetic_scene                               scene{root_count, fanout};
+    const std::shared_ptr<erhe::scene::Animation> animation = make_animation(scene.leaves, keyframe_count);
+
+    fmt::print(
+        "parallel loops benchmark: {} polygons, {} nodes, {} animation channels\n",
+        sphere.get_polygon_count(), scene.nodes.size(), animation->channels.size()
+    );
+
+    Property_map<Polygon_id, glm::vec3> reference_normals  {erhe::geometry::c_polygon_normals};
+    Property_map<Polygon_id, glm::vec3> reference_centroids{erhe::geometry::c_polygon_centroids};
+    std::vector<glm::mat4>              reference_world_transforms;
+    std::vector<glm::mat4>              reference_parent_transforms;
+    std::vector<Results>                results;
+
+    for (const std::size_t thread_count : thread_counts) {
+        std::unique_ptr<Thread_pool> pool;
+        if (thread_count > 1) {
+            pool = std::make_unique<Thread_pool>(thread_count - 1, Scheduling::work_stealing);
+        }
+        Thread_pool* const thread_pool = pool.get();
+
+        Results r;
+        Property_map<Polygon_id, glm::vec3> normals  {erhe::geometry::c_polygon_normals};
+        Property_map<Polygon_id, glm::vec3> centroids{erhe::geometry::c_polygon_centroids};
+        r.normals_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            normals.clear();
+            sphere.compute_polygon_normals(normals, *point_locations, false, thread_pool);
+        });
+        r.centroids_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            centroids.clear();
+            sphere.compute_polygon_centroids(centroids, *point_locations, false, thread_pool);
+        });
+        r.animation_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            for (int frame = 0; frame < frame_count; ++frame) {
+                animation->apply(0.37f + static_cast<float>(frame), thread_pool);
+            }
+        }) / frame_count;
+        const std::vector<glm::mat4> parent_transforms = get_parent_transforms(scene);
+
+        // Animation leaves the same leaf transforms in every pass, so world
+        // transforms computed after it are comparable between passes
+        r.scene_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            for (int frame = 0; frame < frame_count; ++frame) {
+                scene.move_roots(static_cast<float>(frame));
+                scene.host.get_scene().update_node_transforms(thread_pool);
+            }
+        }) / frame_count;
+        const std::vector<glm::mat4> world_transforms = get_world_transforms(scene);
+
+        if (thread_count == 1) {
+            reference_normals           = normals;
+            reference_centroids         = centroids;
+            reference_world_transforms  = world_transforms;
+            reference_parent_transforms = parent_transforms;
+        } else {
+            checks.check(normals.values    == reference_normals.values,    "parallel polygon normals match serial");
+            checks.check(centroids.values  == reference_centroids.values,  "parallel polygon centroids match serial");
+            checks.check(world_transforms  == reference_world_transforms,  "parallel world transforms match serial");
+            checks.check(parent_transforms == reference_parent_transforms, "parallel animation sampling matches serial");
+        }
+        results.push_back(r);
+    }
+
+    fmt::print("threads   normals ms  centroids ms  scene ms/frame  animation ms/frame  (speedup vs 1 thread)\n");
+    for (std::size_t i = 0, end = results.size(); i < end; ++i) {
+        const Results& r    = results[i];
+        const Results& base = results.front();
+        fmt::print(
+            "{:7}  {:8.3f} {:4.2f}x  {:8.3f} {:4.2f}x  {:9.3f} {:4.2f}x  {:12.3f} {:4.2f}x\n",
+            thread_counts[i],
+            1000.0 * r.normals_seconds,   base.normals_seconds   / r.normals_seconds,
+            1000.0 * r.centroids_seconds, base.centroids_seconds / r.centroids_seconds,
+            1000.0 * r.scene_seconds,     base.scene_seconds     / r.scene_seconds,
+            1000.0 * r.animation_seconds, base.animation_seconds / r.animation_seconds
+        );
+    }
+
+    return checks.get_exit_code();
+}
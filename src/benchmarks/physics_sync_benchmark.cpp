@@ -0,0 +1,235 @@
+// Drops 10k dynamic boxes onto a static ground box in an erhe::physics
+// world, and after each simulation step applies active body transforms to
+// scene nodes, followed by Scene::update_node_transforms(). Compares the
+// previous per body path (for_each_active_body() and transform setters) with
+// get_active_body_transforms() and set_world_from_nodes(), as done by
+// Scene_root::after_physics_simulation_steps(), serially and with a thread
+// pool. Each body node has a child node, which must follow its body.
+// Requires the Jolt backend; the null backend does not simulate.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_physics/icollision_shape.hpp"
+#include "erhe_physics/irigid_body.hpp"
+#include "erhe_physics/iworld.hpp"
+#include "erhe_physics/physics_log.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+#include "erhe_scene/trs_transform.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Node;
+using erhe::scene::Node_world_transform;
+
+enum class Mode : unsigned int
+{
+    per_body = 0,
+    batch,
+    batch_thread_pool
+};
+
+class Result
+{
+public:
+    double      step_ms_per_frame{0.0};
+    double      sync_ms_per_frame{0.0};
+    std::size_t active_body_count{0}; // summed over frames
+    float       lowest_y         {0.0f};
+    bool        children_follow  {true};
+};
+
+constexpr float s_frame_dt = 1.0f / 60.0f;
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::physics::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const std::size_t body_count   = options.quick ? 1000 : 10000;
+    const int         frame_count  = options.quick ? 20   : 200;
+    const std::size_t worker_count = std::max<std::size_t>(1, std::thread::hardware_concurrency() - 1);
+    const float       start_y      = 10.0f;
+
+    erhe::concurrency::Thread_pool thread_pool{worker_count};
+
+    const auto run = [&](const Mode mode) -> Result {
+        std::unique_ptr<erhe::physics::IWorld> world = erhe::physics::IWorld::create_unique();
+        world->set_gravity(glm::vec3{0.0f, -9.81f, 0.0f});
+
+        std::shared_ptr<erhe::physics::IRigid_body> ground = world->create_rigid_body_shared(
+            erhe::physics::IRigid_body_create_info{
+                .collision_shape = erhe::physics::ICollision_shape::create_box_shape_shared(glm::vec3{200.0f, 1.0f, 200.0f}),
+                .debug_label     = "ground",
+                .motion_mode     = erhe::physics::Motion_mode::e_static
+            },
+            glm::vec3{0.0f, -1.0f, 0.0f}
+        );
+        world->add_rigid_body(ground.get());
+
+        // Bodies are grouped by 100, so that sibling scans stay short
+        benchmarks::Benchmark_scene                              host{"physics sync"};
+        erhe::scene::Scene&                                      scene = host.get_scene();
+        const std::shared_ptr<erhe::physics::ICollision_shape>   box_shape = erhe::physics::ICollision_shape::create_box_shape_shared(glm::vec3{0.5f});
+        std::vector<std::shared_ptr<erhe::physics::IRigid_body>> rigid_bodies;
+        std::vector<std::shared_ptr<Node>>                       bodies;
+        std::vector<std::shared_ptr<Node>>                       children;
+        std::shared_ptr<Node>                                    group;
+        for (std::size_t i = 0; i < body_count; ++i) {
+            if ((i % 100) == 0) {
+                group = std::make_shared<Node>("group");
+                group->set_parent(host.get_root_node());
+            }
+            const glm::vec3 position{
+                static_cast<float>(i % 100) * 1.5f - 75.0f,
+                start_y,
+                static_cast<float>(i / 100) * 1.5f - 75.0f
+            };
+            auto body = std::make_shared<Node>("body");
+            body->set_parent(group);
+            body->set_world_from_node(erhe::scene::Trs_transform{position});
+            auto child = std::make_shared<Node>("child");
+            child->set_parent_from_node(erhe::scene::Trs_transform{glm::vec3{0.0f, 1.0f, 0.0f}});
+            child->set_parent(body);
+
+            std::shared_ptr<erhe::physics::IRigid_body> rigid_body = world->create_rigid_body_shared(
+                erhe::physics::IRigid_body_create_info{
+                    .collision_shape = box_shape,
+                    .mass            = 1.0f,
+                    .debug_label     = "box",
+                    .motion_mode     = erhe::physics::Motion_mode::e_dynamic
+                },
+                position
+            );
+            rigid_body->set_owner(body.get());
+            world->add_rigid_body(rigid_body.get());
+            rigid_body->set_linear_velocity(glm::vec3{0.0f, -0.1f, 0.0f}); // activates body
+            rigid_bodies.push_back(rigid_body);
+            bodies      .push_back(body);
+            children    .push_back(child);
+        }
+        scene.update_node_transforms();
+
+        Result                                     result;
+        std::vector<erhe::physics::Body_transform> body_transforms;
+        std::vector<Node_world_transform>          node_world_transforms;
+        benchmarks::Stopwatch                      stopwatch;
+        double                                     step_seconds{0.0};
+        double                                     sync_seconds{0.0};
+        for (int frame = 0; frame < frame_count; ++frame) {
+            stopwatch.restart();
+            world->update_fixed_step(s_frame_dt);
+            step_seconds += stopwatch.seconds();
+
+            stopwatch.restart();
+            switch (mode) {
+                case Mode::per_body: {
+                    world->for_each_active_body(
+                        [&result](erhe::physics::IRigid_body* rigid_body) {
+                            if (rigid_body->get_motion_mode() != erhe::physics::Motion_mode::e_dynamic) {
+                                return;
+                            }
+                            Node* node = static_cast<Node*>(rigid_body->get_owner());
+                            node->set_world_from_node(rigid_body->get_world_transform());
+                            ++result.active_body_count;
+                        }
+                    );
+                    break;
+                }
+                case Mode::batch:
+                case Mode::batch_thread_pool: {
+                    world->get_active_body_transforms(body_transforms);
+                    node_world_transforms.clear();
+                    for (const erhe::physics::Body_transform& body_transform : body_transforms) {
+                        node_world_transforms.push_back(
+                            Node_world_transform{
+                                .node            = static_cast<Node*>(body_transform.owner),
+                                .world_from_node = body_transform.world_from_body
+                            }
+                        );
+                    }
+                    std::sort(
+                        node_world_transforms.begin(),
+                        node_world_transforms.end(),
+                        [](const Node_world_transform& lhs, const Node_world_transform& rhs) -> bool {
+                            return lhs.node->get_depth() < rhs.node->get_depth();
+                        }
+                    );
+                    erhe::scene::set_world_from_nodes(
+                        node_world_transforms,
+                        (mode == Mode::batch_thread_pool) ? &thread_pool : nullptr
+                    );
+                    result.active_body_count += body_transforms.size();
+                    break;
+                }
+            }
+            scene.update_node_transforms();
+            sync_seconds += stopwatch.seconds();
+        }
+        result.step_ms_per_frame = 1000.0 * step_seconds / static_cast<double>(frame_count);
+        result.sync_ms_per_frame = 1000.0 * sync_seconds / static_cast<double>(frame_count);
+
+        result.lowest_y = start_y;
+        for (std::size_t i = 0; i < body_count; ++i) {
+            const glm::vec3 body_position = glm::vec3{bodies[i]->position_in_world()};
+            const glm::vec3 expected      = glm::vec3{bodies[i]->world_from_node() * glm::vec4{0.0f, 1.0f, 0.0f, 1.0f}};
+            const glm::vec3 actual        = glm::vec3{children[i]->position_in_world()};
+            const glm::vec3 delta         = actual - expected;
+            if (glm::dot(delta, delta) > 1.0e-6f) {
+                result.children_follow = false;
+            }
+            result.lowest_y = std::min(result.lowest_y, body_position.y);
+        }
+
+        for (const auto& rigid_body : rigid_bodies) {
+            world->remove_rigid_body(rigid_body.get());
+        }
+        world->remove_rigid_body(ground.get());
+        return result;
+    };
+
+    const Result per_body          = run(Mode::per_body);
+    const Result batch             = run(Mode::batch);
+    const Result batch_thread_pool = run(Mode::batch_thread_pool);
+
+    fmt::print("{} falling boxes, each with a child node, {} frames, {} workers\n", body_count, frame_count, worker_count);
+    fmt::print("{:<34} {:>12} {:>12} {:>20}\n", "", "step ms", "sync ms", "active bodies/frame");
+    const auto print_row = [&](const char* label, const Result& result) {
+        fmt::print(
+            "{:<34} {:>12.3f} {:>12.3f} {:>20.0f}\n",
+            label,
+            result.step_ms_per_frame,
+            result.sync_ms_per_frame,
+            static_cast<double>(result.active_body_count) / static_cast<double>(frame_count)
+        );
+    };
+    print_row("per body setters",                  per_body);
+    print_row("set_world_from_nodes",              batch);
+    print_row("set_world_from_nodes, thread pool", batch_thread_pool);
+
+    benchmarks::Checks checks;
+    checks.check(batch.active_body_count > 0,                            "no active bodies");
+    checks.check(batch.lowest_y < start_y - 0.5f,                         "bodies did not fall");
+    checks.check(per_body.children_follow,                               "child nodes do not follow bodies with setters");
+    checks.check(batch.children_follow,                                  "child nodes do not follow bodies with set_world_from_nodes()");
+    checks.check(batch_thread_pool.children_follow,                      "child nodes do not follow bodies with thread pool");
+    return checks.get_exit_code();
+}
@@ -0,0 +1,412 @@
+// Measures closest hit ray queries against scenes of 10k and 100k
+// instances, using the Bvh_tlas top level BVH and the linear scan over all
+// instances which Bvh_scene used before. Each instance is a sphere; its
+// analytic intersection stands in for the per-instance bottom level BVH,
+// so the benchmark runs on CPU without meshes. Build and refit of the
+// TLAS are measured too. TLAS results are compared to the linear scan.
+//
+// Batch throughput of a camera ray grid is then measured in Mrays/s for
+// single ray and packet traversal, closest hit and occlusion queries, and
+// multithreaded dispatch with the chunk size IScene batches use.
+
+#include "benchmark.hpp"
+
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
+#include "erhe_raytrace/ray.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::concurrency::Thread_pool;
+using erhe::raytrace::Aabb;
+using erhe::raytrace::Bvh_tlas;
+using erhe::raytrace::Ray;
+
+constexpr uint32_t c_no_hit = std::numeric_limits<uint32_t>::max();
+
+class Instance
+{
+public:
+    glm::vec3 center;
+    float     radius;
+};
+
+class Scene
+{
+public:
+    Scene(const std::size_t instance_count, const float extent)
+    {
+        std::mt19937                          random{1234u};
+        std::uniform_real_distribution<float> position{-extent, extent};
+        std::uniform_real_distribution<float> radius  {0.2f, 1.0f};
+        instances.resize(instance_count);
+        for (Instance& instance : instances) {
+            instance.center = glm::vec3{position(random), position(random), position(random)};
+            instance.radius = radius(random);
+        }
+        update_bounds();
+    }
+
+    void update_bounds()
+    {
+        bounds.resize(instances.size());
+        for (std::size_t i = 0, end = instances.size(); i < end; ++i) {
+            bounds[i] = Aabb{instances[i].center - glm::vec3{instances[i].radius}, instances[i].center + glm::vec3{instances[i].radius}};
+        }
+    }
+
+    // Instance query as Bvh_instance::intersect() does it: ray to instance
+    // space, local bounds test, then the instance geometry. Shortens ray.t_far.
+    [[nodiscard]] auto intersect_instance(Ray& ray, const uint32_t index) const -> bool
+    {
+        const Instance& instance       = instances[index];
+        const float     inverse_scale  = 1.0f / instance.radius;
+        const glm::vec3 local_origin   = (ray.origin - instance.center) * inverse_scale;
+        const glm::vec3 local_direction = ray.direction * inverse_scale;
+
+        // Local bounds are [-1, 1]
+        float enter = ray.t_near;
+        float exit  = ray.t_far;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float inverse_d = 1.0f / local_direction[axis];
+            const float t0        = (-1.0f - local_origin[axis]) * inverse_d;
+            const float t1        = ( 1.0f - local_origin[axis]) * inverse_d;
+            enter = std::max(enter, std::min(t0, t1));
+            exit  = std::min(exit,  std::max(t0, t1));
+        }
+        if (enter > exit) {
+            return false;
+        }
+
+        // Unit sphere
+        const float a            = glm::dot(local_direction, local_direction);
+        const float b            = glm::dot(local_origin, local_direction);
+        const float c            = glm::dot(local_origin, local_origin) - 1.0f;
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) {
+            return false;
+        }
+        const float t = (-b - std::sqrt(discriminant)) / a;
+        if ((t < ray.t_near) || (t > ray.t_far)) {
+            return false;
+        }
+        ray.t_far = t;
+        return true;
+    }
+
+    std::vector<Instance> instances;
+    std::vector<Aabb>     bounds;
+};
+
+class Hit_record
+{
+public:
+    uint32_t instance{c_no_hit};
+    float    t       {0.0f};
+};
+
+// Bvh_scene::intersect() before the TLAS: every instance, in order
+auto intersect_linear(const Scene& scene, Ray ray) -> Hit_record
+{
+    Hit_record hit;
+    for (uint32_t i = 0, end = static_cast<uint32_t>(scene.instances.size()); i < end; ++i) {
+        if (scene.intersect_instance(ray, i)) {
+            hit.instance = i;
+        }
+    }
+    hit.t = ray.t_far;
+    return hit;
+}
+
+auto intersect_tlas(const Scene& scene, const Bvh_tlas& tlas, Ray ray) -> Hit_record
+{
+    Hit_record hit;
+    tlas.traverse(ray, [&](const uint32_t primitive) {
+        if (scene.intersect_instance(ray, primitive)) {
+            hit.instance = primitive;
+        }
+        return false;
+    });
+    hit.t = ray.t_far;
+    return hit;
+}
+
+// Hover style rays from a camera outside the scene towards random points in it
+auto make_rays(const std::size_t ray_count, const float extent) -> std::vector<Ray>
+{
+    std::mt19937                          random{5678u};
+    std::uniform_real_distribution<float> target{-extent, extent};
+    const glm::vec3                       origin{0.0f, 0.0f, -3.0f * extent};
+    std::vector<Ray> rays(ray_count);
+    for (Ray& ray : rays) {
+        ray.origin    = origin;
+        ray.direction = glm::normalize(glm::vec3{target(random), target(random), target(random)} - origin);
+        ray.t_near    = 0.0f;
+        ray.t_far     = std::numeric_limits<float>::max();
+    }
+    return rays;
+}
+
+// Camera ray grid, neighbouring rays are coherent as in rendering or baking
+auto make_camera_rays(const std::size_t width, const std::size_t height, const float extent) -> std::vector<Ray>
+{
+    const glm::vec3 origin{0.0f, 0.0f, -3.0f * extent};
+    std::vector<Ray> rays;
+    rays.reserve(width * height);
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            const glm::vec3 target{
+                extent * (2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(width ) - 1.0f),
+                extent * (2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 1.0f),
+                0.0f
+            };
+            Ray ray;
+            ray.origin    = origin;
+            ray.direction = glm::normalize(target - origin);
+            ray.t_near    = 0.0f;
+            ray.t_far     = std::numeric_limits<float>::max();
+            rays.push_back(ray);
+        }
+    }
+    return rays;
+}
+
+enum class Query : unsigned int {
+    closest_single = 0,
+    closest_packet,
+    occluded_single,
+    occluded_packet
+};
+
+auto query_name(const Query query) -> const char*
+{
+    switch (query) {
+        case Query::closest_single:  return "closest hit, single";
+        case Query::closest_packet:  return "closest hit, packet";
+        case Query::occluded_single: return "occluded, single";
+        case Query::occluded_packet: return "occluded, packet";
+        default:                     return "?";
+    }
+}
+
+// Same chunk size as IScene and Bvh_scene batches
+constexpr std::size_t s_rays_per_chunk = 64;
+
+// Runs query over rays, writes t_far of closest hit or -infinity for
+// occluded rays, like IScene batch queries do
+void run_batch(
+    const Scene&         scene,
+    const Bvh_tlas&      tlas,
+    const Query          query,
+    const std::span<Ray> rays,
+    Thread_pool* const   thread_pool
+)
+{
+    const auto range = [&](const std::size_t begin, const std::size_t end) {
+        switch (query) {
+            case Query::closest_single: {
+                for (std::size_t i = begin; i < end; ++i) {
+                    Ray& ray = rays[i];
+                    tlas.traverse(ray, [&](const uint32_t primitive) {
+                        scene.intersect_instance(ray, primitive);
+                        return false;
+                    });
+                }
+                break;
+            }
+            case Query::closest_packet: {
+                for (std::size_t i = begin; i < end; i += Bvh_tlas::s_packet_size) {
+                    const std::span<Ray> packet = rays.subspan(i, std::min(Bvh_tlas::s_packet_size, end - i));
+                    tlas.traverse_packet(packet, [&](const uint32_t primitive, const std::size_t lane) {
+                        scene.intersect_instance(packet[lane], primitive);
+                        return false;
+                    });
+                }
+                break;
+            }
+            case Query::occluded_single: {
+                for (std::size_t i = begin; i < end; ++i) {
+                    Ray& ray         = rays[i];
+                    bool is_occluded = false;
+                    tlas.traverse(ray, [&](const uint32_t primitive) {
+                        is_occluded = scene.intersect_instance(ray, primitive);
+                        return is_occluded;
+                    });
+                    if (is_occluded) {
+                        ray.t_far = -std::numeric_limits<float>::infinity();
+                    }
+                }
+                break;
+            }
+            case Query::occluded_packet: {
+                for (std::size_t i = begin; i < end; i += Bvh_tlas::s_packet_size) {
+                    const std::span<Ray> packet        = rays.subspan(i, std::min(Bvh_tlas::s_packet_size, end - i));
+                    uint32_t             occluded_mask = 0;
+                    tlas.traverse_packet(packet, [&](const uint32_t primitive, const std::size_t lane) {
+                        if (scene.intersect_instance(packet[lane], primitive)) {
+                            occluded_mask |= (1u << lane);
+                            return true;
+                        }
+                        return false;
+                    });
+                    for (std::size_t lane = 0, lane_end = packet.size(); lane < lane_end; ++lane) {
+                        if ((occluded_mask & (1u << lane)) != 0) {
+                            packet[lane].t_far = -std::numeric_limits<float>::infinity();
+                        }
+                    }
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, rays.size(), s_rays_per_chunk, range);
+    } else {
+        range(0, rays.size());
+    }
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    const std::size_t ray_count    = options.quick ? 256 : 4096;
+    const int         repeat_count = options.quick ? 1 : 3;
+
+    fmt::print("instances   build ms   refit ms   linear us/ray   tlas us/ray  (speedup)   hits\n");
+    for (const std::size_t instance_count : {std::size_t{10'000}, std::size_t{100'000}}) {
+        if (options.quick && (instance_count > 10'000)) {
+            continue;
+        }
+        // Constant instance density
+        const float extent = 2.0f * std::cbrt(static_cast<float>(instance_count));
+        Scene       scene{instance_count, extent};
+        Bvh_tlas    tlas;
+
+        const double build_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            tlas.build(scene.bounds);
+        });
+
+        // Instances move a little, as under transform updates
+        for (Instance& instance : scene.instances) {
+            instance.center += glm::vec3{0.01f, -0.02f, 0.01f};
+        }
+        scene.update_bounds();
+        const double refit_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            tlas.refit(scene.bounds);
+        });
+
+        const std::vector<Ray> rays = make_rays(ray_count, extent);
+        std::vector<Hit_record> linear_hits(ray_count);
+        std::vector<Hit_record> tlas_hits  (ray_count);
+        const double linear_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            for (std::size_t i = 0; i < ray_count; ++i) {
+                linear_hits[i] = intersect_linear(scene, rays[i]);
+            }
+        });
+        const double tlas_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            for (std::size_t i = 0; i < ray_count; ++i) {
+                tlas_hits[i] = intersect_tlas(scene, tlas, rays[i]);
+            }
+        });
+
+        std::size_t hit_count = 0;
+        std::size_t mismatch  = 0;
+        for (std::size_t i = 0; i < ray_count; ++i) {
+            if (linear_hits[i].instance != c_no_hit) {
+                ++hit_count;
+            }
+            if ((linear_hits[i].instance != tlas_hits[i].instance) || (linear_hits[i].t != tlas_hits[i].t)) {
+                ++mismatch;
+            }
+        }
+
+        fmt::print(
+            "{:9}  {:9.2f}  {:9.3f}  {:14.2f}  {:12.3f}  ({:6.0f}x)  {:5}\n",
+            instance_count,
+            1000.0 * build_seconds, 1000.0 * refit_seconds,
+            1e6 * linear_seconds / static_cast<double>(ray_count),
+            1e6 * tlas_seconds   / static_cast<double>(ray_count),
+            linear_seconds / tlas_seconds,
+            hit_count
+        );
+        checks.check(tlas.get_primitive_count() == instance_count, "TLAS contains all instances");
+        checks.check(hit_count > 0,                                "rays hit instances");
+        checks.check(mismatch == 0,                                "TLAS hits match linear scan");
+    }
+
+    // Batch throughput
+    {
+        const std::size_t instance_count = options.quick ? 10'000 : 100'000;
+        const std::size_t grid_size      = options.quick ? 64 : 512;
+        const float       extent         = 2.0f * std::cbrt(static_cast<float>(instance_count));
+        Scene             scene{instance_count, extent};
+        Bvh_tlas          tlas;
+        tlas.build(scene.bounds);
+
+        const std::vector<Ray> camera_rays = make_camera_rays(grid_size, grid_size, extent);
+        const double           ray_count   = static_cast<double>(camera_rays.size());
+
+        // 1, 2, 4, ... threads, at least up to two so ctest covers the parallel path
+        std::vector<std::size_t> thread_counts;
+        const std::size_t max_thread_count = std::max(2u, std::thread::hardware_concurrency());
+        for (std::size_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+            thread_counts.push_back(thread_count);
+        }
+
+        fmt::print("\n{} instances, {} camera rays, Mrays/s\n", instance_count, camera_rays.size());
+        fmt::print("query                  threads  Mrays/s\n");
+        std::vector<Ray> reference;
+        std::vector<Ray> rays;
+        for (const Query query : {Query::closest_single, Query::closest_packet, Query::occluded_single, Query::occluded_packet}) {
+            for (const std::size_t thread_count : thread_counts) {
+                std::unique_ptr<Thread_pool> pool;
+                if (thread_count > 1) {
+                    pool = std::make_unique<Thread_pool>(thread_count - 1);
+                }
+                const double seconds = benchmarks::measure_min(repeat_count, [&]() {
+                    rays = camera_rays;
+                    run_batch(scene, tlas, query, std::span<Ray>{rays}, pool.get());
+                });
+                fmt::print("{:21}  {:7}  {:7.2f}\n", query_name(query), thread_count, 1e-6 * ray_count / seconds);
+
+                // Closest hits must match single ray results; occluded rays are the ones which hit
+                if (query == Query::closest_single && thread_count == 1) {
+                    reference = rays;
+                    continue;
+                }
+                std::size_t mismatch = 0;
+                for (std::size_t i = 0, end = rays.size(); i < end; ++i) {
+                    const bool reference_hit = reference[i].t_far != std::numeric_limits<float>::max();
+                    const bool ok = ((query == Query::closest_single) || (query == Query::closest_packet))
+                        ? (rays[i].t_far == reference[i].t_far)
+                        : ((rays[i].t_far == -std::numeric_limits<float>::infinity()) == reference_hit);
+                    if (!ok) {
+                        ++mismatch;
+                    }
+                }
+                checks.check(mismatch == 0, "batch query results match single closest hit queries");
+            }
+        }
+    }
+
+    return checks.get_exit_code();
+}
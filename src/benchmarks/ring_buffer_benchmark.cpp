@@ -0,0 +1,359 @@
+// Streams framed packets through a socket sized receive ring buffer, the
+// way erhe::net::Socket::recv() does: recv() stand-in copies up to 64 KiB
+// to begin_produce(), then all complete packets are handed to a receive
+// handler and consumed. Compares the previous Ring_buffer, which rotated
+// storage when a packet wrapped, to the current one, which reads packets in
+// place from get_readable(). Then runs the current buffer with a producer
+// thread filling it while the main thread consumes, as single producer,
+// single consumer. Packet payloads are checksummed and counted.
+
+#include "benchmark.hpp"
+
+#include "erhe_net/ring_buffer.hpp"
+#include "erhe_net/socket.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::net::Ring_buffer;
+
+constexpr uint32_t    s_header_magic     = 0x45'72'68'65u; // "Erhe", as in erhe::net::Packet_header
+constexpr std::size_t s_header_byte_count = 8;
+constexpr std::size_t s_recv_byte_count   = 64 * 1024;
+
+// Ring_buffer before mirrored storage, reduced to what recv() used.
+// rotate() also resets offsets here; the original left them unchanged,
+// so packets read after a rotate were wrong.
+class Previous_ring_buffer
+{
+public:
+    explicit Previous_ring_buffer(const std::size_t capacity)
+        : m_buffer  (capacity)
+        , m_max_size{capacity}
+    {
+    }
+
+    auto size() const -> std::size_t
+    {
+        if (m_full) {
+            return m_max_size;
+        }
+        if (m_write_offset >= m_read_offset) {
+            return m_write_offset - m_read_offset;
+        }
+        return m_max_size + m_write_offset - m_read_offset;
+    }
+
+    void rotate()
+    {
+        const std::size_t byte_count    = size();
+        const std::size_t rotate_amount = m_read_offset;
+        std::size_t       count         = 0;
+        std::size_t       offset        = 0;
+        while (count < m_max_size) {
+            std::size_t to_index   = offset;
+            uint8_t     tmp        = m_buffer[to_index];
+            std::size_t from_index = (to_index + rotate_amount) % m_max_size;
+            while (from_index != offset) {
+                m_buffer[to_index] = m_buffer[from_index];
+                to_index   = from_index;
+                from_index = (to_index + rotate_amount) % m_max_size;
+                ++count;
+            }
+            m_buffer[to_index] = tmp;
+            ++count;
+            ++offset;
+        }
+        m_read_offset  = 0;
+        m_write_offset = byte_count % m_max_size;
+    }
+
+    auto begin_produce(std::size_t& before_wrap, std::size_t& after_wrap) -> uint8_t*
+    {
+        const std::size_t can_write_count = m_max_size - size();
+        before_wrap = (std::min)(can_write_count, m_max_size - m_write_offset);
+        after_wrap  = can_write_count - before_wrap;
+        return &m_buffer[m_write_offset];
+    }
+
+    void end_produce(const std::size_t byte_count)
+    {
+        if (byte_count == 0) {
+            return;
+        }
+        m_write_offset = (m_write_offset + byte_count) % m_max_size;
+        m_full = (m_write_offset == m_read_offset);
+    }
+
+    auto begin_consume(std::size_t& before_wrap, std::size_t& after_wrap) -> const uint8_t*
+    {
+        const std::size_t can_read_count = size();
+        before_wrap = (std::min)(can_read_count, m_max_size - m_read_offset);
+        after_wrap  = can_read_count - before_wrap;
+        return &m_buffer[m_read_offset];
+    }
+
+    void end_consume(const std::size_t byte_count)
+    {
+        m_read_offset = (m_read_offset + byte_count) % m_max_size;
+        m_full        = false;
+    }
+
+    auto peek(uint8_t* dst, const std::size_t byte_count) -> std::size_t
+    {
+        const std::size_t can_read_count    = (std::min)(size(), byte_count);
+        const std::size_t count_before_wrap = (std::min)(can_read_count, m_max_size - m_read_offset);
+        memcpy(dst, &m_buffer[m_read_offset], count_before_wrap);
+        memcpy(dst + count_before_wrap, &m_buffer[0], can_read_count - count_before_wrap);
+        return can_read_count;
+    }
+
+private:
+    std::vector<uint8_t> m_buffer;
+    std::size_t          m_read_offset {0};
+    std::size_t          m_write_offset{0};
+    std::size_t          m_max_size    {0};
+    bool                 m_full        {false};
+};
+
+// Packets with payloads of 16 to 2047 bytes
+class Packet_stream
+{
+public:
+    explicit Packet_stream(const std::size_t byte_count)
+    {
+        uint32_t state = 1;
+        while (bytes.size() < byte_count) {
+            state = state * 1664525u + 1013904223u;
+            const uint32_t length = 16u + ((state >> 8) % 2032u);
+            const uint32_t header[2]{s_header_magic, length};
+            const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(header);
+            bytes.insert(bytes.end(), header_bytes, header_bytes + s_header_byte_count);
+            for (uint32_t i = 0; i < length; ++i) {
+                const uint8_t value = static_cast<uint8_t>((state >> 16) + i * 7u);
+                bytes.push_back(value);
+                checksum += value;
+            }
+            ++packet_count;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    std::size_t          packet_count{0};
+    uint64_t             checksum    {0};
+};
+
+class Receiver
+{
+public:
+    void handle(const uint8_t* const payload, const std::size_t length)
+    {
+        uint64_t sum = 0;
+        for (std::size_t i = 0; i < length; ++i) {
+            sum += payload[i];
+        }
+        checksum += sum;
+        ++packet_count;
+    }
+
+    std::size_t packet_count{0};
+    uint64_t    checksum    {0};
+    std::size_t wrap_count  {0}; // rotates, or copied packets
+    bool        bad_header  {false};
+};
+
+// Returns payload length, if header is readable
+template <typename Buffer>
+[[nodiscard]] auto peek_length(Buffer& buffer, Receiver& receiver) -> std::optional<uint32_t>
+{
+    uint32_t header[2];
+    if (buffer.peek(reinterpret_cast<uint8_t*>(header), s_header_byte_count) < s_header_byte_count) {
+        return {};
+    }
+    if (header[0] != s_header_magic) {
+        receiver.bad_header = true;
+        return {};
+    }
+    return header[1];
+}
+
+// Previous Socket::recv() packet loop
+void consume_previous(Previous_ring_buffer& buffer, Receiver& receiver)
+{
+    for (;;) {
+        const std::optional<uint32_t> length = peek_length(buffer, receiver);
+        if (!length.has_value()) {
+            return;
+        }
+        const std::size_t packet_byte_count = s_header_byte_count + length.value();
+        std::size_t       before_wrap{0};
+        std::size_t       after_wrap {0};
+        const uint8_t*    read_pointer = buffer.begin_consume(before_wrap, after_wrap);
+        if (before_wrap + after_wrap < packet_byte_count) {
+            return;
+        }
+        if (before_wrap < packet_byte_count) {
+            buffer.rotate();
+            read_pointer = buffer.begin_consume(before_wrap, after_wrap);
+            ++receiver.wrap_count;
+        }
+        receiver.handle(read_pointer + s_header_byte_count, length.value());
+        buffer.end_consume(packet_byte_count);
+    }
+}
+
+// Current Socket::recv() packet loop
+void consume_current(Ring_buffer& buffer, Receiver& receiver, std::vector<uint8_t>& wrapped_packet)
+{
+    for (;;) {
+        const std::optional<uint32_t> length = peek_length(buffer, receiver);
+        if (!length.has_value()) {
+            return;
+        }
+        const std::size_t packet_byte_count = s_header_byte_count + length.value();
+        if (buffer.size_available_for_read() < packet_byte_count) {
+            return;
+        }
+        const std::span<const uint8_t> readable = buffer.get_readable();
+        const uint8_t*                 packet   = readable.data();
+        if (readable.size() < packet_byte_count) {
+            wrapped_packet.resize(packet_byte_count);
+            buffer.peek(wrapped_packet.data(), packet_byte_count);
+            packet = wrapped_packet.data();
+            ++receiver.wrap_count;
+        }
+        receiver.handle(packet + s_header_byte_count, length.value());
+        buffer.end_consume(packet_byte_count);
+    }
+}
+
+// recv() stand-in, returns number of bytes copied from stream
+template <typename Buffer>
+[[nodiscard]] auto produce(Buffer& buffer, const std::vector<uint8_t>& stream, const std::size_t offset) -> std::size_t
+{
+    std::size_t    before_wrap{0};
+    std::size_t    after_wrap {0};
+    uint8_t* const write_pointer = buffer.begin_produce(before_wrap, after_wrap);
+    const std::size_t byte_count = (std::min)({before_wrap, s_recv_byte_count, stream.size() - offset});
+    if (byte_count == 0) {
+        buffer.end_produce(0);
+        return 0;
+    }
+    memcpy(write_pointer, stream.data() + offset, byte_count);
+    buffer.end_produce(byte_count);
+    return byte_count;
+}
+
+class Result
+{
+public:
+    double   ms{0.0};
+    Receiver receiver;
+};
+
+template <typename Buffer, typename Consume>
+[[nodiscard]] auto run_single_thread(Buffer& buffer, const Packet_stream& stream, const int repeat_count, Consume consume) -> Result
+{
+    Result                result;
+    benchmarks::Stopwatch stopwatch;
+    for (int repeat = 0; repeat < repeat_count; ++repeat) {
+        std::size_t offset = 0;
+        while (offset < stream.bytes.size()) {
+            offset += produce(buffer, stream.bytes, offset);
+            consume(result.receiver);
+        }
+    }
+    result.ms = stopwatch.milliseconds();
+    return result;
+}
+
+[[nodiscard]] auto run_two_threads(Ring_buffer& buffer, const Packet_stream& stream, const int repeat_count) -> Result
+{
+    Result                result;
+    std::vector<uint8_t>  wrapped_packet;
+    const std::size_t     expected_count = stream.packet_count * static_cast<std::size_t>(repeat_count);
+    benchmarks::Stopwatch stopwatch;
+    std::thread producer{
+        [&buffer, &stream, repeat_count]() {
+            for (int repeat = 0; repeat < repeat_count; ++repeat) {
+                std::size_t offset = 0;
+                while (offset < stream.bytes.size()) {
+                    const std::size_t byte_count = produce(buffer, stream.bytes, offset);
+                    if (byte_count == 0) {
+                        std::this_thread::yield(); // Buffer full
+                    }
+                    offset += byte_count;
+                }
+            }
+        }
+    };
+    while ((result.receiver.packet_count < expected_count) && !result.receiver.bad_header) {
+        const std::size_t packet_count = result.receiver.packet_count;
+        consume_current(buffer, result.receiver, wrapped_packet);
+        if (result.receiver.packet_count == packet_count) {
+            std::this_thread::yield(); // No complete packet
+        }
+    }
+    producer.join();
+    result.ms = stopwatch.milliseconds();
+    return result;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    const std::size_t   capacity     = erhe::net::Socket::default_buffer_size;
+    const Packet_stream stream{options.quick ? (8 * 1024 * 1024) : (64 * 1024 * 1024)};
+    const int           repeat_count = options.quick ? 2 : 8;
+
+    Previous_ring_buffer previous_buffer{capacity};
+    const Result previous = run_single_thread(
+        previous_buffer, stream, repeat_count,
+        [&](Receiver& receiver) { consume_previous(previous_buffer, receiver); }
+    );
+
+    Ring_buffer          current_buffer{capacity};
+    std::vector<uint8_t> wrapped_packet;
+    const Result current = run_single_thread(
+        current_buffer, stream, repeat_count,
+        [&](Receiver& receiver) { consume_current(current_buffer, receiver, wrapped_packet); }
+    );
+
+    Ring_buffer  threaded_buffer{capacity};
+    const Result threaded = run_two_threads(threaded_buffer, stream, repeat_count);
+
+    constexpr double  mib        = 1024.0 * 1024.0;
+    const double      stream_mib = static_cast<double>(stream.bytes.size()) * static_cast<double>(repeat_count) / mib;
+    fmt::print(
+        "{:.0f} MiB in {} packets, {:.0f} MiB buffer, mirrored storage {}\n",
+        stream_mib, stream.packet_count * static_cast<std::size_t>(repeat_count),
+        static_cast<double>(current_buffer.max_size()) / mib, current_buffer.is_mirrored() ? "yes" : "no"
+    );
+    fmt::print("{:<28} {:>10} {:>10} {:>8}\n", "", "ms", "MiB/s", "wraps");
+    const auto print_row = [&](const char* label, const Result& result) {
+        fmt::print("{:<28} {:>10.1f} {:>10.0f} {:>8}\n", label, result.ms, 1000.0 * stream_mib / result.ms, result.receiver.wrap_count);
+    };
+    print_row("previous, rotate on wrap", previous);
+    print_row("get_readable()",           current);
+    print_row("get_readable(), 2 threads", threaded);
+
+    const std::size_t  expected_count    = stream.packet_count * static_cast<std::size_t>(repeat_count);
+    const uint64_t     expected_checksum = stream.checksum * static_cast<uint64_t>(repeat_count);
+    benchmarks::Checks checks;
+    for (const Result* result : {&previous, &current, &threaded}) {
+        checks.check(!result->receiver.bad_header,                      "packet header is corrupt");
+        checks.check(result->receiver.packet_count == expected_count,   "packet count");
+        checks.check(result->receiver.checksum == expected_checksum,    "payload checksum");
+    }
+    checks.check(!current_buffer.is_mirrored() || (current.receiver.wrap_count == 0), "mirrored buffer copied wrapped packets");
+    return checks.get_exit_code();
+}
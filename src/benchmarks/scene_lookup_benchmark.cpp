@@ -0,0 +1,211 @@
+// Looks up meshes and lights of a large scene by id. Scene::get_mesh_by_id()
+// and get_light_by_id() use id indices; the linear scan over layers is
+// how lookups were done before. Also measures registration and removal,
+// which maintain the indices. Items are grouped under parent nodes, as
+// Hierarchy sanity checks scan siblings when a child is added.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_scene/light.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Light;
+using erhe::scene::Mesh;
+using erhe::scene::Node;
+using Id = erhe::Unique_id<Node>::id_type;
+
+constexpr int s_mesh_layer_count = 4; // content, controller, tool, brush in editor
+constexpr int s_items_per_group  = 100;
+
+// Lookup as done before id indices
+auto find_mesh_linear(const erhe::scene::Scene& scene, const Id id) -> std::shared_ptr<Mesh>
+{
+    for (const auto& layer : scene.get_mesh_layers()) {
+        for (const auto& mesh : layer->meshes) {
+            if (mesh->get_id() == id) {
+                return mesh;
+            }
+        }
+    }
+    return {};
+}
+
+auto find_light_linear(const erhe::scene::Scene& scene, const Id id) -> std::shared_ptr<Light>
+{
+    for (const auto& layer : scene.get_light_layers()) {
+        for (const auto& light : layer->lights) {
+            if (light->get_id() == id) {
+                return light;
+            }
+        }
+    }
+    return {};
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const int mesh_count          = options.quick ? 10'000 : 100'000;
+    const int light_count         = options.quick ? 100    : 1'000;
+    const int hash_lookup_count   = 1'000'000;
+    const int linear_lookup_count = 1'000;
+    const int repeat_count        = options.quick ? 1      : 3;
+    const int remove_count        = options.quick ? 100    : 1'000;
+
+    benchmarks::Benchmark_scene host{"scene_lookup_benchmark"};
+    erhe::scene::Scene& scene = host.get_scene();
+    for (int i = 0; i < s_mesh_layer_count; ++i) {
+        scene.add_mesh_layer(std::make_shared<erhe::scene::Mesh_layer>("mesh layer", 0, static_cast<erhe::scene::Layer_id>(i)));
+    }
+    scene.add_light_layer(std::make_shared<erhe::scene::Light_layer>("light layer", 0));
+
+    std::vector<std::shared_ptr<Node>>  nodes;
+    std::vector<std::shared_ptr<Mesh>>  meshes;
+    std::vector<std::shared_ptr<Light>> lights;
+    nodes .reserve(mesh_count + light_count);
+    meshes.reserve(mesh_count);
+    lights.reserve(light_count);
+
+    std::shared_ptr<Node> group;
+    const auto get_group = [&](const std::size_t item_index) -> const std::shared_ptr<Node>& {
+        if ((item_index % s_items_per_group) == 0) {
+            group = std::make_shared<Node>("group");
+            group->set_parent(host.get_root_node());
+        }
+        return group;
+    };
+
+    // Most meshes are content, as in editor scenes
+    benchmarks::Stopwatch register_stopwatch;
+    for (int i = 0; i < mesh_count; ++i) {
+        auto node = std::make_shared<Node>("mesh node");
+        auto mesh = std::make_shared<Mesh>("mesh");
+        mesh->layer_id = static_cast<erhe::scene::Layer_id>(((i % 16) == 0) ? (1 + (i / 16) % (s_mesh_layer_count - 1)) : 0);
+        node->attach(mesh);
+        node->set_parent(get_group(nodes.size()));
+        nodes .push_back(node);
+        meshes.push_back(mesh);
+    }
+    for (int i = 0; i < light_count; ++i) {
+        auto node  = std::make_shared<Node>("light node");
+        auto light = std::make_shared<Light>("light");
+        light->layer_id = 0;
+        node->attach(light);
+        node->set_parent(get_group(nodes.size()));
+        nodes .push_back(node);
+        lights.push_back(light);
+    }
+    const double register_seconds = register_stopwatch.seconds();
+    const std::size_t registered_count = nodes.size();
+
+    std::mt19937 random{12345};
+    std::vector<Id> mesh_queries (hash_lookup_count);
+    std::vector<Id> light_queries(hash_lookup_count);
+    std::uniform_int_distribution<int> mesh_index (0, mesh_count  - 1);
+    std::uniform_int_distribution<int> light_index(0, light_count - 1);
+    for (int i = 0; i < hash_lookup_count; ++i) {
+        mesh_queries [i] = meshes[mesh_index (random)]->get_id();
+        light_queries[i] = lights[light_index(random)]->get_id();
+    }
+
+    std::size_t found = 0;
+    const double mesh_hash_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        found = 0;
+        for (const Id id : mesh_queries) {
+            found += scene.get_mesh_by_id(id) ? 1 : 0;
+        }
+    });
+    checks.check(found == mesh_queries.size(), "every mesh found by id");
+
+    const double mesh_linear_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        found = 0;
+        for (int i = 0; i < linear_lookup_count; ++i) {
+            found += find_mesh_linear(scene, mesh_queries[i]) ? 1 : 0;
+        }
+    });
+    checks.check(found == static_cast<std::size_t>(linear_lookup_count), "every mesh found by linear scan");
+
+    const double light_hash_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        found = 0;
+        for (const Id id : light_queries) {
+            found += scene.get_light_by_id(id) ? 1 : 0;
+        }
+    });
+    checks.check(found == light_queries.size(), "every light found by id");
+
+    const double light_linear_seconds = benchmarks::measure_min(repeat_count, [&]() {
+        found = 0;
+        for (int i = 0; i < linear_lookup_count; ++i) {
+            found += find_light_linear(scene, light_queries[i]) ? 1 : 0;
+        }
+    });
+    checks.check(found == static_cast<std::size_t>(linear_lookup_count), "every light found by linear scan");
+
+    for (int i = 0; i < linear_lookup_count; ++i) {
+        if (scene.get_mesh_by_id(mesh_queries[i]) != find_mesh_linear(scene, mesh_queries[i])) {
+            checks.check(false, "indexed and linear mesh lookups agree");
+            break;
+        }
+    }
+
+    // Ids which are not in the scene
+    const Id missing_id = Node{"missing"}.get_id();
+    checks.check(!scene.get_mesh_by_id(missing_id),  "missing mesh is not found");
+    checks.check(!scene.get_light_by_id(missing_id), "missing light is not found");
+
+    // Removal scans scene node and layer vectors, so only a sample is removed
+    std::vector<Id> removed_ids;
+    benchmarks::Stopwatch unregister_stopwatch;
+    for (int i = 0; i < remove_count; ++i) {
+        const std::shared_ptr<Node>& node = nodes[static_cast<std::size_t>(i) * mesh_count / remove_count];
+        removed_ids.push_back(erhe::scene::get_mesh(node.get())->get_id());
+        node->set_parent(std::shared_ptr<Node>{});
+    }
+    const double unregister_seconds = unregister_stopwatch.seconds();
+    for (const Id id : removed_ids) {
+        if (scene.get_mesh_by_id(id)) {
+            checks.check(false, "removed mesh is not found");
+            break;
+        }
+    }
+
+    const auto ns_per = [](const double seconds, const std::size_t count) {
+        return 1.0e9 * seconds / static_cast<double>(count);
+    };
+    fmt::print("scene lookup benchmark: {} meshes in {} layers, {} lights\n", mesh_count, s_mesh_layer_count, light_count);
+    fmt::print("register   {:10.2f} ms  ({:8.1f} ns/item)\n", 1000.0 * register_seconds,   ns_per(register_seconds,   registered_count));
+    fmt::print("unregister {:10.2f} ms  ({:8.1f} ns/item, {} items)\n", 1000.0 * unregister_seconds, ns_per(unregister_seconds, removed_ids.size()), removed_ids.size());
+    fmt::print("lookup             id index ns   linear scan ns   (speedup)\n");
+    fmt::print(
+        "mesh       {:17.1f}  {:15.1f}  ({:7.0f}x)\n",
+        ns_per(mesh_hash_seconds, hash_lookup_count), ns_per(mesh_linear_seconds, linear_lookup_count),
+        ns_per(mesh_linear_seconds, linear_lookup_count) / ns_per(mesh_hash_seconds, hash_lookup_count)
+    );
+    fmt::print(
+        "light      {:17.1f}  {:15.1f}  ({:7.0f}x)\n",
+        ns_per(light_hash_seconds, hash_lookup_count), ns_per(light_linear_seconds, linear_lookup_count),
+        ns_per(light_linear_seconds, linear_lookup_count) / ns_per(light_hash_seconds, hash_lookup_count)
+    );
+
+    return checks.get_exit_code();
+}
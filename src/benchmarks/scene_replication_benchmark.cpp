@@ -0,0 +1,286 @@
+// Replicates a scene of 10k nodes over erhe::net loopback, as the editor
+// network window does: Scene_delta_writer frames are broadcast by the
+// server, and applied with Scene_delta_reader in client receive handler.
+// Both scenes are built the same way, as editors which have loaded the same
+// scene, so nodes are matched by name and attachments by type. Each frame
+// a tenth of the nodes move; measures bytes per frame, write time and apply
+// time. A second client joining midway must receive the full scene, through
+// server connect handler resetting the writer.
+
+#include "benchmark.hpp"
+#include "benchmark_scene.hpp"
+
+#include "erhe_item/item_log.hpp"
+#include "erhe_log/log.hpp"
+#include "erhe_net/client.hpp"
+#include "erhe_net/net_log.hpp"
+#include "erhe_net/server.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/node_attachment.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+#include "erhe_scene/scene_replication.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace {
+
+using erhe::scene::Node;
+
+constexpr int s_port = 34562;
+
+class Test_attachment
+    : public erhe::scene::Node_attachment
+{
+};
+
+[[nodiscard]] auto node_position(const std::size_t node_index, const int frame) -> glm::vec3
+{
+    const float phase = ((node_index % 10) == 0) ? static_cast<float>(frame) * 0.05f : 0.0f;
+    return glm::vec3{
+        static_cast<float>(node_index % 100) * 2.0f + std::sin(phase),
+        static_cast<float>(node_index / 100),
+        std::cos(phase)
+    };
+}
+
+// Groups of 100 nodes, each node with one attachment
+class Replicated_scene
+{
+public:
+    Replicated_scene(const std::size_t node_count, const bool set_positions)
+        : host{"replication"}
+    {
+        std::shared_ptr<Node> group;
+        for (std::size_t i = 0; i < node_count; ++i) {
+            if ((i % 100) == 0) {
+                group = std::make_shared<Node>(fmt::format("group {}", i / 100));
+                group->set_parent(host.get_root_node());
+            }
+            auto node = std::make_shared<Node>(fmt::format("node {}", i % 100));
+            if (set_positions) {
+                node->set_parent_from_node(erhe::scene::Trs_transform{node_position(i, 0)});
+            }
+            node->set_parent(group);
+            auto attachment = std::make_shared<Test_attachment>();
+            attachment->enable_flag_bits(erhe::Item_flags::visible);
+            node->attach(attachment);
+            nodes      .push_back(node);
+            attachments.push_back(attachment);
+        }
+        host.get_scene().update_node_transforms();
+    }
+
+    benchmarks::Benchmark_scene                   host;
+    std::vector<std::shared_ptr<Node>>            nodes;
+    std::vector<std::shared_ptr<Test_attachment>> attachments;
+};
+
+// Client side of the network window
+class Replica
+{
+public:
+    explicit Replica(const std::size_t node_count)
+        : scene{node_count, false}
+    {
+        client.set_receive_handler(
+            [this](const uint8_t* data, const std::size_t length) {
+                const auto start_time = std::chrono::steady_clock::now();
+                ok = reader.apply_frame(scene.host.get_scene(), std::span<const uint8_t>{data, length}) && ok;
+                scene.host.get_scene().update_node_transforms();
+                const auto end_time = std::chrono::steady_clock::now();
+                apply_ms      += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+                unresolved_ids += reader.get_statistics().unresolved_id_count;
+                ++frame_count;
+            }
+        );
+    }
+
+    // Largest distance of a node from its source node
+    [[nodiscard]] auto get_max_error(const Replicated_scene& source) const -> float
+    {
+        float max_error = 0.0f;
+        for (std::size_t i = 0, end = source.nodes.size(); i < end; ++i) {
+            const glm::vec3 delta = glm::vec3{scene.nodes[i]->position_in_world()} - glm::vec3{source.nodes[i]->position_in_world()};
+            max_error = std::max(max_error, std::max(std::abs(delta.x), std::max(std::abs(delta.y), std::abs(delta.z))));
+        }
+        return max_error;
+    }
+
+    Replicated_scene                scene;
+    erhe::net::Client               client;
+    erhe::scene::Scene_delta_reader reader;
+    double                          apply_ms      {0.0};
+    std::size_t                     frame_count   {0};
+    std::size_t                     unresolved_ids{0};
+    bool                            ok            {true};
+};
+
+// Frame with one node_parent record, written by hand, as the writer never
+// writes cyclic parents
+[[nodiscard]] auto make_parent_frame(const std::size_t id, const std::size_t parent_id) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> frame;
+    const auto write_varint = [&frame](uint64_t value) {
+        while (value >= 0x80u) {
+            frame.push_back(static_cast<uint8_t>(value | 0x80u));
+            value >>= 7;
+        }
+        frame.push_back(static_cast<uint8_t>(value));
+    };
+    for (int i = 0; i < 4; ++i) {
+        frame.push_back(static_cast<uint8_t>(erhe::scene::Scene_delta::c_magic >> (8 * i)));
+    }
+    frame.push_back(erhe::scene::Scene_delta::c_version);
+    write_varint(1); // frame
+    frame.push_back(static_cast<uint8_t>(erhe::scene::Scene_delta::Record::node_parent));
+    write_varint(id);
+    write_varint(parent_id);
+    return frame;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+
+    erhe::log::initialize_log_sinks();
+    erhe::item::initialize_logging();
+    erhe::net::initialize_logging();
+    erhe::scene::initialize_logging();
+
+    const std::size_t node_count  = options.quick ? 1000 : 10000;
+    const int         frame_count = options.quick ? 20   : 200;
+
+    benchmarks::Checks checks;
+
+    Replicated_scene                source{node_count, true};
+    erhe::scene::Scene_delta_writer writer;
+    std::vector<uint8_t>            frame;
+    std::size_t                     accepted_count{0};
+    erhe::net::Server               server;
+    server.set_connect_handler(
+        [&]() {
+            writer.reset();
+            ++accepted_count;
+        }
+    );
+    if (!server.listen("127.0.0.1", s_port)) {
+        fmt::print("listen failed\n");
+        return 1;
+    }
+
+    Replica first {node_count};
+    Replica second{node_count};
+    const auto poll_all = [&]() {
+        server.poll(0);
+        first .client.poll(0);
+        second.client.poll(0);
+    };
+    // Polls until replica has applied expected number of frames
+    const auto wait_frames = [&](Replica& replica, const std::size_t expected_frame_count) -> bool {
+        const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+        while ((replica.frame_count < expected_frame_count) && (std::chrono::steady_clock::now() < timeout)) {
+            poll_all();
+        }
+        return replica.frame_count == expected_frame_count;
+    };
+    const auto wait_accepted = [&](const std::size_t expected_count) -> bool {
+        const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+        while ((accepted_count < expected_count) && (std::chrono::steady_clock::now() < timeout)) {
+            poll_all();
+        }
+        return accepted_count == expected_count;
+    };
+
+    // Full frame when first client joins
+    checks.check(first.client.connect("127.0.0.1", s_port) && wait_accepted(1), "first client did not connect");
+    checks.check(writer.write_frame(source.host.get_scene(), frame),             "full frame was not written");
+    const std::size_t full_frame_bytes = frame.size();
+    server.broadcast(reinterpret_cast<const char*>(frame.data()), frame.size());
+    checks.check(wait_frames(first, 1),                                          "first client did not receive full frame");
+    const double full_frame_apply_ms = first.apply_ms;
+    checks.check(first.reader.get_statistics().node_count == node_count + node_count / 100, "first client did not bind all nodes");
+    first.apply_ms = 0.0;
+
+    // Moving nodes, and second client joining half way. Only delta frames
+    // are measured.
+    std::size_t           delta_bytes {0};
+    std::size_t           delta_frames{0};
+    std::size_t           full_frames {1};
+    double                write_ms    {0.0};
+    double                apply_ms    {0.0};
+    benchmarks::Stopwatch stopwatch;
+    for (int frame_index = 1; frame_index <= frame_count; ++frame_index) {
+        if (frame_index == frame_count / 2) {
+            checks.check(second.client.connect("127.0.0.1", s_port) && wait_accepted(2), "second client did not connect");
+        }
+        for (std::size_t i = 0; i < node_count; i += 10) {
+            source.nodes[i]->set_parent_from_node(erhe::scene::Trs_transform{node_position(i, frame_index)});
+        }
+        if (frame_index == frame_count / 4) {
+            source.attachments[1]->disable_flag_bits(erhe::Item_flags::visible);
+        }
+        source.host.get_scene().update_node_transforms();
+
+        stopwatch.restart();
+        const bool   has_frame     = writer.write_frame(source.host.get_scene(), frame);
+        const double frame_write_ms = stopwatch.milliseconds();
+        if (!has_frame) {
+            continue;
+        }
+        const double apply_ms_before = first.apply_ms;
+        server.broadcast(reinterpret_cast<const char*>(frame.data()), frame.size());
+        checks.check(wait_frames(first, first.frame_count + 1), "first client did not receive frame");
+        if (writer.get_statistics().create_count > 0) { // connect handler has reset the writer
+            ++full_frames;
+            continue;
+        }
+        delta_bytes += frame.size();
+        write_ms    += frame_write_ms;
+        apply_ms    += first.apply_ms - apply_ms_before;
+        ++delta_frames;
+    }
+    checks.check(wait_frames(second, static_cast<std::size_t>(frame_count - frame_count / 2 + 1)), "second client did not receive all frames");
+
+    const double frames          = static_cast<double>(std::max<std::size_t>(1, delta_frames));
+    const double bytes_per_frame = static_cast<double>(delta_bytes) / frames;
+    const float  first_error     = first .get_max_error(source);
+    const float  second_error    = second.get_max_error(source);
+
+    fmt::print("{} nodes in {} groups, {} moving, {} frames over loopback\n", node_count, node_count / 100, node_count / 10, frame_count);
+    fmt::print("{:<16} {:>12} {:>12} {:>12}\n", "", "bytes", "write ms", "apply ms");
+    fmt::print("{:<16} {:>12} {:>12} {:>12.3f}\n", "full frame",  full_frame_bytes, "", full_frame_apply_ms);
+    fmt::print("{:<16} {:>12.0f} {:>12.3f} {:>12.3f}\n", "delta frame", bytes_per_frame, write_ms / frames, apply_ms / frames);
+    fmt::print("full frames {} (joins {}), max position error {} / {}\n", full_frames, accepted_count, first_error, second_error);
+
+    const float tolerance = erhe::scene::Scene_delta::c_position_step;
+    checks.check(first.ok && second.ok,                            "frame was not applied");
+    checks.check(full_frames == 2,                                 "joining client did not trigger full frame");
+    checks.check(second.frame_count > 0,                           "second client did not receive frames");
+    checks.check(first_error  <= tolerance,                        "first client nodes do not follow");
+    checks.check(second_error <= tolerance,                        "second client nodes do not follow");
+    checks.check(first.unresolved_ids == 0 && second.unresolved_ids == 0, "ids were not resolved, attachments must bind by type");
+    checks.check(!first .scene.attachments[1]->is_visible(),        "attachment flags were not replicated to first client");
+    checks.check(!second.scene.attachments[1]->is_visible(),        "attachment flags were not replicated to second client");
+    checks.check(first.scene.attachments[2]->is_visible() == source.attachments[2]->is_visible(), "attachment flags differ");
+    checks.check(bytes_per_frame < static_cast<double>(full_frame_bytes) / 4.0, "delta frames are not smaller than full frame");
+
+    // Malformed parent relations are rejected, without changing the hierarchy
+    const std::size_t group_id = source.nodes[0]->get_parent_node()->get_id();
+    const std::size_t node_id  = source.nodes[0]->get_id();
+    erhe::scene::Scene& replica_scene = first.scene.host.get_scene();
+    checks.check(!first.reader.apply_frame(replica_scene, make_parent_frame(node_id,  node_id)), "node parented to itself was not rejected");
+    checks.check(!first.reader.apply_frame(replica_scene, make_parent_frame(group_id, node_id)), "node parented to its child was not rejected");
+    checks.check(first.scene.nodes[0]->get_parent_node() != nullptr && !first.scene.nodes[0]->get_parent_node()->is_ancestor(first.scene.nodes[0].get()), "hierarchy was changed by rejected frame");
+
+    server.disconnect();
+    return checks.get_exit_code();
+}
@@ -0,0 +1,132 @@
+// Measures Catmull-Clark subdivision of a sphere, which produces over one
+// million corners, and Geometry::transform() of the result, with each
+// Property_map kernel instruction set. Interpolated point attributes of
+// each instruction set are compared to the scalar results.
+
+#include "benchmark.hpp"
+
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_geometry/operation/catmull_clark_subdivision.hpp"
+#include "erhe_geometry/property_map_kernels.hpp"
+#include "erhe_geometry/shapes/sphere.hpp"
+#include "erhe_log/log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using erhe::geometry::Geometry;
+using erhe::geometry::kernels::Instruction_set;
+
+auto get_point_values(const Geometry& geometry, const erhe::geometry::Property_map_descriptor& descriptor) -> std::vector<glm::vec3>
+{
+    const auto* const property_map = geometry.point_attributes().find<glm::vec3>(descriptor);
+    return (property_map != nullptr) ? property_map->values : std::vector<glm::vec3>{};
+}
+
+auto max_difference(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b) -> float
+{
+    if (a.size() != b.size()) {
+        return std::numeric_limits<float>::infinity();
+    }
+    float result = 0.0f;
+    for (std::size_t i = 0, end = a.size(); i < end; ++i) {
+        const glm::vec3 d = glm::abs(a[i] - b[i]);
+        result = std::max(result, std::max(d.x, std::max(d.y, d.z)));
+    }
+    return result;
+}
+
+class Results
+{
+public:
+    Instruction_set        instruction_set;
+    double                 subdivision_seconds{0.0};
+    double                 transform_seconds  {0.0};
+    std::vector<glm::vec3> point_locations;
+    std::vector<glm::vec3> point_normals;
+};
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::geometry::initialize_logging();
+
+    // 512 x 128 sphere has 65536 polygons, mostly quads. Catmull-Clark makes
+    // one quad per corner, so the result has about 1M corners.
+    const unsigned int slice_count    = options.quick ? 32 : 512;
+    const unsigned int stack_division = options.quick ? 8  : 128;
+    const int          repeat_count   = options.quick ? 1  : 3;
+
+    Geometry sphere = erhe::geometry::shapes::make_sphere(1.0, slice_count, stack_division);
+
+    const Instruction_set supported = erhe::geometry::kernels::get_supported_instruction_set();
+    std::vector<Results> results;
+    for (const Instruction_set instruction_set : {Instruction_set::scalar, Instruction_set::sse2, Instruction_set::avx2}) {
+        if (instruction_set > supported) {
+            continue;
+        }
+        erhe::geometry::kernels::set_instruction_set(instruction_set);
+
+        Results r{.instruction_set = instruction_set};
+        std::unique_ptr<Geometry> result;
+        r.subdivision_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            result = std::make_unique<Geometry>("subdivided");
+            erhe::geometry::operation::Catmull_clark_subdivision operation{sphere, *result.get()};
+        });
+        Geometry& subdivided = *result.get();
+        r.point_locations = get_point_values(subdivided, erhe::geometry::c_point_locations);
+        r.point_normals   = get_point_values(subdivided, erhe::geometry::c_point_normals_smooth);
+
+        if (results.empty()) {
+            fmt::print(
+                "catmull-clark of {} polygon sphere: {} points, {} polygons, {} corners\n",
+                sphere.get_polygon_count(),
+                subdivided.get_point_count(), subdivided.get_polygon_count(), subdivided.get_corner_count()
+            );
+            checks.check(options.quick || (subdivided.get_corner_count() >= 1'000'000), "subdivided sphere has 1M+ corners");
+            checks.check(!r.point_locations.empty(), "subdivided sphere has point locations");
+        }
+
+        // Rotation around Y and translation
+        const float     c = std::cos(0.5f);
+        const float     s = std::sin(0.5f);
+        const glm::mat4 matrix{
+            glm::vec4{   c, 0.0f,   -s, 0.0f},
+            glm::vec4{0.0f, 1.0f, 0.0f, 0.0f},
+            glm::vec4{   s, 0.0f,    c, 0.0f},
+            glm::vec4{1.0f, 2.0f, 3.0f, 1.0f}
+        };
+        r.transform_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            subdivided.transform(matrix);
+        });
+
+        const double corner_count = static_cast<double>(subdivided.get_corner_count());
+        fmt::print(
+            "{:6}  catmull_clark_subdivision {:8.2f} ms ({:5.1f} ns/corner)  transform {:7.2f} ms ({:4.1f} ns/corner)\n",
+            erhe::geometry::kernels::c_str(instruction_set),
+            1000.0 * r.subdivision_seconds, 1e9 * r.subdivision_seconds / corner_count,
+            1000.0 * r.transform_seconds,   1e9 * r.transform_seconds   / corner_count
+        );
+
+        if (!results.empty()) {
+            const Results& scalar = results.front();
+            checks.check(max_difference(r.point_locations, scalar.point_locations) < 1e-5f, "point locations match scalar");
+            checks.check(max_difference(r.point_normals,   scalar.point_normals  ) < 1e-4f, "point normals match scalar");
+        }
+        results.push_back(std::move(r));
+    }
+    erhe::geometry::kernels::set_instruction_set(supported);
+
+    return checks.get_exit_code();
+}
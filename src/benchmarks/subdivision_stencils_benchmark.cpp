@@ -0,0 +1,145 @@
+// Compares full Catmull-Clark and sqrt3 subdivision rebuilds against
+// Subdivision_stencils reuse when only base point locations change, over
+// several levels. Refined point locations from stencils are compared to
+// the full rebuild.
+
+#include "benchmark.hpp"
+
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_geometry/operation/catmull_clark_subdivision.hpp"
+#include "erhe_geometry/operation/sqrt3_subdivision.hpp"
+#include "erhe_geometry/operation/subdivision_stencils.hpp"
+#include "erhe_geometry/shapes/sphere.hpp"
+#include "erhe_log/log.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::geometry::Geometry;
+using erhe::geometry::operation::Subdivision_scheme;
+using erhe::geometry::operation::Subdivision_stencils;
+
+auto scheme_name(const Subdivision_scheme scheme) -> const char*
+{
+    switch (scheme) {
+        case Subdivision_scheme::catmull_clark: return "catmull_clark";
+        case Subdivision_scheme::sqrt3:         return "sqrt3";
+        default:                                return "?";
+    }
+}
+
+// Subdivides level_count times with the operations, as without stencils
+auto rebuild(Geometry& base, const Subdivision_scheme scheme, const std::size_t level_count) -> std::unique_ptr<Geometry>
+{
+    Geometry*                 source = &base;
+    std::unique_ptr<Geometry> result;
+    for (std::size_t level = 0; level < level_count; ++level) {
+        auto destination = std::make_unique<Geometry>("rebuild");
+        if (scheme == Subdivision_scheme::sqrt3) {
+            erhe::geometry::operation::Sqrt3_subdivision operation{*source, *destination};
+        } else {
+            erhe::geometry::operation::Catmull_clark_subdivision operation{*source, *destination};
+        }
+        result = std::move(destination);
+        source = result.get();
+    }
+    return result;
+}
+
+// Moves base points radially, as animated editing would
+void deform(Geometry& base, const std::vector<glm::vec3>& original, const float t)
+{
+    auto* const point_locations = base.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations);
+    for (std::size_t i = 0, end = original.size(); i < end; ++i) {
+        const glm::vec3 p = original[i];
+        point_locations->values[i] = p * (1.0f + 0.1f * std::sin(4.0f * p.y + t));
+    }
+    base.invalidate_point_locations();
+}
+
+auto max_difference(const Geometry& a, const Geometry& b) -> float
+{
+    const auto* const a_locations = a.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations);
+    const auto* const b_locations = b.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations);
+    if ((a_locations == nullptr) || (b_locations == nullptr) || (a.get_point_count() != b.get_point_count())) {
+        return std::numeric_limits<float>::infinity();
+    }
+    float result = 0.0f;
+    for (uint32_t i = 0, end = a.get_point_count(); i < end; ++i) {
+        const glm::vec3 d = glm::abs(a_locations->values[i] - b_locations->values[i]);
+        result = std::max(result, std::max(d.x, std::max(d.y, d.z)));
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    erhe::log::initialize_log_sinks();
+    erhe::geometry::initialize_logging();
+
+    const unsigned int slice_count     = options.quick ? 16 : 64;
+    const unsigned int stack_division  = options.quick ? 4  : 16;
+    const std::size_t  max_level_count = options.quick ? 2  : 3;
+    const int          repeat_count    = options.quick ? 1  : 3;
+
+    erhe::concurrency::Thread_pool thread_pool{std::max(1u, std::thread::hardware_concurrency() - 1)};
+
+    Geometry base = erhe::geometry::shapes::make_sphere(1.0, slice_count, stack_division);
+    const std::vector<glm::vec3> original_locations = base.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations)->values;
+
+    fmt::print("base sphere: {} points, {} polygons\n", base.get_point_count(), base.get_polygon_count());
+    fmt::print("scheme         levels  refined points   rebuild ms   stencil build ms   update ms  (speedup)   apply ms\n");
+
+    for (const Subdivision_scheme scheme : {Subdivision_scheme::catmull_clark, Subdivision_scheme::sqrt3}) {
+        for (std::size_t level_count = 1; level_count <= max_level_count; ++level_count) {
+            deform(base, original_locations, 0.0f);
+
+            std::unique_ptr<Subdivision_stencils> stencils;
+            const double build_seconds = benchmarks::measure_min(repeat_count, [&]() {
+                stencils = std::make_unique<Subdivision_stencils>(base, scheme, level_count, &thread_pool);
+            });
+
+            // Each measured frame moves base points, then refreshes refined geometry
+            float t = 0.0f;
+            std::unique_ptr<Geometry> rebuilt;
+            const double rebuild_seconds = benchmarks::measure_min(repeat_count, [&]() {
+                deform(base, original_locations, t += 0.1f);
+                rebuilt = rebuild(base, scheme, level_count);
+            });
+            const double update_seconds = benchmarks::measure_min(repeat_count, [&]() {
+                deform(base, original_locations, t);
+                stencils->update(base, &thread_pool);
+            });
+
+            const auto* const base_locations = base.point_attributes().find<glm::vec3>(erhe::geometry::c_point_locations);
+            std::vector<glm::vec3> refined_locations(stencils->get_refined_point_count());
+            const double apply_seconds = benchmarks::measure_min(repeat_count, [&]() {
+                stencils->apply(base_locations->span(), std::span<glm::vec3>{refined_locations}, &thread_pool);
+            });
+
+            fmt::print(
+                "{:13}  {:6}  {:14}  {:11.2f}  {:17.2f}  {:10.2f}  ({:5.1f}x)  {:9.3f}\n",
+                scheme_name(scheme), level_count, stencils->get_refined_point_count(),
+                1000.0 * rebuild_seconds, 1000.0 * build_seconds, 1000.0 * update_seconds,
+                rebuild_seconds / update_seconds, 1000.0 * apply_seconds
+            );
+
+            checks.check(max_difference(stencils->get_refined_geometry(), *rebuilt.get()) < 1e-4f, "stencil update matches full rebuild");
+        }
+    }
+
+    return checks.get_exit_code();
+}
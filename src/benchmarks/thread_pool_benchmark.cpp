@@ -0,0 +1,200 @@
+// Compares Thread_pool scheduling modes: fork/join overhead, tasks
+// spawned from tasks, dependency graph execution and CPU burned by idle workers.
+
+#include "benchmark.hpp"
+
+#include "erhe_concurrency/concurrent_queue.hpp"
+#include "erhe_concurrency/thread_pool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using erhe::concurrency::Concurrent_queue;
+using erhe::concurrency::Scheduling;
+using erhe::concurrency::Task_handle;
+using erhe::concurrency::Thread_pool;
+
+auto scheduling_name(const Scheduling scheduling) -> const char*
+{
+    switch (scheduling) {
+        case Scheduling::shared_queues: return "shared_queues";
+        case Scheduling::work_stealing: return "work_stealing";
+        default:                        return "?";
+    }
+}
+
+// Flat fork/join through Concurrent_queue, the API used by existing code
+auto run_queue_fork_join(Thread_pool& pool, const int round_count, const int task_count) -> std::size_t
+{
+    std::atomic<std::size_t> counter{0};
+    Concurrent_queue queue{pool};
+    for (int round = 0; round < round_count; ++round) {
+        for (int i = 0; i < task_count; ++i) {
+            queue.enqueue([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+        }
+        queue.wait();
+    }
+    return counter.load();
+}
+
+// Flat fork/join through submit() and wait()
+auto run_submit_fork_join(Thread_pool& pool, const int round_count, const int task_count) -> std::size_t
+{
+    std::atomic<std::size_t> counter{0};
+    std::vector<Task_handle> tasks;
+    tasks.reserve(task_count);
+    for (int round = 0; round < round_count; ++round) {
+        tasks.clear();
+        for (int i = 0; i < task_count; ++i) {
+            tasks.push_back(pool.submit([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); }));
+        }
+        pool.wait(std::span<const Task_handle>{tasks});
+    }
+    return counter.load();
+}
+
+// Binary task tree spawned from worker threads, each task spawns two
+// children without waiting for them. Blocking waits inside tasks are
+// avoided: a waiting worker helps by running other tasks, so with FIFO
+// queues the stack can grow with the number of queued tasks.
+void recursive_spawn(Thread_pool& pool, const int depth, std::atomic<std::size_t>& counter)
+{
+    if (depth > 0) {
+        pool.submit([&pool, depth, &counter]() { recursive_spawn(pool, depth - 1, counter); });
+        pool.submit([&pool, depth, &counter]() { recursive_spawn(pool, depth - 1, counter); });
+    }
+    counter.fetch_add(1, std::memory_order_release);
+}
+
+// Layered graph, each task depends on two tasks of the previous layer.
+// Returns number of tasks which ran before one of their dependencies.
+auto run_layered_graph(Thread_pool& pool, const int layer_count, const int width) -> std::size_t
+{
+    std::vector<std::atomic<int>> done(static_cast<std::size_t>(layer_count * width));
+    for (auto& flag : done) {
+        flag.store(0);
+    }
+    std::atomic<std::size_t> order_errors{0};
+    std::vector<Task_handle> previous_layer;
+    std::vector<Task_handle> layer;
+    for (int l = 0; l < layer_count; ++l) {
+        layer.clear();
+        for (int i = 0; i < width; ++i) {
+            const int index = l * width + i;
+            const int a     = (l > 0) ? (l - 1) * width + i               : -1;
+            const int b     = (l > 0) ? (l - 1) * width + (i + 1) % width : -1;
+            auto func = [&done, &order_errors, index, a, b]() {
+                if (
+                    ((a >= 0) && (done[a].load(std::memory_order_acquire) == 0)) ||
+                    ((b >= 0) && (done[b].load(std::memory_order_acquire) == 0))
+                ) {
+                    order_errors.fetch_add(1);
+                }
+                done[index].store(1, std::memory_order_release);
+            };
+            if (l == 0) {
+                layer.push_back(pool.submit(std::move(func)));
+            } else {
+                layer.push_back(pool.submit(std::move(func), {previous_layer[i], previous_layer[(i + 1) % width]}));
+            }
+        }
+        std::swap(previous_layer, layer);
+    }
+    pool.wait(std::span<const Task_handle>{previous_layer});
+    return order_errors.load();
+}
+
+// Returns process CPU time used while f runs, in percent of one core
+template <typename F>
+auto measure_cpu_percent(F&& f) -> double
+{
+    const double                cpu_before = benchmarks::process_cpu_seconds();
+    const benchmarks::Stopwatch stopwatch;
+    f();
+    return 100.0 * (benchmarks::process_cpu_seconds() - cpu_before) / stopwatch.seconds();
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+    const benchmarks::Options options = benchmarks::parse_options(argc, argv);
+    benchmarks::Checks        checks;
+
+    const std::size_t worker_count = std::max(1u, std::thread::hardware_concurrency() - 1);
+    const int         round_count  = options.quick ? 20 : 2000;
+    const int         task_count   = 256;
+    const int         tree_depth   = options.quick ? 10 : 16;
+    const int         layer_count  = options.quick ? 16 : 256;
+    const int         layer_width  = 64;
+    const int         repeat_count = options.quick ? 1 : 5;
+
+    fmt::print("Thread_pool benchmark, {} workers\n", worker_count);
+
+    for (const Scheduling scheduling : {Scheduling::shared_queues, Scheduling::work_stealing}) {
+        Thread_pool pool{worker_count, scheduling};
+        const char* name = scheduling_name(scheduling);
+
+        std::size_t queue_count  = 0;
+        std::size_t submit_count = 0;
+        std::size_t tree_count   = 0;
+        std::size_t order_errors = 0;
+
+        const double queue_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            queue_count = run_queue_fork_join(pool, round_count, task_count);
+        });
+        const double submit_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            submit_count = run_submit_fork_join(pool, round_count, task_count);
+        });
+        const double tree_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            const std::size_t        expected_count = (std::size_t{2} << tree_depth) - 1;
+            std::atomic<std::size_t> counter{0};
+            pool.submit([&pool, tree_depth, &counter]() { recursive_spawn(pool, tree_depth, counter); });
+            while (counter.load(std::memory_order_acquire) < expected_count) {
+                std::this_thread::yield();
+            }
+            tree_count = counter.load();
+        });
+        const double graph_seconds = benchmarks::measure_min(repeat_count, [&]() {
+            order_errors += run_layered_graph(pool, layer_count, layer_width);
+        });
+
+        // Let workers run out of work, then measure CPU used while pool is idle
+        const int idle_milliseconds = options.quick ? 100 : 500;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const double idle_cpu_percent = measure_cpu_percent([idle_milliseconds]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(idle_milliseconds));
+        });
+
+        // One tiny task every millisecond, workers are idle most of the time
+        const double sparse_cpu_percent = measure_cpu_percent([&pool, idle_milliseconds]() {
+            for (int i = 0; i < idle_milliseconds; ++i) {
+                pool.wait(pool.submit([]() {}));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        const double flat_task_count = static_cast<double>(round_count) * task_count;
+        fmt::print("{}:\n", name);
+        fmt::print("  Concurrent_queue fork/join  {:8.1f} ns/task\n", 1e9 * queue_seconds  / flat_task_count);
+        fmt::print("  submit() fork/join          {:8.1f} ns/task\n", 1e9 * submit_seconds / flat_task_count);
+        fmt::print("  recursive spawn             {:8.1f} ns/task ({} tasks)\n", 1e9 * tree_seconds / static_cast<double>(tree_count), tree_count);
+        fmt::print("  layered graph               {:8.1f} ns/task ({} x {} tasks)\n", 1e9 * graph_seconds / (layer_count * layer_width), layer_count, layer_width);
+        fmt::print("  idle CPU                    {:8.1f} % of one core\n", idle_cpu_percent);
+        fmt::print("  sparse load CPU             {:8.1f} % of one core\n", sparse_cpu_percent);
+
+        const auto statistics = pool.get_statistics();
+        fmt::print("  executed {} stolen {} sleeps {}\n", statistics.executed_count, statistics.stolen_count, statistics.sleep_count);
+
+        const std::size_t expected_flat_count = static_cast<std::size_t>(round_count) * task_count;
+        checks.check(queue_count  == expected_flat_count, "Concurrent_queue executed all tasks");
+        checks.check(submit_count == expected_flat_count, "submit() executed all tasks");
+        checks.check(tree_count   == (std::size_t{2} << tree_depth) - 1, "recursive spawn executed all tasks");
+        checks.check(order_errors == 0, "graph tasks ran after their dependencies");
+    }
+
+    return checks.get_exit_code();
+}
@@ -57,6 +57,9 @@
 
 #include "erhe_commands/commands.hpp"
 #include "erhe_commands/commands_log.hpp"
+#include "erhe_concurrency/concurrent_queue.hpp"
+#include "erhe_concurrency/task_arena.hpp"
+#include "erhe_concurrency/thread_pool.hpp"
 #include "erhe_configuration/configuration.hpp"
 #include "erhe_file/file_log.hpp"
 #include "erhe_geometry/geometry_log.hpp"
@@ -103,6 +106,9 @@
 #   include <nvtx3/nvToolsExt.h>
 #endif
 
+#include <algorithm>
+#include <thread>
+
 namespace editor {
 
 class Editor
@@ -144,13 +150,32 @@ public:
         return erhe::window::Context_window{configuration};
     }
 
+    // Main thread helps the pool while it waits, so one thread less is needed
+    [[nodiscard]] static auto get_worker_thread_count() -> std::size_t
+    {
+        int thread_count = 0; // 0 = use all hardware threads
+        auto ini = erhe::configuration::get_ini("erhe.ini", "threading");
+        ini->get("thread_count", thread_count);
+        if (thread_count <= 0) {
+            thread_count = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        return static_cast<std::size_t>(std::max(thread_count - 1, 1));
+    }
+
     Editor()
-        : m_commands          {}
+        : m_background_thread_pool{std::max<std::size_t>(get_worker_thread_count() / 2, 1)}
+        , m_thread_pool       {get_worker_thread_count(), erhe::concurrency::Scheduling::work_stealing}
+        , m_frame_task_arena  {256 * 1024}
+        , m_frame_queue       {m_thread_pool, "editor.frame"}
+        , m_commands          {}
         , m_scene_message_bus {}
         , m_editor_message_bus{}
         , m_input_state       {}
         , m_time              {}
-        , m_editor_context    {}
+        , m_editor_context    {
+            .thread_pool            = &m_thread_pool,           // Scene_builder constructor uses thread_pool
+            .background_thread_pool = &m_background_thread_pool
+        }
 
         , m_clipboard             {m_commands, m_editor_context}
         , m_context_window        {create_window()}
@@ -284,6 +309,8 @@ public:
         m_selection.setup_xr_bindings(m_commands, m_headset_view);
 #endif
 
+        m_frame_queue.set_task_arena(&m_frame_task_arena);
+
         fill_editor_context();
 
         auto ini = erhe::configuration::get_ini("erhe.ini", "physics");
@@ -335,6 +362,9 @@ public:
     void fill_editor_context()
     {
         m_editor_context.commands               = &m_commands              ;
+        m_editor_context.frame_queue            = &m_frame_queue           ;
+        m_editor_context.thread_pool            = &m_thread_pool           ;
+        m_editor_context.background_thread_pool = &m_background_thread_pool;
         m_editor_context.graphics_instance      = &m_graphics_instance     ;
         m_editor_context.imgui_renderer         = &m_imgui_renderer        ;
         m_editor_context.imgui_windows          = &m_imgui_windows         ;
@@ -417,6 +447,11 @@ public:
         m_editor_rendering.end_frame();
         m_commands.on_idle();
         m_operation_stack.update();
+
+        // All frame tasks are done; recycle their arena allocations
+        m_frame_queue.wait();
+        m_frame_task_arena.reset();
+
         if (!m_openxr) {
             m_context_window.swap_buffers();
         }
@@ -435,6 +470,16 @@ public:
     bool m_close_requested{false};
     bool m_openxr         {false};
 
+    // Background BVH builds. Separate from m_thread_pool, because threads
+    // waiting for m_thread_pool tasks run its queued tasks, and must not pick
+    // up a long build. Declared first, as geometries refer to it.
+    erhe::concurrency::Thread_pool      m_background_thread_pool;
+
+    // Shared by editor subsystems
+    erhe::concurrency::Thread_pool      m_thread_pool;
+    erhe::concurrency::Task_arena       m_frame_task_arena;
+    erhe::concurrency::Concurrent_queue m_frame_queue;
+
     // No dependencies (constructors)
     erhe::commands::Commands       m_commands;
     erhe::scene::Scene_message_bus m_scene_message_bus;
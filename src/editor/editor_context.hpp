@@ -3,6 +3,10 @@
 namespace erhe::commands {
     class Commands;
 }
+namespace erhe::concurrency {
+    class Concurrent_queue;
+    class Thread_pool;
+}
 namespace erhe::graphics {
     class Instance;
 }
@@ -79,6 +83,9 @@ class Editor_context
 {
 public:
     erhe::commands::Commands*               commands              {nullptr};
+    erhe::concurrency::Concurrent_queue*    frame_queue           {nullptr}; // tasks must complete before end of frame
+    erhe::concurrency::Thread_pool*         thread_pool           {nullptr};
+    erhe::concurrency::Thread_pool*         background_thread_pool{nullptr}; // long running tasks, which nothing waits for
     erhe::graphics::Instance*               graphics_instance     {nullptr};
     erhe::imgui::Imgui_renderer*            imgui_renderer        {nullptr};
     erhe::imgui::Imgui_windows*             imgui_windows         {nullptr};
@@ -88,12 +88,16 @@ void Editor_scenes::before_physics_simulation_steps()
 
 void Editor_scenes::update_node_transforms()
 {
+    // Scene roots are updated serially on this thread, because node transform
+    // updates reach into raytrace instances and other scene root state. Large
+    // updates within a scene are split to the thread pool.
+    erhe::concurrency::Thread_pool* thread_pool = m_context.thread_pool;
     for (const auto& scene_root : m_scene_roots) {
-        scene_root->get_scene().update_node_transforms();
+        scene_root->get_scene().update_node_transforms(thread_pool);
     }
 
     // Not in m_scene_roots
-    m_context.tools->get_tool_scene_root()->get_hosted_scene()->update_node_transforms();
+    m_context.tools->get_tool_scene_root()->get_hosted_scene()->update_node_transforms(thread_pool);
 }
 
 void Editor_scenes::update_fixed_step(const Time_context& time_context)
@@ -95,7 +95,8 @@ void import_gltf(
         .root_node         = root_node,
         .mesh_layer_id     = scene_root.layers().content()->id,
         .path              = path,
-        .coordinate_system = y_up ? erhe::gltf::Coordinate_system::Y_up : erhe::gltf::Coordinate_system::Z_up
+        .coordinate_system = y_up ? erhe::gltf::Coordinate_system::Y_up : erhe::gltf::Coordinate_system::Z_up,
+        .thread_pool       = build_info.thread_pool
     };
     erhe::gltf::Gltf_data gltf_data = erhe::gltf::parse_gltf(parse_arguments);
 
@@ -1,13 +1,19 @@
 #include "parsers/wavefront_obj.hpp"
 #include "editor_log.hpp"
 
+#include "erhe_concurrency/parallel.hpp"
 #include "erhe_geometry/geometry.hpp"
-#include "erhe_file/file.hpp"
+#include "erhe_file/mapped_file.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
 #include <limits>
 #include <string>
+#include <string_view>
 
 namespace editor {
 
@@ -62,7 +68,7 @@ enum class Command : unsigned int {
     Vertex_normal,
 };
 
-Command tokenize(const std::string& text)
+auto tokenize(const std::string_view text) -> Command
 {
     // Vertex data
     if (text == "v")          return Command::Vertex_position;
@@ -114,347 +120,494 @@ Command tokenize(const std::string& text)
     return Command::Unknown;
 }
 
+
 // v 0 2.43544 -1.38593
 // vt -0.108459 1.75572
 // vn -1.64188e-16 -0.284002 0.958824
 // f 1/1/1 2/2/2 3/3/3 4/4/4
 
-auto parse_obj_geometry(
-    const std::filesystem::path& path
-) -> std::vector<std::shared_ptr<erhe::geometry::Geometry>>
+namespace {
+
+// Files are split to chunks at line boundaries, and chunks are parsed in
+// parallel. Chunk results are then merged, and geometries are built from
+// merged data in file order.
+constexpr std::size_t s_min_chunk_size = 4 * 1024 * 1024;
+
+constexpr int32_t c_no_index = std::numeric_limits<int32_t>::max();
+
+constexpr uint8_t c_relative_position = 1u << 0;
+constexpr uint8_t c_relative_texcoord = 1u << 1;
+constexpr uint8_t c_relative_normal   = 1u << 2;
+
+// Face corner vertex indices, zero based. Relative (negative) OBJ indices
+// are first stored as indices to chunk local arrays, which can be negative
+// when they refer to earlier chunks, and are made absolute when chunks are
+// merged.
+class Obj_corner
 {
-    ERHE_PROFILE_FUNCTION();
+public:
+    int32_t position     {c_no_index};
+    int32_t texcoord     {c_no_index};
+    int32_t normal       {c_no_index};
+    uint8_t relative_mask{0};
+};
 
-    log_parsers->trace("path = {}", path.generic_string());
+class Obj_group
+{
+public:
+    std::string_view name;
+    std::size_t      first_face; // chunk local
+};
 
-    std::vector<std::shared_ptr<erhe::geometry::Geometry>> result;
-    const auto opt_text = erhe::file::read("parse_obj_geometry", path);
-
-    // I dislike this big scope, I'd prefer just to
-    // return {} but unfortunately having more than
-    // one return kills named return value optimization.
-    if (opt_text.has_value()) {
-        const std::string& text = opt_text.value();
-
-        std::shared_ptr<erhe::geometry::Geometry> geometry{};
-        erhe::geometry::Property_map<erhe::geometry::Point_id,  glm::vec3>* point_positions {nullptr};
-        erhe::geometry::Property_map<erhe::geometry::Point_id,  glm::vec3>* point_colors    {nullptr};
-        erhe::geometry::Property_map<erhe::geometry::Corner_id, glm::vec3>* corner_normals  {nullptr};
-        erhe::geometry::Property_map<erhe::geometry::Corner_id, glm::vec2>* corner_texcoords{nullptr};
-
-        const std::string delimiters  = " \t\v";
-        const std::string end_of_line = "\n";
-        const std::string slash       = "/\r";
-        const std::string comment     = "#";
-
-        std::string::size_type line_last_pos = text.find_first_not_of(end_of_line, 0);
-        std::string::size_type line_pos      = text.find_first_of(end_of_line, line_last_pos);
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec3> colors;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec2> texcoords;
-
-        // Mapping from OBJ point id to erhe::geometry::Geometry::Point_Id
-        std::vector<Point_id>  obj_point_to_geometry_point;
-
-        bool has_vertex_colors = false;
-
-        while (
-            (line_pos != std::string::npos) ||
-            (line_last_pos != std::string::npos)
-        ) {
-            auto line = text.substr(line_last_pos, line_pos - line_last_pos);
-            line.erase(
-                std::remove(
-                    line.begin(),
-                    line.end(),
-                    '\r'
-                ),
-                line.end()
-            );
+class Obj_chunk
+{
+public:
+    std::vector<glm::vec3>   positions;
+    std::vector<glm::vec3>   colors;    // up to last position which has color
+    std::vector<glm::vec3>   normals;
+    std::vector<glm::vec2>   texcoords;
+    std::vector<Obj_corner>  corners;
+    std::vector<std::size_t> face_ends; // end of each face in corners
+    std::vector<Obj_group>   groups;    // o and g commands
+
+    // Offsets to merged arrays
+    std::size_t position_base{0};
+    std::size_t texcoord_base{0};
+    std::size_t normal_base  {0};
+};
 
-            // Drop comments
-            const auto coment_pos = line.find_first_of(comment);
-            if (coment_pos != std::string::npos) {
-                line.erase(line.begin() + coment_pos, line.end());
-            }
+[[nodiscard]] auto is_space(const char c) -> bool
+{
+    return (c == ' ') || (c == '\t') || (c == '\v') || (c == '\r');
+}
 
-            //log_parsers->trace("line: {}", line);
-            if (line.length() == 0) {
-                line_last_pos = text.find_first_not_of(end_of_line, line_pos);
-                line_pos      = text.find_first_of(end_of_line, line_last_pos);
-                continue;
-            }
+[[nodiscard]] auto trim(std::string_view text) -> std::string_view
+{
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
 
-            //const erhe::log::Indenter scope_indent;
+// Returns next whitespace separated token, and removes it from text
+[[nodiscard]] auto next_token(std::string_view& text) -> std::string_view
+{
+    std::size_t begin = 0;
+    while ((begin < text.size()) && is_space(text[begin])) {
+        ++begin;
+    }
+    std::size_t end = begin;
+    while ((end < text.size()) && !is_space(text[end])) {
+        ++end;
+    }
+    const std::string_view token = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return token;
+}
 
-            // process line
-            std::string::size_type token_last_pos = line.find_first_not_of(delimiters, 0);
-            std::string::size_type token_pos      = line.find_first_of    (delimiters, token_last_pos);
-            if (token_last_pos == std::string::npos || token_pos == std::string::npos) {
-                line_last_pos = text.find_first_not_of(end_of_line, line_pos);
-                line_pos      = text.find_first_of(end_of_line, line_last_pos);
-                continue;
-            }
+template <std::size_t N>
+[[nodiscard]] auto parse_floats(std::string_view args, std::array<float, N>& values) -> std::size_t
+{
+    std::size_t count = 0;
+    while (count < N) {
+        std::string_view token = next_token(args);
+        if (!token.empty() && (token.front() == '+')) {
+            token.remove_prefix(1);
+        }
+        if (token.empty()) {
+            break;
+        }
+        const auto result = std::from_chars(token.data(), token.data() + token.size(), values[count]);
+        if (result.ec != std::errc{}) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
 
-            const auto command_text = line.substr(token_last_pos, token_pos - token_last_pos);
-            const auto command      = tokenize(command_text);
-
-            //log_parsers->trace("command: {}", command_text);
-            std::vector<float> float_args;
-            std::vector<int>   int_args;
-            std::vector<int>   face_vertex_position_indices;
-            std::vector<int>   face_vertex_texcoord_indices;
-            std::vector<int>   face_vertex_normal_indices;
-            while ((token_pos != std::string::npos) || (token_last_pos != std::string::npos)) {
-                switch (command) {
-                    //using enum Command;
-                    case Command::Object_name: {
-                        // TODO Choose Geometry splitting based on o / g / s / mg
-                        //      Currently fixed to use g
-                        token_last_pos = line.find_first_not_of(end_of_line, token_pos);
-                        token_pos      = line.find_first_of    (end_of_line, token_last_pos);
-                        if (token_last_pos != std::string::npos || token_pos != std::string::npos) {
-                            const auto arg_text = line.substr(token_last_pos, token_pos - token_last_pos);
-                            geometry         = std::make_shared<erhe::geometry::Geometry>(arg_text);
-                            point_positions  = geometry->point_attributes().create<glm::vec3>(c_point_locations);
-                            point_colors     = geometry->point_attributes().create<glm::vec3>(c_point_colors);
-                            corner_normals   = geometry->corner_attributes().create<glm::vec3>(c_corner_normals);
-                            corner_texcoords = geometry->corner_attributes().create<glm::vec2>(c_corner_texcoords);
-                            result.push_back(geometry);
-                            obj_point_to_geometry_point.clear();
-                            log_parsers->trace("arg: {}", arg_text);
-                        }
-                        break;
-                    }
+// OBJ indices are one based, or negative and relative to end of vertex data
+// read so far.
+[[nodiscard]] auto parse_index(
+    const std::string_view text,
+    const std::size_t      local_count,
+    Obj_corner&            corner,
+    const uint8_t          relative_bit
+) -> int32_t
+{
+    int32_t value{0};
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if ((result.ec != std::errc{}) || (value == 0)) {
+        return c_no_index;
+    }
+    if (value > 0) {
+        return value - 1;
+    }
+    corner.relative_mask |= relative_bit;
+    return static_cast<int32_t>(local_count) + value;
+}
 
-                    case Command::Group_name: {
-                        token_last_pos = line.find_first_not_of(delimiters, token_pos);
-                        token_pos      = line.find_first_of(end_of_line, token_last_pos);
-                        if (token_last_pos != std::string::npos || token_pos != std::string::npos) {
-                            const auto arg_text = line.substr(token_last_pos, token_pos - token_last_pos);
-                            geometry         = std::make_shared<erhe::geometry::Geometry>(arg_text);
-                            point_positions  = geometry->point_attributes().create<glm::vec3>(c_point_locations);
-                            point_colors     = geometry->point_attributes().create<glm::vec3>(c_point_colors);
-                            corner_normals   = geometry->corner_attributes().create<glm::vec3>(c_corner_normals);
-                            corner_texcoords = geometry->corner_attributes().create<glm::vec2>(c_corner_texcoords);
-                            result.push_back(geometry);
-                            obj_point_to_geometry_point.clear();
-                            //log_parsers->trace("arg: {}", arg_text);
-                        }
-                        //token_pos = text.find_first_of(end_of_line, token_last_pos);
-                        break;
-                    }
+void parse_chunk(const std::string_view text, Obj_chunk& chunk)
+{
+    ERHE_PROFILE_FUNCTION();
 
-                    case Command::Use_material:
-                    case Command::Unknown:
-                    case Command::Material_library: {
-                        // consume rest of the line for now
-                        token_last_pos = line.find_first_not_of(end_of_line, token_pos);
-                        token_pos      = line.find_first_of    (end_of_line, token_last_pos);
-                        if (token_last_pos != std::string::npos || token_pos != std::string::npos) {
-                            const auto arg_text = line.substr(token_last_pos, token_pos - token_last_pos);
-                            //log_parsers->trace("arg: {}", arg_text);
-                        }
-                        //token_last_pos = line.find_first_not_of(end_of_line, token_pos);
-                        //token_pos = text.find_first_of(end_of_line, token_last_pos);
-                        break;
-                    }
+    std::size_t line_begin = 0;
+    while (line_begin < text.size()) {
+        std::size_t line_end = text.find('\n', line_begin);
+        if (line_end == std::string_view::npos) {
+            line_end = text.size();
+        }
+        std::string_view line = text.substr(line_begin, line_end - line_begin);
+        line_begin = line_end + 1;
 
-                    case Command::Vertex_position:
-                    // Three required variables: x, y, and z
-                    // One optional variable: w
-                    // Some applications support colors; if they are available, add RBG values after the variables.
-                    // The default is 1.
-
-                    case Command::Vertex_normal:
-                    // If a UV (vt) or vertex normal (vn) are defined for one vertex in a shape, they must be defined for all.
-                    // Three required variables: x, y, and z
-
-                    case Command::Vertex_texture_coordinate:
-                    // If a UV (vt) or vertex normal (vn) are defined for one vertex in a shape, they must be defined for all.
-                    // One required variable: u
-                    // Two optional variables: v and w
-                    // The default is 0.
-
-                    case Command::Vertex_parameter_space:
-                    // Use u for curve points
-                    // Use u and v for surface points and non-rational trimming curve control points
-                    // Use u, v, and w for rational trimming curve control points
-
-                    {
-                        token_last_pos = line.find_first_not_of(delimiters, token_pos);
-                        token_pos      = line.find_first_of    (delimiters, token_last_pos);
-                        if (token_last_pos != std::string::npos || token_pos != std::string::npos) {
-                            const auto  arg_text = line.substr(token_last_pos, token_pos - token_last_pos);
-                            const float value    = std::stof(arg_text);
-                            //log_parsers->trace("arg: {}", arg_text);
-                            float_args.push_back(value);
-                        }
-                        //token_last_pos = line.find_first_not_of(delimiters, token_pos);
-                        break;
-                    }
+        // Drop comments
+        const std::size_t comment_pos = line.find('#');
+        if (comment_pos != std::string_view::npos) {
+            line = line.substr(0, comment_pos);
+        }
 
-                    case Command::Face: {
-                        token_last_pos = line.find_first_not_of(delimiters, token_pos);
-                        token_pos      = line.find_first_of    (delimiters, token_last_pos);
-                        if (token_last_pos != std::string::npos || token_pos != std::string::npos) {
-                            const auto arg_text = line.substr(token_last_pos, token_pos - token_last_pos);
-                            //log_parsers->trace("arg: {}", arg_text);
-                            std::string::size_type subtoken_last_pos = arg_text.find_first_not_of(slash, 0);
-                            std::string::size_type subtoken_pos      = arg_text.find_first_of(slash, subtoken_last_pos);
-                            int subtoken_slot = 0;
-                            while ((subtoken_pos != std::string::npos) || (subtoken_last_pos != std::string::npos)) {
-                                const auto subtoken_text = arg_text.substr(subtoken_last_pos, subtoken_pos - subtoken_last_pos);
-                                //log_parsers->trace("subtoken: {}", subtoken_text);
-                                if (arg_text.length() > 0) {
-                                    const int value = std::stoi(subtoken_text);
-                                    switch (subtoken_slot) {
-                                        case 0: face_vertex_position_indices.push_back(value); break;
-                                        case 1: face_vertex_texcoord_indices.push_back(value); break;
-                                        case 2: face_vertex_normal_indices  .push_back(value); break;
-                                        default: {
-                                            //ERHE_FATAL("bad subtoken slot for wavefront obj parser face command");
-                                            break;
-                                        }
-                                    }
-                                }
-                                subtoken_last_pos = arg_text.find_first_not_of(slash, subtoken_pos);
-                                subtoken_pos      = arg_text.find_first_of    (slash, subtoken_last_pos);
-                                subtoken_slot++;
-                            }
-                        }
-                        //token_last_pos = line.find_first_not_of(delimiters, token_pos);
-                        break;
-                    }
+        const std::string_view command_text = next_token(line);
+        if (command_text.empty()) {
+            continue;
+        }
+
+        switch (tokenize(command_text)) {
+            case Command::Vertex_position: {
+                // Three required variables: x, y, and z
+                // Some applications support colors; if they are available, add RBG values after the variables.
+                std::array<float, 6> values;
+                const std::size_t count = parse_floats(line, values);
+                if (count < 3) {
+                    break;
+                }
+                if (count >= 6) {
+                    chunk.colors.resize(chunk.positions.size(), glm::vec3{1.0f, 1.0f, 1.0f});
+                    chunk.colors.emplace_back(values[3], values[4], values[5]);
                 }
+                chunk.positions.emplace_back(values[0], values[1], values[2]);
+                break;
             }
 
-            switch (command) {
-                //using enum Command;
-                case Command::Group_name:
-                case Command::Use_material:
-                case Command::Unknown:
-                case Command::Material_library:
-                default:
-                    break;
-                case Command::Vertex_position: {
-                    //ZoneScopedN("position");
-                    if (float_args.size() >= 3) {
-                        Expects(geometry);
-                        if (float_args.size() >= 6) {
-                            while (colors.size() < positions.size()) {
-                                colors.emplace_back(1.0f, 1.0f, 1.0f);
-                            }
-                            colors.emplace_back(float_args[3], float_args[4], float_args[5]);
-                            has_vertex_colors = true;
-                            //point_colors->put(point_id, glm::vec3{float_args[3], float_args[4], float_args[5]});
-                        }
+            case Command::Vertex_normal: {
+                // Three required variables: x, y, and z
+                std::array<float, 3> values;
+                if (parse_floats(line, values) == 3) {
+                    chunk.normals.emplace_back(values[0], values[1], values[2]);
+                }
+                break;
+            }
 
-                        positions.emplace_back(float_args[0], float_args[1], float_args[2]);
-                    }
-                    //else
-                    //{
-                    //    ERHE_FATAL("unsupported vertex dimension");
-                    //}
-                    break;
+            case Command::Vertex_texture_coordinate: {
+                // One required variable: u
+                // Two optional variables: v and w
+                // The default is 0.
+                std::array<float, 2> values{0.0f, 0.0f};
+                if (parse_floats(line, values) >= 1) {
+                    chunk.texcoords.emplace_back(values[0], values[1]);
                 }
+                break;
+            }
 
-                case Command::Vertex_normal: {
-                    //ZoneScopedN("normal");
-                    if (float_args.size() == 3) {
-                        normals.emplace_back(float_args[0], float_args[1], float_args[2]);
+            case Command::Face: {
+                // Corners are v, v/vt, v//vn or v/vt/vn
+                const std::size_t first_corner = chunk.corners.size();
+                for (std::string_view token = next_token(line); !token.empty(); token = next_token(line)) {
+                    Obj_corner corner;
+                    const std::size_t slash0 = token.find('/');
+                    // Invalid position index is kept, so that the whole face is skipped
+                    corner.position = parse_index(token.substr(0, slash0), chunk.positions.size(), corner, c_relative_position);
+                    if (slash0 != std::string_view::npos) {
+                        const std::string_view rest   = token.substr(slash0 + 1);
+                        const std::size_t      slash1 = rest.find('/');
+                        corner.texcoord = parse_index(rest.substr(0, slash1), chunk.texcoords.size(), corner, c_relative_texcoord);
+                        if (slash1 != std::string_view::npos) {
+                            corner.normal = parse_index(rest.substr(slash1 + 1), chunk.normals.size(), corner, c_relative_normal);
+                        }
                     }
-                    //else
-                    //{
-                    //    ERHE_FATAL("unsupported normal dimension");
-                    //}
-                    break;
+                    chunk.corners.push_back(corner);
                 }
-                case Command::Vertex_texture_coordinate: {
-                    //ZoneScopedN("texcoord");
-                    // TODO support 1 / 3
-                    if (float_args.size() == 2) {
-                        texcoords.emplace_back(float_args[0], float_args[1]);
-                    }
-                    //else
-                    //{
-                    //    ERHE_FATAL("unsupported texcoord dimension");
-                    //}
-                    break;
+                if (chunk.corners.size() > first_corner) {
+                    chunk.face_ends.push_back(chunk.corners.size());
                 }
-                case Command::Face: {
-                    //ZoneScopedN("face");
-                    Expects(geometry);
-
-                    const Polygon_id polygon_id   = geometry->make_polygon();
-                    const int        corner_count = static_cast<int>(face_vertex_position_indices.size());
-                    for (int i = 0; i < corner_count; ++i) {
-                        const int obj_vertex_index = face_vertex_position_indices[i];
-                        const int position_index =
-                            (obj_vertex_index > 0)
-                                ? obj_vertex_index - 1
-                                : obj_vertex_index + static_cast<int>(positions.size());
-
-                        // Vertex indices in OBJ file are global.
-                        // Each erhe::geometry Geometry has it's own namespace for Point_id.
-                        // This maps OBJ vertex indices to geometry Point_id.
-                        constexpr auto null_point = std::numeric_limits<Point_id>::max();
-                        while (static_cast<int>(obj_point_to_geometry_point.size()) <= position_index) {
-                            obj_point_to_geometry_point.push_back(null_point);
-                        }
-                        if (obj_point_to_geometry_point[position_index] == null_point) {
-                            obj_point_to_geometry_point[position_index] = geometry->make_point();
-                        }
+                break;
+            }
 
-                        const Point_id  point_id  = obj_point_to_geometry_point[position_index];
-                        const Corner_id corner_id = geometry->make_polygon_corner(polygon_id, point_id);
-                        ERHE_VERIFY(position_index >= 0);
-                        ERHE_VERIFY(position_index < static_cast<int>(positions.size()));
+            case Command::Object_name:
+            case Command::Group_name: {
+                // TODO Choose Geometry splitting based on o / g / s / mg
+                const std::string_view name = trim(line);
+                if (!name.empty()) {
+                    chunk.groups.push_back(Obj_group{.name = name, .first_face = chunk.face_ends.size()});
+                }
+                break;
+            }
 
-                        point_positions->put(point_id, positions[position_index]);
+            case Command::Use_material:
+            case Command::Material_library:
+            case Command::Vertex_parameter_space:
+            case Command::Unknown:
+            default: {
+                break;
+            }
+        }
+    }
+}
 
-                        if (has_vertex_colors) {
-                            point_colors->put(point_id, colors[position_index]);
-                        }
+void resolve_relative_indices(Obj_chunk& chunk)
+{
+    for (Obj_corner& corner : chunk.corners) {
+        if (corner.relative_mask == 0) {
+            continue;
+        }
+        if ((corner.relative_mask & c_relative_position) != 0) {
+            corner.position += static_cast<int32_t>(chunk.position_base);
+        }
+        if ((corner.relative_mask & c_relative_texcoord) != 0) {
+            corner.texcoord += static_cast<int32_t>(chunk.texcoord_base);
+        }
+        if ((corner.relative_mask & c_relative_normal) != 0) {
+            corner.normal += static_cast<int32_t>(chunk.normal_base);
+        }
+        corner.relative_mask = 0;
+    }
+}
 
-                        if (i < static_cast<int>(face_vertex_texcoord_indices.size())) {
-                            const int obj_texcoord_index = face_vertex_texcoord_indices[i];
-                            const int texcoord_index =
-                                (obj_texcoord_index > 0)
-                                    ? obj_texcoord_index - 1
-                                    : obj_texcoord_index + static_cast<int>(texcoords.size());
-                            ERHE_VERIFY(texcoord_index < static_cast<int>(texcoords.size()));
-                            corner_texcoords->put(corner_id, texcoords[texcoord_index]);
-                        }
+template <typename T>
+void append(std::vector<T>& destination, const std::vector<T>& source)
+{
+    destination.insert(destination.end(), source.begin(), source.end());
+}
 
-                        if (i < static_cast<int>(face_vertex_normal_indices.size())) {
-                            const int obj_normal_index = face_vertex_normal_indices[i];
-                            const int normal_index =
-                                (obj_normal_index > 0)
-                                    ? obj_normal_index - 1
-                                    : obj_normal_index + static_cast<int>(normals.size());
-                            ERHE_VERIFY(normal_index < static_cast<int>(normals.size()));
-                            corner_normals->put(corner_id, normals[normal_index]);
-                        }
-                    }
-                }
+[[nodiscard]] auto is_valid_index(const int32_t index, const std::size_t count) -> bool
+{
+    return (index >= 0) && (static_cast<std::size_t>(index) < count);
+}
+
+} // anonymous namespace
+
+auto parse_obj_geometry(
+    const std::filesystem::path&    path,
+    erhe::concurrency::Thread_pool* thread_pool,
+    Obj_parse_statistics*           statistics
+) -> std::vector<std::shared_ptr<erhe::geometry::Geometry>>
+{
+    ERHE_PROFILE_FUNCTION();
+
+    log_parsers->trace("path = {}", path.generic_string());
+
+    std::vector<std::shared_ptr<erhe::geometry::Geometry>> result;
+    const erhe::file::Mapped_file file{"parse_obj_geometry", path};
+    if (!file.is_open()) {
+        return result;
+    }
+
+    const auto             start_time = std::chrono::steady_clock::now();
+    const std::string_view text{reinterpret_cast<const char*>(file.data()), file.size()};
+
+    // Split file to chunks at line boundaries
+    const std::size_t worker_count = (thread_pool != nullptr) ? static_cast<std::size_t>(thread_pool->size()) : 0;
+    const std::size_t chunk_count  = (worker_count > 0) ? std::clamp<std::size_t>(text.size() / s_min_chunk_size, 1, 4 * (worker_count + 1)) : 1;
+    std::vector<std::size_t> chunk_begins(chunk_count + 1, text.size());
+    chunk_begins[0] = 0;
+    for (std::size_t i = 1; i < chunk_count; ++i) {
+        const std::size_t split    = std::max(chunk_begins[i - 1], i * text.size() / chunk_count);
+        const std::size_t line_end = text.find('\n', split);
+        chunk_begins[i] = (line_end != std::string_view::npos) ? line_end + 1 : text.size();
+    }
+
+    std::vector<Obj_chunk> chunks(chunk_count);
+    if (chunk_count > 1) {
+        erhe::concurrency::parallel_for_each_index(
+            *thread_pool, 0, chunk_count, 1,
+            [&text, &chunk_begins, &chunks](const std::size_t i) {
+                parse_chunk(text.substr(chunk_begins[i], chunk_begins[i + 1] - chunk_begins[i]), chunks[i]);
             }
+        );
+    } else {
+        parse_chunk(text, chunks.front());
+    }
+    const auto parse_end_time = std::chrono::steady_clock::now();
+
+    // Merge vertex data
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+    {
+        ERHE_PROFILE_SCOPE("merge");
+
+        std::size_t position_count = 0;
+        std::size_t normal_count   = 0;
+        std::size_t texcoord_count = 0;
+        bool        has_colors     = false;
+        for (Obj_chunk& chunk : chunks) {
+            chunk.position_base = position_count;
+            chunk.normal_base   = normal_count;
+            chunk.texcoord_base = texcoord_count;
+            position_count += chunk.positions.size();
+            normal_count   += chunk.normals  .size();
+            texcoord_count += chunk.texcoords.size();
+            has_colors = has_colors || !chunk.colors.empty();
+        }
+        positions.reserve(position_count);
+        normals  .reserve(normal_count);
+        texcoords.reserve(texcoord_count);
+        for (const Obj_chunk& chunk : chunks) {
+            append(positions, chunk.positions);
+            append(normals,   chunk.normals);
+            append(texcoords, chunk.texcoords);
+            if (has_colors) {
+                append(colors, chunk.colors);
+                colors.resize(positions.size(), glm::vec3{1.0f, 1.0f, 1.0f});
+            }
+        }
 
-            line_last_pos = text.find_first_not_of(end_of_line, line_pos);
-            line_pos = text.find_first_of(end_of_line, line_last_pos);
+        if (chunk_count > 1) {
+            erhe::concurrency::parallel_for_each_index(
+                *thread_pool, 0, chunk_count, 1,
+                [&chunks](const std::size_t i) {
+                    resolve_relative_indices(chunks[i]);
+                }
+            );
+        } else {
+            resolve_relative_indices(chunks.front());
         }
+    }
 
-        for (auto g : result) {
-            ERHE_PROFILE_SCOPE("post processing");
+    // Build geometries in file order
+    std::shared_ptr<erhe::geometry::Geometry> geometry{};
+    erhe::geometry::Property_map<erhe::geometry::Point_id,  glm::vec3>* point_positions {nullptr};
+    erhe::geometry::Property_map<erhe::geometry::Point_id,  glm::vec3>* point_colors    {nullptr};
+    erhe::geometry::Property_map<erhe::geometry::Corner_id, glm::vec3>* corner_normals  {nullptr};
+    erhe::geometry::Property_map<erhe::geometry::Corner_id, glm::vec2>* corner_texcoords{nullptr};
+
+    // Mapping from OBJ point id to erhe::geometry::Geometry::Point_Id.
+    // Vertex indices in OBJ file are global. Each erhe::geometry Geometry
+    // has it's own namespace for Point_id.
+    constexpr auto        null_point = std::numeric_limits<Point_id>::max();
+    std::vector<Point_id> obj_point_to_geometry_point(positions.size(), null_point);
+    std::vector<int32_t>  mapped_obj_points;
+    std::size_t           face_number       {0}; // one based, in file order
+    std::size_t           invalid_face_count{0};
+
+    const auto begin_geometry = [&](const std::string_view name) {
+        geometry         = std::make_shared<erhe::geometry::Geometry>(std::string{name});
+        point_positions  = geometry->point_attributes().create<glm::vec3>(c_point_locations);
+        point_colors     = geometry->point_attributes().create<glm::vec3>(c_point_colors);
+        corner_normals   = geometry->corner_attributes().create<glm::vec3>(c_corner_normals);
+        corner_texcoords = geometry->corner_attributes().create<glm::vec2>(c_corner_texcoords);
+        result.push_back(geometry);
+        for (const int32_t obj_point : mapped_obj_points) {
+            obj_point_to_geometry_point[obj_point] = null_point;
+        }
+        mapped_obj_points.clear();
+    };
+
+    const auto add_face = [&](const Obj_corner* const corners, const std::size_t corner_count) {
+        for (std::size_t i = 0; i < corner_count; ++i) {
+            const Obj_corner& corner = corners[i];
+            if (
+                !is_valid_index(corner.position, positions.size()) ||
+                ((corner.texcoord != c_no_index) && !is_valid_index(corner.texcoord, texcoords.size())) ||
+                ((corner.normal   != c_no_index) && !is_valid_index(corner.normal,   normals  .size()))
+            ) {
+                log_parsers->debug(
+                    "{}: face {} skipped, corner {} has invalid vertex index",
+                    path.generic_string(), face_number, i + 1
+                );
+                ++invalid_face_count;
+                return;
+            }
+        }
 
-            g->make_point_corners();
+        const Polygon_id polygon_id = geometry->make_polygon();
+        for (std::size_t i = 0; i < corner_count; ++i) {
+            const Obj_corner& corner = corners[i];
+            Point_id& point_id = obj_point_to_geometry_point[corner.position];
+            if (point_id == null_point) {
+                point_id = geometry->make_point();
+                mapped_obj_points.push_back(corner.position);
+                point_positions->put(point_id, positions[corner.position]);
+                if (!colors.empty()) {
+                    point_colors->put(point_id, colors[corner.position]);
+                }
+            }
+
+            const Corner_id corner_id = geometry->make_polygon_corner(polygon_id, point_id);
+            if (corner.texcoord != c_no_index) {
+                corner_texcoords->put(corner_id, texcoords[corner.texcoord]);
+            }
+            if (corner.normal != c_no_index) {
+                corner_normals->put(corner_id, normals[corner.normal]);
+            }
+        }
+    };
 
-            g->build_edges();
-            g->generate_polygon_texture_coordinates();
-            g->compute_tangents();
+    {
+        ERHE_PROFILE_SCOPE("build geometries");
+
+        for (const Obj_chunk& chunk : chunks) {
+            std::size_t group_index  = 0;
+            std::size_t corner_begin = 0;
+            for (std::size_t face = 0, face_count = chunk.face_ends.size(); face < face_count; ++face) {
+                while ((group_index < chunk.groups.size()) && (chunk.groups[group_index].first_face == face)) {
+                    begin_geometry(chunk.groups[group_index++].name);
+                }
+                if (!geometry) {
+                    begin_geometry(path.stem().string());
+                }
+                const std::size_t corner_end = chunk.face_ends[face];
+                ++face_number;
+                add_face(&chunk.corners[corner_begin], corner_end - corner_begin);
+                corner_begin = corner_end;
+            }
+            while (group_index < chunk.groups.size()) {
+                begin_geometry(chunk.groups[group_index++].name);
+            }
         }
     }
+    if (invalid_face_count > 0) {
+        log_parsers->warn("{}: {} faces with invalid vertex indices were skipped", path.generic_string(), invalid_face_count);
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+    const auto parse_ms = std::chrono::duration_cast<std::chrono::milliseconds>(parse_end_time - start_time).count();
+    const auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    const double megabytes = static_cast<double>(text.size()) / (1024.0 * 1024.0);
+    log_parsers->info(
+        "{}: {:.1f} MB, {} chunks, parse {} ms ({:.1f} MB/s), total {} ms",
+        path.generic_string(),
+        megabytes,
+        chunk_count,
+        parse_ms,
+        (parse_ms > 0) ? 1000.0 * megabytes / static_cast<double>(parse_ms) : 0.0,
+        total_ms
+    );
+
+    for (auto g : result) {
+        ERHE_PROFILE_SCOPE("post processing");
+
+        g->make_point_corners();
+
+        g->build_edges();
+        g->generate_polygon_texture_coordinates();
+        g->compute_tangents();
+    }
+
+    if (statistics != nullptr) {
+        const auto post_processing_end_time = std::chrono::steady_clock::now();
+        *statistics = Obj_parse_statistics{
+            .byte_count         = text.size(),
+            .chunk_count        = chunk_count,
+            .face_count         = face_number,
+            .invalid_face_count = invalid_face_count,
+            .parse_ms           = std::chrono::duration<double, std::milli>(parse_end_time - start_time).count(),
+            .total_ms           = std::chrono::duration<double, std::milli>(post_processing_end_time - start_time).count()
+        };
+    }
 
     return result;
 }
@@ -1,17 +1,34 @@
 #pragma once
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::geometry {
     class Geometry;
 }
 
+#include <cstddef>
 #include <filesystem>
 #include <memory>
 #include <vector>
 
 namespace editor {
 
+class Obj_parse_statistics
+{
+public:
+    std::size_t byte_count        {0};
+    std::size_t chunk_count       {0};
+    std::size_t face_count        {0};
+    std::size_t invalid_face_count{0}; // skipped faces
+    double      parse_ms          {0.0}; // text to vertex and face arrays
+    double      total_ms          {0.0}; // including geometry build and post processing
+};
+
 [[nodiscard]] auto parse_obj_geometry(
-    const std::filesystem::path& path
+    const std::filesystem::path&    path,
+    erhe::concurrency::Thread_pool* thread_pool,          // chunks are parsed serially if not set
+    Obj_parse_statistics*           statistics = nullptr
 ) -> std::vector<std::shared_ptr<erhe::geometry::Geometry>>;
 
 }
@@ -249,7 +249,8 @@ void Id_renderer::update_framebuffer(const erhe::math::Viewport viewport)
 }
 
 void Id_renderer::render(
-    const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes
+    const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+    const std::size_t                                          span_index
 )
 {
     ERHE_PROFILE_FUNCTION();
@@ -269,7 +270,9 @@ void Id_renderer::render(
     const auto draw_indirect_buffer_range = m_draw_indirect_buffers.update(
         meshes,
         erhe::primitive::Primitive_mode::polygon_fill,
-        id_filter
+        id_filter,
+        {},
+        erhe::renderer::Persistent_block_key{.owner = this, .index = span_index}
     );
     if (draw_indirect_buffer_range.draw_indirect_count == 0) {
         return;
@@ -383,19 +386,24 @@ void Id_renderer::render(const Render_parameters& parameters)
 
     m_primitive_buffers.reset_id_ranges();
 
+    // Span index identifies persistent draw indirect block of the span. Tool
+    // spans are drawn twice with the same index, and share the block.
+    std::size_t span_index = 0;
     m_graphics_instance.opengl_state_tracker.execute(m_pipeline);
     for (auto meshes : content_mesh_spans) {
         //ERHE_PROFILE_GPU_SCOPE(c_id_renderer_render_content)
-        render(meshes);
+        render(meshes, span_index++);
     }
+    const std::size_t first_tool_span_index = span_index;
 
     // Clear depth for tool pixels
     {
         //ERHE_PROFILE_GPU_SCOPE(c_id_renderer_render_tool)
         m_graphics_instance.opengl_state_tracker.execute(m_selective_depth_clear_pipeline);
         gl::depth_range(0.0f, 0.0f);
+        span_index = first_tool_span_index;
         for (auto mesh_spans : tool_mesh_spans) {
-            render(mesh_spans);
+            render(mesh_spans, span_index++);
         }
     }
 
@@ -406,8 +414,9 @@ void Id_renderer::render(const Render_parameters& parameters)
         m_graphics_instance.opengl_state_tracker.execute(m_pipeline);
         gl::depth_range(0.0f, 1.0f);
 
+        span_index = first_tool_span_index;
         for (auto meshes : tool_mesh_spans) {
-            render(meshes);
+            render(meshes, span_index++);
         }
     }
 
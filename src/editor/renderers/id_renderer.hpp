@@ -147,7 +147,8 @@ private:
     };
 
     void render(
-        const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes
+        const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+        std::size_t                                                span_index
     );
 
     std::vector<Range> m_ranges;
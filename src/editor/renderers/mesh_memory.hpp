@@ -25,6 +25,9 @@ namespace erhe::scene_renderer {
 namespace editor
 {
 
+// Vertex and index buffer allocation is thread safe, so primitives can
+// be built from worker threads. Buffer data is queued to
+// gl_buffer_transfer_queue and uploaded by flush() on the main thread.
 class Mesh_memory
 {
 public:
@@ -143,7 +143,8 @@ void Shadow_render_node::execute_rendergraph_node()
             .mesh_spans            = { layers.content()->meshes },
             .lights                = layers.light()->lights,
             .skins                 = scene_root->get_scene().get_skins(),
-            .light_projections     = m_light_projections
+            .light_projections     = m_light_projections,
+            .thread_pool           = m_context.thread_pool
         }
     );
 }
@@ -91,7 +91,9 @@ void Scene_open_operation::execute(Editor_context& context)
                     .corner_points   = true,
                     .centroid_points = true
                 },
-                .buffer_info = context.mesh_memory->buffer_info
+                .buffer_info            = context.mesh_memory->buffer_info,
+                .thread_pool            = context.thread_pool,
+                .background_thread_pool = context.background_thread_pool
             },
             *m_scene_root.get(),
             m_path,
@@ -305,7 +307,9 @@ auto Asset_browser::try_import(
                     .corner_points   = true,
                     .centroid_points = true
                 },
-                .buffer_info = m_context.mesh_memory->buffer_info
+                .buffer_info            = m_context.mesh_memory->buffer_info,
+                .thread_pool            = m_context.thread_pool,
+                .background_thread_pool = m_context.background_thread_pool
             },
             *m_context.scene_builder->get_scene_root().get(),
             gltf->get_source_path(),
@@ -126,20 +126,27 @@ void Node_physics::after_physics_simulation()
     }
 
     const auto transform = m_rigid_body->get_world_transform();
-    const glm::vec3 world_position = glm::vec3{transform * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
-
-    if (world_position.y < -100.0f) {
-        const glm::vec3 respawn_location{0.0f, 8.0f, 0.0f};
-        m_rigid_body->set_world_transform (erhe::physics::Transform{glm::mat3{1.0f}, respawn_location});
-        m_rigid_body->set_linear_velocity (glm::vec3{0.0f, 0.0f, 0.0f});
-        m_rigid_body->set_angular_velocity(glm::vec3{0.0f, 0.0f, 0.0f});
-        const glm::mat4 matrix = erhe::math::create_translation<float>(respawn_location);
-        get_node()->set_world_from_node(matrix);
-    } else {
+    if (!respawn_if_fallen(transform)) {
         get_node()->set_world_from_node(transform);
     }
 }
 
+auto Node_physics::respawn_if_fallen(const glm::mat4& world_from_body) -> bool
+{
+    const glm::vec3 world_position = glm::vec3{world_from_body * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+    if (world_position.y >= -100.0f) {
+        return false;
+    }
+
+    const glm::vec3 respawn_location{0.0f, 8.0f, 0.0f};
+    m_rigid_body->set_world_transform (erhe::physics::Transform{glm::mat3{1.0f}, respawn_location});
+    m_rigid_body->set_linear_velocity (glm::vec3{0.0f, 0.0f, 0.0f});
+    m_rigid_body->set_angular_velocity(glm::vec3{0.0f, 0.0f, 0.0f});
+    const glm::mat4 matrix = erhe::math::create_translation<float>(respawn_location);
+    get_node()->set_world_from_node(matrix);
+    return true;
+}
+
 auto Node_physics::get_rigid_body() -> IRigid_body*
 {
     return (m_physics_world != nullptr) ? m_rigid_body.get() : nullptr;
@@ -48,6 +48,10 @@ public:
     void before_physics_simulation();
     void after_physics_simulation();
 
+    // Moves body which has fallen out of the world back to respawn location.
+    // Returns false if body was not moved.
+    auto respawn_if_fallen(const glm::mat4& world_from_body) -> bool;
+
     void set_physics_world(erhe::physics::IWorld* value);
     [[nodiscard]] auto get_physics_world() const -> erhe::physics::IWorld*;
 
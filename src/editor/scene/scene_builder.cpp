@@ -1,5 +1,6 @@
 #include "scene/scene_builder.hpp"
 
+#include "editor_log.hpp"
 #include "editor_rendering.hpp"
 #include "editor_scenes.hpp"
 #include "editor_settings.hpp"
@@ -45,6 +46,7 @@
 #include "erhe_scene/transform.hpp"
 #include "erhe_math/math_util.hpp"
 #include "erhe_profile/profile.hpp"
+#include "erhe_time/timer.hpp"
 #include "erhe_verify/verify.hpp"
 
 #include <fmt/format.h>
@@ -83,6 +85,16 @@ using glm::vec4;
 
 constexpr bool global_instantiate = true;
 
+namespace {
+
+// Scene builder jobs may run in parallel. Brushes are registered to content
+// library and scene after all jobs have completed, sorted by job index and
+// by sequence within job, so that the result does not depend on scheduling.
+thread_local std::size_t t_brush_job_index   {0};
+thread_local std::size_t t_brush_job_sequence{0};
+
+}
+
 Scene_builder::Config::Config()
 {
     auto ini = erhe::configuration::get_ini("erhe.ini", "scene");
@@ -365,16 +377,55 @@ auto Scene_builder::make_brush(
     const bool   instantiate_to_scene
 ) -> std::shared_ptr<Brush>
 {
-    auto content_library = m_scene_root->content_library();
-    const auto brush = content_library->brushes->make<Brush>(brush_create_info);
+    // This may be called from scene builder worker threads. Content library
+    // is not thread safe, brush is registered later in register_brushes().
+    const auto brush = std::make_shared<Brush>(brush_create_info);
     if (instantiate_to_scene) {
-        const std::lock_guard<std::mutex> lock{m_scene_brushes_mutex};
-
-        m_scene_brushes.push_back(brush);
+        // Build primitive buffers and collision shape here, in parallel,
+        // instead of in make_mesh_nodes() on the main thread. Mesh_memory
+        // buffer allocation is thread safe and GL uploads are deferred to
+        // Buffer_transfer_queue::flush().
+        brush->late_initialize();
     }
+
+    const std::lock_guard<std::mutex> lock{m_scene_brushes_mutex};
+    m_pending_brushes.push_back(
+        Pending_brush{
+            .job_index            = t_brush_job_index,
+            .job_sequence         = t_brush_job_sequence++,
+            .brush                = brush,
+            .instantiate_to_scene = instantiate_to_scene
+        }
+    );
     return brush;
 }
 
+void Scene_builder::register_brushes()
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const std::lock_guard<std::mutex> lock{m_scene_brushes_mutex};
+
+    std::sort(
+        m_pending_brushes.begin(),
+        m_pending_brushes.end(),
+        [](const Pending_brush& lhs, const Pending_brush& rhs) {
+            return (lhs.job_index != rhs.job_index)
+                ? (lhs.job_index    < rhs.job_index)
+                : (lhs.job_sequence < rhs.job_sequence);
+        }
+    );
+
+    auto content_library = m_scene_root->content_library();
+    for (const auto& pending_brush : m_pending_brushes) {
+        content_library->brushes->add(pending_brush.brush);
+        if (pending_brush.instantiate_to_scene) {
+            m_scene_brushes.push_back(pending_brush.brush);
+        }
+    }
+    m_pending_brushes.clear();
+}
+
 auto Scene_builder::make_brush(
     Editor_settings&           editor_settings,
     Mesh_memory&               mesh_memory,
@@ -404,7 +455,9 @@ auto Scene_builder::build_info(Mesh_memory& mesh_memory) -> erhe::primitive::Bui
             .corner_points   = true,
             .centroid_points = true
         },
-        .buffer_info = mesh_memory.buffer_info
+        .buffer_info            = mesh_memory.buffer_info,
+        .thread_pool            = m_context.thread_pool,
+        .background_thread_pool = m_context.background_thread_pool
     };
 }
 
@@ -436,19 +489,40 @@ void Scene_builder::make_brushes(
 {
     ERHE_PROFILE_FUNCTION();
 
+    erhe::time::Timer timer{"make_brushes"};
+    timer.begin();
+
     std::unique_ptr<ITask_queue> execution_queue;
 
-    const bool parallel_initialization = false; //// TODO
-    if (parallel_initialization) {
-        const std::size_t thread_count = std::min(
-            8U,
-            std::max(std::thread::hardware_concurrency() - 0, 1U)
-        );
-        execution_queue = std::make_unique<Parallel_task_queue>("scene builder", thread_count);
+    bool parallel_initialization = true;
+    {
+        auto ini = erhe::configuration::get_ini("erhe.ini", "threading");
+        ini->get("parallel_init", parallel_initialization);
+    }
+    int thread_count = 1;
+    if (parallel_initialization && (m_context.thread_pool != nullptr)) {
+        // Main thread helps while it waits for the queue
+        execution_queue = std::make_unique<Parallel_task_queue>(*m_context.thread_pool, "scene builder");
+        thread_count    = m_context.thread_pool->size() + 1;
     } else {
+        parallel_initialization = false;
         execution_queue = std::make_unique<Serial_task_queue>();
     }
 
+    // Jobs are wrapped as they are, without std::function, so that their
+    // captures are stored in Task_function
+    std::size_t job_count = 0;
+    auto enqueue_job = [&execution_queue, &job_count](auto&& job) {
+        const std::size_t job_index = job_count++;
+        execution_queue->enqueue(
+            [job_index, job = std::forward<decltype(job)>(job)]() {
+                t_brush_job_index    = job_index;
+                t_brush_job_sequence = 0;
+                job();
+            }
+        );
+    };
+
     // Floor
     if (config.floor) {
         auto floor_box_shape = erhe::physics::ICollision_shape::create_box_shape_shared(
@@ -458,8 +532,8 @@ void Scene_builder::make_brushes(
         // Otherwise it will be destructed when leave add_floor() scope
         m_collision_shapes.push_back(floor_box_shape);
 
-        execution_queue->enqueue(
-            [this, &floor_box_shape, &editor_settings, &mesh_memory]() {
+        enqueue_job(
+            [this, floor_box_shape, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Floor brush");
 
                 auto floor_geometry = std::make_shared<erhe::geometry::Geometry>(
@@ -480,32 +554,15 @@ void Scene_builder::make_brushes(
                         .collision_shape = floor_box_shape,
                     }
                 );
+                m_floor_brush->late_initialize();
             }
         );
     }
 
     constexpr bool anisotropic_test_object = false;
 
-    if (config.gltf_files) {
-#if !defined(ERHE_GLTF_LIBRARY_NONE)
-        //execution_queue->enqueue(
-        //    [this]()
-            {
-                ERHE_PROFILE_SCOPE("parse gltf files");
-
-                import_gltf(
-                    graphics_instance,
-                    build_info(mesh_memory),
-                    *m_scene_root.get(),
-                    "res/assets/sample_models/SimpleSkin.gltf"
-                );
-            }
-        //);
-#endif
-    }
-
     if (config.obj_files) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("parse .obj files");
 
@@ -518,7 +575,7 @@ void Scene_builder::make_brushes(
                     //"res/models/spoon.obj"
                 };
                 for (auto* path : obj_files_names) {
-                    auto geometries = parse_obj_geometry(path);
+                    auto geometries = parse_obj_geometry(path, m_context.thread_pool);
 
                     for (auto& geometry : geometries) {
                         geometry->compute_polygon_normals();
@@ -547,7 +604,7 @@ void Scene_builder::make_brushes(
     }
 
     if (config.platonic_solids) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Platonic solids");
 
@@ -578,7 +635,7 @@ void Scene_builder::make_brushes(
     }
 
     if (config.sphere) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Sphere");
                 constexpr bool instantiate = global_instantiate;
@@ -608,7 +665,7 @@ void Scene_builder::make_brushes(
     }
 
     if (config.torus) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Torus");
 
@@ -693,7 +750,7 @@ void Scene_builder::make_brushes(
     }
 
     if (config.cylinder) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Cylinder");
 
@@ -732,7 +789,7 @@ void Scene_builder::make_brushes(
     }
 
     if (config.cone) {
-        execution_queue->enqueue(
+        enqueue_job(
             [this, &editor_settings, &mesh_memory]() {
                 ERHE_PROFILE_SCOPE("Cone");
 
@@ -830,7 +887,7 @@ void Scene_builder::make_brushes(
 
         library = Json_library("res/polyhedra/johnson.json");
         for (const auto& key_name : library.names) {
-            execution_queue->enqueue(
+            enqueue_job(
                 [this, &editor_settings, &mesh_memory, &library, &key_name]() {
                     auto geometry = library.make_geometry(key_name);
                     if (geometry.get_polygon_count() == 0) {
@@ -859,9 +916,37 @@ void Scene_builder::make_brushes(
         }
     }
 
+    // glTF import creates textures and adds nodes to the scene, so it is done
+    // on the main thread, overlapping with brush jobs running in workers.
+    if (config.gltf_files) {
+#if !defined(ERHE_GLTF_LIBRARY_NONE)
+        ERHE_PROFILE_SCOPE("parse gltf files");
+
+        import_gltf(
+            graphics_instance,
+            build_info(mesh_memory),
+            *m_scene_root.get(),
+            "res/assets/sample_models/SimpleSkin.gltf"
+        );
+#endif
+    }
+
     execution_queue->wait();
 
+    register_brushes();
+
     mesh_memory.gl_buffer_transfer_queue.flush();
+
+    timer.end();
+    const auto duration = timer.duration();
+    if (duration.has_value()) {
+        log_startup->info(
+            "make_brushes() {} with {} threads: {} ms",
+            parallel_initialization ? "parallel" : "serial",
+            thread_count,
+            std::chrono::duration_cast<std::chrono::milliseconds>(duration.value()).count()
+        );
+    }
 }
 
 void Scene_builder::add_room()
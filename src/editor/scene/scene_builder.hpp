@@ -178,6 +178,7 @@ private:
         Mesh_memory&              mesh_memory
     );
     void make_mesh_nodes    ();
+    void register_brushes   ();
     void make_cube_benchmark(Mesh_memory& mesh_memory);
     void setup_lights       ();
 
@@ -190,6 +191,16 @@ private:
     std::mutex                          m_scene_brushes_mutex;
     std::vector<std::shared_ptr<Brush>> m_scene_brushes;
 
+    class Pending_brush
+    {
+    public:
+        std::size_t            job_index           {0};
+        std::size_t            job_sequence        {0};
+        std::shared_ptr<Brush> brush               {};
+        bool                   instantiate_to_scene{false};
+    };
+    std::vector<Pending_brush> m_pending_brushes;
+
     std::vector<std::shared_ptr<erhe::physics::ICollision_shape>> m_collision_shapes;
 
     // Output
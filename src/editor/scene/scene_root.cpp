@@ -1,5 +1,6 @@
 #include "scene/scene_root.hpp"
 
+#include "editor_context.hpp"
 #include "editor_log.hpp"
 #include "editor_message_bus.hpp"
 #include "editor_scenes.hpp"
@@ -105,7 +106,8 @@ Scene_root::Scene_root(
     const std::shared_ptr<Content_library>& content_library,
     const std::string_view                  name
 )
-    : m_content_library{content_library}
+    : m_context        {editor_context}
+    , m_content_library{content_library}
 {
     ERHE_PROFILE_FUNCTION();
 
@@ -507,7 +509,6 @@ void Scene_root::register_node_physics(const std::shared_ptr<Node_physics>& node
 #endif
     {
         m_node_physics.push_back(node_physics);
-        m_node_physics_sorted = false;
     }
 
     node_physics->set_physics_world(m_physics_world.get());
@@ -533,7 +534,6 @@ void Scene_root::unregister_node_physics(const std::shared_ptr<Node_physics>& no
         log_physics->error("Node_physics for '{}' not in Scene_root", (node != nullptr) ? node->get_name().c_str() : "");
     } else {
         m_node_physics.erase(i, m_node_physics.end());
-        m_node_physics_sorted = false;
     }
 
     erhe::physics::IRigid_body* rigid_body = node_physics->get_rigid_body();
@@ -563,35 +563,50 @@ void Scene_root::update_physics_simulation_fixed_step(const double dt)
 
 void Scene_root::after_physics_simulation_steps()
 {
+    ERHE_PROFILE_FUNCTION();
+
     if (!m_physics_world) {
         return;
     }
 
-    // Sort nodes, so that parent transforms are updated before child nodes
-    if (!m_node_physics_sorted) {
-        std::sort(
-            m_node_physics.begin(),
-            m_node_physics.end(),
-            [](const auto& lhs, const auto& rhs) -> bool {
-                erhe::scene::Node* lhs_node = lhs->get_node();
-                erhe::scene::Node* rhs_node = rhs->get_node();
-                if ((lhs_node == nullptr) || (rhs_node == nullptr)) {
-                    return true;
-                }
-                return lhs_node->get_depth() < rhs_node->get_depth();
+    // Reads all active body transforms at once, then applies them to nodes
+    // in one batch, instead of per body calls through Node_physics
+    m_physics_world->get_active_body_transforms(m_body_transforms);
+
+    m_node_world_transforms.clear();
+    for (const erhe::physics::Body_transform& body_transform : m_body_transforms) {
+        Node_physics* node_physics = reinterpret_cast<Node_physics*>(body_transform.owner);
+        if (node_physics == nullptr) {
+            continue;
+        }
+        erhe::scene::Node* node = node_physics->get_node();
+        if (node == nullptr) {
+            continue;
+        }
+        if (node_physics->respawn_if_fallen(body_transform.world_from_body)) {
+            continue;
+        }
+        m_node_world_transforms.push_back(
+            erhe::scene::Node_world_transform{
+                .node            = node,
+                .world_from_node = body_transform.world_from_body
             }
         );
-        m_node_physics_sorted = true;
     }
 
-    for (const auto& node_physics : m_node_physics) {
-        auto* rigid_body = node_physics->get_rigid_body();
-        if (rigid_body) {
-            if (rigid_body->is_active()) {
-                node_physics->after_physics_simulation();
-            }
+    // Sort nodes, so that parent transforms are updated before child nodes
+    std::sort(
+        m_node_world_transforms.begin(),
+        m_node_world_transforms.end(),
+        [](const erhe::scene::Node_world_transform& lhs, const erhe::scene::Node_world_transform& rhs) -> bool {
+            return lhs.node->get_depth() < rhs.node->get_depth();
         }
-    }
+    );
+
+    erhe::scene::set_world_from_nodes(
+        m_node_world_transforms,
+        (m_context != nullptr) ? m_context->thread_pool : nullptr
+    );
 }
 
 [[nodiscard]] auto Scene_root::layers() -> Scene_layers&
@@ -784,7 +799,8 @@ public:
 
 void Scene_root::sort_lights()
 {
-    std::sort(
+    // Stable, so that shadow map slots of lights of the same type do not change between frames
+    std::stable_sort(
         m_layers.light()->lights.begin(),
         m_layers.light()->lights.end(),
         Light_comparator()
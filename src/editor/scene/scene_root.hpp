@@ -36,6 +36,7 @@ namespace erhe::imgui {
     class Imgui_windows;
 }
 namespace erhe::physics {
+    class Body_transform;
     class IWorld;
 }
 namespace erhe::primitive {
@@ -56,6 +57,7 @@ namespace erhe::scene {
     class Mesh_raytrace;
     class Message_bus;
     class Node;
+    class Node_world_transform;
     class Scene;
     class Scene_message_bus;
 }
@@ -205,13 +207,15 @@ private:
     mutable std::mutex                              m_mutex;
     std::mutex                                      m_rendertarget_meshes_mutex;
 
+    Editor_context*                                 m_context{nullptr};
     Editor_scenes*                                  m_editor_scenes{nullptr};
     std::shared_ptr<Content_library>                m_content_library;
     bool                                            m_is_registered{false};
 
     // Must live longer than m_scene for example
-    bool                                            m_node_physics_sorted{false};
     std::vector<std::shared_ptr<Node_physics>>      m_node_physics;
+    std::vector<erhe::physics::Body_transform>      m_body_transforms;
+    std::vector<erhe::scene::Node_world_transform>  m_node_world_transforms;
     std::vector<std::shared_ptr<Rendertarget_mesh>> m_rendertarget_meshes;
 
     std::vector<std::shared_ptr<erhe::Item_base>>   m_physics_disabled_nodes;
@@ -8,7 +8,7 @@ class ITask_queue
 {
 public:
     virtual ~ITask_queue();
-    virtual void enqueue(std::function<void()>&& func) = 0;
+    virtual void enqueue(erhe::concurrency::Task_function&& func) = 0;
     virtual void wait   () = 0;
 };
 
@@ -16,21 +16,21 @@ class Serial_task_queue
     : public ITask_queue
 {
 public:
-    void enqueue(std::function<void()>&& func) override;
+    void enqueue(erhe::concurrency::Task_function&& func) override;
     void wait   () override;
 };
 
+// Tasks run on the given thread pool, which is shared with other queues
 class Parallel_task_queue
     : public ITask_queue
 {
 public:
-    Parallel_task_queue(const std::string_view name, std::size_t thread_count);
+    Parallel_task_queue(erhe::concurrency::Thread_pool& thread_pool, const std::string_view name);
 
-    void enqueue(std::function<void()>&& func) override;
+    void enqueue(erhe::concurrency::Task_function&& func) override;
     void wait   () override;
 
 private:
-    erhe::concurrency::Thread_pool      m_thread_pool;
     erhe::concurrency::Concurrent_queue m_queue;
 };
 
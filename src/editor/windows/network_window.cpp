@@ -1,16 +1,22 @@
 #include "windows/network_window.hpp"
 
 #include "editor_context.hpp"
+#include "scene/scene_builder.hpp"
+#include "scene/scene_root.hpp"
 
 #include "erhe_configuration/configuration.hpp"
 #include "erhe_imgui/imgui_window.hpp"
 #include "erhe_imgui/imgui_windows.hpp"
 #include "erhe_net/client.hpp"
 #include "erhe_net/server.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_scene/scene.hpp"
 
 #include <imgui/imgui.h>
 #include <imgui/misc/cpp/imgui_stdlib.h>
 
+#include <chrono>
+
 namespace editor
 {
 
@@ -32,6 +38,10 @@ Network_window::Network_window(
 
     m_client.set_receive_handler(
         [this](const uint8_t* data, const std::size_t length) {
+            if (erhe::scene::Scene_delta::is_delta_frame(std::span<const uint8_t>{data, length})) {
+                receive_scene_delta(data, length);
+                return;
+            }
             m_upstream_messages.push_back("received " + std::string{reinterpret_cast<const char*>(data), length});
         }
     );
@@ -41,6 +51,13 @@ Network_window::Network_window(
             m_downstream_messages.push_back("received " + std::string{reinterpret_cast<const char*>(data), length});
         }
     );
+
+    // New clients need full scene. Others get it too, which they handle fine.
+    m_server.set_connect_handler(
+        [this]() {
+            m_scene_delta_writer.reset();
+        }
+    );
 }
 
 void Network_window::update_once_per_frame(const Time_context&)
@@ -56,6 +73,45 @@ void Network_window::update_network()
     if (m_client.get_state() != erhe::net::Socket::State::CLOSED) {
         m_client.poll(0);
     }
+    update_scene_replication();
+}
+
+auto Network_window::get_replicated_scene() const -> erhe::scene::Scene*
+{
+    if (m_context.scene_builder == nullptr) {
+        return nullptr;
+    }
+    const std::shared_ptr<Scene_root> scene_root = m_context.scene_builder->get_scene_root();
+    return scene_root ? &scene_root->get_scene() : nullptr;
+}
+
+void Network_window::update_scene_replication()
+{
+    ERHE_PROFILE_FUNCTION();
+
+    if (!m_replicate_scene || (m_server.get_client_count() == 0)) {
+        return;
+    }
+
+    erhe::scene::Scene* scene = get_replicated_scene();
+    if (scene == nullptr) {
+        return;
+    }
+    if (m_scene_delta_writer.write_frame(*scene, m_scene_delta_frame)) {
+        m_server.broadcast(reinterpret_cast<const char*>(m_scene_delta_frame.data()), m_scene_delta_frame.size());
+    }
+}
+
+void Network_window::receive_scene_delta(const uint8_t* data, const std::size_t length)
+{
+    erhe::scene::Scene* scene = get_replicated_scene();
+    if (scene == nullptr) {
+        return;
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    m_scene_delta_reader.apply_frame(*scene, std::span<const uint8_t>{data, length});
+    const auto end_time = std::chrono::steady_clock::now();
+    m_scene_delta_apply_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
 }
 
 void Network_window::imgui()
@@ -73,6 +129,7 @@ void Network_window::imgui()
         const bool is_connected = m_client.get_state() == Socket::State::CONNECTED;
         if (is_closed) {
             if (ImGui::Button("Connect")) {
+                m_scene_delta_reader.reset();
                 m_client.connect(m_upstream_address.c_str(), m_upstream_port);
             }
         } else {
@@ -86,6 +143,11 @@ void Network_window::imgui()
             if (ImGui::Button("Disconnect")) {
                 m_client.disconnect();
             }
+            const erhe::scene::Scene_delta_statistics& statistics = m_scene_delta_reader.get_statistics();
+            if (statistics.byte_count > 0) {
+                ImGui::Text("Scene delta: %zu bytes, %zu transforms, %.2f ms", statistics.byte_count, statistics.transform_count, m_scene_delta_apply_ms);
+                ImGui::Text("Replicated nodes: %zu, unresolved ids: %zu", statistics.node_count, statistics.unresolved_id_count);
+            }
             for (const auto& message : m_upstream_messages) {
                 ImGui::TextUnformatted(message.c_str());
             }
@@ -114,6 +176,11 @@ void Network_window::imgui()
                     m_server.broadcast(message);
                 }
             }
+            ImGui::Checkbox("Replicate Scene", &m_replicate_scene);
+            if (m_replicate_scene) {
+                const erhe::scene::Scene_delta_statistics& statistics = m_scene_delta_writer.get_statistics();
+                ImGui::Text("Scene delta: %zu bytes, %zu transforms", statistics.byte_count, statistics.transform_count);
+            }
             if (ImGui::Button("Stop")) {
                 m_server.disconnect();
             }
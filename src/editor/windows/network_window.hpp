@@ -4,6 +4,7 @@
 #include "erhe_imgui/imgui_window.hpp"
 #include "erhe_net/client.hpp"
 #include "erhe_net/server.hpp"
+#include "erhe_scene/scene_replication.hpp"
 
 #include <vector>
 
@@ -35,7 +36,10 @@ public:
     void update_once_per_frame(const Time_context&) override;
 
 private:
-    void update_network();
+    void update_network          ();
+    void update_scene_replication();
+    void receive_scene_delta     (const uint8_t* data, std::size_t length);
+    auto get_replicated_scene    () const -> erhe::scene::Scene*;
 
     Editor_context&          m_context;
     erhe::net::Client        m_client;
@@ -50,6 +54,14 @@ private:
     std::string              m_downstream_address;
     int                      m_downstream_port{0};
     std::vector<std::string> m_downstream_messages;
+
+    // Server sends changes of main scene to clients every frame, clients
+    // apply them to their main scene
+    bool                            m_replicate_scene     {false};
+    std::vector<uint8_t>            m_scene_delta_frame;
+    erhe::scene::Scene_delta_writer m_scene_delta_writer;
+    erhe::scene::Scene_delta_reader m_scene_delta_reader;
+    double                          m_scene_delta_apply_ms{0.0};
 };
 
 } // namespace editor
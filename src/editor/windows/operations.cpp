@@ -87,7 +87,9 @@ void Operations::imgui()
             .context = m_context,
             .build_info{
                 .primitive_types = {.fill_triangles = true, .edge_lines = true, .corner_points = true, .centroid_points = true },
-                .buffer_info     = m_context.mesh_memory->buffer_info
+                .buffer_info            = m_context.mesh_memory->buffer_info,
+                .thread_pool            = m_context.thread_pool,
+                .background_thread_pool = m_context.background_thread_pool
             }
         };
     };
@@ -154,7 +156,9 @@ void Operations::imgui()
                     .context = m_context,
                     .build_info{
                         .primitive_types{ .fill_triangles = true, .edge_lines = true, .corner_points = true, .centroid_points = true },
-                        .buffer_info    = m_context.mesh_memory->buffer_info
+                        .buffer_info            = m_context.mesh_memory->buffer_info,
+                        .thread_pool            = m_context.thread_pool,
+                        .background_thread_pool = m_context.background_thread_pool
                     }
                 }
             )
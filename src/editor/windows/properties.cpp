@@ -26,6 +26,7 @@
 #include "erhe_raytrace/iinstance.hpp"
 #include "erhe_raytrace/igeometry.hpp"
 #include "erhe_scene/animation.hpp"
+#include "erhe_scene/animation_evaluator.hpp"
 #include "erhe_scene/camera.hpp"
 #include "erhe_scene/light.hpp"
 #include "erhe_scene/mesh.hpp"
@@ -39,6 +40,9 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <vector>
+
 #if defined(ERHE_GUI_LIBRARY_IMGUI)
 #   include <imgui/imgui.h>
 #   include <imgui/misc/cpp/imgui_stdlib.h>
@@ -59,8 +63,10 @@ Properties::Properties(
 {
 }
 
+Properties::~Properties() noexcept = default;
+
 #if defined(ERHE_GUI_LIBRARY_IMGUI)
-void Properties::animation_properties(erhe::scene::Animation& animation) const
+void Properties::animation_properties(erhe::scene::Animation& animation)
 {
     static float time       = 0.0f;
     static float start_time = 0.0f;
@@ -98,15 +104,30 @@ void Properties::animation_properties(erhe::scene::Animation& animation) const
         return;
     }
 
-    animation.apply(time);
+    // Channels are grouped and repacked once per selected animation
+    if (m_evaluated_animation.lock().get() != &animation) {
+        m_evaluated_animation = std::static_pointer_cast<erhe::scene::Animation>(animation.shared_from_this());
+        m_animation_evaluator = std::make_unique<erhe::scene::Animation_evaluator>(animation);
+        m_animation_evaluator->add_instance();
+    }
+    m_animation_evaluator->apply(time, m_context.thread_pool);
     m_context.editor_message_bus->send_message(
         Editor_message{
             .update_flags = Message_flag_bit::c_flag_bit_animation_update
         }
     );
 
-    // TODO assert all animation channels targets point to same scene?
-    animation.channels.front().target->get_scene()->update_node_transforms();
+    // Targets which are not in a scene were updated by apply()
+    std::vector<erhe::scene::Scene*> scenes;
+    for (const erhe::scene::Animation_channel& channel : animation.channels) {
+        erhe::scene::Scene* scene = channel.target ? channel.target->get_scene() : nullptr;
+        if ((scene != nullptr) && (std::find(scenes.begin(), scenes.end(), scene) == scenes.end())) {
+            scenes.push_back(scene);
+        }
+    }
+    for (erhe::scene::Scene* scene : scenes) {
+        scene->update_node_transforms(m_context.thread_pool);
+    }
 }
 
 void Properties::camera_properties(erhe::scene::Camera& camera) const
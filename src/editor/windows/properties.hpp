@@ -15,6 +15,7 @@ namespace erhe::imgui {
 }
 namespace erhe::scene {
     class Animation;
+    class Animation_evaluator;
     class Camera;
     class Light;
     class Mesh;
@@ -38,6 +39,7 @@ public:
         erhe::imgui::Imgui_windows&  imgui_windows,
         Editor_context&              editor_context
     );
+    ~Properties() noexcept override;
 
     // Implements Imgui_window
     void imgui   () override;
@@ -45,7 +47,7 @@ public:
     void on_end  () override;
 
 private:
-    void animation_properties    (erhe::scene::Animation& animation) const;
+    void animation_properties    (erhe::scene::Animation& animation);
     void camera_properties       (erhe::scene::Camera& camera) const;
     void light_properties        (erhe::scene::Light& light) const;
     void mesh_properties         (erhe::scene::Mesh& mesh) const;
@@ -56,7 +58,9 @@ private:
     void item_flags              (const std::shared_ptr<erhe::Item_base>& item);
     void item_properties         (const std::shared_ptr<erhe::Item_base>& item);
 
-    Editor_context& m_context;
+    Editor_context&                                   m_context;
+    std::weak_ptr<erhe::scene::Animation>             m_evaluated_animation;
+    std::unique_ptr<erhe::scene::Animation_evaluator> m_animation_evaluator;
 };
 
 } // namespace editor
@@ -23,6 +23,11 @@ Concurrent_queue::~Concurrent_queue() noexcept
     wait();
 }
 
+void Concurrent_queue::set_task_arena(Task_arena* const task_arena)
+{
+    m_task_arena = task_arena;
+}
+
 void Concurrent_queue::steal()
 {
     m_pool.dequeue_and_process();
@@ -2,7 +2,10 @@
 
 #include "erhe_concurrency/thread_pool.hpp"
 
+#include <functional>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace erhe::concurrency {
 
@@ -27,12 +30,19 @@ namespace erhe::concurrency {
     // wait until the queue is drained
     q.wait(); // cooperative, blocking (helps pool until all tasks are complete)
 
+    Tasks are stored in Task_function. Tasks with captures up to
+    Task_function::inline_capacity bytes are enqueued without allocations.
+    Larger captures are placed in Task_arena set with set_task_arena(),
+    or in heap if there is no arena or the arena is full. A Task_function
+    is enqueued as is, without wrapping it in another Task_function.
+
 */
 class Concurrent_queue
 {
 protected:
     Thread_pool&       m_pool;
     Thread_pool::Queue m_queue;
+    Task_arena*        m_task_arena{nullptr};
 
 public:
     explicit Concurrent_queue(Thread_pool& thread_pool);
@@ -51,15 +61,29 @@ public:
     template <class F, class... Args>
     void enqueue(F&& f, Args&&... args)
     {
-        m_pool.enqueue(
-            &m_queue,
-            std::bind(
-                std::forward<F>(f),
-                std::forward<Args>(args)...
-            )
-        );
+        if constexpr ((sizeof...(Args) == 0) && std::is_same_v<std::decay_t<F>, Task_function>) {
+            // Already type erased, moved as is
+            m_pool.enqueue(&m_queue, Task_function{std::forward<F>(f)});
+        } else if constexpr (sizeof...(Args) == 0) {
+            m_pool.enqueue(&m_queue, Task_function{std::forward<F>(f), m_task_arena});
+        } else {
+            m_pool.enqueue(
+                &m_queue,
+                Task_function{
+                    [f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable
+                    {
+                        std::invoke(f, args...);
+                    },
+                    m_task_arena
+                }
+            );
+        }
     }
 
+    // Arena is used for captures which do not fit in Task_function inline
+    // storage. Arena must outlive all tasks enqueued while it is set.
+    void set_task_arena(Task_arena* task_arena);
+
     void steal ();
     void cancel();
     void wait  ();
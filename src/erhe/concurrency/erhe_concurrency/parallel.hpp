@@ -0,0 +1,216 @@
+#pragma once
+
+#include "erhe_concurrency/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace erhe::concurrency {
+
+/*
+    Data parallel loop helpers on top of Thread_pool. The calling thread
+    participates in the work, so these can be called from any thread,
+    including from tasks running in the pool.
+
+    parallel_for() uses adaptive (guided) chunking: each participant claims
+    a chunk of remaining / (2 * participant_count) elements, never less than
+    grain_size. Large chunks are taken first, small chunks at the end balance
+    the load.
+
+    Usage example:
+
+    parallel_for(
+        pool, 0, points.size(), 1024,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                points[i] = transform * points[i];
+            }
+        }
+    );
+
+    const float sum = parallel_reduce(
+        pool, 0, values.size(), 4096, 0.0f,
+        [&](std::size_t begin, std::size_t end, float partial) {
+            for (std::size_t i = begin; i < end; ++i) {
+                partial += values[i];
+            }
+            return partial;
+        },
+        [](float lhs, float rhs) { return lhs + rhs; },
+        Reduction::deterministic
+    );
+*/
+
+enum class Reduction : unsigned int
+{
+    unordered     = 0, // Partial results are combined in completion order
+    deterministic = 1  // Chunking and combine order only depend on range and grain size
+};
+
+namespace detail {
+
+// Runs body(participant_index) on participant_count participants; participant 0
+// is the calling thread. Returns when all participants have returned.
+template <typename Body>
+void run_participants(Thread_pool& thread_pool, const std::size_t participant_count, Body& body)
+{
+    std::vector<Task_handle> helpers;
+    helpers.reserve(participant_count - 1);
+    for (std::size_t i = 1; i < participant_count; ++i) {
+        helpers.push_back(thread_pool.submit([&body, i]() { body(i); }));
+    }
+    body(0);
+    thread_pool.wait(std::span<const Task_handle>{helpers});
+}
+
+[[nodiscard]] inline auto get_participant_count(
+    const Thread_pool& thread_pool,
+    const std::size_t  chunk_count
+) -> std::size_t
+{
+    const std::size_t worker_count = static_cast<std::size_t>(std::max(thread_pool.size(), 0));
+    return std::max(std::size_t{1}, std::min(worker_count + 1, chunk_count));
+}
+
+} // namespace detail
+
+// Calls f(begin, end) for disjoint sub ranges covering [begin, end)
+template <typename F>
+void parallel_for(
+    Thread_pool&      thread_pool,
+    const std::size_t begin,
+    const std::size_t end,
+    std::size_t       grain_size,
+    F&&               f
+)
+{
+    if (end <= begin) {
+        return;
+    }
+    grain_size = std::max(grain_size, std::size_t{1});
+    const std::size_t count             = end - begin;
+    const std::size_t max_chunk_count   = (count + grain_size - 1) / grain_size;
+    const std::size_t participant_count = detail::get_participant_count(thread_pool, max_chunk_count);
+    if (participant_count == 1) {
+        f(begin, end);
+        return;
+    }
+
+    std::atomic<std::size_t> next{begin};
+    auto body = [&](std::size_t) {
+        std::size_t chunk_begin = next.load(std::memory_order_relaxed);
+        while (chunk_begin < end) {
+            const std::size_t remaining  = end - chunk_begin;
+            const std::size_t chunk_size = std::max(grain_size, remaining / (2 * participant_count));
+            const std::size_t chunk_end  = std::min(end, chunk_begin + chunk_size);
+            if (next.compare_exchange_weak(chunk_begin, chunk_end, std::memory_order_relaxed)) {
+                f(chunk_begin, chunk_end);
+                chunk_begin = next.load(std::memory_order_relaxed);
+            }
+        }
+    };
+    detail::run_participants(thread_pool, participant_count, body);
+}
+
+// Calls f(i) for each i in [begin, end)
+template <typename F>
+void parallel_for_each_index(
+    Thread_pool&      thread_pool,
+    const std::size_t begin,
+    const std::size_t end,
+    const std::size_t grain_size,
+    F&&               f
+)
+{
+    parallel_for(
+        thread_pool, begin, end, grain_size,
+        [&f](const std::size_t chunk_begin, const std::size_t chunk_end) {
+            for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+                f(i);
+            }
+        }
+    );
+}
+
+// map(begin, end, T partial) -> T folds sub range into partial result,
+// reduce(T lhs, T rhs) -> T combines two partial results. identity must be
+// neutral element for reduce.
+template <typename T, typename Map, typename Reduce>
+[[nodiscard]] auto parallel_reduce(
+    Thread_pool&      thread_pool,
+    const std::size_t begin,
+    const std::size_t end,
+    std::size_t       grain_size,
+    const T&          identity,
+    Map&&             map,
+    Reduce&&          reduce,
+    const Reduction   reduction = Reduction::unordered
+) -> T
+{
+    if (end <= begin) {
+        return identity;
+    }
+    grain_size = std::max(grain_size, std::size_t{1});
+    const std::size_t count       = end - begin;
+    const std::size_t chunk_count = (count + grain_size - 1) / grain_size;
+    const std::size_t participant_count = detail::get_participant_count(thread_pool, chunk_count);
+
+    if (reduction == Reduction::deterministic) {
+        // Fixed chunks, combined in index order
+        std::vector<T>           partials(chunk_count, identity);
+        std::atomic<std::size_t> next_chunk{0};
+        auto body = [&](std::size_t) {
+            for (;;) {
+                const std::size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunk_count) {
+                    return;
+                }
+                const std::size_t chunk_begin = begin + chunk * grain_size;
+                const std::size_t chunk_end   = std::min(end, chunk_begin + grain_size);
+                partials[chunk] = map(chunk_begin, chunk_end, identity);
+            }
+        };
+        if (participant_count == 1) {
+            body(0);
+        } else {
+            detail::run_participants(thread_pool, participant_count, body);
+        }
+        T result = identity;
+        for (const T& partial : partials) {
+            result = reduce(result, partial);
+        }
+        return result;
+    }
+
+    if (participant_count == 1) {
+        return map(begin, end, identity);
+    }
+
+    // One accumulator per participant, combined at the end
+    std::vector<T> partials(participant_count, identity);
+    std::atomic<std::size_t> next{begin};
+    auto body = [&](const std::size_t participant_index) {
+        T&          partial     = partials[participant_index];
+        std::size_t chunk_begin = next.load(std::memory_order_relaxed);
+        while (chunk_begin < end) {
+            const std::size_t remaining  = end - chunk_begin;
+            const std::size_t chunk_size = std::max(grain_size, remaining / (2 * participant_count));
+            const std::size_t chunk_end  = std::min(end, chunk_begin + chunk_size);
+            if (next.compare_exchange_weak(chunk_begin, chunk_end, std::memory_order_relaxed)) {
+                partial     = map(chunk_begin, chunk_end, partial);
+                chunk_begin = next.load(std::memory_order_relaxed);
+            }
+        }
+    };
+    detail::run_participants(thread_pool, participant_count, body);
+
+    T result = identity;
+    for (const T& partial : partials) {
+        result = reduce(result, partial);
+    }
+    return result;
+}
+
+} // namespace erhe::concurrency
@@ -1,5 +1,7 @@
 #include "erhe_concurrency/serial_queue.hpp"
 
+#include <algorithm>
+
 namespace erhe::concurrency {
 
 Serial_queue::Serial_queue()
@@ -43,8 +45,7 @@ void Serial_queue::thread()
         std::unique_lock<std::mutex> queue_lock{m_queue_mutex};
 
         if (m_task_counter > 0) {
-            auto task = std::move(m_task_queue.front());
-            m_task_queue.pop_front();
+            Task task = pop_front();
             queue_lock.unlock();
 
             task();
@@ -64,12 +65,44 @@ void Serial_queue::thread()
     }
 }
 
+void Serial_queue::push_back(Task&& task)
+{
+    if (m_task_ring_size == m_task_ring.size()) {
+        // Ring is full; move tasks to larger ring, oldest task first
+        std::vector<Task> new_ring(std::max(std::size_t{16}, 2 * m_task_ring.size()));
+        const std::size_t mask = m_task_ring.size() - 1;
+        for (std::size_t i = 0; i < m_task_ring_size; ++i) {
+            new_ring[i] = std::move(m_task_ring[(m_task_ring_head + i) & mask]);
+        }
+        m_task_ring.swap(new_ring);
+        m_task_ring_head = 0;
+    }
+    const std::size_t mask = m_task_ring.size() - 1;
+    m_task_ring[(m_task_ring_head + m_task_ring_size) & mask] = std::move(task);
+    ++m_task_ring_size;
+}
+
+auto Serial_queue::pop_front() -> Task
+{
+    Task task = std::move(m_task_ring[m_task_ring_head]);
+    m_task_ring_head = (m_task_ring_head + 1) & (m_task_ring.size() - 1);
+    --m_task_ring_size;
+    return task;
+}
+
+void Serial_queue::set_task_arena(Task_arena* const task_arena)
+{
+    m_task_arena = task_arena;
+}
+
 void Serial_queue::cancel()
 {
     std::unique_lock<std::mutex> queue_lock{m_queue_mutex};
 
-    m_task_counter -= static_cast<int>(m_task_queue.size());
-    m_task_queue.clear();
+    m_task_counter -= static_cast<int>(m_task_ring_size);
+    while (m_task_ring_size > 0) {
+        pop_front();
+    }
 }
 
 void Serial_queue::wait()
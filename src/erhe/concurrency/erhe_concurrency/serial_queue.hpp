@@ -1,13 +1,16 @@
 #pragma once
 
+#include "erhe_concurrency/task_function.hpp"
+
 #include <atomic>
 #include <condition_variable>
-#include <deque>
+#include <cstddef>
 #include <functional>
 #include <mutex>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <vector>
 
 namespace erhe::concurrency {
 
@@ -37,12 +40,18 @@ namespace erhe::concurrency {
     // wait until the queue is drained
     s.wait(); // non-cooperative, blocking (CPU sleeps until queue is drained)
 
+    Tasks are stored in Task_function, in a ring of task slots which is
+    reused. Slots are only allocated when more tasks are queued than ever
+    before, so in steady state enqueue does not allocate. Captures too large
+    for Task_function inline storage go to Task_arena set with
+    set_task_arena(), or to heap.
+
 */
 
 class Serial_queue
 {
 protected:
-    using Task = std::function<void()>;
+    using Task = Task_function;
 
     std::string m_name;
     std::thread m_thread;
@@ -57,13 +66,18 @@ protected:
 #   pragma warning(pop)
 #endif
 
-    std::deque<Task>        m_task_queue;
+    std::vector<Task>       m_task_ring;        // capacity is power of two
+    std::size_t             m_task_ring_head{0}; // index of oldest task
+    std::size_t             m_task_ring_size{0}; // number of queued tasks
+    Task_arena*             m_task_arena{nullptr};
     std::mutex              m_queue_mutex;
     std::mutex              m_wait_mutex;
     std::condition_variable m_task_condition;
     std::condition_variable m_wait_condition;
 
-    void thread();
+    void thread   ();
+    void push_back(Task&& task);
+    auto pop_front() -> Task;
 
 public:
     Serial_queue();
@@ -73,13 +87,31 @@ public:
     template <class F, class... Args>
     void enqueue(F&& f, Args&&... args)
     {
+        Task task = [&]() {
+            if constexpr (sizeof...(Args) == 0) {
+                return Task{std::forward<F>(f), m_task_arena};
+            } else {
+                return Task{
+                    [f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable
+                    {
+                        std::invoke(f, args...);
+                    },
+                    m_task_arena
+                };
+            }
+        }();
+
         std::unique_lock<std::mutex> lock{m_queue_mutex};
 
-        m_task_queue.emplace_back(f, (args)...);
+        push_back(std::move(task));
         ++m_task_counter;
         m_task_condition.notify_one();
     }
 
+    // Arena is used for captures which do not fit in Task_function inline
+    // storage. Arena must outlive all tasks enqueued while it is set.
+    void set_task_arena(Task_arena* task_arena);
+
     void cancel();
     void wait  ();
 };
@@ -0,0 +1,48 @@
+#include "erhe_concurrency/task_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace erhe::concurrency {
+
+Task_arena::Task_arena(const std::size_t capacity)
+    : m_buffer  {std::make_unique<std::byte[]>(capacity)}
+    , m_capacity{capacity}
+{
+}
+
+Task_arena::~Task_arena() noexcept = default;
+
+auto Task_arena::allocate(const std::size_t size, const std::size_t alignment) -> void*
+{
+    const std::uintptr_t base   = reinterpret_cast<std::uintptr_t>(m_buffer.get());
+    std::size_t          offset = m_offset.load(std::memory_order_relaxed);
+    for (;;) {
+        const std::uintptr_t address = (base + offset + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+        const std::size_t    begin   = static_cast<std::size_t>(address - base);
+        const std::size_t    end     = begin + size;
+        if (end > m_capacity) {
+            return nullptr;
+        }
+        if (m_offset.compare_exchange_weak(offset, end, std::memory_order_relaxed)) {
+            return m_buffer.get() + begin;
+        }
+    }
+}
+
+void Task_arena::reset()
+{
+    m_offset.store(0, std::memory_order_relaxed);
+}
+
+auto Task_arena::get_capacity() const -> std::size_t
+{
+    return m_capacity;
+}
+
+auto Task_arena::get_used_bytes() const -> std::size_t
+{
+    return std::min(m_offset.load(std::memory_order_relaxed), m_capacity);
+}
+
+} // namespace erhe::concurrency
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace erhe::concurrency {
+
+/*
+    Task_arena is a linear allocator for task captures which do not fit in
+    inline storage of Task_function. Memory is allocated once and recycled
+    with reset(), typically once per frame after all tasks using the arena
+    have completed. When the arena is full, Task_function falls back to heap.
+
+    Usage example:
+
+    Task_arena arena{256 * 1024};
+    queue.set_task_arena(&arena);
+
+    // per frame
+    queue.enqueue([big_capture]{ ... });
+    queue.wait();
+    arena.reset();
+*/
+class Task_arena
+{
+public:
+    explicit Task_arena(std::size_t capacity);
+    ~Task_arena() noexcept;
+
+    Task_arena(const Task_arena&) = delete;
+    auto operator=(const Task_arena&) -> Task_arena& = delete;
+
+    // Thread safe. Returns nullptr if there is not enough space left.
+    [[nodiscard]] auto allocate(std::size_t size, std::size_t alignment) -> void*;
+
+    // Not thread safe. All tasks allocated from the arena must have been destroyed.
+    void reset();
+
+    [[nodiscard]] auto get_capacity  () const -> std::size_t;
+    [[nodiscard]] auto get_used_bytes() const -> std::size_t;
+
+private:
+    std::unique_ptr<std::byte[]> m_buffer;
+    std::size_t                  m_capacity{0};
+    std::atomic<std::size_t>     m_offset  {0};
+};
+
+} // namespace erhe::concurrency
@@ -0,0 +1,42 @@
+#include "erhe_concurrency/task_function.hpp"
+
+#include <atomic>
+
+namespace erhe::concurrency {
+
+namespace {
+
+std::atomic<std::uint64_t> s_arena_count{0};
+std::atomic<std::uint64_t> s_heap_count {0};
+
+}
+
+namespace detail {
+
+void count_task_arena_allocation()
+{
+    s_arena_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void count_task_heap_allocation()
+{
+    s_heap_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+auto get_task_allocation_statistics() -> Task_allocation_statistics
+{
+    return Task_allocation_statistics{
+        .arena_count = s_arena_count.load(std::memory_order_relaxed),
+        .heap_count  = s_heap_count .load(std::memory_order_relaxed)
+    };
+}
+
+void reset_task_allocation_statistics()
+{
+    s_arena_count.store(0, std::memory_order_relaxed);
+    s_heap_count .store(0, std::memory_order_relaxed);
+}
+
+} // namespace erhe::concurrency
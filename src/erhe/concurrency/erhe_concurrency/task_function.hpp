@@ -0,0 +1,186 @@
+#pragma once
+
+#include "erhe_concurrency/task_arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace erhe::concurrency {
+
+class Task_allocation_statistics
+{
+public:
+    std::uint64_t arena_count{0}; // Captures too large for inline storage, placed in Task_arena
+    std::uint64_t heap_count {0}; // Captures placed in heap (no arena, or arena was full)
+};
+
+[[nodiscard]] auto get_task_allocation_statistics() -> Task_allocation_statistics;
+void reset_task_allocation_statistics();
+
+namespace detail {
+
+void count_task_arena_allocation();
+void count_task_heap_allocation ();
+
+}
+
+// Move-only replacement for std::function<void()> used for tasks.
+// Callables up to inline_capacity bytes are stored inline without
+// allocation. Larger callables are placed in Task_arena, if one is given
+// and has space left, and in heap otherwise.
+class Task_function
+{
+public:
+    static constexpr std::size_t inline_capacity  = 64;
+    static constexpr std::size_t inline_alignment = alignof(std::max_align_t);
+
+    template <typename F>
+    static constexpr bool fits_inline =
+        (sizeof(F)  <= inline_capacity ) &&
+        (alignof(F) <= inline_alignment) &&
+        std::is_nothrow_move_constructible_v<F>;
+
+    Task_function() noexcept = default;
+
+    template <
+        typename F,
+        typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task_function>>
+    >
+    Task_function(F&& f, Task_arena* arena = nullptr)
+    {
+        using Callable = std::decay_t<F>;
+        if constexpr (fits_inline<Callable>) {
+            static_cast<void>(arena);
+            m_object  = ::new(static_cast<void*>(m_storage)) Callable(std::forward<F>(f));
+            m_storage_kind = Storage::inline_storage;
+        } else {
+            void* memory = (arena != nullptr) ? arena->allocate(sizeof(Callable), alignof(Callable)) : nullptr;
+            if (memory != nullptr) {
+                detail::count_task_arena_allocation();
+                m_storage_kind = Storage::arena;
+            } else {
+                detail::count_task_heap_allocation();
+                memory = ::operator new(sizeof(Callable), std::align_val_t{alignof(Callable)});
+                m_storage_kind = Storage::heap;
+            }
+            m_object = ::new(memory) Callable(std::forward<F>(f));
+        }
+        m_operations = &s_operations<Callable>;
+    }
+
+    Task_function(Task_function&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    auto operator=(Task_function&& other) noexcept -> Task_function&
+    {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    Task_function(const Task_function&) = delete;
+    auto operator=(const Task_function&) -> Task_function& = delete;
+
+    ~Task_function() noexcept
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        m_operations->invoke(m_object);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_operations != nullptr;
+    }
+
+    [[nodiscard]] auto is_inline() const noexcept -> bool
+    {
+        return m_storage_kind == Storage::inline_storage;
+    }
+
+    void reset() noexcept
+    {
+        if (m_operations == nullptr) {
+            return;
+        }
+        m_operations->destroy(m_object);
+        if (m_storage_kind == Storage::heap) {
+            m_operations->deallocate(m_object);
+        }
+        m_operations = nullptr;
+        m_object     = nullptr;
+    }
+
+private:
+    enum class Storage : unsigned char
+    {
+        inline_storage = 0,
+        arena          = 1,
+        heap           = 2
+    };
+
+    class Operations
+    {
+    public:
+        void (*invoke         )(void* object);
+        void (*move_to_inline )(void* destination, void* source);
+        void (*destroy        )(void* object);
+        void (*deallocate     )(void* object);
+    };
+
+    template <typename Callable>
+    static constexpr Operations s_operations{
+        .invoke = [](void* object) {
+            (*static_cast<Callable*>(object))();
+        },
+        .move_to_inline = [](void* destination, void* source) {
+            if constexpr (fits_inline<Callable>) {
+                ::new(destination) Callable(std::move(*static_cast<Callable*>(source)));
+                static_cast<Callable*>(source)->~Callable();
+            } else {
+                static_cast<void>(destination);
+                static_cast<void>(source);
+            }
+        },
+        .destroy = [](void* object) {
+            static_cast<Callable*>(object)->~Callable();
+        },
+        .deallocate = [](void* object) {
+            ::operator delete(object, std::align_val_t{alignof(Callable)});
+        }
+    };
+
+    void move_from(Task_function& other) noexcept
+    {
+        if (other.m_operations == nullptr) {
+            return;
+        }
+        m_operations   = other.m_operations;
+        m_storage_kind = other.m_storage_kind;
+        if (m_storage_kind == Storage::inline_storage) {
+            m_operations->move_to_inline(m_storage, other.m_object);
+            m_object = m_storage;
+        } else {
+            m_object = other.m_object;
+        }
+        other.m_operations = nullptr;
+        other.m_object     = nullptr;
+    }
+
+    alignas(inline_alignment) std::byte m_storage[inline_capacity];
+    void*                               m_object      {nullptr};
+    const Operations*                   m_operations  {nullptr};
+    Storage                             m_storage_kind{Storage::inline_storage};
+};
+
+} // namespace erhe::concurrency
@@ -0,0 +1,27 @@
+#include "erhe_concurrency/task_handle.hpp"
+
+namespace erhe::concurrency {
+
+Task_node::Task_node(Task_function&& func)
+    : func{std::move(func)}
+{
+}
+
+Task_handle::Task_handle(const std::shared_ptr<Task_node>& node)
+    : m_node{node}
+{
+}
+
+auto Task_handle::is_valid() const -> bool
+{
+    return static_cast<bool>(m_node);
+}
+
+auto Task_handle::is_done() const -> bool
+{
+    // Invalid (default constructed) handle is considered done so that it
+    // can be used as no-op dependency.
+    return !m_node || m_node->done.load(std::memory_order_acquire);
+}
+
+} // namespace erhe::concurrency
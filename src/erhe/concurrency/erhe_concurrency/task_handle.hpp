@@ -0,0 +1,56 @@
+#pragma once
+
+#include "erhe_concurrency/task_function.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace erhe::concurrency {
+
+class Thread_pool;
+
+// Node in task dependency graph. Task_node becomes ready for execution
+// once all tasks it depends on have completed. Use Task_handle to refer
+// to tasks, Task_node is only used by Thread_pool.
+class Task_node
+{
+public:
+    explicit Task_node(Task_function&& func);
+
+    Task_function                           func;
+    std::atomic<int>                        pending_dependencies{1}; // +1 held while task is being submitted
+    std::atomic<bool>                       done                {false};
+    std::mutex                              mutex;                   // protects continuations and done transition
+    std::vector<std::shared_ptr<Task_node>> continuations;
+};
+
+/*
+    Task_handle refers to task submitted to Thread_pool with Thread_pool::submit().
+    Task_handles can be passed as dependencies to later submit() calls; such
+    continuation task runs after all of its dependencies have completed.
+
+    Usage example:
+
+    auto a = thread_pool.submit([]{ ... });
+    auto b = thread_pool.submit([]{ ... });
+    auto c = thread_pool.submit([]{ ... }, {a, b}); // runs after a and b
+    thread_pool.wait(c); // cooperative, blocking (helps pool until c is complete)
+*/
+class Task_handle
+{
+public:
+    Task_handle() = default;
+    explicit Task_handle(const std::shared_ptr<Task_node>& node);
+
+    [[nodiscard]] auto is_valid() const -> bool;
+    [[nodiscard]] auto is_done () const -> bool;
+
+private:
+    friend class Thread_pool;
+
+    std::shared_ptr<Task_node> m_node;
+};
+
+} // namespace erhe::concurrency
@@ -3,6 +3,7 @@
 #include <concurrentqueue.h>
 
 #include <chrono>
+#include <deque>
 
 namespace erhe::concurrency {
 
@@ -23,13 +24,44 @@ struct Thread_pool::Task_queue
     moodycamel::ConcurrentQueue<Task> tasks;
 };
 
-Thread_pool::Thread_pool(size_t size)
+// Per worker deque used in Scheduling::work_stealing mode. Owner pushes and
+// pops at the back (LIFO, keeps recently produced data in cache), other
+// threads steal from the front (FIFO, takes oldest and usually largest work).
+struct Thread_pool::Worker
+{
+    using Task = Thread_pool::Task;
+
+    std::mutex       mutex;
+    std::deque<Task> tasks;
+};
+
+namespace {
+
+// Identifies worker thread so that tasks spawned from within a task can be
+// pushed to local deque of the worker.
+thread_local const Thread_pool* t_current_pool        {nullptr};
+thread_local std::size_t        t_current_worker_index{0};
+
+// Number of unsuccessful work searches before worker goes to sleep
+constexpr int idle_spin_count = 64;
+
+}
+
+Thread_pool::Thread_pool(const size_t size, const Scheduling scheduling)
     : m_queues      {nullptr}
+    , m_scheduling  {scheduling}
     , m_static_queue{this, int(Priority::NORMAL), "static"}
     , m_threads     {size}
 {
     m_queues = new Task_queue[3];
 
+    if (m_scheduling == Scheduling::work_stealing) {
+        m_workers.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            m_workers.push_back(std::make_unique<Worker>());
+        }
+    }
+
     // NOTE: let OS scheduler shuffle tasks as it sees fit
     //       this gives better performance overall UNTIL we have some practical
     //       use for the affinity (eg. dependent tasks using same cache)
@@ -64,7 +96,10 @@ Thread_pool::Thread_pool(size_t size)
 
 Thread_pool::~Thread_pool() noexcept
 {
-    m_stop = true;
+    {
+        std::unique_lock<std::mutex> lock{m_queue_mutex};
+        m_stop = true;
+    }
     m_condition.notify_all();
 
     for (auto& thread : m_threads) {
@@ -83,9 +118,37 @@ int Thread_pool::size() const
     return int(m_threads.size());
 }
 
-void Thread_pool::thread(size_t threadID)
+auto Thread_pool::get_scheduling() const -> Scheduling
 {
-    static_cast<void>(threadID);
+    return m_scheduling;
+}
+
+auto Thread_pool::get_statistics() const -> Thread_pool_statistics
+{
+    return Thread_pool_statistics{
+        .executed_count = m_executed_count.load(std::memory_order_relaxed),
+        .stolen_count   = m_stolen_count  .load(std::memory_order_relaxed),
+        .sleep_count    = m_sleep_count   .load(std::memory_order_relaxed)
+    };
+}
+
+void Thread_pool::thread(const size_t threadID)
+{
+    t_current_pool         = this;
+    t_current_worker_index = threadID;
+
+    switch (m_scheduling) {
+        case Scheduling::shared_queues: thread_shared_queues(threadID); break;
+        case Scheduling::work_stealing: thread_work_stealing(threadID); break;
+        default: break;
+    }
+
+    t_current_pool = nullptr;
+}
+
+void Thread_pool::thread_shared_queues(const size_t thread_index)
+{
+    static_cast<void>(thread_index);
 
     auto time0 = high_resolution_clock::now();
 
@@ -99,6 +162,7 @@ void Thread_pool::thread(size_t threadID)
             if (elapsed >= microseconds(1200)) {
                 std::unique_lock<std::mutex> lock{m_queue_mutex};
 
+                m_sleep_count.fetch_add(1, std::memory_order_relaxed);
                 m_condition.wait_for(lock, milliseconds(120));
             } else { // if (elapsed >= microseconds(2))
                 std::this_thread::yield();
@@ -110,33 +174,182 @@ void Thread_pool::thread(size_t threadID)
     }
 }
 
-void Thread_pool::enqueue(Queue* queue, std::function<void()>&& func)
+void Thread_pool::thread_work_stealing(const size_t thread_index)
+{
+    static_cast<void>(thread_index);
+
+    int idle_count = 0;
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        if (dequeue_and_process()) {
+            idle_count = 0;
+            continue;
+        }
+
+        if (++idle_count < idle_spin_count) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Sleep until there is work. There is no timeout, so idle workers
+        // do not burn CPU. m_sleeping_count is incremented before checking
+        // m_pending_count while holding m_queue_mutex; notify_work() increments
+        // m_pending_count before checking m_sleeping_count, so wakeups
+        // cannot be lost.
+        idle_count = 0;
+        std::unique_lock<std::mutex> lock{m_queue_mutex};
+        m_sleeping_count.fetch_add(1);
+        if (
+            !m_stop.load() &&
+            (m_pending_count.load() <= 0)
+        ) {
+            m_sleep_count.fetch_add(1, std::memory_order_relaxed);
+            m_condition.wait(
+                lock,
+                [this]
+                {
+                    return m_stop.load() || (m_pending_count.load() > 0);
+                }
+            );
+        }
+        m_sleeping_count.fetch_sub(1);
+    }
+}
+
+void Thread_pool::notify_work()
+{
+    m_pending_count.fetch_add(1);
+    if (m_scheduling == Scheduling::shared_queues) {
+        m_condition.notify_one();
+        return;
+    }
+    if (m_sleeping_count.load() > 0) {
+        {
+            std::unique_lock<std::mutex> lock{m_queue_mutex};
+        }
+        m_condition.notify_one();
+    }
+}
+
+void Thread_pool::schedule(Task&& task)
+{
+    if (
+        (m_scheduling == Scheduling::work_stealing) &&
+        !m_workers.empty()
+    ) {
+        // Tasks spawned from worker thread go to local deque of that worker,
+        // tasks from other threads are distributed round-robin.
+        const size_t worker_index = (t_current_pool == this)
+            ? t_current_worker_index
+            : m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+        Worker& worker = *m_workers[worker_index].get();
+        {
+            std::lock_guard<std::mutex> lock{worker.mutex};
+            worker.tasks.push_back(std::move(task));
+        }
+    } else {
+        const int priority = (task.queue != nullptr) ? task.queue->priority : int(Priority::NORMAL);
+        m_queues[priority].tasks.enqueue(std::move(task));
+    }
+    notify_work();
+}
+
+void Thread_pool::enqueue(Queue* queue, Task_function&& func)
 {
     Task task;
     task.queue = queue;
     task.func = std::move(func);
 
     ++queue->task_counter;
-    m_queues[queue->priority].tasks.enqueue(std::move(task));
+    schedule(std::move(task));
+}
 
-    m_condition.notify_one();
+auto Thread_pool::try_pop_local(Task& task) -> bool
+{
+    if (t_current_pool != this) {
+        return false;
+    }
+    Worker& worker = *m_workers[t_current_worker_index].get();
+    std::lock_guard<std::mutex> lock{worker.mutex};
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+auto Thread_pool::try_steal(Task& task) -> bool
+{
+    const size_t worker_count = m_workers.size();
+    const size_t start        = (t_current_pool == this) ? t_current_worker_index + 1 : 0;
+    for (size_t i = 0; i < worker_count; ++i) {
+        Worker& victim = *m_workers[(start + i) % worker_count].get();
+        std::unique_lock<std::mutex> lock{victim.mutex, std::try_to_lock};
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        if (t_current_pool == this) {
+            m_stolen_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+void Thread_pool::execute(Task& task)
+{
+    m_pending_count.fetch_sub(1);
+    m_executed_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (task.node) {
+        task.node->func();
+        task.node->func.reset(); // release captures as early as possible
+        complete(*task.node.get());
+        return;
+    }
+
+    Queue* const queue = task.queue;
+
+    // check if the task is cancelled
+    if (!queue->cancelled) {
+        // process task
+        task.func();
+    }
+
+    --queue->task_counter;
+}
+
+void Thread_pool::complete(Task_node& node)
+{
+    std::vector<std::shared_ptr<Task_node>> continuations;
+    {
+        std::lock_guard<std::mutex> lock{node.mutex};
+        node.done.store(true, std::memory_order_release);
+        continuations.swap(node.continuations);
+    }
+    for (auto& continuation : continuations) {
+        if (continuation->pending_dependencies.fetch_sub(1) == 1) {
+            schedule(Task{.queue = nullptr, .func = {}, .node = std::move(continuation)});
+        }
+    }
 }
 
 bool Thread_pool::dequeue_and_process()
 {
+    Task task;
+    if (m_scheduling == Scheduling::work_stealing) {
+        if (try_pop_local(task) || try_steal(task)) {
+            execute(task);
+            return true;
+        }
+    }
+
     // scan task queues in priority order
     for (size_t priority = 0; priority < 3; ++priority) {
-        Task task;
         if (m_queues[priority].tasks.try_dequeue(task)) {
-            Queue* const queue = task.queue;
-
-            // check if the task is cancelled
-            if (!queue->cancelled) {
-                // process task
-                task.func();
-            }
-
-            --queue->task_counter;
+            execute(task);
             return true;
         }
     }
@@ -151,6 +364,63 @@ void Thread_pool::wait(Queue* queue)
     }
 }
 
+auto Thread_pool::submit(Task_function&& func) -> Task_handle
+{
+    return submit(std::move(func), std::span<const Task_handle>{});
+}
+
+auto Thread_pool::submit(
+    Task_function&&                    func,
+    std::initializer_list<Task_handle> dependencies
+) -> Task_handle
+{
+    return submit(
+        std::move(func),
+        std::span<const Task_handle>{dependencies.begin(), dependencies.size()}
+    );
+}
+
+auto Thread_pool::submit(
+    Task_function&&              func,
+    std::span<const Task_handle> dependencies
+) -> Task_handle
+{
+    auto node = std::make_shared<Task_node>(std::move(func));
+    for (const Task_handle& dependency : dependencies) {
+        Task_node* const parent = dependency.m_node.get();
+        if (parent == nullptr) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock{parent->mutex};
+        if (!parent->done.load(std::memory_order_acquire)) {
+            node->pending_dependencies.fetch_add(1);
+            parent->continuations.push_back(node);
+        }
+    }
+
+    // Release the submission reference; schedule now if all dependencies are done
+    if (node->pending_dependencies.fetch_sub(1) == 1) {
+        schedule(Task{.queue = nullptr, .func = {}, .node = node});
+    }
+    return Task_handle{node};
+}
+
+void Thread_pool::wait(const Task_handle& task)
+{
+    while (!task.is_done()) {
+        if (!dequeue_and_process()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void Thread_pool::wait(const std::span<const Task_handle> tasks)
+{
+    for (const Task_handle& task : tasks) {
+        wait(task);
+    }
+}
+
 void Thread_pool::cancel(Queue* queue)
 {
     queue->cancelled = true;
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "erhe_concurrency/task_handle.hpp"
+
 #include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
 #include <mutex>
+#include <span>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -11,6 +16,20 @@
 
 namespace erhe::concurrency {
 
+enum class Scheduling : unsigned int
+{
+    shared_queues = 0, // All workers take tasks from shared priority queues
+    work_stealing = 1  // Each worker has own deque, idle workers steal from other workers
+};
+
+class Thread_pool_statistics
+{
+public:
+    std::uint64_t executed_count{0}; // Tasks executed, by workers or by waiting threads
+    std::uint64_t stolen_count  {0}; // Tasks taken from deque of another worker
+    std::uint64_t sleep_count   {0}; // Times a worker went to sleep waiting for work
+};
+
 class Thread_pool
 {
 private:
@@ -49,37 +68,67 @@ private:
 
     struct Task
     {
-        Queue*                queue;
-        std::function<void()> func;
+        Queue*                     queue{nullptr};
+        Task_function              func;
+        std::shared_ptr<Task_node> node; // set for tasks submitted with submit()
     };
 
 public:
-    explicit Thread_pool(std::size_t size);
+    explicit Thread_pool(std::size_t size, Scheduling scheduling = Scheduling::shared_queues);
     ~Thread_pool() noexcept;
 
-    int size() const;
+    int  size          () const;
+    auto get_scheduling() const -> Scheduling;
+    auto get_statistics() const -> Thread_pool_statistics;
 
-    void enqueue(std::function<void()>&& func)
+    void enqueue(Task_function&& func)
     {
         enqueue(&m_static_queue, std::move(func));
     }
 
+    // Task graph API. Submitted task runs once all dependencies have completed.
+    auto submit(Task_function&& func) -> Task_handle;
+    auto submit(Task_function&& func, std::initializer_list<Task_handle> dependencies) -> Task_handle;
+    auto submit(Task_function&& func, std::span<const Task_handle> dependencies) -> Task_handle;
+
+    // Cooperative, blocking (helps pool until task(s) are complete)
+    void wait(const Task_handle& task);
+    void wait(std::span<const Task_handle> tasks);
+
 protected:
     void thread             (size_t threadID);
-    void enqueue            (Queue* queue, std::function<void()>&& func);
+    void enqueue            (Queue* queue, Task_function&& func);
     bool dequeue_and_process();
     void cancel             (Queue* queue);
     void wait               (Queue* queue);
 
 private:
+    void thread_shared_queues(size_t thread_index);
+    void thread_work_stealing(size_t thread_index);
+    void schedule            (Task&& task);
+    void execute             (Task& task);
+    void complete            (Task_node& node);
+    auto try_pop_local       (Task& task) -> bool;
+    auto try_steal           (Task& task) -> bool;
+    void notify_work         ();
+
     struct Task_queue;
+    struct Worker;
     alignas(64) Task_queue* m_queues;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Scheduling                           m_scheduling;
 
 #if defined(_MSC_VER)
 #   pragma warning(push)
 #   pragma warning(disable : 4324)  // structure was padded due to alignment specifier
 #endif
-    alignas(64) std::atomic<bool> m_stop { false };
+    alignas(64) std::atomic<bool>          m_stop          { false };
+    alignas(64) std::atomic<std::int64_t>  m_pending_count { 0 };
+    alignas(64) std::atomic<int>           m_sleeping_count{ 0 };
+    alignas(64) std::atomic<std::size_t>   m_next_worker   { 0 };
+    std::atomic<std::uint64_t>             m_executed_count{ 0 };
+    std::atomic<std::uint64_t>             m_stolen_count  { 0 };
+    std::atomic<std::uint64_t>             m_sleep_count   { 0 };
 #if defined(_MSC_VER)
 #   pragma warning(pop)
 #endif
@@ -0,0 +1,164 @@
+#include "erhe_file/mapped_file.hpp"
+#include "erhe_file/file.hpp"
+#include "erhe_file/file_log.hpp"
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   include <cerrno>
+#   include <cstring>
+#endif
+
+#include <utility>
+
+namespace erhe::file
+{
+
+Mapped_file::Mapped_file() = default;
+
+Mapped_file::Mapped_file(const std::string_view description, const std::filesystem::path& path)
+{
+#if defined(_WIN32)
+    const HANDLE file_handle = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        log_file->error("{}: Could not open file '{}' for mapping, error {}", description, to_string(path), GetLastError());
+        return;
+    }
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        log_file->error("{}: Could not get size of file '{}', error {}", description, to_string(path), GetLastError());
+        CloseHandle(file_handle);
+        return;
+    }
+    m_file_handle = file_handle;
+    m_is_open     = true;
+    if (file_size.QuadPart == 0) {
+        return;
+    }
+    const HANDLE mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        log_file->error("{}: Could not create mapping for file '{}', error {}", description, to_string(path), GetLastError());
+        close();
+        return;
+    }
+    m_mapping_handle = mapping_handle;
+    const void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        log_file->error("{}: Could not map file '{}', error {}", description, to_string(path), GetLastError());
+        close();
+        return;
+    }
+    m_data = static_cast<const std::byte*>(view);
+    m_size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_file->error("{}: Could not open file '{}' for mapping: {}", description, to_string(path), std::strerror(errno));
+        return;
+    }
+    struct stat file_stat{};
+    if (::fstat(fd, &file_stat) != 0) {
+        log_file->error("{}: Could not get size of file '{}': {}", description, to_string(path), std::strerror(errno));
+        ::close(fd);
+        return;
+    }
+    m_is_open = true;
+    const std::size_t size = static_cast<std::size_t>(file_stat.st_size);
+    if (size > 0) {
+        void* view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            log_file->error("{}: Could not map file '{}': {}", description, to_string(path), std::strerror(errno));
+            m_is_open = false;
+        } else {
+            m_data = static_cast<const std::byte*>(view);
+            m_size = size;
+        }
+    }
+    // Mapping keeps file contents accessible after descriptor is closed
+    ::close(fd);
+#endif
+}
+
+Mapped_file::~Mapped_file() noexcept
+{
+    close();
+}
+
+Mapped_file::Mapped_file(Mapped_file&& other) noexcept
+    : m_data   {std::exchange(other.m_data, nullptr)}
+    , m_size   {std::exchange(other.m_size, 0)}
+    , m_is_open{std::exchange(other.m_is_open, false)}
+#if defined(_WIN32)
+    , m_file_handle   {std::exchange(other.m_file_handle, nullptr)}
+    , m_mapping_handle{std::exchange(other.m_mapping_handle, nullptr)}
+#endif
+{
+}
+
+Mapped_file& Mapped_file::operator=(Mapped_file&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data    = std::exchange(other.m_data, nullptr);
+        m_size    = std::exchange(other.m_size, 0);
+        m_is_open = std::exchange(other.m_is_open, false);
+#if defined(_WIN32)
+        m_file_handle    = std::exchange(other.m_file_handle, nullptr);
+        m_mapping_handle = std::exchange(other.m_mapping_handle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void Mapped_file::close()
+{
+#if defined(_WIN32)
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping_handle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(m_mapping_handle));
+        m_mapping_handle = nullptr;
+    }
+    if (m_file_handle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(m_file_handle));
+        m_file_handle = nullptr;
+    }
+#else
+    if (m_data != nullptr) {
+        ::munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+#endif
+    m_data    = nullptr;
+    m_size    = 0;
+    m_is_open = false;
+}
+
+auto Mapped_file::is_open() const -> bool
+{
+    return m_is_open;
+}
+
+auto Mapped_file::data() const -> const std::byte*
+{
+    return m_data;
+}
+
+auto Mapped_file::size() const -> std::size_t
+{
+    return m_size;
+}
+
+auto Mapped_file::span() const -> std::span<const std::byte>
+{
+    return std::span<const std::byte>{m_data, m_size};
+}
+
+} // namespace erhe::file
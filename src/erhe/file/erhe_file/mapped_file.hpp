@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace erhe::file
+{
+
+// Read-only memory mapping of a whole file. Mapping stays valid for the
+// lifetime of the Mapped_file object.
+class Mapped_file
+{
+public:
+    Mapped_file();
+    // On failure, logs error (using description) and is_open() returns false.
+    // Empty file is opened as empty span.
+    Mapped_file(std::string_view description, const std::filesystem::path& path);
+    ~Mapped_file() noexcept;
+
+    Mapped_file(const Mapped_file&) = delete;
+    Mapped_file& operator=(const Mapped_file&) = delete;
+    Mapped_file(Mapped_file&& other) noexcept;
+    Mapped_file& operator=(Mapped_file&& other) noexcept;
+
+    [[nodiscard]] auto is_open() const -> bool;
+    [[nodiscard]] auto data   () const -> const std::byte*;
+    [[nodiscard]] auto size   () const -> std::size_t;
+    [[nodiscard]] auto span   () const -> std::span<const std::byte>;
+    void close();
+
+private:
+    const std::byte* m_data   {nullptr};
+    std::size_t      m_size   {0};
+    bool             m_is_open{false};
+#if defined(_WIN32)
+    void*            m_file_handle   {nullptr};
+    void*            m_mapping_handle{nullptr};
+#endif
+};
+
+} // namespace erhe::file
@@ -1,5 +1,6 @@
 #include "erhe_geometry/geometry.hpp"
 #include "erhe_geometry/geometry_log.hpp"
+#include "erhe_concurrency/parallel.hpp"
 #include "erhe_log/log_glm.hpp"
 #include "erhe_verify/verify.hpp"
 #include "erhe_profile/profile.hpp"
@@ -161,8 +162,82 @@ auto Geometry::has_polygon_normals() const -> bool
     return false;
 }
 
+namespace {
+
+constexpr std::size_t s_polygons_per_chunk = 4096;
+
+// Stores compute(polygon) to destination for polygons with at least
+// min_corner_count corners. With thread pool, values are computed in
+// parallel to scratch storage and stored serially afterwards, because
+// Property_map::put() may grow the map.
+template <typename F>
+void compute_polygon_values(
+    const Geometry&                       geometry,
+    Property_map<Polygon_id, vec3>&       destination,
+    const bool                            skip_present,
+    const uint32_t                        min_corner_count,
+    erhe::concurrency::Thread_pool* const thread_pool,
+    F&&                                   compute
+)
+{
+    const Polygon_id polygon_count = geometry.get_polygon_count();
+    const auto is_wanted = [&geometry, &destination, skip_present, min_corner_count](const Polygon_id polygon_id) -> bool {
+        return
+            (geometry.polygons[polygon_id].corner_count >= min_corner_count) &&
+            (!skip_present || !destination.has(polygon_id));
+    };
+
+    if (thread_pool == nullptr) {
+        for (Polygon_id polygon_id = 0; polygon_id < polygon_count; ++polygon_id) {
+            if (is_wanted(polygon_id)) {
+                destination.put(polygon_id, compute(geometry.polygons[polygon_id]));
+            }
+        }
+        return;
+    }
+
+    std::vector<vec3>    values(polygon_count);
+    std::vector<uint8_t> wanted(polygon_count);
+    erhe::concurrency::parallel_for(
+        *thread_pool, 0, polygon_count, s_polygons_per_chunk,
+        [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const Polygon_id polygon_id = static_cast<Polygon_id>(i);
+                wanted[i] = is_wanted(polygon_id) ? 1 : 0;
+                if (wanted[i] != 0) {
+                    values[i] = compute(geometry.polygons[polygon_id]);
+                }
+            }
+        }
+    );
+    for (Polygon_id polygon_id = 0; polygon_id < polygon_count; ++polygon_id) {
+        if (wanted[polygon_id] != 0) {
+            destination.put(polygon_id, values[polygon_id]);
+        }
+    }
+}
+
+} // anonymous namespace
+
+void Geometry::compute_polygon_normals(
+    Property_map<Polygon_id, vec3>&       polygon_normals,
+    const Property_map<Point_id, vec3>&   point_locations,
+    const bool                            skip_present,
+    erhe::concurrency::Thread_pool* const thread_pool
+) const
+{
+    ERHE_PROFILE_FUNCTION();
+
+    compute_polygon_values(
+        *this, polygon_normals, skip_present, 3, thread_pool,
+        [this, &point_locations](const Polygon& polygon) -> vec3 {
+            return polygon.compute_normal(*this, point_locations);
+        }
+    );
+}
+
 // Requires point locations
-auto Geometry::compute_polygon_normals() -> bool
+auto Geometry::compute_polygon_normals(erhe::concurrency::Thread_pool* const thread_pool) -> bool
 {
     ERHE_PROFILE_FUNCTION();
 
@@ -184,9 +259,7 @@ auto Geometry::compute_polygon_normals() -> bool
         return false;
     }
 
-    for_each_polygon([&](auto& i) {
-        i.polygon.compute_normal(i.polygon_id, *this, *polygon_normals, *point_locations);
-    });
+    compute_polygon_normals(*polygon_normals, *point_locations, false, thread_pool);
 
     m_serial_polygon_normals = m_serial;
 
@@ -206,7 +279,24 @@ auto Geometry::has_polygon_centroids() const -> bool
     return false;
 }
 
-auto Geometry::compute_polygon_centroids() -> bool
+void Geometry::compute_polygon_centroids(
+    Property_map<Polygon_id, vec3>&       polygon_centroids,
+    const Property_map<Point_id, vec3>&   point_locations,
+    const bool                            skip_present,
+    erhe::concurrency::Thread_pool* const thread_pool
+) const
+{
+    ERHE_PROFILE_FUNCTION();
+
+    compute_polygon_values(
+        *this, polygon_centroids, skip_present, 1, thread_pool,
+        [this, &point_locations](const Polygon& polygon) -> vec3 {
+            return polygon.compute_centroid(*this, point_locations);
+        }
+    );
+}
+
+auto Geometry::compute_polygon_centroids(erhe::concurrency::Thread_pool* const thread_pool) -> bool
 {
     ERHE_PROFILE_FUNCTION();
 
@@ -224,9 +314,7 @@ auto Geometry::compute_polygon_centroids() -> bool
         return false;
     }
 
-    for_each_polygon([&](auto& i) {
-        i.polygon.compute_centroid(i.polygon_id, *this, *polygon_centroids, *point_locations);
-    });
+    compute_polygon_centroids(*polygon_centroids, *point_locations, false, thread_pool);
 
     m_serial_polygon_centroids = m_serial;
 
@@ -245,101 +333,125 @@ auto Geometry::has_edges() const -> bool
     return false;
 }
 
-void Geometry::build_edges(bool is_manifold)
+namespace {
+
+[[nodiscard]] auto make_edge_key(const Point_id a, const Point_id b) -> uint64_t
+{
+    return (a < b)
+        ? (static_cast<uint64_t>(a) << 32) | b
+        : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+// Stable LSD radix sort of keys with payload, 16 bits per pass.
+// Passes where all keys have the same digit are skipped.
+void radix_sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values)
 {
     ERHE_PROFILE_FUNCTION();
 
-    if (has_edges()) {
-        return;
+    const std::size_t count = keys.size();
+    std::vector<uint64_t> keys_temp  (count);
+    std::vector<uint32_t> values_temp(count);
+    std::vector<std::size_t> histogram(std::size_t{1} << 16);
+    for (unsigned int shift = 0; shift < 64; shift += 16) {
+        std::fill(histogram.begin(), histogram.end(), std::size_t{0});
+        for (const uint64_t key : keys) {
+            ++histogram[(key >> shift) & 0xffffu];
+        }
+        if (histogram[(keys.front() >> shift) & 0xffffu] == count) {
+            continue;
+        }
+        std::size_t offset = 0;
+        for (std::size_t& bucket : histogram) {
+            const std::size_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::size_t destination = histogram[(keys[i] >> shift) & 0xffffu]++;
+            keys_temp  [destination] = keys[i];
+            values_temp[destination] = values[i];
+        }
+        keys  .swap(keys_temp);
+        values.swap(values_temp);
     }
+}
 
-    edges.clear();
-    m_next_edge_id = 0;
+}
 
-    log_build_edges->trace("{} build_edges() : {} polygons", name, m_next_polygon_id);
+void Geometry::build_edges()
+{
+    ERHE_PROFILE_FUNCTION();
 
-    //const erhe::log::Indenter scope_indent;
-    std::size_t polygon_index{0};
+    if (has_edges()) {
+        return;
+    }
 
-    std::size_t polygon_edge_count = 0;
+    log_build_edges->trace("{} build_edges() : {} polygons", name, m_next_polygon_id);
 
+    // Collect half edges as (edge key, polygon) pairs
+    std::vector<uint64_t>   keys;
+    std::vector<Polygon_id> polygon_ids;
     std::size_t non_manifold_edge_count = 0;
-    // First pass - shared edges
     {
-        ERHE_PROFILE_SCOPE("first pass");
-
-        for_each_polygon([&](auto& i) {
-            //const erhe::log::Indenter scope_indent;
-
-            i.polygon.for_each_corner_neighborhood(*this, [&](auto& j) {
-                const Point_id a = j.prev_corner.point_id;
-                const Point_id b = j.corner.point_id;
-                ++polygon_edge_count;
+        ERHE_PROFILE_SCOPE("collect half edges");
+
+        keys       .reserve(m_next_polygon_corner_id);
+        polygon_ids.reserve(m_next_polygon_corner_id);
+        for (Polygon_id polygon_id = 0; polygon_id < m_next_polygon_id; ++polygon_id) {
+            const Polygon& polygon = polygons[polygon_id];
+            if (polygon.corner_count == 0) {
+                continue;
+            }
+            const Polygon_corner_id first = polygon.first_polygon_corner_id;
+            Point_id a = corners[polygon_corners[first + polygon.corner_count - 1]].point_id;
+            for (uint32_t i = 0; i < polygon.corner_count; ++i) {
+                const Point_id b = corners[polygon_corners[first + i]].point_id;
                 if (a == b) {
-                    //log_build_edges->warn("Bad edge {} - {}", a, b);
                     ++non_manifold_edge_count;
-                    return;
-                }
-                if (a < b) { // This does not work for non-shared edges going wrong direction
-                    const Edge_id edge_id = make_edge(a, b);
-                    const Point&  pa      = points[a];
-                    make_edge_polygon(edge_id, i.polygon_id);
-                    ERHE_VERIFY(pa.corner_count > 0);
-                    pa.for_each_corner_const(*this, [&](auto& k) {
-                         const Polygon_id polygon_id_in_point = k.corner.polygon_id;
-                         const Polygon&   polygon_in_point    = polygons[polygon_id_in_point];
-                         const Corner_id  prev_corner_id      = polygon_in_point.prev_corner(*this, k.corner_id);
-                         const Corner&    prev_corner         = corners[prev_corner_id];
-                         const Point_id   prev_point_id       = prev_corner.point_id;
-                         if (prev_point_id == b) {
-                             make_edge_polygon(edge_id, polygon_id_in_point);
-                             ++polygon_index;
-                         }
-                    });
+                } else {
+                    keys       .push_back(make_edge_key(a, b));
+                    polygon_ids.push_back(polygon_id);
                 }
-            });
-        });
+                a = b;
+            }
+        }
     }
 
-    // Second pass - non-shared edges wrong direction or non-manifold wrong direction
-    if (!is_manifold || (get_edge_count() != polygon_edge_count / 2)) {
-        ERHE_PROFILE_SCOPE("second pass");
-
-        for_each_polygon([&](auto& i) {
-            //const erhe::log::Indenter scope_indent;
-
-            i.polygon.for_each_corner_neighborhood(*this, [&](auto& j) {
-                const Point_id a_ = j.prev_corner.point_id;
-                const Point_id b_ = j.corner.point_id;
-                if (a_ == b_) {
-                    return;
-                }
+    // Sort is stable, so polygons of each edge stay in polygon order
+    if (!keys.empty()) {
+        radix_sort(keys, polygon_ids);
+    }
 
-                auto edge = find_edge(a_, b_);
-                if (!edge) {
-                    // ERHE_VERIFY(b < a); This does not hold for non-manifold objects
-                    {
-                        const Point_id a = std::max(a_, b_);
-                        const Point_id b = std::min(a_, b_);
-                        const Edge_id edge_id = make_edge(b, a); // Swapped a, b because b < a
-                        const Point&  pb      = points[b];
-                        make_edge_polygon(edge_id, i.polygon_id);
-                        ERHE_VERIFY(pb.corner_count > 0);
-                        pb.for_each_corner_const(*this, [&](auto& k) {
-                             const Polygon_id polygon_id_in_point = k.corner.polygon_id;
-                             const Polygon&   polygon_in_point    = polygons[polygon_id_in_point];
-                             const Corner_id  prev_corner_id      = polygon_in_point.prev_corner(*this, k.corner_id);
-                             const Corner&    prev_corner         = corners[prev_corner_id];
-                             const Point_id   prev_point_id       = prev_corner.point_id;
-                             if (prev_point_id == a) {
-                                 make_edge_polygon(edge_id, polygon_id_in_point);
-                                 ++polygon_index;
-                             }
-                        });
-                    }
+    // Each run of equal keys is one edge
+    {
+        ERHE_PROFILE_SCOPE("make edges");
+
+        ++m_serial;
+        edges.clear();
+        edge_polygons.resize(keys.size());
+        m_edge_index.clear();
+        for (std::size_t begin = 0, count = keys.size(); begin < count;) {
+            std::size_t end = begin + 1;
+            while ((end < count) && (keys[end] == keys[begin])) {
+                ++end;
+            }
+            edges.push_back(
+                Edge{
+                    .a                     = static_cast<Point_id>(keys[begin] >> 32),
+                    .b                     = static_cast<Point_id>(keys[begin] & 0xffffffffu),
+                    .first_edge_polygon_id = static_cast<Edge_polygon_id>(begin),
+                    .polygon_count         = static_cast<uint32_t>(end - begin)
                 }
-            });
-        });
+            );
+            for (std::size_t i = begin; i < end; ++i) {
+                edge_polygons[i] = polygon_ids[i];
+            }
+            begin = end;
+        }
+        m_next_edge_id          = static_cast<Edge_id>(edges.size());
+        m_next_edge_polygon_id  = static_cast<Edge_polygon_id>(keys.size());
+        m_edge_polygon_edge     = (m_next_edge_id > 0) ? m_next_edge_id - 1 : 0;
+        m_edge_index_edge_count = 0; // built on demand by find_edge()
     }
 
     if (non_manifold_edge_count > 0) {
@@ -349,6 +461,27 @@ void Geometry::build_edges(bool is_manifold)
     m_serial_edges = m_serial;
 }
 
+auto Geometry::find_edge(const Point_id a, const Point_id b) -> std::optional<Edge>
+{
+    if (m_edge_index_edge_count != m_next_edge_id) {
+        ERHE_PROFILE_SCOPE("build edge index");
+
+        m_edge_index.clear();
+        m_edge_index.reserve(m_next_edge_id);
+        for (Edge_id edge_id = 0; edge_id < m_next_edge_id; ++edge_id) {
+            const Edge& edge = edges[edge_id];
+            m_edge_index.emplace(make_edge_key(edge.a, edge.b), edge_id);
+        }
+        m_edge_index_edge_count = m_next_edge_id;
+    }
+
+    const auto i = m_edge_index.find(make_edge_key(a, b));
+    if ((i == m_edge_index.end()) || (i->second >= edges.size())) {
+        return {};
+    }
+    return edges[i->second];
+}
+
 void Geometry::debug_trace() const
 {
     ERHE_PROFILE_FUNCTION();
@@ -10,8 +10,13 @@
 #include <functional>
 #include <optional>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
+
 namespace spdlog {
     class logger;
 }
@@ -499,6 +504,18 @@ public:
         m_serial_corner_texture_coordinates = m_serial;
     }
 
+    // Call after modifying point locations. Attributes derived from point
+    // locations (normals, centroids, tangents, ...) are considered out of
+    // date. Topology, including edges, is not affected.
+    void invalidate_point_locations()
+    {
+        const bool edges_valid = (m_serial_edges == m_serial);
+        ++m_serial;
+        if (edges_valid) {
+            m_serial_edges = m_serial;
+        }
+    }
+
     auto get_corner_count        () const -> uint32_t { return m_next_corner_id; }
     auto get_point_count         () const -> uint32_t { return m_next_point_id; }
     auto get_point_corner_count  () const -> uint32_t { return m_next_point_corner_reserve; }
@@ -506,18 +523,8 @@ public:
     auto get_polygon_corner_count() const -> uint32_t { return m_next_polygon_corner_id; }
     auto get_edge_count          () const -> uint32_t { return m_next_edge_id; }
 
-    [[nodiscard]] auto find_edge(Point_id a, Point_id b) -> std::optional<Edge>
-    {
-        if (b < a) {
-            std::swap(a, b);
-        }
-        for (const auto& edge : edges) {
-            if (edge.a == a && edge.b == b) {
-                return edge;
-            }
-        }
-        return {};
-    }
+    // O(1) lookup using edge index, which is built on demand
+    [[nodiscard]] auto find_edge(Point_id a, Point_id b) -> std::optional<Edge>;
 
     // Allocates new Corner / Corner_id
     // - Point must be allocated.
@@ -622,14 +629,33 @@ public:
     // Requires point locations.
     // Returns false if point locations are not available.
     // Returns true on success.
-    auto compute_polygon_normals() -> bool;
+    // Polygons are processed in parallel when thread pool is given.
+    auto compute_polygon_normals(erhe::concurrency::Thread_pool* thread_pool = nullptr) -> bool;
+
+    // Computes normals to polygon_normals, which need not be attribute of
+    // this geometry. When skip_present is set, polygons which already have
+    // value are not updated.
+    void compute_polygon_normals(
+        Property_map<Polygon_id, glm::vec3>&     polygon_normals,
+        const Property_map<Point_id, glm::vec3>& point_locations,
+        bool                                     skip_present,
+        erhe::concurrency::Thread_pool*          thread_pool = nullptr
+    ) const;
 
     [[nodiscard]] auto has_polygon_normals() const -> bool;
 
     // Requires point locations.
     // Returns false if point locations are not available.
     // Returns true on success.
-    auto compute_polygon_centroids() -> bool;
+    // Polygons are processed in parallel when thread pool is given.
+    auto compute_polygon_centroids(erhe::concurrency::Thread_pool* thread_pool = nullptr) -> bool;
+
+    void compute_polygon_centroids(
+        Property_map<Polygon_id, glm::vec3>&     polygon_centroids,
+        const Property_map<Point_id, glm::vec3>& point_locations,
+        bool                                     skip_present,
+        erhe::concurrency::Thread_pool*          thread_pool = nullptr
+    ) const;
 
     [[nodiscard]] auto has_polygon_centroids() const -> bool;
 
@@ -687,7 +713,10 @@ public:
 
     void make_point_corners();
 
-    void build_edges(bool is_manifold = true);
+    // Builds edges in single pass: half edges are sorted by (min point, max point)
+    // key, each run of equal keys becomes one edge. Works for non-manifold and
+    // inconsistently wound meshes.
+    void build_edges();
 
     [[nodiscard]] auto has_edges() const -> bool;
 
@@ -833,6 +862,8 @@ public:
     Edge_polygon_id                 m_next_edge_polygon_id     {0};
     Polygon_id                      m_polygon_corner_polygon   {0};
     Edge_id                         m_edge_polygon_edge        {0};
+    std::unordered_map<uint64_t, Edge_id> m_edge_index;             // (min point, max point) -> edge, see find_edge()
+    Edge_id                         m_edge_index_edge_count    {0}; // edges [0, count) are in m_edge_index
     Point_property_map_collection   m_point_property_map_collection;
     Corner_property_map_collection  m_corner_property_map_collection;
     Polygon_property_map_collection m_polygon_property_map_collection;
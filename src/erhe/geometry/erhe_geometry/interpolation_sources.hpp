@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace erhe::geometry
+{
+
+// Weighted sources (old keys) for each new key, used to interpolate
+// property maps. Stored in compressed sparse row (CSR) form: sources of
+// new key k are at [offsets[k], offsets[k + 1]) in weights and old keys.
+//
+// Sources can be added in any new key order. They are grouped by new key
+// with counting sort when finalize() is called; sources of each new key
+// keep the order in which they were added. Sources can be added after
+// finalize(), next finalize() merges them.
+template <typename Key_type>
+class Interpolation_sources
+{
+public:
+    class Source_range
+    {
+    public:
+        [[nodiscard]] auto size () const -> std::size_t { return weights.size(); }
+        [[nodiscard]] auto empty() const -> bool        { return weights.empty(); }
+
+        std::span<const float>    weights;
+        std::span<const Key_type> old_keys;
+    };
+
+    void clear()
+    {
+        m_offsets.assign(1, 0);
+        m_weights .clear();
+        m_old_keys.clear();
+        m_pending .clear();
+    }
+
+    void reserve(const std::size_t source_count)
+    {
+        m_pending.reserve(source_count);
+    }
+
+    void add(const Key_type new_key, const float weight, const Key_type old_key)
+    {
+        m_pending.push_back(Pending_source{new_key, weight, old_key});
+    }
+
+    [[nodiscard]] auto is_finalized() const -> bool
+    {
+        return m_pending.empty();
+    }
+
+    void finalize()
+    {
+        if (m_pending.empty()) {
+            return;
+        }
+
+        std::size_t key_count = size();
+        for (const Pending_source& source : m_pending) {
+            key_count = std::max(key_count, static_cast<std::size_t>(source.new_key) + 1);
+        }
+
+        std::vector<uint32_t> offsets(key_count + 1, 0);
+        for (std::size_t key = 0, end = size(); key < end; ++key) {
+            offsets[key + 1] = m_offsets[key + 1] - m_offsets[key];
+        }
+        for (const Pending_source& source : m_pending) {
+            ++offsets[static_cast<std::size_t>(source.new_key) + 1];
+        }
+        for (std::size_t key = 0; key < key_count; ++key) {
+            offsets[key + 1] += offsets[key];
+        }
+
+        const std::size_t     source_count = offsets.back();
+        std::vector<float>    weights (source_count);
+        std::vector<Key_type> old_keys(source_count);
+        std::vector<uint32_t> cursor  (offsets.begin(), offsets.end() - 1);
+        for (std::size_t key = 0, end = size(); key < end; ++key) {
+            for (uint32_t i = m_offsets[key], i_end = m_offsets[key + 1]; i < i_end; ++i) {
+                const uint32_t j = cursor[key]++;
+                weights [j] = m_weights [i];
+                old_keys[j] = m_old_keys[i];
+            }
+        }
+        for (const Pending_source& source : m_pending) {
+            const uint32_t j = cursor[static_cast<std::size_t>(source.new_key)]++;
+            weights [j] = source.weight;
+            old_keys[j] = source.old_key;
+        }
+
+        m_offsets  = std::move(offsets);
+        m_weights  = std::move(weights);
+        m_old_keys = std::move(old_keys);
+        m_pending.clear();
+    }
+
+    // Finalizes and sets number of new keys. Sources for keys beyond
+    // key_count are dropped, added keys have no sources.
+    void set_key_count(const std::size_t key_count)
+    {
+        finalize();
+        if (key_count < size()) {
+            m_offsets.resize(key_count + 1);
+            m_weights .resize(m_offsets.back());
+            m_old_keys.resize(m_offsets.back());
+        } else {
+            m_offsets.resize(key_count + 1, m_offsets.back());
+        }
+    }
+
+    // Number of new keys
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_offsets.size() - 1;
+    }
+
+    // Sources of new key; must be finalized
+    [[nodiscard]] auto get(const Key_type new_key) const -> Source_range
+    {
+        assert(is_finalized());
+        const std::size_t key = static_cast<std::size_t>(new_key);
+        if (key >= size()) {
+            return Source_range{};
+        }
+        const uint32_t begin = m_offsets[key];
+        const uint32_t count = m_offsets[key + 1] - begin;
+        return Source_range{
+            .weights  = std::span<const float   >{m_weights .data() + begin, count},
+            .old_keys = std::span<const Key_type>{m_old_keys.data() + begin, count}
+        };
+    }
+
+    [[nodiscard]] auto get_offsets () const -> const std::vector<uint32_t>& { return m_offsets; }
+    [[nodiscard]] auto get_weights () const -> const std::vector<float>&    { return m_weights; }
+    [[nodiscard]] auto get_old_keys() const -> const std::vector<Key_type>& { return m_old_keys; }
+
+private:
+    class Pending_source
+    {
+    public:
+        Key_type new_key;
+        float    weight;
+        Key_type old_key;
+    };
+
+    std::vector<uint32_t>       m_offsets{0};
+    std::vector<float>          m_weights;
+    std::vector<Key_type>       m_old_keys;
+    std::vector<Pending_source> m_pending;
+};
+
+} // namespace erhe::geometry
@@ -15,6 +15,7 @@ Ambo::Ambo(Geometry& source, Geometry& destination)
 
     make_polygon_centroids();
     make_edge_midpoints();
+    finalize_point_sources();
 
     // New faces from old points, new face corner for each old point corner edge midpoint
     {
@@ -113,6 +113,8 @@ Catmull_clark_subdivision::Catmull_clark_subdivision(
         });
     }
 
+    finalize_point_sources();
+
     // Subdivide polygons, clone (and corners);
     {
         ERHE_PROFILE_SCOPE("subdivide");
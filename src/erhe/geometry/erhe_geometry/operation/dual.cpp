@@ -14,6 +14,7 @@ Dual::Dual(Geometry& source, Geometry& destination, bool post_process)
     ERHE_PROFILE_FUNCTION();
 
     make_polygon_centroids();
+    finalize_point_sources();
 
     // New faces from old points, new face corner for each old point corner
     source.for_each_point_const([&](auto& i) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "erhe_geometry/interpolation_sources.hpp"
 #include "erhe_geometry/types.hpp"
 
 #include <set>
@@ -26,18 +27,18 @@ public:
     }
 
     static constexpr std::size_t s_grow_size = 4096;
-    Geometry&                                              source;
-    Geometry&                                              destination;
-    std::vector<Point_id  >                                point_old_to_new;
-    std::vector<Polygon_id>                                polygon_old_to_new;
-    std::vector<Corner_id >                                corner_old_to_new;
-    std::vector<Edge_id   >                                edge_old_to_new;
-    std::vector<Point_id  >                                old_polygon_centroid_to_new_points;
-    std::vector<std::vector<std::pair<float, Point_id  >>> new_point_sources;
-    std::vector<std::vector<std::pair<float, Corner_id >>> new_point_corner_sources;
-    std::vector<std::vector<std::pair<float, Corner_id >>> new_corner_sources;
-    std::vector<std::vector<std::pair<float, Polygon_id>>> new_polygon_sources;
-    std::vector<std::vector<std::pair<float, Edge_id   >>> new_edge_sources;
+    Geometry&                         source;
+    Geometry&                         destination;
+    std::vector<Point_id  >           point_old_to_new;
+    std::vector<Polygon_id>           polygon_old_to_new;
+    std::vector<Corner_id >           corner_old_to_new;
+    std::vector<Edge_id   >           edge_old_to_new;
+    std::vector<Point_id  >           old_polygon_centroid_to_new_points;
+    Interpolation_sources<Point_id  > new_point_sources;
+    Interpolation_sources<Corner_id > new_point_corner_sources;
+    Interpolation_sources<Corner_id > new_corner_sources;
+    Interpolation_sources<Polygon_id> new_polygon_sources;
+    Interpolation_sources<Edge_id   > new_edge_sources;
 
 private:
     static constexpr std::size_t s_max_edge_point_slots = 300;
@@ -49,6 +50,10 @@ public:
     void make_polygon_centroids    ();
     void reserve_edge_to_new_points();
 
+    // Groups point corner sources by new point. Call once after all new
+    // points have been made, before corners are made from them.
+    void finalize_point_sources();
+
     [[nodiscard]] auto find_or_make_point_from_edge(
         Point_id    a,
         Point_id    b,
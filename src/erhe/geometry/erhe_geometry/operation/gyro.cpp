@@ -30,6 +30,7 @@ Gyro::Gyro(Geometry& src, Geometry& destination)
             2.0f / 3.0f
         }
     );
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         i.polygon.for_each_corner_neighborhood_const(source, [&](auto& j) {
@@ -19,6 +19,7 @@ Join::Join(Geometry& src, Geometry& destination)
 
     make_points_from_points();
     make_polygon_centroids();
+    finalize_point_sources();
 
     source.for_each_edge_const([&](const auto& i) {
         if (i.edge.polygon_count != 2) {
@@ -15,6 +15,7 @@ Kis::Kis(Geometry& src, Geometry& destination)
 
     make_points_from_points();
     make_polygon_centroids();
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         i.polygon.for_each_corner_neighborhood_const(source, [&](auto& j) {
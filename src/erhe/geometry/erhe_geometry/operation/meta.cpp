@@ -24,6 +24,7 @@ Meta::Meta(Geometry& src, Geometry& destination)
     make_points_from_points();
     make_polygon_centroids();
     make_edge_midpoints();
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         i.polygon.for_each_corner_neighborhood_const(source, [&](auto& j) {
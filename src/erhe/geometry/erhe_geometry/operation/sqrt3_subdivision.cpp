@@ -36,6 +36,7 @@ Sqrt3_subdivision::Sqrt3_subdivision(Geometry& src, Geometry& destination)
     });
 
     make_polygon_centroids();
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         i.polygon.for_each_corner_neighborhood_const(source, [&](auto& j) {
@@ -24,6 +24,7 @@ Subdivide::Subdivide(Geometry& src, Geometry& destination)
     make_points_from_points();
     make_polygon_centroids();
     make_edge_midpoints();
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         //if (src_polygon.corner_count == 3)
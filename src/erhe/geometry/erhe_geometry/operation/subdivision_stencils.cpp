@@ -0,0 +1,276 @@
+#include "erhe_geometry/operation/subdivision_stencils.hpp"
+#include "erhe_geometry/operation/catmull_clark_subdivision.hpp"
+#include "erhe_geometry/operation/sqrt3_subdivision.hpp"
+#include "erhe_geometry/geometry.hpp"
+#include "erhe_geometry/geometry_log.hpp"
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace erhe::geometry::operation
+{
+
+namespace {
+
+constexpr std::size_t s_stencils_per_chunk = 1024;
+
+// Converts interpolation sources of one subdivision level to stencil table
+// with normalized weights. Interpolation uses weights relative to their sum,
+// so normalized stencils produce the same values.
+auto make_level_stencil_table(
+    const Interpolation_sources<Point_id>& sources,
+    const std::size_t                      source_point_count
+) -> Stencil_table
+{
+    ERHE_PROFILE_FUNCTION();
+
+    Stencil_table table;
+    table.offsets.reserve(sources.size() + 1);
+    table.weights.reserve(sources.get_weights().size());
+    table.sources.reserve(sources.get_weights().size());
+    for (std::size_t new_key = 0, end = sources.size(); new_key < end; ++new_key) {
+        const auto range = sources.get(static_cast<Point_id>(new_key));
+        float      sum_weights{0.0f};
+        for (std::size_t i = 0, i_end = range.size(); i < i_end; ++i) {
+            if (range.old_keys[i] < source_point_count) {
+                sum_weights += range.weights[i];
+            }
+        }
+        if (sum_weights != 0.0f) {
+            for (std::size_t i = 0, i_end = range.size(); i < i_end; ++i) {
+                if (range.old_keys[i] < source_point_count) {
+                    table.weights.push_back(range.weights[i] / sum_weights);
+                    table.sources.push_back(range.old_keys[i]);
+                }
+            }
+        }
+        table.offsets.push_back(static_cast<uint32_t>(table.weights.size()));
+    }
+    return table;
+}
+
+// Returns outer * inner: stencils of outer refer to points of inner, result
+// stencils refer to source points of inner. Rows are composed in fixed size
+// chunks, so result does not depend on thread count.
+auto compose_stencil_tables(
+    const Stencil_table&            outer,
+    const Stencil_table&            inner,
+    erhe::concurrency::Thread_pool* thread_pool
+) -> Stencil_table
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const std::size_t          row_count   = outer.size();
+    const std::size_t          chunk_count = (row_count + s_stencils_per_chunk - 1) / s_stencils_per_chunk;
+    std::vector<Stencil_table> chunks(chunk_count);
+
+    const auto compose_chunk = [&](const std::size_t chunk) {
+        Stencil_table&                          out = chunks[chunk];
+        std::vector<std::pair<Point_id, float>> row;
+        const std::size_t row_begin = chunk * s_stencils_per_chunk;
+        const std::size_t row_end   = std::min(row_count, row_begin + s_stencils_per_chunk);
+        for (std::size_t k = row_begin; k < row_end; ++k) {
+            row.clear();
+            for (uint32_t i = outer.offsets[k], i_end = outer.offsets[k + 1]; i < i_end; ++i) {
+                const float    outer_weight = outer.weights[i];
+                const Point_id inner_row    = outer.sources[i];
+                for (uint32_t j = inner.offsets[inner_row], j_end = inner.offsets[inner_row + 1]; j < j_end; ++j) {
+                    row.emplace_back(inner.sources[j], outer_weight * inner.weights[j]);
+                }
+            }
+            std::sort(
+                row.begin(),
+                row.end(),
+                [](const std::pair<Point_id, float>& lhs, const std::pair<Point_id, float>& rhs) {
+                    return lhs.first < rhs.first;
+                }
+            );
+            for (std::size_t a = 0, a_end = row.size(); a < a_end;) {
+                float       weight = row[a].second;
+                std::size_t b      = a + 1;
+                while ((b < a_end) && (row[b].first == row[a].first)) {
+                    weight += row[b].second;
+                    ++b;
+                }
+                out.weights.push_back(weight);
+                out.sources.push_back(row[a].first);
+                a = b;
+            }
+            out.offsets.push_back(static_cast<uint32_t>(out.weights.size()));
+        }
+    };
+
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for_each_index(*thread_pool, 0, chunk_count, 1, compose_chunk);
+    } else {
+        for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            compose_chunk(chunk);
+        }
+    }
+
+    Stencil_table result;
+    std::size_t   entry_count = 0;
+    for (const Stencil_table& chunk : chunks) {
+        entry_count += chunk.weights.size();
+    }
+    result.offsets.reserve(row_count + 1);
+    result.weights.reserve(entry_count);
+    result.sources.reserve(entry_count);
+    for (const Stencil_table& chunk : chunks) {
+        const uint32_t base = static_cast<uint32_t>(result.weights.size());
+        for (std::size_t k = 1, end = chunk.offsets.size(); k < end; ++k) {
+            result.offsets.push_back(base + chunk.offsets[k]);
+        }
+        result.weights.insert(result.weights.end(), chunk.weights.begin(), chunk.weights.end());
+        result.sources.insert(result.sources.end(), chunk.sources.begin(), chunk.sources.end());
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+Subdivision_stencils::Subdivision_stencils(
+    Geometry&                       base,
+    const Subdivision_scheme        scheme,
+    const std::size_t               level_count,
+    erhe::concurrency::Thread_pool* thread_pool
+)
+    : m_scheme          {scheme}
+    , m_level_count     {level_count}
+    , m_base_point_count{base.get_point_count()}
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(level_count > 0);
+
+    Geometry*                 level_source = &base;
+    std::unique_ptr<Geometry> level_geometry;
+    for (std::size_t level = 0; level < level_count; ++level) {
+        auto destination = std::make_unique<Geometry>(
+            fmt::format("{}({})", (scheme == Subdivision_scheme::sqrt3) ? "sqrt3" : "catmull_clark", level_source->name)
+        );
+        Interpolation_sources<Point_id> point_sources;
+        switch (scheme) {
+            //using enum Subdivision_scheme;
+            case Subdivision_scheme::sqrt3: {
+                Sqrt3_subdivision operation{*level_source, *destination};
+                point_sources = std::move(operation.new_point_sources);
+                break;
+            }
+            case Subdivision_scheme::catmull_clark:
+            default: {
+                Catmull_clark_subdivision operation{*level_source, *destination};
+                point_sources = std::move(operation.new_point_sources);
+                break;
+            }
+        }
+
+        Stencil_table level_table = make_level_stencil_table(point_sources, level_source->get_point_count());
+        m_stencil_table = (level == 0)
+            ? std::move(level_table)
+            : compose_stencil_tables(level_table, m_stencil_table, thread_pool);
+
+        level_geometry = std::move(destination);
+        level_source   = level_geometry.get();
+    }
+    m_refined_geometry = std::move(level_geometry);
+
+    log_subdivide->trace(
+        "{} levels, {} base points, {} refined points, {} stencil weights",
+        level_count, m_base_point_count, get_refined_point_count(), m_stencil_table.weights.size()
+    );
+}
+
+Subdivision_stencils::~Subdivision_stencils() noexcept = default;
+
+auto Subdivision_stencils::get_scheme() const -> Subdivision_scheme
+{
+    return m_scheme;
+}
+
+auto Subdivision_stencils::get_level_count() const -> std::size_t
+{
+    return m_level_count;
+}
+
+auto Subdivision_stencils::get_base_point_count() const -> std::size_t
+{
+    return m_base_point_count;
+}
+
+auto Subdivision_stencils::get_refined_point_count() const -> std::size_t
+{
+    return m_stencil_table.size();
+}
+
+auto Subdivision_stencils::get_stencil_table() const -> const Stencil_table&
+{
+    return m_stencil_table;
+}
+
+auto Subdivision_stencils::get_refined_geometry() -> Geometry&
+{
+    return *m_refined_geometry;
+}
+
+void Subdivision_stencils::apply(
+    const std::span<const glm::vec3> base_values,
+    const std::span<glm::vec3>       refined_values,
+    erhe::concurrency::Thread_pool*  thread_pool
+) const
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(base_values.size() >= m_base_point_count);
+    ERHE_VERIFY(refined_values.size() >= get_refined_point_count());
+
+    const Stencil_table& table = m_stencil_table;
+    const auto evaluate = [&table, base_values, refined_values](const std::size_t begin, const std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            glm::vec3 value{0.0f};
+            for (uint32_t i = table.offsets[k], i_end = table.offsets[k + 1]; i < i_end; ++i) {
+                value += table.weights[i] * base_values[table.sources[i]];
+            }
+            refined_values[k] = value;
+        }
+    };
+
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, get_refined_point_count(), s_stencils_per_chunk, evaluate);
+    } else {
+        evaluate(0, get_refined_point_count());
+    }
+}
+
+auto Subdivision_stencils::update(
+    const Geometry&                 base,
+    erhe::concurrency::Thread_pool* thread_pool
+) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(base.get_point_count() == m_base_point_count);
+
+    Geometry&   refined                 = *m_refined_geometry;
+    const auto* base_point_locations    = base.point_attributes().find<glm::vec3>(c_point_locations);
+    auto*       refined_point_locations = refined.point_attributes().find<glm::vec3>(c_point_locations);
+    if ((base_point_locations == nullptr) || (refined_point_locations == nullptr)) {
+        log_subdivide->warn("{} geometry = {} - No point locations found", __func__, base.name);
+        return false;
+    }
+
+    apply(base_point_locations->span(), refined_point_locations->span(), thread_pool);
+
+    refined.invalidate_point_locations();
+    refined.compute_point_normals(c_point_normals_smooth);
+    refined.compute_polygon_centroids();
+    refined.compute_tangents(true, true, false, false, true, true);
+    return true;
+}
+
+} // namespace erhe::geometry::operation
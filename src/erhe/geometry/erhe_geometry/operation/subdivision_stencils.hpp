@@ -0,0 +1,95 @@
+#pragma once
+
+#include "erhe_geometry/types.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace erhe::concurrency
+{
+    class Thread_pool;
+}
+
+namespace erhe::geometry
+{
+    class Geometry;
+}
+
+namespace erhe::geometry::operation
+{
+
+enum class Subdivision_scheme : unsigned int {
+    catmull_clark = 0,
+    sqrt3
+};
+
+// Stencil k gives refined point k as weighted sum of source points:
+// sum of weights[i] * source point sources[i], i in [offsets[k], offsets[k + 1]).
+// Weights of each stencil sum to one.
+class Stencil_table
+{
+public:
+    [[nodiscard]] auto size() const -> std::size_t { return offsets.size() - 1; }
+
+    std::vector<uint32_t> offsets{0};
+    std::vector<float>    weights;
+    std::vector<Point_id> sources;
+};
+
+// Cached refinement plan for repeated subdivision of the same topology
+// (stencil tables in the OpenSubdiv style). Topology is refined once, and
+// stencils of all levels are composed into one table that maps base points
+// directly to points of the last level. When only base point locations
+// change, update() recomputes refined point locations from the stencils
+// (in parallel if thread pool is given) and refreshes derived attributes,
+// without rebuilding topology or attribute sources.
+class Subdivision_stencils
+{
+public:
+    Subdivision_stencils(
+        Geometry&                       base,
+        Subdivision_scheme              scheme,
+        std::size_t                     level_count,
+        erhe::concurrency::Thread_pool* thread_pool = nullptr
+    );
+    ~Subdivision_stencils() noexcept;
+
+    [[nodiscard]] auto get_scheme             () const -> Subdivision_scheme;
+    [[nodiscard]] auto get_level_count        () const -> std::size_t;
+    [[nodiscard]] auto get_base_point_count   () const -> std::size_t;
+    [[nodiscard]] auto get_refined_point_count() const -> std::size_t;
+    [[nodiscard]] auto get_stencil_table      () const -> const Stencil_table&;
+
+    // Refined geometry, as created when stencils were built
+    [[nodiscard]] auto get_refined_geometry() -> Geometry&;
+
+    // Evaluates stencils: refined_values[k] = sum of weight * base_values[source]
+    void apply(
+        std::span<const glm::vec3>      base_values,
+        std::span<glm::vec3>            refined_values,
+        erhe::concurrency::Thread_pool* thread_pool = nullptr
+    ) const;
+
+    // Reads point locations from base (which must have topology stencils were
+    // built from), writes refined point locations, and recomputes point
+    // normals, polygon centroids and tangents of refined geometry.
+    // Returns false if point locations are missing.
+    auto update(
+        const Geometry&                 base,
+        erhe::concurrency::Thread_pool* thread_pool = nullptr
+    ) -> bool;
+
+private:
+    Subdivision_scheme        m_scheme;
+    std::size_t               m_level_count     {0};
+    std::size_t               m_base_point_count{0};
+    Stencil_table             m_stencil_table;
+    std::unique_ptr<Geometry> m_refined_geometry;
+};
+
+} // namespace erhe::geometry::operation
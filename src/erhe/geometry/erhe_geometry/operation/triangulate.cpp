@@ -15,6 +15,7 @@ Triangulate::Triangulate(Geometry& src, Geometry& destination)
 
     make_points_from_points();
     make_polygon_centroids();
+    finalize_point_sources();
 
     source.for_each_polygon_const([&](auto& i) {
         if (i.polygon.corner_count == 3) {
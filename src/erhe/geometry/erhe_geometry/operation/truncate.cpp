@@ -23,6 +23,7 @@ Truncate::Truncate(Geometry& source, Geometry& destination)
 
     make_polygon_centroids();
     make_edge_midpoints( {t0, t1} );
+    finalize_point_sources();
 
     // New faces from old points, new face corner for each old point corner edge
     // 'midpoint' that is closest to the corner
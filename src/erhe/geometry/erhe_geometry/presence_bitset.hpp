@@ -0,0 +1,139 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace erhe::geometry
+{
+
+// Word based bitset used to track which keys have a value in sparse
+// Property_map. Iteration over set bits skips empty words and uses
+// count trailing zeros within words.
+class Presence_bitset
+{
+public:
+    using Word = uint64_t;
+    static constexpr std::size_t s_word_bits = 64;
+
+    void clear()
+    {
+        m_words.clear();
+        m_size = 0;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+        return m_size == 0;
+    }
+
+    void reserve(const std::size_t size)
+    {
+        m_words.reserve(word_count(size));
+    }
+
+    // New bits are set to value
+    void resize(const std::size_t size, const bool value = false)
+    {
+        if (size < m_size) {
+            m_words.resize(word_count(size));
+            m_size = size;
+            clear_unused_bits();
+            return;
+        }
+        if (value) {
+            // Set tail of current last word
+            const std::size_t tail = m_size % s_word_bits;
+            if (tail != 0) {
+                m_words.back() |= ~Word{0} << tail;
+            }
+        }
+        m_words.resize(word_count(size), value ? ~Word{0} : Word{0});
+        m_size = size;
+        clear_unused_bits();
+    }
+
+    [[nodiscard]] auto test(const std::size_t i) const -> bool
+    {
+        return (m_words[i / s_word_bits] >> (i % s_word_bits)) & Word{1};
+    }
+
+    void set(const std::size_t i)
+    {
+        m_words[i / s_word_bits] |= Word{1} << (i % s_word_bits);
+    }
+
+    void reset(const std::size_t i)
+    {
+        m_words[i / s_word_bits] &= ~(Word{1} << (i % s_word_bits));
+    }
+
+    void assign(const std::size_t i, const bool value)
+    {
+        if (value) {
+            set(i);
+        } else {
+            reset(i);
+        }
+    }
+
+    [[nodiscard]] auto count() const -> std::size_t
+    {
+        std::size_t result = 0;
+        for (const Word word : m_words) {
+            result += static_cast<std::size_t>(std::popcount(word));
+        }
+        return result;
+    }
+
+    [[nodiscard]] auto all() const -> bool
+    {
+        return count() == m_size;
+    }
+
+    void append(const Presence_bitset& other)
+    {
+        const std::size_t offset = m_size;
+        resize(m_size + other.m_size);
+        other.for_each_set_bit([this, offset](const std::size_t i) { set(offset + i); });
+    }
+
+    // Calls f(index) for each set bit in increasing index order
+    template <typename F>
+    void for_each_set_bit(F&& f) const
+    {
+        for (std::size_t word_index = 0, end = m_words.size(); word_index < end; ++word_index) {
+            Word word = m_words[word_index];
+            while (word != 0) {
+                const std::size_t bit = static_cast<std::size_t>(std::countr_zero(word));
+                f(word_index * s_word_bits + bit);
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] static auto word_count(const std::size_t size) -> std::size_t
+    {
+        return (size + s_word_bits - 1) / s_word_bits;
+    }
+
+    void clear_unused_bits()
+    {
+        const std::size_t tail = m_size % s_word_bits;
+        if (tail != 0) {
+            m_words.back() &= (Word{1} << tail) - 1;
+        }
+    }
+
+    std::vector<Word> m_words;
+    std::size_t       m_size{0};
+};
+
+} // namespace erhe::geometry
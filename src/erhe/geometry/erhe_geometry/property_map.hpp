@@ -1,11 +1,16 @@
 #pragma once
 
+#include "erhe_geometry/interpolation_sources.hpp"
+#include "erhe_geometry/presence_bitset.hpp"
+#include "erhe_geometry/property_map_kernels.hpp"
+
 #include <glm/glm.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <typeinfo>
 #include <vector>
 
@@ -53,8 +58,8 @@ public:
     virtual void remap_keys(const std::vector<Key_type>& key_old_to_new) = 0;
 
     virtual void interpolate(
-        Property_map_base<Key_type>*                                destination,
-        const std::vector<std::vector<std::pair<float, Key_type>>>& key_new_to_olds
+        Property_map_base<Key_type>*           destination,
+        const Interpolation_sources<Key_type>& sources
     ) const = 0;
 
     virtual void transform  (const glm::mat4 matrix) = 0;
@@ -65,6 +70,15 @@ protected:
     Property_map_base() = default;
 };
 
+// Property_map has two storage modes:
+//  - dense:  every key in [0, values.size()) has a value, no presence bits
+//            are stored or checked. New maps start dense and stay dense as
+//            long as keys are put in order without gaps, and no keys are
+//            erased. This is the common case for generated geometry and for
+//            maps produced by interpolate().
+//  - sparse: presence of each key is tracked in Presence_bitset.
+// Sparse map is converted back to dense by interpolate() or compact() when
+// all keys are present.
 template <typename Key_type, typename Value_type>
 class Property_map
     : public Property_map_base<Key_type>
@@ -92,8 +106,8 @@ public:
     void remap_keys(const std::vector<Key_type>& key_new_to_old) final;
 
     void interpolate(
-        Property_map_base<Key_type>*                                destination,
-        const std::vector<std::vector<std::pair<float, Key_type>>>& key_new_to_olds
+        Property_map_base<Key_type>*           destination,
+        const Interpolation_sources<Key_type>& sources
     ) const final;
 
     void transform  (const glm::mat4 matrix) final;
@@ -101,13 +115,32 @@ public:
     void import_from(Property_map_base<Key_type>* source, const glm::mat4 transform) final;
     auto constructor(const Property_map_descriptor& descriptor) const -> Property_map_base<Key_type>* final;
 
+    [[nodiscard]] auto is_dense     () const -> bool { return m_dense; }
+    [[nodiscard]] auto present_count() const -> std::size_t;
+
+    // Contiguous values; in sparse mode values for keys that are not present are unspecified
+    [[nodiscard]] auto span() -> std::span<Value_type>             { return std::span<Value_type>{values}; }
+    [[nodiscard]] auto span() const -> std::span<const Value_type> { return std::span<const Value_type>{values}; }
+
+    // Converts to dense mode if all keys are present
+    auto compact() -> bool;
+
+    // Calls f(key, value) for each present key in increasing key order
+    template <typename F>
+    void for_each_present(F&& f) const;
+
     static constexpr std::size_t s_grow_size = 4096;
 
     std::vector<Value_type> values;
-    std::vector<bool>       present; // Yes, I know vector<bool> has limitations
+    Presence_bitset         present; // Only used in sparse mode
 
 private:
+    void make_sparse    ();
+    void import_presence(const Property_map<Key_type, Value_type>& source);
+    void transform_range(const glm::mat4& matrix, std::size_t begin, std::size_t end);
+
     Property_map_descriptor m_descriptor;
+    bool                    m_dense{true};
 };
 
 } // namespace erhe::geometry
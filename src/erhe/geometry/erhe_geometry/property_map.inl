@@ -34,6 +34,7 @@ Property_map<Key_type, Value_type>::clear()
 
     values.clear();
     present.clear();
+    m_dense = true;
 }
 
 template <typename Key_type, typename Value_type>
@@ -50,10 +51,82 @@ Property_map<Key_type, Value_type>::size() const -> std::size_t
     return values.size();
 }
 
+template <typename Key_type, typename Value_type>
+inline auto
+Property_map<Key_type, Value_type>::present_count() const -> std::size_t
+{
+    return m_dense ? values.size() : present.count();
+}
+
+template <typename Key_type, typename Value_type>
+inline void
+Property_map<Key_type, Value_type>::make_sparse()
+{
+    if (!m_dense) {
+        return;
+    }
+    present.clear();
+    present.resize(values.size(), true);
+    m_dense = false;
+}
+
+template <typename Key_type, typename Value_type>
+inline auto
+Property_map<Key_type, Value_type>::compact() -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    if (m_dense) {
+        return true;
+    }
+
+    // Trailing keys that are not present (grow padding) can be dropped
+    std::size_t count    {0};
+    std::size_t used_size{0};
+    present.for_each_set_bit(
+        [&count, &used_size](const std::size_t i) {
+            ++count;
+            used_size = i + 1;
+        }
+    );
+    if (count != used_size) {
+        return false;
+    }
+    values.resize(used_size);
+    present.clear();
+    m_dense = true;
+    return true;
+}
+
+template <typename Key_type, typename Value_type>
+template <typename F>
+inline void
+Property_map<Key_type, Value_type>::for_each_present(F&& f) const
+{
+    if (m_dense) {
+        for (std::size_t i = 0, end = values.size(); i < end; ++i) {
+            f(static_cast<Key_type>(i), values[i]);
+        }
+        return;
+    }
+    present.for_each_set_bit(
+        [this, &f](const std::size_t i) {
+            f(static_cast<Key_type>(i), values[i]);
+        }
+    );
+}
+
 template <typename Key_type, typename Value_type>
 inline void
 Property_map<Key_type, Value_type>::trim(std::size_t size)
 {
+    if (m_dense) {
+        if (size <= values.size()) {
+            values.resize(size);
+            return;
+        }
+        make_sparse();
+    }
     values.resize(size);
     present.resize(size);
 }
@@ -62,12 +135,20 @@ template <typename Key_type, typename Value_type>
 inline void
 Property_map<Key_type, Value_type>::remap_keys(const std::vector<Key_type>& key_new_to_old)
 {
-    const auto old_values  = values;
-    const auto old_present = present;
+    const auto old_values = values;
+    if (m_dense) {
+        for (Key_type new_key = 0, end = static_cast<Key_type>(key_new_to_old.size()); new_key < end; ++new_key) {
+            Key_type old_key = key_new_to_old[new_key];
+            values[new_key] = old_values[old_key];
+        }
+        return;
+    }
+
+    const Presence_bitset old_present = present;
     for (Key_type new_key = 0, end = static_cast<Key_type>(key_new_to_old.size()); new_key < end; ++new_key) {
         Key_type old_key = key_new_to_old[new_key];
-        values [new_key] = old_values[old_key];
-        present[new_key] = old_present[old_key];
+        values[new_key] = old_values[old_key];
+        present.assign(new_key, old_present.test(old_key));
     }
 }
 
@@ -78,12 +159,23 @@ Property_map<Key_type, Value_type>::put(Key_type key, Value_type value)
     ERHE_PROFILE_FUNCTION();
 
     const std::size_t i = static_cast<std::size_t>(key);
+    if (m_dense) {
+        if (i < values.size()) {
+            values[i] = value;
+            return;
+        }
+        if (i == values.size()) {
+            values.push_back(value);
+            return;
+        }
+        make_sparse(); // gap in keys
+    }
     if (values.size() <= i) {
         values.resize(i + s_grow_size);
         present.resize(i + s_grow_size);
     }
     values[i] = value;
-    present[i] = true;
+    present.set(i);
 }
 
 template <typename Key_type, typename Value_type>
@@ -93,7 +185,7 @@ Property_map<Key_type, Value_type>::get(Key_type key) const -> Value_type
     ERHE_PROFILE_FUNCTION();
 
     const std::size_t i = static_cast<std::size_t>(key);
-    if ((values.size() <= i) || !present[i]) {
+    if ((values.size() <= i) || (!m_dense && !present.test(i))) {
         ERHE_FATAL("Value not found");
     }
     return values[i];
@@ -106,11 +198,17 @@ Property_map<Key_type, Value_type>::erase(Key_type key)
     ERHE_PROFILE_FUNCTION();
 
     const std::size_t i = static_cast<std::size_t>(key);
+    if (m_dense) {
+        if (values.size() <= i) {
+            return;
+        }
+        make_sparse();
+    }
     if (values.size() <= i) {
         values.resize(i + s_grow_size);
         present.resize(i + s_grow_size);
     }
-    present[i] = false;
+    present.reset(i);
 }
 
 template <typename Key_type, typename Value_type>
@@ -120,7 +218,7 @@ Property_map<Key_type, Value_type>::maybe_get(Key_type key, Value_type& out_valu
     ERHE_PROFILE_FUNCTION();
 
     const std::size_t i = static_cast<size_t>(key);
-    if ((values.size() <= i) || !present[i]) {
+    if ((values.size() <= i) || (!m_dense && !present.test(i))) {
         return false;
     }
     out_value = values[i];
@@ -135,7 +233,7 @@ Property_map<Key_type, Value_type>::has(Key_type key) const -> bool
     ERHE_PROFILE_FUNCTION();
 
     const std::size_t i = static_cast<std::size_t>(key);
-    if ((values.size() <= i) || !present[i]) {
+    if ((values.size() <= i) || (!m_dense && !present.test(i))) {
         return false;
     }
     return true;
@@ -154,11 +252,18 @@ Property_map<Key_type, Value_type>::constructor(
     return base_ptr;
 }
 
+// Number of float components for value types supported by bulk kernels
+template <typename T> struct kernel_properties            { static constexpr std::size_t component_count = 0; };
+template <>           struct kernel_properties<float>     { static constexpr std::size_t component_count = 1; };
+template <>           struct kernel_properties<glm::vec2> { static constexpr std::size_t component_count = 2; };
+template <>           struct kernel_properties<glm::vec3> { static constexpr std::size_t component_count = 3; };
+template <>           struct kernel_properties<glm::vec4> { static constexpr std::size_t component_count = 4; };
+
 template <typename Key_type, typename Value_type>
 inline void
 Property_map<Key_type, Value_type>::interpolate(
-    Property_map_base<Key_type>*                                destination_base,
-    const std::vector<std::vector<std::pair<float, Key_type>>>& key_new_to_olds
+    Property_map_base<Key_type>*           destination_base,
+    const Interpolation_sources<Key_type>& sources
 ) const
 {
     ERHE_PROFILE_FUNCTION();
@@ -174,37 +279,85 @@ Property_map<Key_type, Value_type>::interpolate(
         return;
     }
 
-    for (
-        std::size_t new_key = 0, end = key_new_to_olds.size();
-        new_key < end;
-        ++new_key
-    ) {
-        const std::vector<std::pair<float, Key_type>>& old_keys = key_new_to_olds[new_key];
+    ERHE_VERIFY(sources.is_finalized());
+
+    const std::size_t new_count = sources.size();
+    const bool        bulk      = destination->empty();
+    Presence_bitset   bulk_present;
+    bool              bulk_all_present{true};
+    if (bulk) {
+        destination->values.resize(new_count);
+        bulk_present.resize(new_count);
+    }
+
+    const bool normalize_xyz =
+        (std::is_same_v<Value_type, glm::vec3> && (m_descriptor.interpolation_mode == Interpolation_mode::normalized)) ||
+        (std::is_same_v<Value_type, glm::vec4> && (m_descriptor.interpolation_mode == Interpolation_mode::normalized_vec3_float));
+
+    // Dense source to empty destination uses bulk kernel
+    if constexpr ((kernel_properties<Value_type>::component_count > 0) && std::is_same_v<Key_type, uint32_t>) {
+        if (m_dense && bulk) {
+            const std::size_t missing_count = kernels::interpolate(
+                kernel_properties<Value_type>::component_count,
+                reinterpret_cast<const float*>(values.data()),
+                values.size(),
+                sources.get_offsets().data(),
+                sources.get_weights().data(),
+                sources.get_old_keys().data(),
+                new_count,
+                normalize_xyz,
+                reinterpret_cast<float*>(destination->values.data()),
+                bulk_present
+            );
+            if (missing_count == 0) {
+                destination->present.clear();
+                destination->m_dense = true;
+            } else {
+                destination->present = std::move(bulk_present);
+                destination->m_dense = false;
+            }
+            return;
+        }
+    }
+
+    // Presence checks are skipped for dense source, and values are written
+    // directly to empty destination, which becomes dense if every new key
+    // received a value.
+    const bool        source_dense = m_dense;
+    const std::size_t source_size  = values.size();
+    const auto is_present = [this, source_dense, source_size](const Key_type old_key) -> bool {
+        const std::size_t i = static_cast<std::size_t>(old_key);
+        return (i < source_size) && (source_dense || present.test(i));
+    };
+
+    for (std::size_t new_key = 0; new_key < new_count; ++new_key) {
+        const auto old_sources = sources.get(static_cast<Key_type>(new_key));
 
         SPDLOG_LOGGER_TRACE(log_interpolate, "\tkey = {} from", new_key);
         float sum_weights{0.0f};
-        for (auto j : old_keys) {
-            const Key_type old_key = j.second;
-            SPDLOG_LOGGER_TRACE(log_interpolate, "\t\told key {} weight {}", static_cast<unsigned int>(old_key), static_cast<float>(j.first));
-            if (has(old_key)) {
-                sum_weights += j.first;
+        for (std::size_t j = 0, end = old_sources.size(); j < end; ++j) {
+            const Key_type old_key = old_sources.old_keys[j];
+            SPDLOG_LOGGER_TRACE(log_interpolate, "\t\told key {} weight {}", static_cast<unsigned int>(old_key), old_sources.weights[j]);
+            if (is_present(old_key)) {
+                sum_weights += old_sources.weights[j];
             }
         }
 
         if (sum_weights == 0.0f) {
             SPDLOG_LOGGER_TRACE(log_interpolate, "\t\tzero sum");
+            bulk_all_present = false;
             continue;
         }
 
         Value_type new_value(0);
         // TODO
         if constexpr (!std::is_same_v<Value_type, glm::uvec4>) {
-            for (auto j : old_keys) {
-                const float    weight  = j.first;
-                const Key_type old_key = j.second;
+            for (std::size_t j = 0, end = old_sources.size(); j < end; ++j) {
+                const float    weight  = old_sources.weights[j];
+                const Key_type old_key = old_sources.old_keys[j];
 
-                if (has(old_key)) {
-                    const Value_type old_value = get(old_key);
+                if (is_present(old_key)) {
+                    const Value_type old_value = values[static_cast<std::size_t>(old_key)];
                     SPDLOG_LOGGER_TRACE(log_interpolate, "\told value {} weight {}", old_value, (weight / sum_weights));
                     new_value += static_cast<Value_type>((weight / sum_weights) * static_cast<Value_type>(old_value));
                 } else {
@@ -215,7 +368,7 @@ Property_map<Key_type, Value_type>::interpolate(
 
         // Special treatment for normal and other direction vectors
         if constexpr (std::is_same_v<Value_type, glm::vec3>) {
-            if (m_descriptor.interpolation_mode == Interpolation_mode::normalized) {
+            if (normalize_xyz) {
                 new_value = glm::normalize(new_value);
                 SPDLOG_LOGGER_TRACE(log_interpolate, "\tnormalized", new_value);
             }
@@ -223,12 +376,12 @@ Property_map<Key_type, Value_type>::interpolate(
 
         // Special treatment for tangent vectors (and other vec3 direction + float vec4s).
         if constexpr (std::is_same_v<Value_type, glm::vec4>) {
-            if (m_descriptor.interpolation_mode == Interpolation_mode::normalized_vec3_float) {
+            if (normalize_xyz) {
                 new_value = glm::vec4{
                     glm::normalize(
                         glm::vec3{new_value}
                     ),
-                    new_value.z
+                    new_value.w
                 };
                 SPDLOG_LOGGER_TRACE(log_interpolate, "\tnormalized vec3-float", new_value);
             }
@@ -236,7 +389,22 @@ Property_map<Key_type, Value_type>::interpolate(
 
         SPDLOG_LOGGER_TRACE(log_interpolate, "\tvalue = {}", new_value);
 
-        destination->put(static_cast<Key_type>(new_key), new_value);
+        if (bulk) {
+            destination->values[new_key] = new_value;
+            bulk_present.set(new_key);
+        } else {
+            destination->put(static_cast<Key_type>(new_key), new_value);
+        }
+    }
+
+    if (bulk) {
+        if (bulk_all_present) {
+            destination->present.clear();
+            destination->m_dense = true;
+        } else {
+            destination->present = std::move(bulk_present);
+            destination->m_dense = false;
+        }
     }
 }
 
@@ -268,6 +436,25 @@ template <>           struct transform_properties<glm::vec2> { static const bool
 template <>           struct transform_properties<glm::vec3> { static const bool is_transformable = true;  };
 template <>           struct transform_properties<glm::vec4> { static const bool is_transformable = true;  };
 
+template <typename Key_type, typename Value_type>
+inline void
+Property_map<Key_type, Value_type>::import_presence(const Property_map<Key_type, Value_type>& source)
+{
+    ERHE_VERIFY(m_dense || (values.size() == present.size()));
+    ERHE_VERIFY(source.m_dense || (source.values.size() == source.present.size()));
+
+    // Merged map stays dense only if both maps are dense
+    if (m_dense && source.m_dense) {
+        return;
+    }
+    make_sparse();
+    if (source.m_dense) {
+        present.resize(present.size() + source.values.size(), true);
+    } else {
+        present.append(source.present);
+    }
+}
+
 template <typename Key_type, typename Value_type>
 inline void
 Property_map<Key_type, Value_type>::import_from(
@@ -282,78 +469,76 @@ Property_map<Key_type, Value_type>::import_from(
         return;
     }
 
-    ERHE_VERIFY(values.size() == present.size());
-    ERHE_VERIFY(source->values.size() == source->present.size());
-
-    values .reserve(values.size()  + source->values.size());
-    present.reserve(present.size() + source->present.size());
-    present.insert(present.end(), source->present.begin(), source->present.end());
+    import_presence(*source);
     values.insert(values.end(), source->values.begin(), source->values.end());
 }
 
+// Transforms values in [begin, end) according to transform mode. For direction
+// modes, matrix must be inverse transpose of the transform.
 template <typename Key_type, typename Value_type>
 inline void
-Property_map<Key_type, Value_type>::transform(
-    const glm::mat4 transform
+Property_map<Key_type, Value_type>::transform_range(
+    const glm::mat4&  matrix,
+    const std::size_t begin,
+    const std::size_t end
 )
 {
-    ERHE_PROFILE_FUNCTION();
-
-    ERHE_VERIFY(values.size() == present.size());
+    if (end <= begin) {
+        return;
+    }
+    const std::size_t count = end - begin;
+    switch (m_descriptor.transform_mode) {
+        //using enum Transform_mode;
+        default:
+        case Transform_mode::none: {
+            break;
+        }
 
-    if constexpr(transform_properties<Value_type>::is_transformable) {
-        switch (m_descriptor.transform_mode) {
-            //using enum Transform_mode;
-            default:
-            case Transform_mode::none: {
-                break;
+        case Transform_mode::position: {
+            if constexpr (std::is_same_v<Value_type, glm::vec3>) {
+                kernels::transform_vec3(matrix, reinterpret_cast<float*>(values.data() + begin), count, 1.0f, false);
+            } else if constexpr (std::is_same_v<Value_type, glm::vec4>) {
+                kernels::transform_vec4(matrix, reinterpret_cast<float*>(values.data() + begin), count);
+            } else if constexpr (transform_properties<Value_type>::is_transformable) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    values[i] = apply_transform(values[i], matrix, 1.0f);
+                }
             }
+            break;
+        }
 
-            case Transform_mode::position: {
-                for (std::size_t i = 0, end = values.size(); i < end; ++i) {
-                    values[i] = apply_transform(values[i], transform, 1.0f);
-                }
-                break;
+        case Transform_mode::direction: {
+            if constexpr (std::is_same_v<Value_type, glm::vec3>) {
+                kernels::transform_vec3(matrix, reinterpret_cast<float*>(values.data() + begin), count, 0.0f, true);
             }
+            break;
+        }
 
-            // TODO Use cofactor matrix for bivectors?
-            case Transform_mode::direction: {
-                if constexpr (std::is_same_v<Value_type, glm::vec3>) {
-                    const glm::mat4 inverse_transpose_transform = glm::inverse(glm::transpose(transform));
-                    for (std::size_t i = 0, end = values.size(); i < end; ++i) {
-                        values[i] = glm::normalize(
-                            apply_transform(
-                                values[i],
-                                inverse_transpose_transform,
-                                0.0f
-                            )
-                        );
-                    }
-                }
-                break;
+        case Transform_mode::direction_vec3_float: {
+            if constexpr (std::is_same_v<Value_type, glm::vec4>) {
+                kernels::transform_vec4_direction_float(matrix, reinterpret_cast<float*>(values.data() + begin), count);
             }
+            break;
+        }
+    }
+}
+
+template <typename Key_type, typename Value_type>
+inline void
+Property_map<Key_type, Value_type>::transform(
+    const glm::mat4 transform
+)
+{
+    ERHE_PROFILE_FUNCTION();
 
+    ERHE_VERIFY(m_dense || (values.size() == present.size()));
+
+    if constexpr(transform_properties<Value_type>::is_transformable) {
+        if (m_descriptor.transform_mode == Transform_mode::position) {
+            transform_range(transform, 0, values.size());
+        } else if (m_descriptor.transform_mode != Transform_mode::none) {
             // TODO Use cofactor matrix for bivectors?
-            case Transform_mode::direction_vec3_float: {
-                if constexpr (std::is_same_v<Value_type, glm::vec4>) {
-                    const glm::mat4 inverse_transpose_transform = glm::inverse(glm::transpose(transform));
-                    for (std::size_t i = 0, end = values.size(); i < end; ++i) {
-                        values[i] = glm::vec4{
-                            glm::normalize(
-                                apply_transform(
-                                    glm::vec3{
-                                        values[i]
-                                    },
-                                    inverse_transpose_transform,
-                                    0.0f
-                                )
-                            ),
-                            values[i].w
-                        };
-                    }
-                }
-                break;
-            }
+            transform_range(glm::inverse(glm::transpose(transform)), 0, values.size());
         }
     }
 }
@@ -373,60 +558,15 @@ Property_map<Key_type, Value_type>::import_from(
         return;
     }
 
-    ERHE_VERIFY(values.size() == present.size());
-    ERHE_VERIFY(source->values.size() == source->present.size());
-
-    const auto combined_values_size = values.size()  + source->values.size();
-    const auto combined_present_size = present.size() + source->present.size();
-    values .reserve(combined_values_size);
-    present.reserve(combined_present_size);
-    present.insert(present.end(), source->present.begin(), source->present.end());
-    if constexpr(!transform_properties<Value_type>::is_transformable) {
-        values.insert(values.end(), source->values.begin(), source->values.end());
-    } else {
-        switch (m_descriptor.transform_mode) {
-            //using enum Transform_mode;
-            default:
-            case Transform_mode::none: {
-                values.insert(values.end(), source->values.begin(), source->values.end());
-                break;
-            }
-
-            case Transform_mode::position: {
-                for (std::size_t i = 0, end = source->values.size(); i < end; ++i) {
-                    const Value_type source_value = source->values[i];
-                    const Value_type result       = apply_transform(source_value, transform, 1.0f);
-                    values.push_back(result);
-                }
-                break;
-            }
-
-            // TODO Use cofactor matrix for bivectors?
-            case Transform_mode::direction: {
-                if constexpr (std::is_same_v<Value_type, glm::vec3>) {
-                    const glm::mat4 inverse_transpose_transform = glm::inverse(glm::transpose(transform));
-                    for (std::size_t i = 0, end = source->values.size(); i < end; ++i) {
-                        const Value_type source_value = source->values[i];
-                        const Value_type result       = glm::normalize(apply_transform(source_value, inverse_transpose_transform, 0.0f));
-                        values.push_back(result);
-                    }
-                }
-                break;
-            }
-
+    import_presence(*source);
+    const std::size_t offset = values.size();
+    values.insert(values.end(), source->values.begin(), source->values.end());
+    if constexpr(transform_properties<Value_type>::is_transformable) {
+        if (m_descriptor.transform_mode == Transform_mode::position) {
+            transform_range(transform, offset, values.size());
+        } else if (m_descriptor.transform_mode != Transform_mode::none) {
             // TODO Use cofactor matrix for bivectors?
-            case Transform_mode::direction_vec3_float: {
-                if constexpr (std::is_same_v<Value_type, glm::vec4>) {
-                    const glm::mat4 inverse_transpose_transform = glm::inverse(glm::transpose(transform));
-                    for (std::size_t i = 0, end = source->values.size(); i < end; ++i) {
-                        const Value_type source_value     = source->values[i];
-                        const glm::vec3  transformed_vec3 = glm::normalize(apply_transform(glm::vec3{source_value}, inverse_transpose_transform, 0.0f));
-                        const Value_type result           = glm::vec4{transformed_vec3, source_value.w};
-                        values.push_back(result);
-                    }
-                }
-                break;
-            }
+            transform_range(glm::inverse(glm::transpose(transform)), offset, values.size());
         }
     }
 }
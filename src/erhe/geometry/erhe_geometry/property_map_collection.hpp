@@ -83,8 +83,8 @@ public:
     void trim      (size_t size);
     void remap_keys(const std::vector<Key_type>& key_new_to_old);
     void interpolate(
-        Property_map_collection<Key_type>&                          destination,
-        const std::vector<std::vector<std::pair<float, Key_type>>>& key_new_to_olds
+        Property_map_collection<Key_type>&     destination,
+        const Interpolation_sources<Key_type>& sources
     );
 
     void merge_to            (Property_map_collection<Key_type>& source, const glm::mat4 transform);
@@ -197,8 +197,8 @@ Property_map_collection<Key_type>::remap_keys(const std::vector<Key_type>& key_n
 template <typename Key_type>
 inline void
 Property_map_collection<Key_type>::interpolate(
-    Property_map_collection<Key_type>&                          destination,
-    const std::vector<std::vector<std::pair<float, Key_type>>>& key_new_to_olds)
+    Property_map_collection<Key_type>&     destination,
+    const Interpolation_sources<Key_type>& sources)
 {
     ERHE_PROFILE_FUNCTION();
 
@@ -211,7 +211,7 @@ Property_map_collection<Key_type>::interpolate(
         Property_map_base<Key_type>* destination_map = src_map->constructor(descriptor);
 
         SPDLOG_LOGGER_TRACE(log_interpolate, "interpolating {}", src_map->descriptor().name);
-        src_map->interpolate(destination_map, key_new_to_olds);
+        src_map->interpolate(destination_map, sources);
 
         destination.insert(destination_map);
     }
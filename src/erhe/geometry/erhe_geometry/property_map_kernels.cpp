@@ -0,0 +1,612 @@
+#include "erhe_geometry/property_map_kernels.hpp"
+#include "erhe_profile/profile.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define ERHE_GEOMETRY_KERNELS_X86_64 1
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#       define ERHE_TARGET_AVX2
+#   else
+#       define ERHE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#   endif
+#endif
+
+namespace erhe::geometry::kernels
+{
+
+namespace {
+
+auto detect_instruction_set() -> Instruction_set
+{
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+#   if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool fma     = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+    bool       avx2    = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    const bool os_saves_ymm = osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+    if (fma && avx && avx2 && os_saves_ymm) {
+        return Instruction_set::avx2;
+    }
+#   else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Instruction_set::avx2;
+    }
+#   endif
+    return Instruction_set::sse2; // x86-64 baseline
+#else
+    return Instruction_set::scalar;
+#endif
+}
+
+constexpr int c_not_selected = -1;
+
+std::atomic<int> s_instruction_set{c_not_selected};
+
+////////////////////////////////////////////////////////////////////////////
+// Scalar
+
+void transform_vec3_scalar(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count,
+    const float       w,
+    const bool        normalize
+)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const p = values + 3 * i;
+        glm::vec3 result{matrix * glm::vec4{p[0], p[1], p[2], w}};
+        if (normalize) {
+            result = glm::normalize(result);
+        }
+        p[0] = result.x;
+        p[1] = result.y;
+        p[2] = result.z;
+    }
+}
+
+void transform_vec4_scalar(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const    p = values + 4 * i;
+        const glm::vec4 result = matrix * glm::vec4{p[0], p[1], p[2], p[3]};
+        p[0] = result.x;
+        p[1] = result.y;
+        p[2] = result.z;
+        p[3] = result.w;
+    }
+}
+
+void transform_vec4_direction_float_scalar(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const    p = values + 4 * i;
+        const glm::vec3 result = glm::normalize(glm::vec3{matrix * glm::vec4{p[0], p[1], p[2], 0.0f}});
+        p[0] = result.x;
+        p[1] = result.y;
+        p[2] = result.z;
+    }
+}
+
+template <std::size_t N>
+auto interpolate_scalar(
+    const float*      source_values,
+    const std::size_t source_count,
+    const uint32_t*   offsets,
+    const float*      weights,
+    const uint32_t*   old_keys,
+    const std::size_t new_count,
+    const bool        normalize_xyz,
+    float*            destination_values,
+    Presence_bitset&  destination_present
+) -> std::size_t
+{
+    std::size_t missing_count = 0;
+    for (std::size_t new_key = 0; new_key < new_count; ++new_key) {
+        const uint32_t begin = offsets[new_key];
+        const uint32_t end   = offsets[new_key + 1];
+        float sum_weights{0.0f};
+        for (uint32_t j = begin; j < end; ++j) {
+            if (old_keys[j] < source_count) {
+                sum_weights += weights[j];
+            }
+        }
+        if (sum_weights == 0.0f) {
+            ++missing_count;
+            continue;
+        }
+
+        float result[N] = {};
+        for (uint32_t j = begin; j < end; ++j) {
+            const std::size_t old_key = old_keys[j];
+            if (old_key < source_count) {
+                const float        weight = weights[j] / sum_weights;
+                const float* const source = source_values + N * old_key;
+                for (std::size_t c = 0; c < N; ++c) {
+                    result[c] += weight * source[c];
+                }
+            }
+        }
+
+        if constexpr (N >= 3) {
+            if (normalize_xyz) {
+                const float scale = 1.0f / std::sqrt(result[0] * result[0] + result[1] * result[1] + result[2] * result[2]);
+                result[0] *= scale;
+                result[1] *= scale;
+                result[2] *= scale;
+            }
+        }
+
+        float* const destination = destination_values + N * new_key;
+        for (std::size_t c = 0; c < N; ++c) {
+            destination[c] = result[c];
+        }
+        destination_present.set(new_key);
+    }
+    return missing_count;
+}
+
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+
+////////////////////////////////////////////////////////////////////////////
+// SSE2
+
+// Values are only float aligned, memcpy avoids misaligned double access
+inline auto sse_load2(const float* p) -> __m128
+{
+    double xy;
+    std::memcpy(&xy, p, sizeof(double));
+    return _mm_castpd_ps(_mm_set_sd(xy)); // x y 0 0
+}
+
+inline void sse_store2(float* p, const __m128 v)
+{
+    double xy;
+    _mm_store_sd(&xy, _mm_castps_pd(v));
+    std::memcpy(p, &xy, sizeof(double));
+}
+
+inline auto sse_load3(const float* p) -> __m128
+{
+    return _mm_movelh_ps(sse_load2(p), _mm_load_ss(p + 2)); // x y z 0
+}
+
+inline void sse_store3(float* p, const __m128 v)
+{
+    sse_store2(p, v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+
+template <std::size_t N>
+inline auto sse_load(const float* p) -> __m128
+{
+    if constexpr (N == 1) {
+        return _mm_load_ss(p);
+    } else if constexpr (N == 2) {
+        return sse_load2(p);
+    } else if constexpr (N == 3) {
+        return sse_load3(p);
+    } else {
+        return _mm_loadu_ps(p);
+    }
+}
+
+template <std::size_t N>
+inline void sse_store(float* p, const __m128 v)
+{
+    if constexpr (N == 1) {
+        _mm_store_ss(p, v);
+    } else if constexpr (N == 2) {
+        sse_store2(p, v);
+    } else if constexpr (N == 3) {
+        sse_store3(p, v);
+    } else {
+        _mm_storeu_ps(p, v);
+    }
+}
+
+inline auto sse_mask_xyz() -> __m128
+{
+    return _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+}
+
+// Same evaluation order as glm mat4 * vec4
+inline auto sse_transform(const __m128 c[4], const __m128 v, const __m128 w_column) -> __m128
+{
+    const __m128 x = _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 z = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c[0], x), _mm_mul_ps(c[1], y)),
+        _mm_add_ps(_mm_mul_ps(c[2], z), w_column)
+    );
+}
+
+// Lane 3 of v must be zero
+inline auto sse_normalize3(const __m128 v) -> __m128
+{
+    const __m128 squared = _mm_mul_ps(v, v);
+    __m128       sum     = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_mul_ps(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(sum)));
+}
+
+void transform_vec3_sse2(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count,
+    const float       w,
+    const bool        normalize
+)
+{
+    const __m128 c[4] = {
+        _mm_loadu_ps(&matrix[0][0]),
+        _mm_loadu_ps(&matrix[1][0]),
+        _mm_loadu_ps(&matrix[2][0]),
+        _mm_loadu_ps(&matrix[3][0])
+    };
+    const __m128 w_column = _mm_mul_ps(c[3], _mm_set1_ps(w));
+    const __m128 mask_xyz = sse_mask_xyz();
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const p      = values + 3 * i;
+        __m128       result = sse_transform(c, sse_load3(p), w_column);
+        if (normalize) {
+            result = sse_normalize3(_mm_and_ps(result, mask_xyz));
+        }
+        sse_store3(p, result);
+    }
+}
+
+void transform_vec4_sse2(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    const __m128 c[4] = {
+        _mm_loadu_ps(&matrix[0][0]),
+        _mm_loadu_ps(&matrix[1][0]),
+        _mm_loadu_ps(&matrix[2][0]),
+        _mm_loadu_ps(&matrix[3][0])
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const p = values + 4 * i;
+        const __m128 v = _mm_loadu_ps(p);
+        const __m128 w = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(p, sse_transform(c, v, _mm_mul_ps(c[3], w)));
+    }
+}
+
+void transform_vec4_direction_float_sse2(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    const __m128 c[4] = {
+        _mm_loadu_ps(&matrix[0][0]),
+        _mm_loadu_ps(&matrix[1][0]),
+        _mm_loadu_ps(&matrix[2][0]),
+        _mm_loadu_ps(&matrix[3][0])
+    };
+    const __m128 w_column = _mm_mul_ps(c[3], _mm_setzero_ps());
+    const __m128 mask_xyz = sse_mask_xyz();
+    for (std::size_t i = 0; i < count; ++i) {
+        float* const p      = values + 4 * i;
+        const __m128 v      = _mm_loadu_ps(p);
+        const __m128 result = sse_normalize3(_mm_and_ps(sse_transform(c, v, w_column), mask_xyz));
+        _mm_storeu_ps(p, _mm_or_ps(result, _mm_andnot_ps(mask_xyz, v)));
+    }
+}
+
+// Also used when AVX2 is selected: each new key gathers a few short vectors,
+// which does not benefit from wider registers.
+template <std::size_t N>
+auto interpolate_sse2(
+    const float*      source_values,
+    const std::size_t source_count,
+    const uint32_t*   offsets,
+    const float*      weights,
+    const uint32_t*   old_keys,
+    const std::size_t new_count,
+    const bool        normalize_xyz,
+    float*            destination_values,
+    Presence_bitset&  destination_present
+) -> std::size_t
+{
+    std::size_t missing_count = 0;
+    for (std::size_t new_key = 0; new_key < new_count; ++new_key) {
+        const uint32_t begin = offsets[new_key];
+        const uint32_t end   = offsets[new_key + 1];
+        float sum_weights{0.0f};
+        for (uint32_t j = begin; j < end; ++j) {
+            if (old_keys[j] < source_count) {
+                sum_weights += weights[j];
+            }
+        }
+        if (sum_weights == 0.0f) {
+            ++missing_count;
+            continue;
+        }
+
+        __m128 result = _mm_setzero_ps();
+        for (uint32_t j = begin; j < end; ++j) {
+            const std::size_t old_key = old_keys[j];
+            if (old_key < source_count) {
+                const __m128 weight = _mm_set1_ps(weights[j] / sum_weights);
+                result = _mm_add_ps(result, _mm_mul_ps(weight, sse_load<N>(source_values + N * old_key)));
+            }
+        }
+
+        if constexpr (N >= 3) {
+            if (normalize_xyz) {
+                const __m128 mask_xyz = sse_mask_xyz();
+                const __m128 xyz      = sse_normalize3(_mm_and_ps(result, mask_xyz));
+                result = _mm_or_ps(xyz, _mm_andnot_ps(mask_xyz, result));
+            }
+        }
+
+        sse_store<N>(destination_values + N * new_key, result);
+        destination_present.set(new_key);
+    }
+    return missing_count;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// AVX2 + FMA, two vectors per iteration
+
+ERHE_TARGET_AVX2 inline auto avx2_broadcast_column(const glm::mat4& matrix, const int column) -> __m256
+{
+    const __m128 c = _mm_loadu_ps(&matrix[column][0]);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(c), c, 1);
+}
+
+ERHE_TARGET_AVX2 inline auto avx2_normalize3(const __m256 v) -> __m256
+{
+    const __m256 squared = _mm256_mul_ps(v, v);
+    __m256       sum     = _mm256_add_ps(squared, _mm256_permute_ps(squared, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm256_add_ps(sum, _mm256_permute_ps(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm256_mul_ps(v, _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(sum)));
+}
+
+ERHE_TARGET_AVX2 inline auto avx2_transform(const __m256 c[4], const __m256 v, const __m256 w_column) -> __m256
+{
+    const __m256 x = _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m256 y = _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m256 z = _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2));
+    return _mm256_fmadd_ps(c[0], x, _mm256_fmadd_ps(c[1], y, _mm256_fmadd_ps(c[2], z, w_column)));
+}
+
+ERHE_TARGET_AVX2 void transform_vec3_avx2(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count,
+    const float       w,
+    const bool        normalize
+)
+{
+    const __m256 c[4] = {
+        avx2_broadcast_column(matrix, 0),
+        avx2_broadcast_column(matrix, 1),
+        avx2_broadcast_column(matrix, 2),
+        avx2_broadcast_column(matrix, 3)
+    };
+    const __m256 w_column = _mm256_mul_ps(c[3], _mm256_set1_ps(w));
+    const __m256 mask_xyz = _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1));
+
+    // Unaligned 4 float loads read one float past each vec3, so the last
+    // vector is processed by SSE2 code.
+    std::size_t i = 0;
+    for (; i + 3 <= count; i += 2) {
+        float* const p = values + 3 * i;
+        const __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 3), 1);
+        __m256 result = avx2_transform(c, v, w_column);
+        if (normalize) {
+            result = avx2_normalize3(_mm256_and_ps(result, mask_xyz));
+        }
+        _mm_storeu_ps(p, _mm256_castps256_ps128(result)); // lane 3 is overwritten by next store
+        sse_store3(p + 3, _mm256_extractf128_ps(result, 1));
+    }
+    if (i < count) {
+        transform_vec3_sse2(matrix, values + 3 * i, count - i, w, normalize);
+    }
+}
+
+ERHE_TARGET_AVX2 void transform_vec4_avx2(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    const __m256 c[4] = {
+        avx2_broadcast_column(matrix, 0),
+        avx2_broadcast_column(matrix, 1),
+        avx2_broadcast_column(matrix, 2),
+        avx2_broadcast_column(matrix, 3)
+    };
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        float* const p = values + 4 * i;
+        const __m256 v = _mm256_loadu_ps(p);
+        const __m256 w = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm256_storeu_ps(p, avx2_transform(c, v, _mm256_mul_ps(c[3], w)));
+    }
+    if (i < count) {
+        transform_vec4_sse2(matrix, values + 4 * i, count - i);
+    }
+}
+
+ERHE_TARGET_AVX2 void transform_vec4_direction_float_avx2(const glm::mat4& matrix, float* values, const std::size_t count)
+{
+    const __m256 c[4] = {
+        avx2_broadcast_column(matrix, 0),
+        avx2_broadcast_column(matrix, 1),
+        avx2_broadcast_column(matrix, 2),
+        avx2_broadcast_column(matrix, 3)
+    };
+    const __m256 w_column = _mm256_mul_ps(c[3], _mm256_setzero_ps());
+    const __m256 mask_xyz = _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1));
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        float* const p      = values + 4 * i;
+        const __m256 v      = _mm256_loadu_ps(p);
+        const __m256 result = avx2_normalize3(_mm256_and_ps(avx2_transform(c, v, w_column), mask_xyz));
+        _mm256_storeu_ps(p, _mm256_or_ps(result, _mm256_andnot_ps(mask_xyz, v)));
+    }
+    if (i < count) {
+        transform_vec4_direction_float_sse2(matrix, values + 4 * i, count - i);
+    }
+}
+
+#endif // ERHE_GEOMETRY_KERNELS_X86_64
+
+template <std::size_t N>
+auto interpolate_n(
+    const Instruction_set instruction_set,
+    const float*          source_values,
+    const std::size_t     source_count,
+    const uint32_t*       offsets,
+    const float*          weights,
+    const uint32_t*       old_keys,
+    const std::size_t     new_count,
+    const bool            normalize_xyz,
+    float*                destination_values,
+    Presence_bitset&      destination_present
+) -> std::size_t
+{
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+    if (instruction_set != Instruction_set::scalar) {
+        return interpolate_sse2<N>(
+            source_values, source_count, offsets, weights, old_keys, new_count,
+            normalize_xyz, destination_values, destination_present
+        );
+    }
+#else
+    static_cast<void>(instruction_set);
+#endif
+    return interpolate_scalar<N>(
+        source_values, source_count, offsets, weights, old_keys, new_count,
+        normalize_xyz, destination_values, destination_present
+    );
+}
+
+} // anonymous namespace
+
+auto c_str(const Instruction_set instruction_set) -> const char*
+{
+    switch (instruction_set) {
+        //using enum Instruction_set;
+        case Instruction_set::scalar: return "scalar";
+        case Instruction_set::sse2:   return "SSE2";
+        case Instruction_set::avx2:   return "AVX2";
+        default:                      return "?";
+    }
+}
+
+auto get_supported_instruction_set() -> Instruction_set
+{
+    static const Instruction_set supported = detect_instruction_set();
+    return supported;
+}
+
+auto get_instruction_set() -> Instruction_set
+{
+    int instruction_set = s_instruction_set.load(std::memory_order_relaxed);
+    if (instruction_set == c_not_selected) {
+        instruction_set = static_cast<int>(get_supported_instruction_set());
+        s_instruction_set.store(instruction_set, std::memory_order_relaxed);
+    }
+    return static_cast<Instruction_set>(instruction_set);
+}
+
+void set_instruction_set(const Instruction_set instruction_set)
+{
+    const Instruction_set supported = get_supported_instruction_set();
+    const Instruction_set selected  = (static_cast<int>(instruction_set) <= static_cast<int>(supported))
+        ? instruction_set
+        : supported;
+    s_instruction_set.store(static_cast<int>(selected), std::memory_order_relaxed);
+}
+
+void transform_vec3(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count,
+    const float       w,
+    const bool        normalize
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    switch (get_instruction_set()) {
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+        case Instruction_set::avx2: transform_vec3_avx2(matrix, values, count, w, normalize); return;
+        case Instruction_set::sse2: transform_vec3_sse2(matrix, values, count, w, normalize); return;
+#endif
+        default:                    transform_vec3_scalar(matrix, values, count, w, normalize); return;
+    }
+}
+
+void transform_vec4(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    switch (get_instruction_set()) {
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+        case Instruction_set::avx2: transform_vec4_avx2(matrix, values, count); return;
+        case Instruction_set::sse2: transform_vec4_sse2(matrix, values, count); return;
+#endif
+        default:                    transform_vec4_scalar(matrix, values, count); return;
+    }
+}
+
+void transform_vec4_direction_float(
+    const glm::mat4&  matrix,
+    float*            values,
+    const std::size_t count
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    switch (get_instruction_set()) {
+#if defined(ERHE_GEOMETRY_KERNELS_X86_64)
+        case Instruction_set::avx2: transform_vec4_direction_float_avx2(matrix, values, count); return;
+        case Instruction_set::sse2: transform_vec4_direction_float_sse2(matrix, values, count); return;
+#endif
+        default:                    transform_vec4_direction_float_scalar(matrix, values, count); return;
+    }
+}
+
+auto interpolate(
+    const std::size_t component_count,
+    const float*      source_values,
+    const std::size_t source_count,
+    const uint32_t*   offsets,
+    const float*      weights,
+    const uint32_t*   old_keys,
+    const std::size_t new_count,
+    const bool        normalize_xyz,
+    float*            destination_values,
+    Presence_bitset&  destination_present
+) -> std::size_t
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const Instruction_set instruction_set = get_instruction_set();
+    switch (component_count) {
+        case 1: return interpolate_n<1>(instruction_set, source_values, source_count, offsets, weights, old_keys, new_count, false,         destination_values, destination_present);
+        case 2: return interpolate_n<2>(instruction_set, source_values, source_count, offsets, weights, old_keys, new_count, false,         destination_values, destination_present);
+        case 3: return interpolate_n<3>(instruction_set, source_values, source_count, offsets, weights, old_keys, new_count, normalize_xyz, destination_values, destination_present);
+        case 4: return interpolate_n<4>(instruction_set, source_values, source_count, offsets, weights, old_keys, new_count, normalize_xyz, destination_values, destination_present);
+        default: return new_count;
+    }
+}
+
+} // namespace erhe::geometry::kernels
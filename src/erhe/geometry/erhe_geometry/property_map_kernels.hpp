@@ -0,0 +1,75 @@
+#pragma once
+
+#include "erhe_geometry/presence_bitset.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace erhe::geometry::kernels
+{
+
+// Bulk kernels for Property_map transform and interpolate. Implementation
+// is selected at runtime based on CPU features; scalar implementation is
+// used when SIMD is not available.
+enum class Instruction_set : unsigned int {
+    scalar = 0,
+    sse2,
+    avx2 // with FMA
+};
+
+[[nodiscard]] auto c_str(Instruction_set instruction_set) -> const char*;
+
+// Best instruction set supported by the CPU
+[[nodiscard]] auto get_supported_instruction_set() -> Instruction_set;
+
+[[nodiscard]] auto get_instruction_set() -> Instruction_set;
+
+// Selects instruction set used by kernels, for testing and benchmarking.
+// Clamped to the supported instruction set.
+void set_instruction_set(Instruction_set instruction_set);
+
+// values: count packed vec3, in place: v = matrix * vec4{v, w}, optionally normalized
+void transform_vec3(
+    const glm::mat4& matrix,
+    float*           values,
+    std::size_t      count,
+    float            w,
+    bool             normalize
+);
+
+// values: count packed vec4, in place: v = matrix * v
+void transform_vec4(
+    const glm::mat4& matrix,
+    float*           values,
+    std::size_t      count
+);
+
+// values: count packed vec4, in place: v.xyz = normalize(matrix * vec4{v.xyz, 0}), v.w is kept
+void transform_vec4_direction_float(
+    const glm::mat4& matrix,
+    float*           values,
+    std::size_t      count
+);
+
+// Weighted interpolation of packed float vectors with component_count (1..4)
+// components, using sources in CSR form (see Interpolation_sources).
+// Old keys outside [0, source_count) are ignored. New keys with zero sum
+// of weights are left untouched and not set in destination_present.
+// If normalize_xyz is set, first three components are normalized (requires
+// component_count >= 3). Returns number of new keys without value.
+auto interpolate(
+    std::size_t      component_count,
+    const float*     source_values,
+    std::size_t      source_count,
+    const uint32_t*  offsets,
+    const float*     weights,
+    const uint32_t*  old_keys,
+    std::size_t      new_count,
+    bool             normalize_xyz,
+    float*           destination_values,
+    Presence_bitset& destination_present
+) -> std::size_t;
+
+} // namespace erhe::geometry::kernels
@@ -1,9 +1,11 @@
 // #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
 
 #include "gltf.hpp"
+#include "gltf_file.hpp"
 #include "gltf_log.hpp"
 #include "image_transfer.hpp"
 
+#include "erhe_concurrency/thread_pool.hpp"
 #include "erhe_file/file.hpp"
 #include "erhe_gl/wrapper_functions.hpp"
 #include "erhe_geometry/geometry.hpp"
@@ -13,6 +15,7 @@
 #include "erhe_graphics/texture.hpp"
 #include "erhe_graphics/vertex_attribute.hpp"
 #include "erhe_primitive/material.hpp"
+#include "erhe_profile/profile.hpp"
 #include "erhe_raytrace/ibuffer.hpp"
 #include "erhe_raytrace/igeometry.hpp"
 #include "erhe_scene/animation.hpp"
@@ -34,7 +37,9 @@ extern "C" {
 #include <glm/glm.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -68,23 +73,6 @@ constexpr glm::mat4 mat4_yup_from_zup{
     }
 }
 
-[[nodiscard]] const char* c_str(const cgltf_result value)
-{
-    switch (value) {
-        case cgltf_result::cgltf_result_success:         return "success";
-        case cgltf_result::cgltf_result_data_too_short:  return "data too short";
-        case cgltf_result::cgltf_result_unknown_format:  return "unknown format";
-        case cgltf_result::cgltf_result_invalid_json:    return "invalid json";
-        case cgltf_result::cgltf_result_invalid_gltf:    return "invalid gltf";
-        case cgltf_result::cgltf_result_invalid_options: return "invalid options";
-        case cgltf_result::cgltf_result_file_not_found:  return "file not found";
-        case cgltf_result::cgltf_result_io_error:        return "io error";
-        case cgltf_result::cgltf_result_out_of_memory:   return "out of memory";
-        case cgltf_result::cgltf_result_legacy_gltf:     return "legacy gltf";
-        default:                                         return "?";
-    }
-}
-
 [[nodiscard]] auto c_str(const cgltf_attribute_type value) -> const char*
 {
     switch (value) {
@@ -337,57 +325,6 @@ using Item_flags = erhe::Item_flags;
     // std::unreachable() return gl::Internal_format::rgba8;
 }
 
-namespace {
-
-cgltf_result cgltf_custom_file_read(
-    const cgltf_memory_options* ,
-    const cgltf_file_options*   ,
-    const char*                 path,
-    cgltf_size*                 size,
-    void**                      data
-)
-{
-    std::string str_path{path};
-    std::filesystem::path fs_path = std::filesystem::path((const char8_t*)&*path);
-    std::optional<std::string> file_contents_opt = erhe::file::read("cgltf file read", fs_path);
-    if (!file_contents_opt.has_value())  {
-        if (size != nullptr) {
-            *size = 0;
-        }
-        if (data != nullptr) {
-            *data = nullptr;
-        }
-        return cgltf_result_file_not_found;
-    }
-    const std::string& file_contents = file_contents_opt.value();
-    cgltf_size file_size = file_contents.size();
-    char* file_data = (char*)malloc(file_size);
-    if (file_data == nullptr) {
-        return cgltf_result_out_of_memory;
-    }
-    memcpy(file_data, file_contents.data(), file_size);
-
-    if (size) {
-        *size = file_size;
-    }
-    if (data) {
-        *data = file_data;
-    }
-
-    return cgltf_result_success;
-}
-
-void cgltf_custom_file_release(
-    const cgltf_memory_options* ,
-    const cgltf_file_options*   ,
-    void*                       data
-)
-{
-    free(data);
-}
-
-}
-
 class Gltf_parser
 {
 public:
@@ -407,6 +344,93 @@ public:
         trace_info();
     }
 
+    Gltf_parser(const Gltf_parser&) = delete;
+    Gltf_parser& operator=(const Gltf_parser&) = delete;
+
+    // Decodes images and converts primitives to geometry on worker threads.
+    // Workers only read parsed glTF data and write to their own result
+    // slots. At most max_images_in_flight images are decoded or waiting for
+    // upload at a time. Images are uploaded on the calling thread in image
+    // order as soon as each decode finishes, and their pixels are released.
+    // Time spent in uploads is accumulated to m_upload_duration, and is not
+    // included in the logged decode and convert time.
+    void import_images_and_convert_geometries()
+    {
+        ERHE_PROFILE_FUNCTION();
+
+        const auto start_time = std::chrono::steady_clock::now();
+        m_upload_duration = std::chrono::steady_clock::duration::zero();
+
+        m_decoded_images.clear();
+        m_decoded_images.resize(m_data->images_count);
+        m_data_out.images.resize(m_data->images_count);
+        collect_primitive_geometries();
+
+        const std::size_t               image_count    = m_decoded_images.size();
+        const std::size_t               geometry_count = m_geometries.size();
+        erhe::concurrency::Thread_pool* thread_pool    = m_arguments.thread_pool;
+        const auto timed_parse_image = [this](const std::size_t image_index) {
+            const auto upload_start_time = std::chrono::steady_clock::now();
+            parse_image(image_index);
+            m_upload_duration += std::chrono::steady_clock::now() - upload_start_time;
+        };
+        if (thread_pool == nullptr) {
+            for (std::size_t i = 0; i < image_count; ++i) {
+                decode_image(i);
+                timed_parse_image(i);
+            }
+            for (Geometry_entry& geometry_entry : m_geometries) {
+                convert_primitive_geometry(geometry_entry);
+            }
+        } else {
+            const std::size_t max_images_in_flight = (m_arguments.max_images_in_flight > 0)
+                ? m_arguments.max_images_in_flight
+                : 2 * (static_cast<std::size_t>(thread_pool->size()) + 1);
+
+            std::vector<erhe::concurrency::Task_handle> image_tasks(image_count);
+            const auto submit_decode = [this, thread_pool, &image_tasks](const std::size_t image_index) {
+                image_tasks[image_index] = thread_pool->submit(
+                    [this, image_index]() {
+                        decode_image(image_index);
+                    }
+                );
+            };
+            for (std::size_t i = 0, end = std::min(max_images_in_flight, image_count); i < end; ++i) {
+                submit_decode(i);
+            }
+
+            std::vector<erhe::concurrency::Task_handle> geometry_tasks;
+            geometry_tasks.reserve(geometry_count);
+            for (Geometry_entry& geometry_entry : m_geometries) {
+                geometry_tasks.push_back(
+                    thread_pool->submit(
+                        [this, &geometry_entry]() {
+                            convert_primitive_geometry(geometry_entry);
+                        }
+                    )
+                );
+            }
+
+            for (std::size_t i = 0; i < image_count; ++i) {
+                thread_pool->wait(image_tasks[i]);
+                timed_parse_image(i);
+                if (i + max_images_in_flight < image_count) {
+                    submit_decode(i + max_images_in_flight);
+                }
+            }
+            thread_pool->wait(geometry_tasks);
+        }
+        m_decoded_images.clear();
+
+        const auto end_time = std::chrono::steady_clock::now();
+        log_gltf->info(
+            "glTF decoded {} images and converted {} geometries in {} ms",
+            image_count,
+            geometry_count,
+            std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time - m_upload_duration).count()
+        );
+    }
+
     void parse_and_build()
     {
         if (m_data == nullptr) {
@@ -414,11 +438,16 @@ public:
             return;
         }
 
-        log_gltf->trace("parsing images");
-        m_data_out.images.resize(m_data->images_count);
-        for (cgltf_size i = 0; i < m_data->images_count; ++i) {
-            parse_image(i);
-        }
+        log_gltf->trace("parsing images and primitive geometries");
+        import_images_and_convert_geometries();
+
+        const auto primitives_start_time = std::chrono::steady_clock::now();
+        add_primitive_geometries();
+        const auto primitives_end_time = std::chrono::steady_clock::now();
+        log_gltf->info(
+            "glTF image upload and geometry primitives took {} ms",
+            std::chrono::duration_cast<std::chrono::milliseconds>(m_upload_duration + primitives_end_time - primitives_start_time).count()
+        );
 
         log_gltf->trace("parsing samplers");
         m_data_out.samplers.resize(m_data->samplers_count);
@@ -487,44 +516,24 @@ public:
 private:
     auto open(const std::filesystem::path& path) -> bool
     {
-        std::optional<std::string> file_contents_opt = erhe::file::read("GLTF file", path);
-        if (!file_contents_opt.has_value()) {
-            return false;
-        }
-        const cgltf_options parse_options{
-            .type             = cgltf_file_type_invalid, // auto
-            .json_token_count = 0, // 0 == auto
-            .memory = {
-                .alloc_func   = nullptr,
-                .free_func    = nullptr,
-                .user_data    = nullptr
-            },
-            .file = {
-                .read         = cgltf_custom_file_read,
-                .release      = cgltf_custom_file_release,
-                .user_data    = nullptr
-            }
-        };
-
-        m_file_contents = file_contents_opt.value();
-        const cgltf_result parse_result = cgltf_parse(
-            &parse_options,
-            m_file_contents.data(),
-            m_file_contents.size(),
-            &m_data
-        );
+        ERHE_PROFILE_FUNCTION();
 
-        if (parse_result != cgltf_result::cgltf_result_success) {
-            log_gltf->error("glTF parse error: {}", c_str(parse_result));
-            return false;
-        }
+        const auto start_time = std::chrono::steady_clock::now();
 
-        const std::string path_string = erhe::file::to_string(path);
-        const cgltf_result load_buffers_result = cgltf_load_buffers(&parse_options, m_data, path_string.c_str());
-        if (load_buffers_result != cgltf_result::cgltf_result_success) {
-            log_gltf->error("glTF load buffers error: {}", c_str(load_buffers_result));
+        if (!m_file.open(path, true)) {
             return false;
         }
+        m_data = m_file.get_data();
+
+        const auto end_time    = std::chrono::steady_clock::now();
+        const auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        log_gltf->info(
+            "Opened {}: {} bytes mapped from {} files in {} ms",
+            erhe::file::to_string(path),
+            m_file.get_mapped_byte_count(),
+            m_file.get_mapped_file_count(),
+            static_cast<double>(duration_us) / 1000.0
+        );
 
         return true;
     }
@@ -696,72 +705,52 @@ private:
         }
         m_data_out.animations[animation_index] = erhe_animation;
     }
-    auto load_image_file(const std::filesystem::path& path) -> std::shared_ptr<erhe::graphics::Texture>
+    // PNG decoding is done by worker threads into CPU memory, GL texture
+    // upload through Image_transfer slots is done later on main thread.
+    class Decoded_image
     {
-        const bool file_is_ok = erhe::file::check_is_existing_non_empty_regular_file("Gltf_parser::load_image_file", path);
-        if (!file_is_ok) {
-            return {};
-        }
-
+    public:
         erhe::graphics::Image_info image_info;
-        erhe::graphics::PNG_loader loader;
-
-        if (!loader.open(path, image_info)) {
-            return {};
-        }
-
-        auto& slot = m_arguments.image_transfer.get_slot();
-
-        erhe::graphics::Texture_create_info texture_create_info{
-            .instance        = m_arguments.graphics_instance,
-            .internal_format = to_gl(image_info.format),
-            .use_mipmaps     = true, //(image_info.level_count > 1),
-            .width           = image_info.width,
-            .height          = image_info.height,
-            .depth           = image_info.depth,
-            .level_count     = image_info.level_count,
-            .row_stride      = image_info.row_stride,
-            .debug_label     = path.filename().string()
-        };
-        const int  mipmap_count    = texture_create_info.calculate_level_count();
-        const bool generate_mipmap = mipmap_count != image_info.level_count;
-        if (generate_mipmap) {
-            texture_create_info.level_count = mipmap_count;
-        }
-        gsl::span<std::byte> span = slot.begin_span_for(
-            image_info.width,
-            image_info.height,
-            texture_create_info.internal_format
-        );
+        std::vector<std::byte>     data;
+        std::filesystem::path      source_path;
+        std::string                debug_label;
+        bool                       ok{false};
+    };
+    std::vector<Decoded_image> m_decoded_images;
+    std::chrono::steady_clock::duration m_upload_duration{};
 
-        const bool ok = loader.load(span);
+    [[nodiscard]] static auto decode_png(erhe::graphics::PNG_loader& loader, Decoded_image& decoded_image) -> bool
+    {
+        const erhe::graphics::Image_info& image_info = decoded_image.image_info;
+        const std::size_t row_stride = image_info.width * erhe::graphics::get_upload_pixel_byte_count(to_gl(image_info.format));
+        decoded_image.data.resize(row_stride * image_info.height);
+        const bool ok = loader.load(decoded_image.data);
         loader.close();
         if (!ok) {
-            slot.end();
-            return {};
+            decoded_image.data.clear();
+        }
+        decoded_image.ok = ok;
+        return ok;
+    }
+    auto decode_image_file(const std::filesystem::path& path, Decoded_image& decoded_image) -> bool
+    {
+        const bool file_is_ok = erhe::file::check_is_existing_non_empty_regular_file("Gltf_parser::decode_image_file", path);
+        if (!file_is_ok) {
+            return false;
         }
 
-        auto texture = std::make_shared<erhe::graphics::Texture>(texture_create_info);
-        texture->set_source_path(path);
-        texture->set_debug_label(erhe::file::to_string(path));
-
-        gl::flush_mapped_named_buffer_range(slot.gl_name(), 0, span.size_bytes());
-        gl::pixel_store_i(gl::Pixel_store_parameter::unpack_alignment, 1);
-        gl::bind_buffer(gl::Buffer_target::pixel_unpack_buffer, slot.gl_name());
-        texture->upload(texture_create_info.internal_format, texture_create_info.width, texture_create_info.height);
-        gl::bind_buffer(gl::Buffer_target::pixel_unpack_buffer, 0);
-
-        slot.end();
-        if (generate_mipmap) {
-            gl::generate_texture_mipmap(texture->gl_name());
+        erhe::graphics::PNG_loader loader;
+        if (!loader.open(path, decoded_image.image_info)) {
+            return false;
         }
-        return texture;
+        decoded_image.source_path = path;
+        decoded_image.debug_label = path.filename().string();
+        return decode_png(loader, decoded_image);
     }
-    auto load_png_buffer(const cgltf_buffer_view* buffer_view, const cgltf_size image_index) -> std::shared_ptr<erhe::graphics::Texture>
+    auto decode_png_buffer(const cgltf_buffer_view* buffer_view, const cgltf_size image_index, Decoded_image& decoded_image) -> bool
     {
         const cgltf_size  buffer_view_index = buffer_view - m_data->buffer_views;
         const std::string name              = safe_resource_name(buffer_view->name, "buffer_view", buffer_view_index);
-        erhe::graphics::Image_info image_info;
         erhe::graphics::PNG_loader loader;
 
         const uint8_t*   data_u8 = cgltf_buffer_view_data(buffer_view);
@@ -770,10 +759,31 @@ private:
             data,
             static_cast<std::size_t>(buffer_view->size)
         };
-        if (!loader.open(png_encoded_buffer_view, image_info)) {
+        if (!loader.open(png_encoded_buffer_view, decoded_image.image_info)) {
             log_gltf->error("Failed to parse PNG encoded image from buffer view '{}'", name);
-            return {};
+            return false;
         }
+        decoded_image.source_path = m_arguments.path;
+        decoded_image.debug_label = fmt::format("{} image {}", m_arguments.path.filename().string(), image_index);
+        return decode_png(loader, decoded_image);
+    }
+    void decode_image(const cgltf_size image_index)
+    {
+        const cgltf_image* image         = &m_data->images[image_index];
+        Decoded_image&     decoded_image = m_decoded_images[image_index];
+        if (image->uri != nullptr) {
+            std::filesystem::path uri{image->uri};
+            std::filesystem::path path{m_arguments.path};
+            if (!decode_image_file(path.replace_filename(uri), decoded_image)) {
+                decode_image_file(uri, decoded_image);
+            }
+        } else if (image->buffer_view != nullptr) {
+            decode_png_buffer(image->buffer_view, image_index, decoded_image);
+        }
+    }
+    auto upload_image(const Decoded_image& decoded_image) -> std::shared_ptr<erhe::graphics::Texture>
+    {
+        const erhe::graphics::Image_info& image_info = decoded_image.image_info;
 
         auto& slot = m_arguments.image_transfer.get_slot();
 
@@ -786,7 +796,7 @@ private:
             .depth           = image_info.depth,
             .level_count     = image_info.level_count,
             .row_stride      = image_info.row_stride,
-            .debug_label     = fmt::format("{} image {}", m_arguments.path.filename().string(), image_index) 
+            .debug_label     = decoded_image.debug_label
         };
         const int  mipmap_count    = texture_create_info.calculate_level_count();
         const bool generate_mipmap = mipmap_count != image_info.level_count;
@@ -798,17 +808,12 @@ private:
             image_info.height,
             texture_create_info.internal_format
         );
-
-        const bool ok = loader.load(span);
-        loader.close();
-        if (!ok) {
-            slot.end();
-            return {};
-        }
+        ERHE_VERIFY(span.size_bytes() == decoded_image.data.size());
+        memcpy(span.data(), decoded_image.data.data(), span.size_bytes());
 
         auto texture = std::make_shared<erhe::graphics::Texture>(texture_create_info);
-        texture->set_source_path(m_arguments.path);
-        texture->set_debug_label(name);
+        texture->set_source_path(decoded_image.source_path);
+        texture->set_debug_label(decoded_image.debug_label);
 
         gl::flush_mapped_named_buffer_range(slot.gl_name(), 0, span.size_bytes());
         gl::pixel_store_i(gl::Pixel_store_parameter::unpack_alignment, 1);
@@ -829,15 +834,11 @@ private:
         log_gltf->trace("Image: image index = {}, name = {}", image_index, image_name);
 
         std::shared_ptr<erhe::graphics::Texture> erhe_texture;
-        if (image->uri != nullptr) {
-            std::filesystem::path uri{image->uri};
-            erhe_texture = load_image_file(m_arguments.path.replace_filename(uri));
-            if (!erhe_texture) {
-                erhe_texture = load_image_file(image->uri);
-            }
-        } else if (image->buffer_view != nullptr) {
-            erhe_texture = load_png_buffer(image->buffer_view, image_index);
+        Decoded_image& decoded_image = m_decoded_images[image_index];
+        if (decoded_image.ok) {
+            erhe_texture = upload_image(decoded_image);
         }
+        decoded_image = Decoded_image{};
         if (erhe_texture) {
             erhe_texture->set_debug_label(image_name);
             m_data_out.images.push_back(erhe_texture);
@@ -1534,53 +1535,79 @@ private:
         std::vector<Property_map<erhe::geometry::Point_id, glm::vec4>* > point_joint_weights;
     };
 
+    // Primitives which use the same accessors share geometry. Unique
+    // primitives are collected first, then converted to geometry by worker
+    // threads, and finally wrapped to Geometry_primitive on main thread.
     class Geometry_entry
     {
     public:
+        const cgltf_primitive*                               primitive{nullptr};
         cgltf_size                                           index_accessor;
         std::vector<cgltf_size>                              attribute_accessors;
         std::shared_ptr<erhe::geometry::Geometry>            geometry;
         std::shared_ptr<erhe::primitive::Geometry_primitive> geometry_primitive;
     };
-    std::vector<Geometry_entry> m_geometries;
-    void load_new_primitive_geometry(const cgltf_primitive* primitive, Geometry_entry& geometry_entry)
-    {
-        Primitive_to_geometry primitive_to_geometry{m_arguments, primitive};
-        geometry_entry.geometry = primitive_to_geometry.geometry;
-        if (primitive_to_geometry.corner_tangents.empty()) {
-            if (primitive_to_geometry.corner_texcoords.empty()) {
-                primitive_to_geometry.geometry->generate_polygon_texture_coordinates();
-            }
-            primitive_to_geometry.geometry->compute_tangents();
-        }
-        geometry_entry.geometry_primitive = std::make_shared<erhe::primitive::Geometry_primitive>(
-            geometry_entry.geometry
-        );
-        m_data_out.geometries.push_back(primitive_to_geometry.geometry);
-        m_data_out.geometry_primitives.push_back(geometry_entry.geometry_primitive);
-    }
-    auto get_primitive_geometry(const cgltf_primitive* primitive, Geometry_entry& geometry_entry)
+    std::vector<Geometry_entry>           m_geometries;
+    std::vector<std::vector<std::size_t>> m_mesh_primitive_geometries; // per mesh, per primitive: index to m_geometries
+
+    auto find_or_add_geometry_entry(const cgltf_primitive* primitive) -> std::size_t
     {
-        geometry_entry.index_accessor = static_cast<cgltf_size>(primitive->indices - m_data->accessors);
-        geometry_entry.attribute_accessors.clear();
+        Geometry_entry geometry_entry{
+            .primitive      = primitive,
+            .index_accessor = static_cast<cgltf_size>(primitive->indices - m_data->accessors)
+        };
         for (cgltf_size i = 0; i < primitive->attributes_count; ++i) {
             const cgltf_accessor* accessor = primitive->attributes[i].data;
             const cgltf_size attribute_accessor_index = accessor - m_data->accessors;
             geometry_entry.attribute_accessors.push_back(attribute_accessor_index);
         }
 
-        for (const auto& entry : m_geometries) {
-            if (entry.index_accessor != geometry_entry.index_accessor) continue;
-            if (entry.attribute_accessors.size() != geometry_entry.attribute_accessors.size()) continue;
-            for (std::size_t i = 0, end = entry.attribute_accessors.size(); i < end; ++i) {
-                if (entry.attribute_accessors[i] != geometry_entry.attribute_accessors[i]) continue;
+        for (std::size_t i = 0, end = m_geometries.size(); i < end; ++i) {
+            const Geometry_entry& entry = m_geometries[i];
+            if (
+                (entry.index_accessor      == geometry_entry.index_accessor) &&
+                (entry.attribute_accessors == geometry_entry.attribute_accessors)
+            ) {
+                return i;
             }
-            // Found existing entry
-            geometry_entry = entry;
-            return;
         }
 
-        load_new_primitive_geometry(primitive, geometry_entry);
+        m_geometries.push_back(std::move(geometry_entry));
+        return m_geometries.size() - 1;
+    }
+    void collect_primitive_geometries()
+    {
+        m_geometries.clear();
+        m_mesh_primitive_geometries.resize(m_data->meshes_count);
+        for (cgltf_size mesh_index = 0; mesh_index < m_data->meshes_count; ++mesh_index) {
+            const cgltf_mesh* mesh = &m_data->meshes[mesh_index];
+            auto& primitive_geometries = m_mesh_primitive_geometries[mesh_index];
+            primitive_geometries.resize(mesh->primitives_count);
+            for (cgltf_size i = 0; i < mesh->primitives_count; ++i) {
+                primitive_geometries[i] = find_or_add_geometry_entry(&mesh->primitives[i]);
+            }
+        }
+    }
+    void convert_primitive_geometry(Geometry_entry& geometry_entry) const
+    {
+        Primitive_to_geometry primitive_to_geometry{m_arguments, geometry_entry.primitive};
+        if (primitive_to_geometry.corner_tangents.empty()) {
+            if (primitive_to_geometry.corner_texcoords.empty()) {
+                primitive_to_geometry.geometry->generate_polygon_texture_coordinates();
+            }
+            primitive_to_geometry.geometry->compute_tangents();
+        }
+        geometry_entry.geometry = primitive_to_geometry.geometry;
+    }
+    void add_primitive_geometries()
+    {
+        for (Geometry_entry& geometry_entry : m_geometries) {
+            geometry_entry.geometry_primitive = std::make_shared<erhe::primitive::Geometry_primitive>(
+                geometry_entry.geometry
+            );
+            m_data_out.geometries.push_back(geometry_entry.geometry);
+            m_data_out.geometry_primitives.push_back(geometry_entry.geometry_primitive);
+        }
     }
 
     void parse_primitive(
@@ -1595,8 +1622,8 @@ private:
             ? fmt::format("{}[{}]", mesh->name, primitive_index)
             : fmt::format("primitive[{}] {}", primitive_index, c_str(primitive->type));
 
-        Geometry_entry geometry_entry;
-        get_primitive_geometry(primitive, geometry_entry);
+        const std::size_t     geometry_index = m_mesh_primitive_geometries.at(mesh - m_data->meshes).at(primitive_index);
+        const Geometry_entry& geometry_entry = m_geometries.at(geometry_index);
 
         erhe_mesh->add_primitive(
             erhe::primitive::Primitive{
@@ -1740,10 +1767,10 @@ private:
         }
     }
 
-    Gltf_data&           m_data_out;
-    Gltf_parse_arguments m_arguments;
-    std::string          m_file_contents; // GLB needs file contents in memory
-    cgltf_data*          m_data{nullptr};
+    Gltf_data&              m_data_out;
+    Gltf_parse_arguments    m_arguments;
+    Gltf_file               m_file;
+    cgltf_data*             m_data{nullptr}; // owned by m_file
 };
 
 auto parse_gltf(const Gltf_parse_arguments& arguments) -> Gltf_data
@@ -1756,42 +1783,11 @@ auto parse_gltf(const Gltf_parse_arguments& arguments) -> Gltf_data
 
 auto scan_gltf(std::filesystem::path path) -> Gltf_scan
 {
-    std::optional<std::string> file_contents_opt = erhe::file::read("GLTF file", path);
-    if (!file_contents_opt.has_value()) {
-        return {};
-    }
-    const cgltf_options parse_options{
-        .type             = cgltf_file_type_invalid, // auto
-        .json_token_count = 0, // 0 == auto
-        .memory = {
-            .alloc_func   = nullptr,
-            .free_func    = nullptr,
-            .user_data    = nullptr
-        },
-        .file = {
-            .read         = cgltf_custom_file_read,
-            .release      = cgltf_custom_file_release,
-            .user_data    = nullptr
-        }
-    };
-
-    const std::string& file_contents = file_contents_opt.value();
-    cgltf_data* data = nullptr;
-    const cgltf_result parse_result = cgltf_parse(
-        &parse_options,
-        file_contents.data(),
-        file_contents.size(),
-        &data
-    );
-
-    if (parse_result != cgltf_result::cgltf_result_success) {
-        log_gltf->error("glTF parse error: {}", c_str(parse_result));
-        return {};
-    }
-    if (data == nullptr) {
-        log_gltf->error("No data loaded to parse glTF");
+    Gltf_file file;
+    if (!file.open(path, false)) {
         return {};
     }
+    const cgltf_data* data = file.get_data();
 
     Gltf_scan result;
     result.images.resize(data->images_count);
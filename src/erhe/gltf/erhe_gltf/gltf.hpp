@@ -4,6 +4,9 @@
 #include <filesystem>
 #include <vector>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::geometry {
     class Geometry;
 }
@@ -77,6 +80,8 @@ struct Gltf_parse_arguments
     erhe::scene::Layer_id                     mesh_layer_id;
     std::filesystem::path                     path;
     Coordinate_system                         coordinate_system{Coordinate_system::Y_up};
+    erhe::concurrency::Thread_pool*           thread_pool         {nullptr}; // for image decode and geometry conversion, import is serial if not set
+    std::size_t                               max_images_in_flight{0};       // decoded images not yet uploaded, 0 is two per thread
 };
 
 [[nodiscard]] auto parse_gltf(const Gltf_parse_arguments& arguments) -> Gltf_data;
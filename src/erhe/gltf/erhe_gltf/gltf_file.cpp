@@ -0,0 +1,187 @@
+#include "gltf_file.hpp"
+#include "gltf_log.hpp"
+
+#include "erhe_file/file.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+extern "C" {
+    #include "cgltf.h"
+}
+
+#include <algorithm>
+#include <string>
+
+namespace erhe::gltf {
+
+namespace {
+
+[[nodiscard]] const char* c_str(const cgltf_result value)
+{
+    switch (value) {
+        case cgltf_result::cgltf_result_success:         return "success";
+        case cgltf_result::cgltf_result_data_too_short:  return "data too short";
+        case cgltf_result::cgltf_result_unknown_format:  return "unknown format";
+        case cgltf_result::cgltf_result_invalid_json:    return "invalid json";
+        case cgltf_result::cgltf_result_invalid_gltf:    return "invalid gltf";
+        case cgltf_result::cgltf_result_invalid_options: return "invalid options";
+        case cgltf_result::cgltf_result_file_not_found:  return "file not found";
+        case cgltf_result::cgltf_result_io_error:        return "io error";
+        case cgltf_result::cgltf_result_out_of_memory:   return "out of memory";
+        case cgltf_result::cgltf_result_legacy_gltf:     return "legacy gltf";
+        default:                                         return "?";
+    }
+}
+
+cgltf_result cgltf_custom_file_read(
+    const cgltf_memory_options* ,
+    const cgltf_file_options*   file_options,
+    const char*                 path,
+    cgltf_size*                 size,
+    void**                      data
+)
+{
+    ERHE_VERIFY(file_options != nullptr);
+    ERHE_VERIFY(file_options->user_data != nullptr);
+    auto* const file_mappings = static_cast<Cgltf_file_mappings*>(file_options->user_data);
+
+    std::filesystem::path fs_path = std::filesystem::path((const char8_t*)&*path);
+    auto mapped_file = std::make_unique<erhe::file::Mapped_file>("cgltf file read", fs_path);
+    if (!mapped_file->is_open() || (mapped_file->size() == 0)) {
+        if (size != nullptr) {
+            *size = 0;
+        }
+        if (data != nullptr) {
+            *data = nullptr;
+        }
+        return cgltf_result_file_not_found;
+    }
+
+    if (size) {
+        *size = mapped_file->size();
+    }
+    if (data) {
+        // cgltf does not write to buffer data
+        *data = const_cast<std::byte*>(mapped_file->data());
+    }
+    file_mappings->mapped_files.push_back(std::move(mapped_file));
+
+    return cgltf_result_success;
+}
+
+void cgltf_custom_file_release(
+    const cgltf_memory_options* ,
+    const cgltf_file_options*   file_options,
+    void*                       data
+)
+{
+    if (data == nullptr) {
+        return;
+    }
+    ERHE_VERIFY(file_options != nullptr);
+    ERHE_VERIFY(file_options->user_data != nullptr);
+    auto* const file_mappings = static_cast<Cgltf_file_mappings*>(file_options->user_data);
+    auto&       mapped_files  = file_mappings->mapped_files;
+    const auto i = std::find_if(
+        mapped_files.begin(),
+        mapped_files.end(),
+        [data](const std::unique_ptr<erhe::file::Mapped_file>& mapped_file) {
+            return mapped_file->data() == data;
+        }
+    );
+    ERHE_VERIFY(i != mapped_files.end());
+    mapped_files.erase(i);
+}
+
+[[nodiscard]] auto make_cgltf_options(Cgltf_file_mappings& file_mappings) -> cgltf_options
+{
+    return cgltf_options{
+        .type             = cgltf_file_type_invalid, // auto
+        .json_token_count = 0, // 0 == auto
+        .memory = {
+            .alloc_func   = nullptr,
+            .free_func    = nullptr,
+            .user_data    = nullptr
+        },
+        .file = {
+            .read         = cgltf_custom_file_read,
+            .release      = cgltf_custom_file_release,
+            .user_data    = &file_mappings
+        }
+    };
+}
+
+} // anonymous namespace
+
+Gltf_file::Gltf_file() = default;
+
+Gltf_file::~Gltf_file() noexcept
+{
+    // Releases external buffer mappings through cgltf_custom_file_release()
+    if (m_data != nullptr) {
+        cgltf_free(m_data);
+    }
+}
+
+auto Gltf_file::open(const std::filesystem::path& path, const bool load_buffers) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(m_data == nullptr);
+
+    // GLB binary chunk is used directly from the mapping by cgltf, so
+    // the mapping is kept until cgltf_free().
+    m_file = erhe::file::Mapped_file{"GLTF file", path};
+    if (!m_file.is_open() || (m_file.size() == 0)) {
+        return false;
+    }
+
+    const cgltf_options parse_options = make_cgltf_options(m_file_mappings);
+    const cgltf_result  parse_result  = cgltf_parse(
+        &parse_options,
+        m_file.data(),
+        m_file.size(),
+        &m_data
+    );
+
+    if (parse_result != cgltf_result::cgltf_result_success) {
+        log_gltf->error("glTF parse error: {}", c_str(parse_result));
+        return false;
+    }
+    if (m_data == nullptr) {
+        log_gltf->error("No data loaded to parse glTF");
+        return false;
+    }
+    if (!load_buffers) {
+        return true;
+    }
+
+    const std::string  path_string         = erhe::file::to_string(path);
+    const cgltf_result load_buffers_result = cgltf_load_buffers(&parse_options, m_data, path_string.c_str());
+    if (load_buffers_result != cgltf_result::cgltf_result_success) {
+        log_gltf->error("glTF load buffers error: {}", c_str(load_buffers_result));
+        return false;
+    }
+    return true;
+}
+
+auto Gltf_file::get_data() const -> cgltf_data*
+{
+    return m_data;
+}
+
+auto Gltf_file::get_mapped_byte_count() const -> std::size_t
+{
+    std::size_t mapped_byte_count = m_file.size();
+    for (const auto& mapped_file : m_file_mappings.mapped_files) {
+        mapped_byte_count += mapped_file->size();
+    }
+    return mapped_byte_count;
+}
+
+auto Gltf_file::get_mapped_file_count() const -> std::size_t
+{
+    return (m_file.is_open() ? 1 : 0) + m_file_mappings.mapped_files.size();
+}
+
+} // namespace erhe::gltf
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "erhe_file/mapped_file.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+struct cgltf_data;
+
+namespace erhe::gltf {
+
+// Files read by cgltf (glTF external buffers) are memory mapped instead of
+// copied to heap. Mappings are owned by Cgltf_file_mappings which is passed
+// to cgltf as file options user_data, and are kept until cgltf_free().
+class Cgltf_file_mappings
+{
+public:
+    std::vector<std::unique_ptr<erhe::file::Mapped_file>> mapped_files;
+};
+
+// glTF file parsed by cgltf from a read-only memory mapping. The GLB binary
+// chunk and external buffers are used directly from the mappings, which are
+// kept until the Gltf_file is destroyed. Does not use graphics.
+class Gltf_file
+{
+public:
+    Gltf_file();
+    ~Gltf_file() noexcept;
+
+    Gltf_file(const Gltf_file&) = delete;
+    Gltf_file& operator=(const Gltf_file&) = delete;
+
+    // On failure, logs error and returns false. External buffers are only
+    // mapped if load_buffers is set.
+    auto open(const std::filesystem::path& path, bool load_buffers) -> bool;
+
+    [[nodiscard]] auto get_data             () const -> cgltf_data*;
+    [[nodiscard]] auto get_mapped_byte_count() const -> std::size_t;
+    [[nodiscard]] auto get_mapped_file_count() const -> std::size_t;
+
+private:
+    erhe::file::Mapped_file m_file; // GLB binary chunk is referenced by m_data
+    Cgltf_file_mappings     m_file_mappings;
+    cgltf_data*             m_data{nullptr};
+};
+
+} // namespace erhe::gltf
@@ -0,0 +1,109 @@
+#include "erhe_hash/xxh64.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace erhe::hash
+{
+
+namespace {
+
+constexpr uint64_t c_prime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t c_prime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t c_prime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t c_prime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t c_prime64_5 = 0x27D4EB2F165667C5ull;
+
+// Reference implementation reads little endian; supported targets are little endian
+static_assert(std::endian::native == std::endian::little);
+
+[[nodiscard]] inline auto read_u64(const uint8_t* p) -> uint64_t
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+[[nodiscard]] inline auto read_u32(const uint8_t* p) -> uint32_t
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+[[nodiscard]] inline auto round(uint64_t accumulator, const uint64_t input) -> uint64_t
+{
+    accumulator += input * c_prime64_2;
+    accumulator  = std::rotl(accumulator, 31);
+    accumulator *= c_prime64_1;
+    return accumulator;
+}
+
+[[nodiscard]] inline auto merge_round(uint64_t accumulator, const uint64_t value) -> uint64_t
+{
+    accumulator ^= round(0, value);
+    accumulator  = accumulator * c_prime64_1 + c_prime64_4;
+    return accumulator;
+}
+
+} // anonymous namespace
+
+auto xxh64(
+    const void*       data,
+    const std::size_t byte_count,
+    const uint64_t    seed
+) -> uint64_t
+{
+    const uint8_t*       p   = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + byte_count;
+    uint64_t             h;
+
+    if (byte_count >= 32) {
+        const uint8_t* const limit = end - 32;
+        uint64_t v1 = seed + c_prime64_1 + c_prime64_2;
+        uint64_t v2 = seed + c_prime64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - c_prime64_1;
+        do {
+            v1 = round(v1, read_u64(p));      p += 8;
+            v2 = round(v2, read_u64(p));      p += 8;
+            v3 = round(v3, read_u64(p));      p += 8;
+            v4 = round(v4, read_u64(p));      p += 8;
+        } while (p <= limit);
+
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + c_prime64_5;
+    }
+
+    h += static_cast<uint64_t>(byte_count);
+
+    while (p + 8 <= end) {
+        h ^= round(0, read_u64(p));
+        h  = std::rotl(h, 27) * c_prime64_1 + c_prime64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read_u32(p)) * c_prime64_1;
+        h  = std::rotl(h, 23) * c_prime64_2 + c_prime64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<uint64_t>(*p) * c_prime64_5;
+        h  = std::rotl(h, 11) * c_prime64_1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= c_prime64_2;
+    h ^= h >> 29;
+    h *= c_prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace erhe::hash
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace erhe::hash
+{
+
+// XXH64 (https://github.com/Cyan4973/xxHash), for hashing large buffers.
+// Processes 32 bytes per round, much faster than byte at a time hash()
+// from hash.hpp. Result matches reference XXH64 implementation.
+[[nodiscard]] auto xxh64(
+    const void*       data,
+    const std::size_t byte_count,
+    const uint64_t    seed = 0
+) -> uint64_t;
+
+} // namespace erhe::hash
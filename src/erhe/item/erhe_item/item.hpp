@@ -174,6 +174,7 @@ class Item_filter
 {
 public:
     [[nodiscard]] auto operator()(uint64_t filter_bits) const -> bool;
+    [[nodiscard]] auto operator==(const Item_filter& other) const -> bool = default;
 
     auto describe() const -> std::string;
 
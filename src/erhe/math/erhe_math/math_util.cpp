@@ -600,6 +600,34 @@ void calculate_bounding_volume(
     return transformed_bounding_sphere;
 }
 
+Frustum_planes::Frustum_planes(const glm::mat4& clip_from_world)
+{
+    const vec4 row0{clip_from_world[0][0], clip_from_world[1][0], clip_from_world[2][0], clip_from_world[3][0]};
+    const vec4 row1{clip_from_world[0][1], clip_from_world[1][1], clip_from_world[2][1], clip_from_world[3][1]};
+    const vec4 row2{clip_from_world[0][2], clip_from_world[1][2], clip_from_world[2][2], clip_from_world[3][2]};
+    const vec4 row3{clip_from_world[0][3], clip_from_world[1][3], clip_from_world[2][3], clip_from_world[3][3]};
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+}
+
+auto Frustum_planes::intersects(const glm::vec3 center, const glm::vec3 half_extent) const -> bool
+{
+    for (const vec4& plane : planes) {
+        const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        const float radius   =
+            std::abs(plane.x) * half_extent.x +
+            std::abs(plane.y) * half_extent.y +
+            std::abs(plane.z) * half_extent.z;
+        if (distance + radius < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
 [[nodiscard]] auto compose(
     glm::vec3 scale,
     glm::quat rotation,
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <vector>
@@ -795,6 +796,25 @@ public:
     const Bounding_sphere& sphere
 ) -> Bounding_sphere;
 
+// Left, right, bottom, top and near planes of view volume given by
+// clip_from_world, extracted from matrix rows (Gribb & Hartmann). Point p
+// is on the inside of plane when dot(plane, vec4{p, 1}) >= 0. Far plane is
+// not included: its clip space equation depends on depth range convention,
+// and it may be at infinity. Near plane uses -w <= z, which is exact for
+// minus one to one depth range and conservative for others.
+class Frustum_planes
+{
+public:
+    static constexpr std::size_t plane_count = 5;
+
+    explicit Frustum_planes(const glm::mat4& clip_from_world);
+
+    // Conservative test for axis aligned box given by center and half extent
+    [[nodiscard]] auto intersects(glm::vec3 center, glm::vec3 half_extent) const -> bool;
+
+    std::array<glm::vec4, plane_count> planes;
+};
+
 class Bounding_volume_source
 {
 public:
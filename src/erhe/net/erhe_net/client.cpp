@@ -87,6 +87,11 @@ void Client::set_receive_handler(Receive_handler receive_handler)
     m_socket.set_receive_handler(receive_handler);
 }
 
+void Client::set_buffer_sizes(const std::size_t send_byte_count, const std::size_t receive_byte_count)
+{
+    m_socket.set_buffer_sizes(send_byte_count, receive_byte_count);
+}
+
 auto Client::get_state() -> Socket::State
 {
     return m_socket.get_state();
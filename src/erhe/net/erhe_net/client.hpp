@@ -19,6 +19,7 @@ public:
     void disconnect         ();
     auto send               (const std::string& message) -> bool;
     void set_receive_handler(Receive_handler receive_handler);
+    void set_buffer_sizes   (std::size_t send_byte_count, std::size_t receive_byte_count); // before connect()
     auto poll               (int timeout_ms) -> bool;
     auto get_state          () -> Socket::State;
 
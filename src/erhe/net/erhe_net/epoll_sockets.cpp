@@ -0,0 +1,79 @@
+#include "erhe_net/epoll_sockets.hpp"
+#include "erhe_net/net_log.hpp"
+#include "erhe_verify/verify.hpp"
+
+namespace erhe::net
+{
+
+namespace {
+
+constexpr std::size_t s_max_events_per_wait = 256;
+
+}
+
+Epoll_sockets::Epoll_sockets()
+    : m_epoll_fd{::epoll_create1(EPOLL_CLOEXEC)}
+    , m_events  (s_max_events_per_wait)
+{
+    if (m_epoll_fd < 0) {
+        log_net->error("epoll_create1() failed with error {}", get_net_last_error_message());
+    }
+}
+
+Epoll_sockets::~Epoll_sockets() noexcept
+{
+    if (m_epoll_fd >= 0) {
+        ::close(m_epoll_fd);
+    }
+}
+
+auto Epoll_sockets::is_open() const -> bool
+{
+    return m_epoll_fd >= 0;
+}
+
+auto Epoll_sockets::add(const SOCKET socket, void* const user_data) -> bool
+{
+    epoll_event event{};
+    event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = user_data;
+    const int result = ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, socket, &event);
+    if (result == SOCKET_ERROR) {
+        log_net->error("epoll_ctl(EPOLL_CTL_ADD) failed with error {}", get_net_last_error_message());
+        return false;
+    }
+    return true;
+}
+
+void Epoll_sockets::remove(const SOCKET socket)
+{
+    static_cast<void>(::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, socket, nullptr));
+}
+
+auto Epoll_sockets::wait(const int timeout_ms) -> int
+{
+    const int result = ::epoll_wait(m_epoll_fd, m_events.data(), static_cast<int>(m_events.size()), timeout_ms);
+    if ((result == SOCKET_ERROR) && (get_net_last_error() == EINTR)) {
+        return 0;
+    }
+    return result;
+}
+
+auto Epoll_sockets::get_event(const int index) const -> const epoll_event&
+{
+    ERHE_VERIFY((index >= 0) && (static_cast<std::size_t>(index) < m_events.size()));
+    return m_events[index];
+}
+
+auto Epoll_sockets::is_readable(const epoll_event& event) -> bool
+{
+    // Hang up and errors are reported by recv()
+    return (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+}
+
+auto Epoll_sockets::is_writable(const epoll_event& event) -> bool
+{
+    return (event.events & EPOLLOUT) != 0;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "erhe_net/net_os.hpp"
+
+#include <vector>
+
+namespace erhe::net
+{
+
+// Edge triggered epoll instance. Unlike Select_sockets, sockets are
+// registered once, and wait() only returns sockets which have events.
+class Epoll_sockets
+{
+public:
+    Epoll_sockets();
+    ~Epoll_sockets() noexcept;
+    Epoll_sockets (const Epoll_sockets&) = delete;
+    void operator=(const Epoll_sockets&) = delete;
+
+    [[nodiscard]] auto is_open() const -> bool;
+
+    // Registers socket for read, write and hang up events. user_data is
+    // returned in events for the socket. Closing socket removes it.
+    auto add   (SOCKET socket, void* user_data) -> bool;
+    void remove(SOCKET socket);
+
+    // Returns number of events, or SOCKET_ERROR
+    auto wait     (int timeout_ms) -> int;
+    auto get_event(int index) const -> const epoll_event&;
+
+    [[nodiscard]] static auto is_readable(const epoll_event& event) -> bool;
+    [[nodiscard]] static auto is_writable(const epoll_event& event) -> bool;
+
+private:
+    int                      m_epoll_fd{-1};
+    std::vector<epoll_event> m_events;
+};
+
+}
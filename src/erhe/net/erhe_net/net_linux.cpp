@@ -2,6 +2,8 @@
 #include "erhe_net/net_log.hpp"
 #include <string.h>
 
+#include <algorithm>
+
 #include <fmt/format.h>
  
 namespace erhe::net
@@ -189,7 +191,7 @@ auto is_error_busy(const int error_code) -> bool
 
 auto is_socket_good(const SOCKET socket) -> bool
 {
-    return (socket >= 0) && (socket <= FD_SETSIZE);
+    return socket >= 0;
 }
 
 auto set_socket_option(
@@ -213,7 +215,7 @@ auto set_socket_option(
             if (flags == -1) {
                 return false;
             }
-            flags = (value != 0) ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+            flags = (value != 0) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
             result = fcntl(socket, F_SETFL, flags);
             break;
         }
@@ -290,6 +292,66 @@ auto get_socket_option(
     return value;
 }
 
+auto send_gather(const SOCKET socket, const Send_span* const spans, const int span_count) -> int64_t
+{
+    static constexpr int max_span_count = 64;
+    iovec iov[max_span_count];
+    const int iov_count = std::min(span_count, max_span_count);
+    for (int i = 0; i < iov_count; ++i) {
+        iov[i].iov_base = const_cast<void*>(spans[i].data);
+        iov[i].iov_len  = spans[i].byte_count;
+    }
+    msghdr message{};
+    message.msg_iov    = iov;
+    message.msg_iovlen = static_cast<std::size_t>(iov_count);
+
+    // sendmsg() is writev() for sockets, and does not raise SIGPIPE
+    const ssize_t result = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+    return (result < 0) ? SOCKET_ERROR : static_cast<int64_t>(result);
+}
+
+auto map_mirrored_memory(std::size_t& byte_count) -> uint8_t*
+{
+    const long        page_size = ::sysconf(_SC_PAGESIZE);
+    const std::size_t page      = (page_size > 0) ? static_cast<std::size_t>(page_size) : 4096;
+    const std::size_t size      = ((byte_count + page - 1) / page) * page;
+
+    const int fd = ::memfd_create("erhe_ring_buffer", MFD_CLOEXEC);
+    if (fd < 0) {
+        log_net->warn("memfd_create() failed with error {}", get_net_last_error_message());
+        return nullptr;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        log_net->warn("ftruncate() failed with error {}", get_net_last_error_message());
+        ::close(fd);
+        return nullptr;
+    }
+
+    // Reserve address range for both copies, then map file over both halves
+    void* const base = ::mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        log_net->warn("mmap() failed with error {}", get_net_last_error_message());
+        ::close(fd);
+        return nullptr;
+    }
+    uint8_t* const data   = static_cast<uint8_t*>(base);
+    void* const    first  = ::mmap(data,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void* const    second = ::mmap(data + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    ::close(fd); // Mappings keep the memory
+    if ((first == MAP_FAILED) || (second == MAP_FAILED)) {
+        log_net->warn("mmap() failed with error {}", get_net_last_error_message());
+        ::munmap(base, 2 * size);
+        return nullptr;
+    }
+    byte_count = size;
+    return data;
+}
+
+void unmap_mirrored_memory(uint8_t* const data, const std::size_t byte_count)
+{
+    ::munmap(data, 2 * byte_count);
+}
+
 auto get_net_hints(const int flags, const int family, const int socktype, const int protocol) -> addrinfo
 {
     static_cast<void>(flags);
@@ -16,9 +16,12 @@ static constexpr int ERHE_NET_ERROR_CODE_CONNECTED = WSAEISCONN;
 #   include <fcntl.h>
 #   include <netdb.h>
 #   include <netinet/tcp.h>
+#   include <sys/epoll.h>
+#   include <sys/mman.h>
 #   include <sys/select.h>
 #   include <sys/socket.h>
 #   include <sys/types.h>
+#   include <sys/uio.h>
 #   include <unistd.h>
 
 // For now, pretent Windows like API... TODO fix
@@ -33,12 +36,21 @@ static constexpr int    SD_BOTH        = SHUT_RDWR;
 inline auto closesocket(const SOCKET s) -> int { return close(s); }
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 
 namespace erhe::net
 {
 
+class Send_span
+{
+public:
+    const void* data;
+    std::size_t byte_count;
+};
+
 auto get_net_last_error          () -> int;
 auto get_net_error_code_string   (const int error_code) -> std::string;
 auto get_net_error_message_string(const int error_code) -> std::string;
@@ -64,6 +76,17 @@ auto c_str(Socket_option) -> const char*;
 auto set_socket_option(SOCKET socket, Socket_option option, int value) -> bool;
 auto get_socket_option(SOCKET socket, Socket_option option) -> std::optional<int>;
 
+// Sends data from multiple buffers with one call (writev() style).
+// Returns number of bytes sent, or SOCKET_ERROR.
+auto send_gather(SOCKET socket, const Send_span* spans, int span_count) -> int64_t;
+
+// Maps same memory twice, back to back, so that byte i and byte
+// i + byte_count alias. byte_count is rounded up to page size (allocation
+// granularity on Windows). Uses memfd on Linux, and placeholder views on
+// Windows 10 version 1803 and later. Returns nullptr if not supported.
+auto map_mirrored_memory  (std::size_t& byte_count) -> uint8_t*;
+void unmap_mirrored_memory(uint8_t* data, std::size_t byte_count);
+
 auto initialize_net() -> bool;
 
 }
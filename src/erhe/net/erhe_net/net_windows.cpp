@@ -3,6 +3,7 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <cstdio>
 
 namespace erhe::net
@@ -277,6 +278,127 @@ auto get_socket_option(const SOCKET socket, const Socket_option option) -> std::
     return value;
 }
 
+auto send_gather(const SOCKET socket, const Send_span* const spans, const int span_count) -> int64_t
+{
+    static constexpr int max_span_count = 64;
+    WSABUF buffers[max_span_count];
+    const int buffer_count = (std::min)(span_count, max_span_count);
+    for (int i = 0; i < buffer_count; ++i) {
+        buffers[i].buf = const_cast<CHAR*>(static_cast<const CHAR*>(spans[i].data));
+        buffers[i].len = static_cast<ULONG>(spans[i].byte_count);
+    }
+    DWORD     sent_byte_count{0};
+    const int result = WSASend(socket, buffers, static_cast<DWORD>(buffer_count), &sent_byte_count, 0, nullptr, nullptr);
+    return (result == SOCKET_ERROR) ? SOCKET_ERROR : static_cast<int64_t>(sent_byte_count);
+}
+
+#if !defined(MEM_RESERVE_PLACEHOLDER)
+#   define MEM_RESERVE_PLACEHOLDER  0x00040000
+#   define MEM_REPLACE_PLACEHOLDER  0x00004000
+#   define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+namespace {
+
+// VirtualAlloc2() and MapViewOfFile3() are available from Windows 10
+// version 1803. They are looked up at runtime, so that older versions
+// fall back to plain ring buffer storage. Extended parameters are unused.
+using Virtual_alloc_2    = PVOID (WINAPI*)(HANDLE process, PVOID base_address, SIZE_T size, ULONG allocation_type, ULONG page_protection, void* parameters, ULONG parameter_count);
+using Map_view_of_file_3 = PVOID (WINAPI*)(HANDLE file_mapping, HANDLE process, PVOID base_address, ULONG64 offset, SIZE_T view_size, ULONG allocation_type, ULONG page_protection, void* parameters, ULONG parameter_count);
+
+class Placeholder_api
+{
+public:
+    Placeholder_api()
+    {
+        const HMODULE kernelbase = GetModuleHandleW(L"kernelbase.dll");
+        if (kernelbase == nullptr) {
+            return;
+        }
+        virtual_alloc_2    = reinterpret_cast<Virtual_alloc_2   >(reinterpret_cast<void*>(GetProcAddress(kernelbase, "VirtualAlloc2")));
+        map_view_of_file_3 = reinterpret_cast<Map_view_of_file_3>(reinterpret_cast<void*>(GetProcAddress(kernelbase, "MapViewOfFile3")));
+    }
+
+    [[nodiscard]] auto is_available() const -> bool
+    {
+        return (virtual_alloc_2 != nullptr) && (map_view_of_file_3 != nullptr);
+    }
+
+    Virtual_alloc_2    virtual_alloc_2   {nullptr};
+    Map_view_of_file_3 map_view_of_file_3{nullptr};
+};
+
+} // anonymous namespace
+
+auto map_mirrored_memory(std::size_t& byte_count) -> uint8_t*
+{
+    static const Placeholder_api api;
+    if (!api.is_available()) {
+        return nullptr;
+    }
+
+    // Views must be aligned to allocation granularity, not just page size
+    SYSTEM_INFO system_info{};
+    GetSystemInfo(&system_info);
+    const std::size_t granularity = static_cast<std::size_t>(system_info.dwAllocationGranularity);
+    const std::size_t size        = ((byte_count + granularity - 1) / granularity) * granularity;
+
+    const HANDLE section = CreateFileMappingW(
+        INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+        static_cast<DWORD>(size & 0xffffffffu),
+        nullptr
+    );
+    if (section == nullptr) {
+        log_net->warn("CreateFileMapping() failed with error {}", GetLastError());
+        return nullptr;
+    }
+
+    // Reserve address range for both copies, and split it to two
+    // placeholders, which are then replaced with views of the section
+    uint8_t* const data = static_cast<uint8_t*>(
+        api.virtual_alloc_2(nullptr, nullptr, 2 * size, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr, 0)
+    );
+    if (data == nullptr) {
+        log_net->warn("VirtualAlloc2() failed with error {}", GetLastError());
+        CloseHandle(section);
+        return nullptr;
+    }
+    if (!VirtualFree(data, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+        log_net->warn("VirtualFree() failed with error {}", GetLastError());
+        VirtualFree(data, 0, MEM_RELEASE);
+        CloseHandle(section);
+        return nullptr;
+    }
+    void* const first  = api.map_view_of_file_3(section, nullptr, data,        0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+    void* const second = api.map_view_of_file_3(section, nullptr, data + size, 0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+    CloseHandle(section); // Views keep the memory
+    if ((first == nullptr) || (second == nullptr)) {
+        log_net->warn("MapViewOfFile3() failed with error {}", GetLastError());
+        if (first != nullptr) {
+            UnmapViewOfFile(first);
+        } else {
+            VirtualFree(data, 0, MEM_RELEASE);
+        }
+        if (second != nullptr) {
+            UnmapViewOfFile(second);
+        } else {
+            VirtualFree(data + size, 0, MEM_RELEASE);
+        }
+        return nullptr;
+    }
+    byte_count = size;
+    return data;
+}
+
+void unmap_mirrored_memory(uint8_t* const data, const std::size_t byte_count)
+{
+    UnmapViewOfFile(data);
+    UnmapViewOfFile(data + byte_count);
+}
+
 auto get_net_hints(
     const int flags,
     const int family,
@@ -1,5 +1,7 @@
 #include "erhe_net/ring_buffer.hpp"
+#include "erhe_net/net_os.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 
@@ -8,94 +10,102 @@ namespace erhe::net
 
 Ring_buffer::Ring_buffer(const std::size_t capacity)
 {
-    m_buffer.resize(capacity);
-    m_max_size = capacity;
-    reset();
+    std::size_t mirrored_capacity = capacity;
+    m_data = map_mirrored_memory(mirrored_capacity);
+    if (m_data != nullptr) {
+        m_capacity = mirrored_capacity;
+        m_mirrored = true;
+    } else {
+        m_fallback_storage.resize(capacity);
+        m_data     = m_fallback_storage.data();
+        m_capacity = capacity;
+    }
+}
+
+Ring_buffer::~Ring_buffer() noexcept
+{
+    release();
+}
+
+void Ring_buffer::release()
+{
+    if (m_mirrored) {
+        unmap_mirrored_memory(m_data, m_capacity);
+    }
+    m_fallback_storage.clear();
+    m_data     = nullptr;
+    m_capacity = 0;
+    m_mirrored = false;
 }
 
 Ring_buffer::Ring_buffer(Ring_buffer&& other) noexcept
-    : m_buffer      {std::move(other.m_buffer)}
-    , m_read_offset {other.m_read_offset}
-    , m_write_offset{other.m_write_offset}
-    , m_max_size    {other.m_max_size}
-    , m_full        {other.m_full}
+    : m_data            {other.m_data}
+    , m_capacity        {other.m_capacity}
+    , m_mirrored        {other.m_mirrored}
+    , m_fallback_storage{std::move(other.m_fallback_storage)}
+    , m_read_position   {other.m_read_position.load()}
+    , m_write_position  {other.m_write_position.load()}
 {
+    other.m_data     = nullptr;
+    other.m_capacity = 0;
+    other.m_mirrored = false;
+    other.reset();
 }
 
 auto Ring_buffer::operator=(Ring_buffer&& other) noexcept -> Ring_buffer&
 {
-    m_buffer       = std::move(other.m_buffer);
-    m_read_offset  = other.m_read_offset;
-    m_write_offset = other.m_write_offset;
-    m_max_size     = other.m_max_size;
-    m_full         = other.m_full;
+    if (this != &other) {
+        release();
+        m_data             = other.m_data;
+        m_capacity         = other.m_capacity;
+        m_mirrored         = other.m_mirrored;
+        m_fallback_storage = std::move(other.m_fallback_storage);
+        m_read_position .store(other.m_read_position .load());
+        m_write_position.store(other.m_write_position.load());
+        other.m_data     = nullptr;
+        other.m_capacity = 0;
+        other.m_mirrored = false;
+        other.reset();
+    }
     return *this;
 }
 
 void Ring_buffer::reset()
 {
-    m_write_offset = 0;
-    m_read_offset  = 0;
-    m_full         = false;
+    m_write_position.store(0);
+    m_read_position .store(0);
 }
 
 auto Ring_buffer::empty() const -> bool
 {
-    return !m_full && (m_read_offset == m_write_offset);
+    return size() == 0;
 }
 
 auto Ring_buffer::full() const -> bool
 {
-    return m_full;
+    return size() == m_capacity;
 }
 
-auto Ring_buffer::max_size() const -> std::size_t
+auto Ring_buffer::is_mirrored() const -> bool
 {
-    return m_max_size;
+    return m_mirrored;
 }
 
-auto Ring_buffer::size() const -> std::size_t
+auto Ring_buffer::max_size() const -> std::size_t
 {
-    if (full()) {
-        return m_max_size;
-    }
-    if (m_write_offset >= m_read_offset) {
-        return m_write_offset - m_read_offset;
-    }
-    return m_max_size + m_write_offset - m_read_offset;
+    return m_capacity;
 }
 
-void Ring_buffer::rotate()
+auto Ring_buffer::size() const -> std::size_t
 {
-    rotate(m_read_offset);
-}
-
-void Ring_buffer::rotate(std::size_t rotate_amount)
-{
-    size_t count  = 0;
-    size_t offset = 0;
-
-    while (count < m_max_size) {
-        size_t  to_index   = offset;
-        uint8_t tmp        = m_buffer[to_index];
-        size_t  from_index = (to_index + rotate_amount) % m_max_size;
-
-        while (from_index != offset) {
-            m_buffer[to_index] = m_buffer[from_index];
-            to_index   = from_index;
-            from_index = (to_index + rotate_amount) % m_max_size;
-            ++count;
-        }
-
-        m_buffer[to_index] = tmp;
-        ++count;
-        ++offset;
-    }
+    const uint64_t read_position  = m_read_position .load(std::memory_order_acquire);
+    const uint64_t write_position = m_write_position.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(write_position - read_position);
 }
 
 auto Ring_buffer::size_available_for_write() const -> std::size_t
 {
-    return m_max_size - size();
+    return m_capacity - size();
 }
 
 auto Ring_buffer::size_available_for_read() const -> std::size_t
@@ -108,43 +118,43 @@ auto Ring_buffer::begin_produce(
     std::size_t& writable_byte_count_after_wrap
 ) -> uint8_t*
 {
-    const std::size_t can_write_count = size_available_for_write();
+    const uint64_t    write_position  = m_write_position.load(std::memory_order_relaxed);
+    const uint64_t    read_position   = m_read_position .load(std::memory_order_acquire);
+    const std::size_t can_write_count = m_capacity - static_cast<std::size_t>(write_position - read_position);
     if (can_write_count == 0) {
         writable_byte_count_before_wrap = 0;
-        writable_byte_count_after_wrap = 0;
-        return 0;
+        writable_byte_count_after_wrap  = 0;
+        return nullptr;
     }
-    const std::size_t max_count_before_wrap = m_max_size - m_write_offset;
-    writable_byte_count_before_wrap = (std::min)(can_write_count, max_count_before_wrap);
-    writable_byte_count_after_wrap  = (writable_byte_count_before_wrap < can_write_count)
-        ? can_write_count - writable_byte_count_before_wrap
-        : 0;
-
-    return &m_buffer[m_write_offset];
+    const std::size_t write_offset = static_cast<std::size_t>(write_position % m_capacity);
+    writable_byte_count_before_wrap = m_mirrored
+        ? can_write_count
+        : (std::min)(can_write_count, m_capacity - write_offset);
+    writable_byte_count_after_wrap = can_write_count - writable_byte_count_before_wrap;
+    return m_data + write_offset;
 }
 
 void Ring_buffer::end_produce(const std::size_t write_byte_count)
 {
-    m_write_offset = (m_write_offset + write_byte_count) % m_max_size;
-    m_full = (m_write_offset == m_read_offset);
+    const uint64_t write_position = m_write_position.load(std::memory_order_relaxed);
+    m_write_position.store(write_position + write_byte_count, std::memory_order_release);
 }
 
 auto Ring_buffer::write(const uint8_t* src, const std::size_t byte_count) -> std::size_t
 {
-    const std::size_t can_write_count = (std::min)(size_available_for_write(), byte_count);
+    std::size_t    count_before_wrap{0};
+    std::size_t    count_after_wrap {0};
+    uint8_t* const dst = begin_produce(count_before_wrap, count_after_wrap);
+    const std::size_t can_write_count = (std::min)(count_before_wrap + count_after_wrap, byte_count);
     if (can_write_count == 0) {
         return 0;
     }
-    const std::size_t max_count_before_wrap = m_max_size - m_write_offset;
-    const std::size_t count_before_wrap     = (std::min)(can_write_count, max_count_before_wrap);
-    const std::size_t count_after_wrap      = (count_before_wrap < can_write_count) ? (can_write_count - count_before_wrap) : 0;
-    memcpy(&m_buffer[m_write_offset], src, count_before_wrap);
-    if (count_after_wrap > 0) {
-        memcpy(&m_buffer[0], src + count_before_wrap, count_after_wrap);
+    const std::size_t first_count = (std::min)(can_write_count, count_before_wrap);
+    memcpy(dst, src, first_count);
+    if (first_count < can_write_count) {
+        memcpy(m_data, src + first_count, can_write_count - first_count);
     }
-
-    m_write_offset = (m_write_offset + can_write_count) % m_max_size;
-    m_full = (m_write_offset == m_read_offset);
+    end_produce(can_write_count);
     return can_write_count;
 }
 
@@ -153,71 +163,71 @@ auto Ring_buffer::begin_consume(
     std::size_t& readable_byte_count_after_wrap
 ) -> const uint8_t*
 {
-    const std::size_t can_read_count = size_available_for_read();
+    const uint64_t    read_position  = m_read_position .load(std::memory_order_relaxed);
+    const uint64_t    write_position = m_write_position.load(std::memory_order_acquire);
+    const std::size_t can_read_count = static_cast<std::size_t>(write_position - read_position);
     if (can_read_count == 0) {
         readable_byte_count_before_wrap = 0;
-        readable_byte_count_after_wrap = 0;
+        readable_byte_count_after_wrap  = 0;
         return nullptr;
     }
-    const std::size_t max_count_before_wrap = m_max_size - m_read_offset;
-    readable_byte_count_before_wrap = std::min(can_read_count, max_count_before_wrap);
-    readable_byte_count_after_wrap  = (readable_byte_count_before_wrap < can_read_count)
-        ? (can_read_count - readable_byte_count_before_wrap)
-        : 0;
-
-    return &m_buffer[m_read_offset];
+    const std::size_t read_offset = static_cast<std::size_t>(read_position % m_capacity);
+    readable_byte_count_before_wrap = m_mirrored
+        ? can_read_count
+        : (std::min)(can_read_count, m_capacity - read_offset);
+    readable_byte_count_after_wrap = can_read_count - readable_byte_count_before_wrap;
+    return m_data + read_offset;
 }
 
-void Ring_buffer::end_consume(std::size_t byte_count)
+void Ring_buffer::end_consume(const std::size_t byte_count)
 {
-    m_read_offset = (m_read_offset + byte_count) % m_max_size;
-    m_full        = false;
+    const uint64_t read_position = m_read_position.load(std::memory_order_relaxed);
+    m_read_position.store(read_position + byte_count, std::memory_order_release);
 }
 
-auto Ring_buffer::read(uint8_t* dst, const std::size_t byte_count) -> std::size_t
+auto Ring_buffer::get_readable() const -> std::span<const uint8_t>
 {
-    const std::size_t can_read_count = std::min(size_available_for_read(), byte_count);
+    const uint64_t    read_position  = m_read_position .load(std::memory_order_relaxed);
+    const uint64_t    write_position = m_write_position.load(std::memory_order_acquire);
+    const std::size_t can_read_count = static_cast<std::size_t>(write_position - read_position);
     if (can_read_count == 0) {
-        return 0;
-    }
-    const std::size_t max_count_before_wrap = m_max_size - m_read_offset;
-    const std::size_t count_before_wrap     = std::min(can_read_count, max_count_before_wrap);
-    const std::size_t count_after_wrap      = (count_before_wrap < can_read_count) ? (can_read_count - count_before_wrap) : 0;
-    memcpy(dst, &m_buffer[m_read_offset], count_before_wrap);
-    if (count_after_wrap > 0) {
-        memcpy(dst + count_before_wrap, &m_buffer[0], count_after_wrap);
+        return {};
     }
+    const std::size_t read_offset = static_cast<std::size_t>(read_position % m_capacity);
+    return std::span<const uint8_t>{
+        m_data + read_offset,
+        m_mirrored ? can_read_count : (std::min)(can_read_count, m_capacity - read_offset)
+    };
+}
 
-    m_read_offset = (m_read_offset + can_read_count) % m_max_size;
-    m_full        = false;
-    return can_read_count;
+auto Ring_buffer::read(uint8_t* dst, const std::size_t byte_count) -> std::size_t
+{
+    const std::size_t read_count = peek(dst, byte_count);
+    end_consume(read_count);
+    return read_count;
 }
 
 auto Ring_buffer::peek(uint8_t* dst, const std::size_t byte_count) -> std::size_t
 {
-    const std::size_t can_read_count = std::min(size_available_for_read(), byte_count);
+    std::size_t          count_before_wrap{0};
+    std::size_t          count_after_wrap {0};
+    const uint8_t* const src = begin_consume(count_before_wrap, count_after_wrap);
+    const std::size_t can_read_count = (std::min)(count_before_wrap + count_after_wrap, byte_count);
     if (can_read_count == 0) {
         return 0;
     }
-    const std::size_t max_count_before_wrap = m_max_size - m_read_offset;
-    const std::size_t count_before_wrap     = std::min(can_read_count, max_count_before_wrap);
-    const std::size_t count_after_wrap      = (count_before_wrap < can_read_count) ? (can_read_count - count_before_wrap) : 0;
-    memcpy(dst, &m_buffer[m_read_offset], count_before_wrap);
-    if (count_after_wrap > 0) {
-        memcpy(dst + count_before_wrap, &m_buffer[0], count_after_wrap);
+    const std::size_t first_count = (std::min)(can_read_count, count_before_wrap);
+    memcpy(dst, src, first_count);
+    if (first_count < can_read_count) {
+        memcpy(dst + first_count, m_data, can_read_count - first_count);
     }
-
     return can_read_count;
 }
 
 auto Ring_buffer::discard(const std::size_t byte_count) -> std::size_t
 {
-    const std::size_t can_discard_count = std::min(size_available_for_read(), byte_count);
-    if (can_discard_count == 0) {
-        return 0;
-    }
-    m_read_offset = (m_read_offset + can_discard_count) % m_max_size;
-    m_full        = false;
+    const std::size_t can_discard_count = (std::min)(size_available_for_read(), byte_count);
+    end_consume(can_discard_count);
     return can_discard_count;
 }
 
@@ -1,15 +1,31 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 namespace erhe::net
 {
 
+// Byte ring buffer.
+//
+// Where supported (Linux, Windows 10 version 1803 and later), storage
+// pages are mapped twice back to back, so all readable and all writable
+// bytes are always one contiguous span, and begin_produce() /
+// begin_consume() never report bytes after wrap. Capacity is then rounded
+// up to page size. Elsewhere storage is a plain array.
+//
+// Read and write positions are atomic, so that one producer thread
+// (begin_produce(), end_produce(), write()) and one consumer thread
+// (begin_consume(), end_consume(), read(), peek(), discard()) can use the
+// buffer at the same time. reset() needs exclusive access.
 class Ring_buffer
 {
 public:
     explicit Ring_buffer(std::size_t capacity);
+    ~Ring_buffer() noexcept;
 
     Ring_buffer   (const Ring_buffer&) = delete;
     void operator=(const Ring_buffer&) = delete;
@@ -19,6 +35,7 @@ public:
     void reset                   ();
     auto empty                   () const -> bool;
     auto full                    () const -> bool;
+    auto is_mirrored             () const -> bool;
     auto max_size                () const -> std::size_t;
     auto size                    () const -> std::size_t;
     auto size_available_for_write() const -> std::size_t;
@@ -45,15 +62,22 @@ public:
 
     auto discard                 (std::size_t byte_count) -> std::size_t;
 
-    void rotate                  ();
-    void rotate                  (std::size_t amount);
+    // Readable bytes, in place. Whole contents when mirrored, otherwise
+    // bytes before wrap. Valid until end_consume().
+    auto get_readable            () const -> std::span<const uint8_t>;
 
 private:
-    std::vector<uint8_t> m_buffer;
-    std::size_t          m_read_offset {0};
-    std::size_t          m_write_offset{0};
-    std::size_t          m_max_size    {0};
-    bool                 m_full        {false};
+    void release();
+
+    uint8_t*             m_data    {nullptr};
+    std::size_t          m_capacity{0};
+    bool                 m_mirrored{false};
+    std::vector<uint8_t> m_fallback_storage;
+
+    // Total byte counts produced and consumed. Each is only written by one
+    // side, which publishes bytes to the other side with release store.
+    alignas(64) std::atomic<uint64_t> m_read_position {0};
+    alignas(64) std::atomic<uint64_t> m_write_position{0};
 };
 
 }
@@ -12,6 +12,15 @@ Select_sockets::Select_sockets()
     FD_ZERO(&except_fds);
 }
 
+auto Select_sockets::can_select(const SOCKET socket) -> bool
+{
+#if defined(ERHE_OS_LINUX)
+    return (socket >= 0) && (socket < FD_SETSIZE);
+#else
+    return socket != INVALID_SOCKET;
+#endif
+}
+
 auto Select_sockets::has_read() const -> bool
 {
     return (flags & flag_read) == flag_read;
@@ -44,6 +53,9 @@ auto Select_sockets::has_except(const SOCKET socket) const -> bool
 
 void Select_sockets::set_read(const SOCKET socket)
 {
+    if (!can_select(socket)) {
+        return;
+    }
     FD_SET(socket, &read_fds);
     nfds = std::max(nfds, static_cast<int>(socket + 1));
     flags = flags | flag_read;
@@ -51,6 +63,9 @@ void Select_sockets::set_read(const SOCKET socket)
 
 void Select_sockets::set_write(const SOCKET socket)
 {
+    if (!can_select(socket)) {
+        return;
+    }
     FD_SET(socket, &write_fds );
     nfds = std::max(nfds, static_cast<int>(socket + 1));
     flags = flags | flag_write;
@@ -58,6 +73,9 @@ void Select_sockets::set_write(const SOCKET socket)
 
 void Select_sockets::set_except(const SOCKET socket)
 {
+    if (!can_select(socket)) {
+        return;
+    }
     FD_SET(socket, &except_fds);
     nfds = std::max(nfds, static_cast<int>(socket + 1));
     flags = flags | flag_except;
@@ -14,6 +14,9 @@ public:
     static constexpr int flag_write  = (1u << 1u);
     static constexpr int flag_except = (1u << 2u);
 
+    // On Linux, select() can only be used with fds less than FD_SETSIZE
+    [[nodiscard]] static auto can_select(SOCKET socket) -> bool;
+
     auto has_read  () const -> bool;
     auto has_write () const -> bool;
     auto has_except() const -> bool;
@@ -1,26 +1,42 @@
 #include "erhe_net/server.hpp"
 #include "erhe_net/net_log.hpp"
 #include "erhe_net/select_sockets.hpp"
+#if defined(ERHE_OS_LINUX)
+#   include "erhe_net/epoll_sockets.hpp"
+#endif
 
 #include "erhe_verify/verify.hpp"
 
 #include <fmt/format.h>
 
+#include <algorithm>
+
 
 namespace erhe::net
 {
 
 Server::Server() = default;
 
+Server::Server(const Poll_backend poll_backend)
+    : m_poll_backend{poll_backend}
+{
+}
+
 Server::~Server()
 {
     log_server->trace("Server destructor");
 }
 
 Server::Server(Server&& other) noexcept
-    : m_listen_socket  {std::move(other.m_listen_socket)}
-    , m_receive_handler{std::move(other.m_receive_handler)}
-    , m_clients        {std::move(other.m_clients)}
+    : m_poll_backend      {other.m_poll_backend}
+    , m_listen_socket     {std::move(other.m_listen_socket)}
+    , m_receive_handler   {std::move(other.m_receive_handler)}
+    , m_connect_handler   {std::move(other.m_connect_handler)}
+    , m_clients           {std::move(other.m_clients)}
+    , m_has_closed_clients{other.m_has_closed_clients}
+#if defined(ERHE_OS_LINUX)
+    , m_epoll_sockets     {std::move(other.m_epoll_sockets)}
+#endif
 {
     log_server->trace("Server move constructor");
 }
@@ -28,15 +44,38 @@ Server::Server(Server&& other) noexcept
 auto Server::operator=(Server&& other) noexcept -> Server&
 {
     log_server->trace("Server move assignment");
-    m_listen_socket   = std::move(other.m_listen_socket);
-    m_receive_handler = std::move(other.m_receive_handler);
-    m_clients         = std::move(other.m_clients);
+    m_poll_backend       = other.m_poll_backend;
+    m_listen_socket      = std::move(other.m_listen_socket);
+    m_receive_handler    = std::move(other.m_receive_handler);
+    m_connect_handler    = std::move(other.m_connect_handler);
+    m_clients            = std::move(other.m_clients);
+    m_has_closed_clients = other.m_has_closed_clients;
+#if defined(ERHE_OS_LINUX)
+    m_epoll_sockets      = std::move(other.m_epoll_sockets);
+#endif
     return *this;
 }
 
 auto Server::listen(const char* address, const int port) -> bool
 {
-    return m_listen_socket.bind(address, port);
+    if (!m_listen_socket.bind(address, port)) {
+        return false;
+    }
+
+#if defined(ERHE_OS_LINUX)
+    if (m_poll_backend == Poll_backend::epoll) {
+        m_epoll_sockets = std::make_unique<Epoll_sockets>();
+        // Listen socket is registered with nullptr user data
+        if (!m_epoll_sockets->is_open() || !m_epoll_sockets->add(m_listen_socket.get_socket(), nullptr)) {
+            log_server->warn("Using select() instead of epoll");
+            m_epoll_sockets.reset();
+            m_poll_backend = Poll_backend::select;
+        }
+    }
+#else
+    m_poll_backend = Poll_backend::select;
+#endif
+    return true;
 }
 
 auto Server::poll(const int timeout_ms) -> bool
@@ -45,12 +84,24 @@ auto Server::poll(const int timeout_ms) -> bool
         return true; // NOP
     }
 
+    const bool result = (m_poll_backend == Poll_backend::epoll)
+        ? poll_epoll (timeout_ms)
+        : poll_select(timeout_ms);
+
+    if (m_has_closed_clients) {
+        remove_closed_clients();
+    }
+    return result;
+}
+
+auto Server::poll_select(const int timeout_ms) -> bool
+{
     Select_sockets select_sockets;
 
     // Collect fds for select
     m_listen_socket.pre_select(select_sockets);
     for (auto& client : m_clients) {
-        client.pre_select(select_sockets);
+        client->pre_select(select_sockets);
     }
 
     // Call select() to find out if there is work to do
@@ -62,39 +113,123 @@ auto Server::poll(const int timeout_ms) -> bool
 
     // Perform send and receive for client sockets, collect closed sockets
     for (auto& client : m_clients) {
-        client.post_select_send_recv(select_sockets);
+        client->post_select_send_recv(select_sockets);
+        if (client->get_state() == Socket::State::CLOSED) {
+            m_has_closed_clients = true;
+        }
+    }
+
+    // Check for new clients
+    auto new_socket = m_listen_socket.post_select_listen(select_sockets);
+    if (new_socket.has_value()) {
+        if (!Select_sockets::can_select(new_socket.value().get_socket())) {
+            log_net->warn("new client socket cannot be used with select(), closing");
+            return true;
+        }
+        add_client(std::move(new_socket.value()));
+    }
+
+    return true;
+}
+
+auto Server::poll_epoll(const int timeout_ms) -> bool
+{
+#if defined(ERHE_OS_LINUX)
+    ERHE_VERIFY(m_epoll_sockets);
+
+    const int event_count = m_epoll_sockets->wait(timeout_ms);
+    if (event_count == SOCKET_ERROR) {
+        log_net->trace("server epoll_wait() returned error {}", get_net_last_error_message());
+        return false;
+    }
+
+    for (int i = 0; i < event_count; ++i) {
+        const epoll_event& event = m_epoll_sockets->get_event(i);
+        if (event.data.ptr == nullptr) {
+            // Edge triggered: accept all pending connections. Dropped
+            // connection does not end the loop, as there would be no new
+            // edge for connections still pending.
+            for (;;) {
+                Accept_result result = m_listen_socket.accept();
+                if (result.status == Accept_result::Status::dropped) {
+                    continue;
+                }
+                if (result.status != Accept_result::Status::accepted) {
+                    break;
+                }
+                add_client(std::move(result.socket.value()));
+            }
+            continue;
+        }
+
+        Socket* const client = static_cast<Socket*>(event.data.ptr);
+        client->on_readiness(
+            Epoll_sockets::is_readable(event),
+            Epoll_sockets::is_writable(event)
+        );
+        if (client->get_state() == Socket::State::CLOSED) {
+            m_has_closed_clients = true;
+        }
     }
+    return true;
+#else
+    static_cast<void>(timeout_ms);
+    return false;
+#endif
+}
+
+void Server::add_client(Socket&& socket)
+{
+    log_net->info("new client is connecting to server");
+    auto client = std::make_unique<Socket>(std::move(socket));
+    client->set_receive_handler(m_receive_handler);
+#if defined(ERHE_OS_LINUX)
+    if (m_epoll_sockets) {
+        client->set_edge_triggered(true);
+        if (!m_epoll_sockets->add(client->get_socket(), client.get())) {
+            return;
+        }
+    }
+#endif
+    m_clients.push_back(std::move(client));
+    if (m_connect_handler) {
+        m_connect_handler();
+    }
+}
 
-    // Remove closed sockets
+void Server::remove_closed_clients()
+{
     m_clients.erase(
         std::remove_if(
             m_clients.begin(),
             m_clients.end(),
-            [](Socket& client) {
-                return client.get_state() == Socket::State::CLOSED;
+            [](const std::unique_ptr<Socket>& client) {
+                return client->get_state() == Socket::State::CLOSED;
             }
         ),
         m_clients.end()
     );
-
-    // Check for new clients
-    auto new_socket = m_listen_socket.post_select_listen(select_sockets);
-    if (new_socket.has_value()) {
-        log_net->info("new client is connecting to server");
-        new_socket.value().set_receive_handler(m_receive_handler);
-        m_clients.push_back(std::move(new_socket.value()));
-    }
-
-    return true;
+    m_has_closed_clients = false;
 }
 
 auto Server::broadcast(const std::string& message) -> bool
 {
+    return broadcast(message.data(), message.length());
+}
+
+auto Server::broadcast(const char* const data, const std::size_t length) -> bool
+{
+    // All clients queue the same packet
+    const Shared_packet packet = make_shared_packet(data, length);
+
     std::size_t error_count = 0;
     for (auto& client : m_clients) {
-        if (!client.send(message.data(), static_cast<int>(message.length()))) {
+        if (!client->send(packet)) {
             ++error_count;
         }
+        if (client->get_state() == Socket::State::CLOSED) {
+            m_has_closed_clients = true;
+        }
     }
     return error_count == 0;
 }
@@ -104,10 +239,23 @@ void Server::set_receive_handler(Receive_handler receive_handler)
     m_receive_handler = receive_handler;
 }
 
+void Server::set_connect_handler(Connect_handler connect_handler)
+{
+    m_connect_handler = connect_handler;
+}
+
+void Server::set_buffer_sizes(const std::size_t send_byte_count, const std::size_t receive_byte_count)
+{
+    m_listen_socket.set_buffer_sizes(send_byte_count, receive_byte_count);
+}
+
 void Server::disconnect()
 {
-    m_listen_socket.close();
     m_clients.clear();
+#if defined(ERHE_OS_LINUX)
+    m_epoll_sockets.reset();
+#endif
+    m_listen_socket.close();
 }
 
 auto Server::get_state() const -> Socket::State
@@ -120,4 +268,9 @@ auto Server::get_client_count() const -> std::size_t
     return m_clients.size();
 }
 
+auto Server::get_poll_backend() const -> Poll_backend
+{
+    return m_poll_backend;
+}
+
 }
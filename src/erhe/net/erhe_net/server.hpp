@@ -2,13 +2,33 @@
 
 #include "erhe_net/socket.hpp"
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace erhe::net
 {
 
+class Epoll_sockets;
+
+enum class Poll_backend : unsigned int {
+    select = 0,
+    epoll  = 1  // Linux only, edge triggered
+};
+
+#if defined(ERHE_OS_LINUX)
+static constexpr Poll_backend default_poll_backend = Poll_backend::epoll;
+#else
+static constexpr Poll_backend default_poll_backend = Poll_backend::select;
+#endif
+
+using Connect_handler = std::function<void()>;
+
 class Server
 {
 public:
     Server();
+    explicit Server(Poll_backend poll_backend);
     ~Server();
     Server(Server&) = delete;
     auto operator=(const Server&) = delete;
@@ -16,17 +36,32 @@ public:
     auto operator=(Server&& other) noexcept -> Server&;
 
     auto broadcast          (const std::string& message) -> bool;
+    auto broadcast          (const char* data, std::size_t length) -> bool;
     void set_receive_handler(Receive_handler receive_handler);
+    void set_connect_handler(Connect_handler connect_handler); // called when server has accepted new client
+    void set_buffer_sizes   (std::size_t send_byte_count, std::size_t receive_byte_count); // for clients accepted after this call
     void disconnect         ();
     auto listen             (const char* address, int port) -> bool;
     auto poll               (int timeout_ms) -> bool;
     auto get_state          () const -> Socket::State;
     auto get_client_count   () const -> std::size_t;
+    auto get_poll_backend   () const -> Poll_backend;
 
 private:
-    Socket              m_listen_socket;
-    Receive_handler     m_receive_handler;
-    std::vector<Socket> m_clients;
+    auto poll_select          (int timeout_ms) -> bool;
+    auto poll_epoll           (int timeout_ms) -> bool;
+    void add_client           (Socket&& socket);
+    void remove_closed_clients();
+
+    Poll_backend                         m_poll_backend{default_poll_backend};
+    Socket                               m_listen_socket;
+    Receive_handler                      m_receive_handler;
+    Connect_handler                      m_connect_handler;
+    std::vector<std::unique_ptr<Socket>> m_clients; // Stable addresses, used as epoll user data
+    bool                                 m_has_closed_clients{false};
+#if defined(ERHE_OS_LINUX)
+    std::unique_ptr<Epoll_sockets>       m_epoll_sockets;
+#endif
 };
 
 }
@@ -6,6 +6,8 @@
 
 #include <fmt/format.h>
 
+#include <array>
+#include <cstring>
 
 namespace erhe::net
 {
@@ -36,6 +38,9 @@ auto c_str(const Socket::State state) -> const char*
     };
 }
 
+constexpr std::size_t send_queue_max_byte_count = 4 * 1024 * 1024;
+constexpr std::size_t send_queue_max_span_count  = 64;
+
 Packet_header::Packet_header() = default;
 
 Packet_header::Packet_header(const uint32_t length)
@@ -44,6 +49,17 @@ Packet_header::Packet_header(const uint32_t length)
 {
 }
 
+auto make_shared_packet(const char* const data, const std::size_t length) -> Shared_packet
+{
+    auto packet = std::make_shared<std::vector<uint8_t>>(sizeof(Packet_header) + length);
+    const Packet_header header{static_cast<uint32_t>(length)};
+    memcpy(packet->data(), &header, sizeof(Packet_header));
+    if (length > 0) {
+        memcpy(packet->data() + sizeof(Packet_header), data, length);
+    }
+    return packet;
+}
+
 Socket::Socket()
 {
     log_socket->trace("Socket default constructor");
@@ -51,10 +67,14 @@ Socket::Socket()
 
 Socket::Socket(
     const SOCKET&      socket,
-    const sockaddr_in& address_in
+    const sockaddr_in& address_in,
+    const std::size_t  send_buffer_size,
+    const std::size_t  receive_buffer_size
 )
-    : m_socket    {socket}
-    , m_address_in{address_in}
+    : m_socket             {socket}
+    , m_address_in         {address_in}
+    , m_send_buffer_size   {send_buffer_size}
+    , m_receive_buffer_size{receive_buffer_size}
 {
     log_socket->trace("Socket (for client in server) constructor");
     set_state(State::CONNECTED);
@@ -80,38 +100,64 @@ Socket::~Socket()
 }
 
 Socket::Socket(Socket&& other) noexcept
-    : m_socket         {other.m_socket}
-    , m_address_in     {other.m_address_in}
-    , m_addr_info      {other.m_addr_info}
-    , m_address        {std::move(other.m_address)}
-    , m_state          {other.m_state}
-    , m_send_buffer    {std::move(other.m_send_buffer)}
-    , m_receive_buffer {std::move(other.m_receive_buffer)}
-    , m_receive_handler{std::move(other.m_receive_handler)}
+    : m_socket               {other.m_socket}
+    , m_address_in           {other.m_address_in}
+    , m_addr_info            {other.m_addr_info}
+    , m_address              {std::move(other.m_address)}
+    , m_state                {other.m_state}
+    , m_send_buffer          {std::move(other.m_send_buffer)}
+    , m_receive_buffer       {std::move(other.m_receive_buffer)}
+    , m_receive_handler      {std::move(other.m_receive_handler)}
+    , m_send_queue           {std::move(other.m_send_queue)}
+    , m_send_queue_offset    {other.m_send_queue_offset}
+    , m_send_queue_byte_count{other.m_send_queue_byte_count}
+    , m_edge_triggered       {other.m_edge_triggered}
+    , m_send_buffer_size     {other.m_send_buffer_size}
+    , m_receive_buffer_size  {other.m_receive_buffer_size}
+    , m_wrapped_packet       {std::move(other.m_wrapped_packet)}
 {
     log_socket->trace("Socket move constructor");
-    other.m_socket    = INVALID_SOCKET;
-    other.m_state     = State::CLOSED;
-    other.m_addr_info = nullptr;
+    other.m_socket                = INVALID_SOCKET;
+    other.m_state                 = State::CLOSED;
+    other.m_addr_info             = nullptr;
+    other.m_send_queue_offset     = 0;
+    other.m_send_queue_byte_count = 0;
 }
 
 auto Socket::operator=(Socket&& other) noexcept -> Socket&
 {
     log_socket->trace("Socket move assignment");
-    m_socket          = other.m_socket;
-    m_address_in      = other.m_address_in;
-    m_addr_info       = other.m_addr_info;
-    m_address         = std::move(other.m_address);
-    m_state           = other.m_state;
-    m_send_buffer     = std::move(other.m_send_buffer);
-    m_receive_buffer  = std::move(other.m_receive_buffer);
-    m_receive_handler = std::move(other.m_receive_handler);
-    other.m_socket    = INVALID_SOCKET;
-    other.m_state     = State::CLOSED;
-    other.m_addr_info = nullptr;
+    m_socket                = other.m_socket;
+    m_address_in            = other.m_address_in;
+    m_addr_info             = other.m_addr_info;
+    m_address               = std::move(other.m_address);
+    m_state                 = other.m_state;
+    m_send_buffer           = std::move(other.m_send_buffer);
+    m_receive_buffer        = std::move(other.m_receive_buffer);
+    m_receive_handler       = std::move(other.m_receive_handler);
+    m_send_queue            = std::move(other.m_send_queue);
+    m_send_queue_offset     = other.m_send_queue_offset;
+    m_send_queue_byte_count = other.m_send_queue_byte_count;
+    m_edge_triggered        = other.m_edge_triggered;
+    m_send_buffer_size      = other.m_send_buffer_size;
+    m_receive_buffer_size   = other.m_receive_buffer_size;
+    m_wrapped_packet        = std::move(other.m_wrapped_packet);
+    other.m_socket                = INVALID_SOCKET;
+    other.m_state                 = State::CLOSED;
+    other.m_addr_info             = nullptr;
+    other.m_send_queue_offset     = 0;
+    other.m_send_queue_byte_count = 0;
     return *this;
 }
 
+void Socket::set_buffer_sizes(const std::size_t send_byte_count, const std::size_t receive_byte_count)
+{
+    ERHE_VERIFY(send_byte_count > 0);
+    ERHE_VERIFY(receive_byte_count > sizeof(Packet_header));
+    m_send_buffer_size    = send_byte_count;
+    m_receive_buffer_size = receive_byte_count;
+}
+
 void Socket::close()
 {
     set_state(State::CLOSED);
@@ -121,6 +167,9 @@ void Socket::close()
     }
     m_send_buffer.reset();
     m_receive_buffer.reset();
+    m_send_queue.clear();
+    m_send_queue_offset     = 0;
+    m_send_queue_byte_count = 0;
     if (is_socket_good(m_socket)) {
         log_socket->info("Closing socket");
         shutdown   (m_socket, SD_BOTH);
@@ -226,22 +275,24 @@ auto Socket::bind(const char* const address, const int port) -> bool
         return false;
     }
 
-    const int backlog = 8;
+    // Many clients may connect between two polls
+    const int backlog = SOMAXCONN;
     const int listen_res = listen(m_socket, backlog);
     if (listen_res == SOCKET_ERROR) {
         log_socket->error("listen() failed with error {}", get_net_last_error_message());
         return false;
     }
 
-    m_send_buffer    = std::make_unique<Ring_buffer>(4 * 1024 * 1024);
-    m_receive_buffer = std::make_unique<Ring_buffer>(4 * 1024 * 1024);
+    m_send_buffer    = std::make_unique<Ring_buffer>(m_send_buffer_size);
+    m_receive_buffer = std::make_unique<Ring_buffer>(m_receive_buffer_size);
 
     log_socket->info("Listening at {} port {}", address, port);
     set_state(State::SERVER_LISTENING);
     return true;
 }
 
-// Attempts to send some or all of the data queued in send buffer.
+// Attempts to send some or all of the data queued in send buffer, and
+// then in send queue.
 // Returns true if no error, returns false in case of error.
 auto Socket::send_pending() -> bool
 {
@@ -252,7 +303,7 @@ auto Socket::send_pending() -> bool
     // wraps around, in which case two send() calls are needed.
     for (;;) {
         if (m_send_buffer->empty()) {
-            return true;
+            return send_queued_packets();
         }
 
         std::size_t          can_send_byte_count_before_wrap{0};
@@ -279,21 +330,75 @@ auto Socket::send_pending() -> bool
             return true;
         }
         m_send_buffer->end_consume(sent_byte_count);
-        if (
-            (sent_byte_count < can_send_byte_count_before_wrap) ||
-            (can_send_byte_count_after_wrap == 0)
-        ) {
+        if (sent_byte_count < can_send_byte_count_before_wrap) {
             break;
         }
     }
     return true;
 }
 
+// Sends packets from send queue, several packets with one call.
+// Returns true if no error, returns false in case of error.
+auto Socket::send_queued_packets() -> bool
+{
+    std::array<Send_span, send_queue_max_span_count> spans;
+    while (!m_send_queue.empty()) {
+        int         span_count = 0;
+        std::size_t byte_count = 0;
+        for (auto i = m_send_queue.begin(), end = m_send_queue.end(); (i != end) && (span_count < static_cast<int>(spans.size())); ++i) {
+            const std::vector<uint8_t>& packet = *i->get();
+            const std::size_t           offset = (span_count == 0) ? m_send_queue_offset : 0;
+            spans[span_count++] = Send_span{
+                .data       = packet.data() + offset,
+                .byte_count = packet.size() - offset
+            };
+            byte_count += packet.size() - offset;
+        }
+
+        const int64_t send_result = send_gather(m_socket, spans.data(), span_count);
+        if (send_result < 0) {
+            const int error_code = get_net_last_error();
+            if (is_error_fatal(error_code)) {
+                log_socket->error(
+                    "send_gather({} bytes) failed with error {}",
+                    byte_count,
+                    get_net_error_message(error_code)
+                );
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        std::size_t sent_byte_count = static_cast<std::size_t>(send_result);
+        m_send_queue_byte_count -= sent_byte_count;
+        while (sent_byte_count > 0) {
+            const std::size_t remaining_byte_count = m_send_queue.front()->size() - m_send_queue_offset;
+            if (sent_byte_count < remaining_byte_count) {
+                m_send_queue_offset += sent_byte_count;
+                break;
+            }
+            sent_byte_count -= remaining_byte_count;
+            m_send_queue.pop_front();
+            m_send_queue_offset = 0;
+        }
+        if (static_cast<std::size_t>(send_result) < byte_count) {
+            break; // Socket send buffer is full
+        }
+    }
+    return true;
+}
+
 // Sends a packet. Returns true if there was no error, false if there was an error.
 auto Socket::send(const char* const data, const int length) -> bool
 {
     ERHE_VERIFY(m_state == State::CONNECTED);
 
+    // Keep packet order when there are queued shared packets
+    if (!m_send_queue.empty()) {
+        return send(make_shared_packet(data, static_cast<std::size_t>(length)));
+    }
+
     // Check if new message fits to send buffer
     std::size_t can_write_count = m_send_buffer->size_available_for_write();
     if (can_write_count < sizeof(Packet_header) + length) {
@@ -324,7 +429,34 @@ auto Socket::send(const char* const data, const int length) -> bool
     return send_pending();
 }
 
-auto Socket::receive_packet_length() -> uint32_t
+// Queues a shared packet. Returns true if there was no error, false if there was an error.
+auto Socket::send(const Shared_packet& packet) -> bool
+{
+    if (m_state != State::CONNECTED) {
+        return false;
+    }
+    ERHE_VERIFY(packet);
+
+    if (m_send_queue_byte_count + packet->size() > send_queue_max_byte_count) {
+        // Does not fit? Try to flush queued data
+        const auto send_pending_result = send_pending();
+        if (!send_pending_result) {
+            return false;
+        }
+        if (m_send_queue_byte_count + packet->size() > send_queue_max_byte_count) {
+            log_socket->warn("message ({} bytes) does not fit to send queue ({} bytes queued)", packet->size(), m_send_queue_byte_count);
+            return false;
+        }
+    }
+
+    m_send_queue.push_back(packet);
+    m_send_queue_byte_count += packet->size();
+
+    // Try to send some or all of the queued data
+    return send_pending();
+}
+
+auto Socket::receive_packet_length() -> std::optional<uint32_t>
 {
     ERHE_VERIFY(m_state == State::CONNECTED);
 
@@ -334,7 +466,7 @@ auto Socket::receive_packet_length() -> uint32_t
         sizeof(Packet_header)
     );
     if (read_byte_count < sizeof(Packet_header)) {
-        return 0;
+        return {};
     }
     ERHE_VERIFY(header.magic == erhe_header_magic_u32);
     return header.length;
@@ -347,8 +479,12 @@ auto Socket::recv() -> bool
     ERHE_VERIFY(m_receive_buffer);
 
     for (;;) {
+        // Complete packets are consumed below, so full buffer can not make
+        // progress. With edge triggered notifications there would be no
+        // further notification either.
         if (m_receive_buffer->full()) {
-            log_socket->warn("receive buffer is full, unable to call recv()");
+            log_socket->error("receive buffer is full, closing connection");
+            close();
             return false;
         }
 
@@ -377,43 +513,53 @@ auto Socket::recv() -> bool
 
         // Process received packets
         for (;;) {
-            const uint32_t next_packet_length = receive_packet_length();
-            if (next_packet_length == 0) {
+            const std::optional<uint32_t> packet_length = receive_packet_length();
+            if (!packet_length.has_value()) {
                 break; // Header not received
             }
-            std::size_t    readable_byte_count_before_wrap{0};
-            std::size_t    readable_byte_count_after_wrap {0};
-            const uint8_t* read_pointer = m_receive_buffer->begin_consume(readable_byte_count_before_wrap, readable_byte_count_after_wrap);
-            std::size_t    readable_byte_count_total = readable_byte_count_before_wrap + readable_byte_count_after_wrap;
-            if (readable_byte_count_total < sizeof(Packet_header) + next_packet_length) {
-                m_receive_buffer->end_consume(0); // Packet not fully received
-                break;
+            const uint32_t next_packet_length = packet_length.value();
+            if (sizeof(Packet_header) + next_packet_length > m_receive_buffer->max_size()) {
+                log_socket->error(
+                    "packet ({} bytes) does not fit to receive buffer ({} bytes), closing connection",
+                    next_packet_length,
+                    m_receive_buffer->max_size()
+                );
+                close();
+                return false;
+            }
+            const std::size_t packet_byte_count = header_byte_count + next_packet_length;
+            if (m_receive_buffer->size_available_for_read() < packet_byte_count) {
+                break; // Packet not fully received
             }
 
             log_socket->trace("received message, length = {} bytes", next_packet_length);
 
-            // Ring buffer would wrap? Rotate so that it won't
-            if (readable_byte_count_before_wrap < sizeof(Packet_header) + next_packet_length) {
-                log_socket->trace("message ring buffer wrap - rotating ring buffer");
-                m_receive_buffer->end_consume(0);
-                m_receive_buffer->rotate();
-                readable_byte_count_before_wrap = 0;
-                readable_byte_count_after_wrap  = 0;
-                read_pointer = m_receive_buffer->begin_consume(readable_byte_count_before_wrap, readable_byte_count_after_wrap);
+            // Packet is read in place. Readable bytes are always contiguous
+            // with mirrored storage, otherwise packet which wraps is copied.
+            const std::span<const uint8_t> readable = m_receive_buffer->get_readable();
+            const uint8_t*                 packet   = readable.data();
+            if (readable.size() < packet_byte_count) {
+                m_wrapped_packet.resize(packet_byte_count);
+                m_receive_buffer->peek(m_wrapped_packet.data(), packet_byte_count);
+                packet = m_wrapped_packet.data();
             }
-            ERHE_VERIFY(readable_byte_count_before_wrap >= sizeof(Packet_header) + next_packet_length);
             if (m_receive_handler) {
-                log_socket->info("calling receive handler");
-                m_receive_handler(read_pointer + header_byte_count, next_packet_length);
+                log_socket->trace("calling receive handler");
+                m_receive_handler(packet + header_byte_count, next_packet_length);
             } else {
                 log_socket->warn("no receive handler set, message discarded");
             }
-            m_receive_buffer->end_consume(header_byte_count + next_packet_length);
+            m_receive_buffer->end_consume(packet_byte_count);
         }
 
+        // With edge triggered notifications, keep reading until recv()
+        // reports that it would block
         if (
-            (received_byte_count < can_receive_byte_count_before_wrap) ||
-            (can_receive_byte_count_after_wrap == 0)
+            !m_edge_triggered &&
+            (
+                (received_byte_count < can_receive_byte_count_before_wrap) ||
+                (can_receive_byte_count_after_wrap == 0)
+            )
         ) {
             break;
         }
@@ -421,6 +567,27 @@ auto Socket::recv() -> bool
     return true;
 }
 
+// Handles readiness notification. Returns false in case of error, true if ok
+auto Socket::on_readiness(const bool readable, const bool writable) -> bool
+{
+    if (m_state != State::CONNECTED) {
+        return false;
+    }
+    if (writable && has_pending_writes()) {
+        const bool send_ok = send_pending();
+        if (!send_ok) {
+            return false;
+        }
+    }
+    if (readable && (m_state == State::CONNECTED)) {
+        const bool recv_ok = recv();
+        if (!recv_ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void Socket::pre_select(Select_sockets& select_sockets)
 {
     switch (m_state) {
@@ -483,8 +650,8 @@ void Socket::on_state_changed(const State old_state, const State new_state)
 {
     log_socket->info("Socket state changed {} -> {}", c_str(old_state), c_str(new_state));
     if (new_state == State::CONNECTED) {
-        m_send_buffer    = std::make_unique<Ring_buffer>(4 * 1024 * 1024);
-        m_receive_buffer = std::make_unique<Ring_buffer>(4 * 1024 * 1024);
+        m_send_buffer    = std::make_unique<Ring_buffer>(m_send_buffer_size);
+        m_receive_buffer = std::make_unique<Ring_buffer>(m_receive_buffer_size);
     }
 }
 
@@ -569,24 +736,36 @@ auto Socket::post_select_listen(Select_sockets& select_sockets) -> std::optional
 {
     if (select_sockets.has_read(m_socket)) {
         log_socket->info("Server post_select_listen() has readable socket");
+        return accept().socket;
+    }
+    return {};
+}
 
-        sockaddr_in  address{};
-        socklen_t    len        = sizeof(address);
-        const SOCKET accept_res = ::accept(m_socket, reinterpret_cast<sockaddr*>(&address), &len);
-        if (!is_socket_good(accept_res)) {
-            const int error_code = get_net_last_error();
-            if (!is_error_busy(error_code)) {
-                log_socket->warn("Server accept() failed with error {}", get_net_error_message(error_code));
-                return {};
-            }
-        } else {
-            // TODO check if already added
-            // TODO set buffer sizes
-            log_socket->info("Server accept(): new connection");
-            return Socket{accept_res, address};
+// Accepts new connection for listening socket, if there is one
+auto Socket::accept() -> Accept_result
+{
+    ERHE_VERIFY(m_state == State::SERVER_LISTENING);
+
+    sockaddr_in  address{};
+    socklen_t    len        = sizeof(address);
+    const SOCKET accept_res = ::accept(m_socket, reinterpret_cast<sockaddr*>(&address), &len);
+    if (!is_socket_good(accept_res)) {
+        const int error_code = get_net_last_error();
+        if (is_error_busy(error_code)) {
+            return Accept_result{.status = Accept_result::Status::would_block};
         }
+        log_socket->warn("Server accept() failed with error {}", get_net_error_message(error_code));
+        return Accept_result{.status = Accept_result::Status::failed};
     }
-    return {};
+
+    log_socket->info("Server accept(): new connection");
+    Socket socket{accept_res, address, m_send_buffer_size, m_receive_buffer_size};
+    const bool non_block_ok = set_socket_option(accept_res, Socket_option::NonBlocking, true);
+    if (!non_block_ok) {
+        log_socket->warn("Server accept(): could not set non-blocking mode, closing connection");
+        return Accept_result{.status = Accept_result::Status::dropped}; // socket destructor closes connection
+    }
+    return Accept_result{.status = Accept_result::Status::accepted, .socket = std::move(socket)};
 }
 
 }
@@ -3,6 +3,7 @@
 #include "erhe_net/ring_buffer.hpp"
 #include "erhe_net/net_os.hpp"
 
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -14,6 +15,13 @@ namespace erhe::net
 
 using Receive_handler = std::function<void(const uint8_t* data, std::size_t length)>;
 
+// Complete packet (header and payload). Same packet can be queued to many
+// sockets without copying it.
+using Shared_packet = std::shared_ptr<const std::vector<uint8_t>>;
+
+[[nodiscard]] auto make_shared_packet(const char* data, std::size_t length) -> Shared_packet;
+
+class Accept_result;
 class Select_sockets;
 
 class Socket
@@ -26,10 +34,14 @@ public:
         CONNECTED         = 3
     };
 
+    static constexpr std::size_t default_buffer_size = 4 * 1024 * 1024;
+
     Socket();
     Socket(
         const SOCKET&      socket,
-        const sockaddr_in& address_in
+        const sockaddr_in& address_in,
+        std::size_t        send_buffer_size    = default_buffer_size,
+        std::size_t        receive_buffer_size = default_buffer_size
     );
     ~Socket();
     Socket(const Socket&) = delete;
@@ -42,13 +54,26 @@ public:
     auto get_socket          () const -> SOCKET                { return m_socket; }
     auto get_sockaddr_in     () const -> const sockaddr_in&    { return m_address_in; }
     auto get_address_string  () const -> const std::string&    { return m_address; }
-    auto get_send_buffer_size() const -> size_t                { return m_send_buffer ? m_send_buffer->size() : 0; }
+    auto get_send_buffer_size() const -> size_t                { return (m_send_buffer ? m_send_buffer->size() : 0) + m_send_queue_byte_count; }
     auto send                (const char* data, int length) -> bool;
+    auto send                (const Shared_packet& packet) -> bool;
     auto send_pending        () -> bool;
     auto recv                () -> bool;
     auto get_receive_buffer  () -> Ring_buffer* { return m_receive_buffer.get(); }
     void close               ();
-    auto has_pending_writes  () -> bool         { return m_send_buffer ? !m_send_buffer->empty() : false; }
+    auto has_pending_writes  () -> bool         { return (m_send_buffer ? !m_send_buffer->empty() : false) || !m_send_queue.empty(); }
+
+    // Capacities of send and receive ring buffers, which are created when
+    // socket gets connected. Accepted sockets use sizes of listening socket.
+    // Receive buffer must hold the largest packet, including its header;
+    // connection sending a larger packet is closed.
+    void set_buffer_sizes(std::size_t send_byte_count, std::size_t receive_byte_count);
+
+    // For edge triggered readiness notification: recv() reads until socket
+    // would block, instead of stopping at first partial read.
+    void set_edge_triggered(bool value)         { m_edge_triggered = value; }
+    auto on_readiness      (bool readable, bool writable) -> bool;
+    auto accept            () -> Accept_result;
 
     void pre_select           (Select_sockets& select_sockets);
     auto post_select_send_recv(Select_sockets& select_sockets) -> bool;
@@ -62,7 +87,8 @@ private:
     auto connect              () -> bool;
     void set_state            (State state);
     void on_state_changed     (State old_state, State new_state);
-    auto receive_packet_length() -> uint32_t;
+    auto receive_packet_length() -> std::optional<uint32_t>;
+    auto send_queued_packets  () -> bool;
 
     SOCKET                       m_socket    {INVALID_SOCKET};
     sockaddr_in                  m_address_in{};
@@ -72,6 +98,29 @@ private:
     std::unique_ptr<Ring_buffer> m_send_buffer;
     std::unique_ptr<Ring_buffer> m_receive_buffer;
     Receive_handler              m_receive_handler;
+
+    // Packets sent after send buffer, used for shared packets
+    std::deque<Shared_packet>    m_send_queue;
+    std::size_t                  m_send_queue_offset    {0}; // sent bytes of first packet
+    std::size_t                  m_send_queue_byte_count{0};
+    bool                         m_edge_triggered       {false};
+    std::size_t                  m_send_buffer_size     {default_buffer_size};
+    std::size_t                  m_receive_buffer_size  {default_buffer_size};
+    std::vector<uint8_t>         m_wrapped_packet; // only used without mirrored receive buffer
+};
+
+class Accept_result
+{
+public:
+    enum class Status : unsigned int {
+        accepted = 0,
+        would_block, // no pending connections
+        dropped,     // connection could not be set up and was closed, others may be pending
+        failed       // accept() failed
+    };
+
+    Status                status{Status::would_block};
+    std::optional<Socket> socket;
 };
 
 auto c_str(const Socket::State state) -> const char*;
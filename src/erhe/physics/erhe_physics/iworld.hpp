@@ -16,6 +16,14 @@ class IDebug_draw;
 class IRigid_body;
 class IRigid_body_create_info;
 
+class Body_transform
+{
+public:
+    IRigid_body* rigid_body;
+    void*        owner;           // IRigid_body::get_owner()
+    glm::mat4    world_from_body;
+};
+
 class IWorld
 {
 public:
@@ -53,6 +61,12 @@ public:
     virtual void set_on_body_activated  (std::function<void(IRigid_body*)> callback)     = 0;
     virtual void set_on_body_deactivated(std::function<void(IRigid_body*)> callback)     = 0;
     virtual void for_each_active_body   (std::function<void(IRigid_body*)> callback)     = 0;
+
+    // Replaces contents of out with world transforms of all active dynamic
+    // bodies. Bodies are read in a single pass, without calls through
+    // IRigid_body, so this is intended to be used once after simulation
+    // steps instead of for_each_active_body() and get_world_transform().
+    virtual void get_active_body_transforms(std::vector<Body_transform>& out)            = 0;
 };
 
 } // namespace erhe::physics
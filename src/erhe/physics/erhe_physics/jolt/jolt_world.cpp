@@ -5,11 +5,14 @@
 #include "erhe_physics/jolt/glm_conversions.hpp"
 #include "erhe_physics/idebug_draw.hpp"
 #include "erhe_physics/physics_log.hpp"
+#include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
 #include <Jolt/RegisterTypes.h>
 #include <Jolt/Core/Factory.h>
 #include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Physics/Body/BodyLock.h>
+#include <Jolt/Physics/Body/BodyLockMulti.h>
 
 #include <cstdarg>
 
@@ -417,6 +420,43 @@ void Jolt_world::for_each_active_body(std::function<void(IRigid_body*)> callback
     }
 }
 
+void Jolt_world::get_active_body_transforms(std::vector<Body_transform>& out)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    out.clear();
+    const JPH::BodyID* active_rigid_bodies     = m_physics_system.GetActiveBodiesUnsafe(JPH::EBodyType::RigidBody);
+    const JPH::uint32  active_rigid_body_count = m_physics_system.GetNumActiveBodies(JPH::EBodyType::RigidBody);
+    if (active_rigid_body_count == 0) {
+        return;
+    }
+    out.reserve(active_rigid_body_count);
+
+    // Locks body mutexes once for all active bodies
+    JPH::BodyLockMultiRead lock{
+        m_physics_system.GetBodyLockInterface(),
+        active_rigid_bodies,
+        static_cast<int>(active_rigid_body_count)
+    };
+    for (JPH::uint32 i = 0; i < active_rigid_body_count; ++i) {
+        const JPH::Body* body = lock.GetBody(static_cast<int>(i));
+        if ((body == nullptr) || (body->GetMotionType() != JPH::EMotionType::Dynamic)) {
+            continue;
+        }
+        Jolt_rigid_body* jolt_rigid_body = reinterpret_cast<Jolt_rigid_body*>(body->GetUserData());
+        if (jolt_rigid_body == nullptr) {
+            continue;
+        }
+        out.push_back(
+            Body_transform{
+                .rigid_body      = jolt_rigid_body,
+                .owner           = jolt_rigid_body->get_owner(),
+                .world_from_body = from_jolt(body->GetWorldTransform())
+            }
+        );
+    }
+}
+
 void Jolt_world::OnBodyActivated(
     const JPH::BodyID& inBodyID,
     JPH::uint64        inBodyUserData
@@ -88,6 +88,7 @@ public:
     void set_on_body_activated  (std::function<void(IRigid_body*)> callback) override;
     void set_on_body_deactivated(std::function<void(IRigid_body*)> callback) override;
     void for_each_active_body   (std::function<void(IRigid_body*)> callback) override;
+    void get_active_body_transforms(std::vector<Body_transform>& out)         override;
 
     // Implements BodyActivationListener
     void OnBodyActivated  (const JPH::BodyID& inBodyID, JPH::uint64 inBodyUserData) override;
@@ -4,6 +4,9 @@
 
 #include <glm/glm.hpp>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::graphics {
     class Vertex_attribute_mappings;
 }
@@ -30,6 +33,8 @@ public:
     Normal_style                               normal_style             {Normal_style::corner_normals};
     erhe::graphics::Vertex_attribute_mappings* vertex_attribute_mappings{nullptr};
     bool                                       autocolor                {false};
+    erhe::concurrency::Thread_pool*            thread_pool              {nullptr}; // Optional, used for derived attributes
+    erhe::concurrency::Thread_pool*            background_thread_pool   {nullptr}; // Optional, used for high quality BVH builds. Nothing may wait for it
 };
 
 } // namespace erhe::primitive
@@ -44,11 +44,68 @@ auto c_str(const Normal_style normal_style) -> const char*
 Geometry_raytrace::Geometry_raytrace() = default;
 
 Geometry_raytrace::Geometry_raytrace(
-    erhe::geometry::Geometry& geometry
+    erhe::geometry::Geometry&             geometry,
+    erhe::concurrency::Thread_pool* const background_thread_pool
 )
 {
     ERHE_PROFILE_FUNCTION();
 
+    rt_geometry = erhe::raytrace::IGeometry::create_unique(
+        geometry.name + "_triangle_geometry",
+        erhe::raytrace::Geometry_type::GEOMETRY_TYPE_TRIANGLE
+    );
+    rt_geometry->set_thread_pool(background_thread_pool);
+    make_buffers(geometry);
+    //SPDLOG_LOGGER_TRACE(log_raytrace, "{}:", m_source_geometry->name);
+
+    {
+        ERHE_PROFILE_SCOPE("geometry commit");
+        rt_geometry->commit();
+    }
+
+    ////{
+    ////    ERHE_PROFILE_SCOPE("create scene");
+    ////    primitive.rt_scene = erhe::raytrace::IScene::create_unique(
+    ////        geometry.name + "_scene"
+    ////    );
+    ////}
+    ////
+    ////primitive.rt_scene->attach(primitive.rt_geometry.get());
+    ////
+    ////primitive.rt_instance = erhe::raytrace::IInstance::create_unique(
+    ////    geometry.name + "_instance_geometry"
+    ////);
+    ////
+    ////primitive.rt_instance->set_scene(primitive.rt_scene.get());
+    ////primitive.rt_instance->commit();
+    ////primitive.rt_instance->set_user_data(this);
+    ////
+    ////const bool visible = is_visible();
+    ////if (visible) {
+    ////    m_instance->enable();
+    ////} else {
+    ////    m_instance->disable();
+    ////}
+}
+
+void Geometry_raytrace::update(erhe::geometry::Geometry& geometry)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(rt_geometry);
+    const std::size_t old_triangle_count = rt_geometry_mesh.index_buffer_range.count / 3;
+    const std::size_t new_triangle_count = make_buffers(geometry);
+    if (new_triangle_count == old_triangle_count) {
+        ERHE_PROFILE_SCOPE("geometry refit");
+        rt_geometry->refit();
+    } else {
+        ERHE_PROFILE_SCOPE("geometry commit");
+        rt_geometry->commit();
+    }
+}
+
+auto Geometry_raytrace::make_buffers(erhe::geometry::Geometry& geometry) -> std::size_t
+{
     const erhe::graphics::Vertex_format vertex_format{
         erhe::graphics::Vertex_attribute::position_float3()
     };
@@ -82,10 +139,6 @@ Geometry_raytrace::Geometry_raytrace(
         erhe::primitive::Normal_style::none
     );
 
-    rt_geometry = erhe::raytrace::IGeometry::create_unique(
-        geometry.name + "_triangle_geometry",
-        erhe::raytrace::Geometry_type::GEOMETRY_TYPE_TRIANGLE
-    );
     rt_geometry->set_user_data(&geometry);
 
     const auto& vertex_buffer_range   = rt_geometry_mesh.vertex_buffer_range;
@@ -116,36 +169,7 @@ Geometry_raytrace::Geometry_raytrace(
         triangle_size,
         triangle_count
     );
-    //SPDLOG_LOGGER_TRACE(log_raytrace, "{}:", m_source_geometry->name);
-
-    {
-        ERHE_PROFILE_SCOPE("geometry commit");
-        rt_geometry->commit();
-    }
-
-    ////{
-    ////    ERHE_PROFILE_SCOPE("create scene");
-    ////    primitive.rt_scene = erhe::raytrace::IScene::create_unique(
-    ////        geometry.name + "_scene"
-    ////    );
-    ////}
-    ////
-    ////primitive.rt_scene->attach(primitive.rt_geometry.get());
-    ////
-    ////primitive.rt_instance = erhe::raytrace::IInstance::create_unique(
-    ////    geometry.name + "_instance_geometry"
-    ////);
-    ////
-    ////primitive.rt_instance->set_scene(primitive.rt_scene.get());
-    ////primitive.rt_instance->commit();
-    ////primitive.rt_instance->set_user_data(this);
-    ////
-    ////const bool visible = is_visible();
-    ////if (visible) {
-    ////    m_instance->enable();
-    ////} else {
-    ////    m_instance->disable();
-    ////}
+    return triangle_count;
 }
 
 Geometry_raytrace& Geometry_raytrace::operator=(Geometry_raytrace&& other) = default;
@@ -201,7 +225,11 @@ void Geometry_primitive::build_from_geometry(
 {
     normal_style     = normal_style_in;
     gl_geometry_mesh = make_geometry_mesh(*source_geometry.get(), build_info, normal_style);
-    raytrace         = Geometry_raytrace{*source_geometry.get()};
+    if (raytrace.rt_geometry) {
+        raytrace.update(*source_geometry.get());
+    } else {
+        raytrace = Geometry_raytrace{*source_geometry.get(), build_info.background_thread_pool};
+    }
 }
 
 
@@ -6,6 +6,9 @@
 #include <memory>
 #include <optional>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::geometry {
     class Geometry;
 }
@@ -24,14 +27,24 @@ class Geometry_raytrace
 {
 public:
     Geometry_raytrace();
-    explicit Geometry_raytrace(erhe::geometry::Geometry& geometry);
+    explicit Geometry_raytrace(
+        erhe::geometry::Geometry&       geometry,
+        erhe::concurrency::Thread_pool* background_thread_pool = nullptr
+    );
     ~Geometry_raytrace() noexcept;
     Geometry_raytrace& operator=(Geometry_raytrace&& other);
 
+    // Rebuilds buffers from geometry. When triangle count is unchanged,
+    // acceleration structure is refitted instead of built from scratch.
+    void update(erhe::geometry::Geometry& geometry);
+
     Geometry_mesh                              rt_geometry_mesh;
     std::shared_ptr<erhe::raytrace::IBuffer>   rt_vertex_buffer{};
     std::shared_ptr<erhe::raytrace::IBuffer>   rt_index_buffer {};
     std::unique_ptr<erhe::raytrace::IGeometry> rt_geometry     {};
+
+private:
+    auto make_buffers(erhe::geometry::Geometry& geometry) -> std::size_t;
 };
 
 class Geometry_primitive
@@ -304,7 +304,7 @@ Build_context::Build_context(
     , normal_style {normal_style}
     , vertex_writer{*this, build_info.buffer_info.buffer_sink}
     , index_writer {*this, build_info.buffer_info.buffer_sink}
-    , property_maps{geometry, build_info.primitive_types, build_info.buffer_info.vertex_format}
+    , property_maps{geometry, build_info.primitive_types, build_info.buffer_info.vertex_format, build_info.thread_pool}
 {
     Expects(property_maps.point_locations != nullptr);
 
@@ -14,7 +14,8 @@ using uvec4 = glm::uvec4;
 Property_maps::Property_maps(
     const erhe::geometry::Geometry&      geometry,
     const Primitive_types&               primitive_types,
-    const erhe::graphics::Vertex_format& vertex_format 
+    const erhe::graphics::Vertex_format& vertex_format,
+    erhe::concurrency::Thread_pool*      thread_pool
 )
 {
     ERHE_PROFILE_FUNCTION();
@@ -70,14 +71,7 @@ Property_maps::Property_maps(
             polygon_normals = polygon_attributes.create<vec3>(erhe::geometry::c_polygon_normals);
         }
         if (!geometry.has_polygon_normals()) {
-            geometry.for_each_polygon_const(
-                [this, &geometry](auto& i)
-                {
-                    if (!polygon_normals->has(i.polygon_id)) {
-                        i.polygon.compute_normal(i.polygon_id, geometry, *polygon_normals, *point_locations);
-                    }
-                }
-            );
+            geometry.compute_polygon_normals(*polygon_normals, *point_locations, true, thread_pool);
         }
         if ((corner_normals == nullptr) && (point_normals == nullptr) && (point_normals_smooth == nullptr)) {
             corner_normals = corner_attributes.create<vec3>(erhe::geometry::c_corner_normals);
@@ -117,13 +111,7 @@ Property_maps::Property_maps(
             polygon_centroids = polygon_attributes.create<vec3>(erhe::geometry::c_polygon_centroids);
         }
         if (!geometry.has_polygon_centroids()) {
-            geometry.for_each_polygon_const(
-                [this, &geometry](auto& i) {
-                    if (!polygon_centroids->has(i.polygon_id)) {
-                        i.polygon.compute_centroid(i.polygon_id, geometry, *polygon_centroids, *point_locations);
-                    }
-                }
-            );
+            geometry.compute_polygon_centroids(*polygon_centroids, *point_locations, true, thread_pool);
         }
     }
 #endif
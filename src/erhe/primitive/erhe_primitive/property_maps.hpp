@@ -27,7 +27,8 @@ public:
     Property_maps(
         const erhe::geometry::Geometry&      geometry,
         const Primitive_types&               primitive_types,
-        const erhe::graphics::Vertex_format& vertex_format 
+        const erhe::graphics::Vertex_format& vertex_format,
+        erhe::concurrency::Thread_pool*      thread_pool = nullptr
     );
 
     template <typename Key_type, typename Value_type>
@@ -0,0 +1,380 @@
+#if defined(_MSC_VER)
+#   pragma warning(push)
+#   pragma warning(disable : 4702) // unreachable code
+#   pragma warning(disable : 4714) // marked as __forceinline not inlined
+#endif
+
+#include "erhe_raytrace/bvh/bvh_cache.hpp"
+#include "erhe_raytrace/raytrace_log.hpp"
+
+#include "erhe_configuration/configuration.hpp"
+#include "erhe_file/file.hpp"
+#include "erhe_file/mapped_file.hpp"
+#include "erhe_profile/profile.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace erhe::raytrace
+{
+
+namespace {
+
+static_assert(std::is_trivially_copyable_v<Bvh_node>);
+static_assert(std::is_trivially_copyable_v<Bvh_precomputed_tri>);
+
+constexpr char        c_magic[8]  = {'E', 'R', 'H', 'E', 'B', 'V', 'H', '\0'};
+constexpr uint32_t    c_version   = 1;
+constexpr uint32_t    c_endian    = 0x01020304u;
+constexpr std::size_t c_alignment = 64;
+
+// File layout: header, followed by node, primitive id and precomputed
+// triangle arrays, each aligned to c_alignment bytes from start of file.
+class File_header
+{
+public:
+    char     magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t key;
+    uint32_t header_size;
+    uint32_t node_size;
+    uint32_t primitive_id_size;
+    uint32_t triangle_size;
+    float    bounds_min[3];
+    float    bounds_max[3];
+    uint64_t node_offset;
+    uint64_t node_count;
+    uint64_t primitive_id_offset;
+    uint64_t primitive_id_count;
+    uint64_t triangle_offset;
+    uint64_t triangle_count;
+    uint64_t file_size;
+};
+static_assert(std::is_trivially_copyable_v<File_header>);
+
+class Bvh_cache_config
+{
+public:
+    Bvh_cache_config()
+    {
+        auto ini = erhe::configuration::get_ini("erhe.ini", "raytrace");
+        std::string path_string{"cache/bvh"};
+        ini->get("bvh_cache",          enabled);
+        ini->get("bvh_cache_path",     path_string);
+        ini->get("bvh_cache_max_size", max_size_megabytes);
+        path = erhe::file::from_string(path_string);
+    }
+
+    bool                  enabled           {true};
+    std::filesystem::path path;
+    std::size_t           max_size_megabytes{1024};
+};
+
+auto get_config() -> const Bvh_cache_config&
+{
+    static const Bvh_cache_config config;
+    return config;
+}
+
+std::atomic<uint64_t> s_hit_count  {0};
+std::atomic<uint64_t> s_miss_count {0};
+std::atomic<uint64_t> s_store_count{0};
+std::atomic<uint64_t> s_evict_count{0};
+std::mutex            s_store_mutex;
+
+[[nodiscard]] auto get_entry_path(const uint64_t key) -> std::filesystem::path
+{
+    return get_config().path / fmt::format("{:016x}.bvh", key);
+}
+
+[[nodiscard]] auto align_up(const uint64_t offset) -> uint64_t
+{
+    return (offset + c_alignment - 1) & ~static_cast<uint64_t>(c_alignment - 1);
+}
+
+// Checks that count elements of element_size at offset are inside file
+[[nodiscard]] auto is_valid_range(
+    const uint64_t offset,
+    const uint64_t count,
+    const uint64_t element_size,
+    const uint64_t file_size
+) -> bool
+{
+    if ((offset % c_alignment) != 0) {
+        return false;
+    }
+    if (offset > file_size) {
+        return false;
+    }
+    return count <= (file_size - offset) / element_size;
+}
+
+[[nodiscard]] auto is_valid_header(const File_header& header, const uint64_t key, const uint64_t file_size) -> bool
+{
+    return
+        (std::memcmp(header.magic, c_magic, sizeof(c_magic)) == 0) &&
+        (header.version           == c_version) &&
+        (header.endian            == c_endian) &&
+        (header.key               == key) &&
+        (header.header_size       == sizeof(File_header)) &&
+        (header.node_size         == sizeof(Bvh_node)) &&
+        (header.primitive_id_size == sizeof(std::size_t)) &&
+        (header.triangle_size     == sizeof(Bvh_precomputed_tri)) &&
+        (header.file_size         == file_size) &&
+        (header.node_count        > 0) &&
+        (header.triangle_count    == header.primitive_id_count) &&
+        is_valid_range(header.node_offset,         header.node_count,         sizeof(Bvh_node),            file_size) &&
+        is_valid_range(header.primitive_id_offset, header.primitive_id_count, sizeof(std::size_t),         file_size) &&
+        is_valid_range(header.triangle_offset,     header.triangle_count,     sizeof(Bvh_precomputed_tri), file_size);
+}
+
+void write_padding(std::ofstream& out, const uint64_t offset)
+{
+    static constexpr char zeros[c_alignment] = {};
+    const uint64_t padding = align_up(offset) - offset;
+    out.write(zeros, static_cast<std::streamsize>(padding));
+}
+
+// Removes least recently used entries until total size is within limit.
+// Loaded entries are touched on load, so write time tracks last use.
+void evict()
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const Bvh_cache_config& config    = get_config();
+    const uint64_t          max_bytes = static_cast<uint64_t>(config.max_size_megabytes) * 1024 * 1024;
+
+    class File_entry
+    {
+    public:
+        std::filesystem::path           path;
+        uint64_t                        size;
+        std::filesystem::file_time_type time;
+    };
+    std::vector<File_entry> files;
+    uint64_t                total_size{0};
+
+    std::error_code error_code;
+    for (const auto& directory_entry : std::filesystem::directory_iterator{config.path, error_code}) {
+        std::error_code entry_error_code;
+        if (!directory_entry.is_regular_file(entry_error_code)) {
+            continue;
+        }
+        if (directory_entry.path().extension() == ".tmp") {
+            continue;
+        }
+        const uint64_t size = directory_entry.file_size(entry_error_code);
+        if (entry_error_code) {
+            continue;
+        }
+        const auto time = directory_entry.last_write_time(entry_error_code);
+        if (entry_error_code) {
+            continue;
+        }
+        files.push_back(File_entry{directory_entry.path(), size, time});
+        total_size += size;
+    }
+    if (total_size <= max_bytes) {
+        return;
+    }
+
+    std::sort(
+        files.begin(),
+        files.end(),
+        [](const File_entry& lhs, const File_entry& rhs) { return lhs.time < rhs.time; }
+    );
+    for (const File_entry& file : files) {
+        if (total_size <= max_bytes) {
+            break;
+        }
+        std::error_code remove_error_code;
+        // Removal fails on some platforms if file is currently mapped; it is retried on next eviction
+        if (std::filesystem::remove(file.path, remove_error_code)) {
+            total_size -= file.size;
+            ++s_evict_count;
+            log_geometry->debug("BVH cache evicted {} ({} bytes)", erhe::file::to_string(file.path), file.size);
+        }
+    }
+}
+
+} // anonymous namespace
+
+auto bvh_cache_is_enabled() -> bool
+{
+    return get_config().enabled;
+}
+
+auto bvh_cache_load(const uint64_t key) -> std::optional<Bvh_cache_entry>
+{
+    ERHE_PROFILE_FUNCTION();
+
+    if (!bvh_cache_is_enabled()) {
+        return {};
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto path       = get_entry_path(key);
+
+    std::error_code error_code;
+    if (!std::filesystem::is_regular_file(path, error_code)) {
+        ++s_miss_count;
+        log_geometry->debug("BVH cache miss {:016x}", key);
+        return {};
+    }
+
+    // Update write time for least recently used eviction
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error_code);
+
+    auto mapping = std::make_shared<erhe::file::Mapped_file>("BVH cache", path);
+    File_header header{};
+    bool is_valid = mapping->is_open() && (mapping->size() >= sizeof(File_header));
+    if (is_valid) {
+        std::memcpy(&header, mapping->data(), sizeof(File_header));
+        is_valid = is_valid_header(header, key, mapping->size());
+    }
+    if (!is_valid) {
+        ++s_miss_count;
+        log_geometry->warn("BVH cache entry {} is invalid or from different version, removing", erhe::file::to_string(path));
+        mapping.reset();
+        std::filesystem::remove(path, error_code);
+        return {};
+    }
+
+    const std::byte* data = mapping->data();
+    Bvh_cache_entry entry{
+        .mapping       = mapping,
+        .bounds        = Aabb{
+            glm::vec3{header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]},
+            glm::vec3{header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]}
+        },
+        .nodes         = std::span<const Bvh_node>{
+            reinterpret_cast<const Bvh_node*>(data + header.node_offset),
+            static_cast<std::size_t>(header.node_count)
+        },
+        .primitive_ids = std::span<const std::size_t>{
+            reinterpret_cast<const std::size_t*>(data + header.primitive_id_offset),
+            static_cast<std::size_t>(header.primitive_id_count)
+        },
+        .triangles     = std::span<const Bvh_precomputed_tri>{
+            reinterpret_cast<const Bvh_precomputed_tri*>(data + header.triangle_offset),
+            static_cast<std::size_t>(header.triangle_count)
+        }
+    };
+
+    ++s_hit_count;
+    const auto duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time);
+    log_geometry->debug(
+        "BVH cache hit {:016x}: {} nodes, {} triangles, {} bytes mapped in {:.3f} ms",
+        key, entry.nodes.size(), entry.triangles.size(), mapping->size(), duration.count()
+    );
+    return entry;
+}
+
+auto bvh_cache_store(
+    const uint64_t                             key,
+    const Aabb&                                bounds,
+    const std::span<const Bvh_node>            nodes,
+    const std::span<const std::size_t>         primitive_ids,
+    const std::span<const Bvh_precomputed_tri> triangles
+) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    if (!bvh_cache_is_enabled()) {
+        return false;
+    }
+
+    File_header header{};
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.version             = c_version;
+    header.endian              = c_endian;
+    header.key                 = key;
+    header.header_size         = sizeof(File_header);
+    header.node_size           = sizeof(Bvh_node);
+    header.primitive_id_size   = sizeof(std::size_t);
+    header.triangle_size       = sizeof(Bvh_precomputed_tri);
+    header.bounds_min[0]       = bounds.min.x;
+    header.bounds_min[1]       = bounds.min.y;
+    header.bounds_min[2]       = bounds.min.z;
+    header.bounds_max[0]       = bounds.max.x;
+    header.bounds_max[1]       = bounds.max.y;
+    header.bounds_max[2]       = bounds.max.z;
+    header.node_offset         = align_up(sizeof(File_header));
+    header.node_count          = nodes.size();
+    header.primitive_id_offset = align_up(header.node_offset + nodes.size_bytes());
+    header.primitive_id_count  = primitive_ids.size();
+    header.triangle_offset     = align_up(header.primitive_id_offset + primitive_ids.size_bytes());
+    header.triangle_count      = triangles.size();
+    header.file_size           = header.triangle_offset + triangles.size_bytes();
+
+    const std::lock_guard<std::mutex> lock{s_store_mutex};
+
+    const Bvh_cache_config& config = get_config();
+    std::error_code error_code;
+    std::filesystem::create_directories(config.path, error_code);
+
+    const auto path      = get_entry_path(key);
+    auto       temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out{temp_path, std::ofstream::binary | std::ofstream::trunc};
+        if (!out) {
+            log_geometry->warn("BVH cache could not create {}", erhe::file::to_string(temp_path));
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(File_header));
+        write_padding(out, sizeof(File_header));
+        out.write(reinterpret_cast<const char*>(nodes.data()), static_cast<std::streamsize>(nodes.size_bytes()));
+        write_padding(out, header.node_offset + nodes.size_bytes());
+        out.write(reinterpret_cast<const char*>(primitive_ids.data()), static_cast<std::streamsize>(primitive_ids.size_bytes()));
+        write_padding(out, header.primitive_id_offset + primitive_ids.size_bytes());
+        out.write(reinterpret_cast<const char*>(triangles.data()), static_cast<std::streamsize>(triangles.size_bytes()));
+        if (!out) {
+            log_geometry->warn("BVH cache write failed for {}", erhe::file::to_string(temp_path));
+            out.close();
+            std::filesystem::remove(temp_path, error_code);
+            return false;
+        }
+    }
+
+    // Entry becomes visible only when complete
+    std::filesystem::rename(temp_path, path, error_code);
+    if (error_code) {
+        log_geometry->warn("BVH cache could not rename {}: {}", erhe::file::to_string(temp_path), error_code.message());
+        std::filesystem::remove(temp_path, error_code);
+        return false;
+    }
+
+    ++s_store_count;
+    log_geometry->debug("BVH cache stored {:016x}: {} bytes", key, header.file_size);
+
+    evict();
+    return true;
+}
+
+auto get_bvh_cache_statistics() -> Bvh_cache_statistics
+{
+    return Bvh_cache_statistics{
+        .hit_count   = s_hit_count  .load(),
+        .miss_count  = s_miss_count .load(),
+        .store_count = s_store_count.load(),
+        .evict_count = s_evict_count.load()
+    };
+}
+
+} // namespace erhe::raytrace
+
+#if defined(_MSC_VER)
+#   pragma warning(pop)
+#endif
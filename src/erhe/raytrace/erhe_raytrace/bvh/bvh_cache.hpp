@@ -0,0 +1,75 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#   pragma warning(push)
+#   pragma warning(disable : 4702) // unreachable code
+#   pragma warning(disable : 4714) // marked as __forceinline not inlined
+#endif
+
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
+
+#include <bvh/v2/bvh.h>
+#include <bvh/v2/tri.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace erhe::file
+{
+    class Mapped_file;
+}
+
+namespace erhe::raytrace
+{
+
+using Bvh_node            = bvh::v2::Node<float, 3>;
+using Bvh_precomputed_tri = bvh::v2::PrecomputedTri<float>;
+
+// Cache entry loaded from disk. Arrays point directly into memory mapped
+// cache file, which is kept alive by mapping.
+class Bvh_cache_entry
+{
+public:
+    std::shared_ptr<erhe::file::Mapped_file> mapping;
+    Aabb                                     bounds;
+    std::span<const Bvh_node>                nodes;
+    std::span<const std::size_t>             primitive_ids;
+    std::span<const Bvh_precomputed_tri>     triangles;
+};
+
+class Bvh_cache_statistics
+{
+public:
+    uint64_t hit_count  {0};
+    uint64_t miss_count {0};
+    uint64_t store_count{0};
+    uint64_t evict_count{0};
+};
+
+// Persistent cache of built BVHs, keyed by content hash. Each entry is one
+// versioned file which is memory mapped on load. Total cache size is
+// limited; least recently used entries are evicted when an entry is stored.
+// Configured in erhe.ini section [raytrace]: bvh_cache (enable),
+// bvh_cache_path and bvh_cache_max_size (megabytes).
+[[nodiscard]] auto bvh_cache_is_enabled() -> bool;
+
+[[nodiscard]] auto bvh_cache_load(uint64_t key) -> std::optional<Bvh_cache_entry>;
+
+auto bvh_cache_store(
+    uint64_t                             key,
+    const Aabb&                          bounds,
+    std::span<const Bvh_node>            nodes,
+    std::span<const std::size_t>         primitive_ids,
+    std::span<const Bvh_precomputed_tri> triangles
+) -> bool;
+
+[[nodiscard]] auto get_bvh_cache_statistics() -> Bvh_cache_statistics;
+
+} // namespace erhe::raytrace
+
+#if defined(_MSC_VER)
+#   pragma warning(pop)
+#endif
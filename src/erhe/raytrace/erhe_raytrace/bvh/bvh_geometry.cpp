@@ -7,15 +7,20 @@
 #include <fmt/chrono.h>
 
 #include "erhe_raytrace/bvh/bvh_geometry.hpp"
+#include "erhe_raytrace/bvh/bvh_cache.hpp"
 #include "erhe_raytrace/bvh/bvh_instance.hpp"
 #include "erhe_raytrace/bvh/glm_conversions.hpp"
 #include "erhe_raytrace/ibuffer.hpp"
 #include "erhe_raytrace/raytrace_log.hpp"
 #include "erhe_raytrace/ray.hpp"
 
-#include "erhe_hash/hash.hpp"
+#include "erhe_concurrency/thread_pool.hpp"
+#include "erhe_configuration/configuration.hpp"
+#include "erhe_file/mapped_file.hpp"
+#include "erhe_hash/xxh64.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_time/timer.hpp"
+#include "erhe_verify/verify.hpp"
 
 #include <bvh/v2/bvh.h>
 #include <bvh/v2/default_builder.h>
@@ -25,46 +30,13 @@
 #include <bvh/v2/stack.h>
 #include <bvh/v2/thread_pool.h>
 
-#include <fstream>
+#include <atomic>
+#include <cstring>
+#include <optional>
 
 namespace erhe::raytrace
 {
 
-using Bvh = bvh::v2::Bvh<bvh::v2::Node<float, 3>>;
-
-auto save_bvh(const Bvh& bvh, const uint64_t hash_code) -> bool
-{
-    std::string file_name = fmt::format("cache/bvh/{}", hash_code);
-    std::ofstream out{file_name, std::ofstream::binary};
-    if (!out) {
-        return false;
-    }
-
-    try {
-        bvh::v2::StdOutputStream stream{out};
-        bvh.serialize(stream);
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
-
-auto load_bvh(Bvh& bvh, const uint64_t hash_code) -> bool
-{
-    std::string file_name = fmt::format("cache/bvh/{}", hash_code);
-    std::ifstream in{file_name, std::ofstream::binary};
-    if (!in) {
-        return false;
-    }
-    try {
-        bvh::v2::StdInputStream stream{in};
-        bvh = Bvh::deserialize(stream);
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
-
 auto IGeometry::create(
     const std::string_view debug_label,
     const Geometry_type    geometry_type
@@ -110,144 +82,407 @@ using PrecomputedTri = bvh::v2::PrecomputedTri<Scalar>;
 
 static constexpr bool should_permute = false; //// TODO
 
-// TODO Are these ok here?
-bvh::v2::ThreadPool thread_pool;
-bvh::v2::ParallelExecutor executor{thread_pool};
+// Bump when BVH build settings change, so old cache entries are not used
+static constexpr uint64_t c_bvh_cache_key_version = 2;
 
-void Bvh_geometry::commit()
+namespace {
+
+class Build_input
+{
+public:
+    std::vector<Tri>  triangles;
+    std::vector<BBox> bboxes;
+    std::vector<Vec3> centers;
+};
+
+// Used for foreground (low quality) builds
+auto get_bvh_thread_pool() -> bvh::v2::ThreadPool&
+{
+    static bvh::v2::ThreadPool thread_pool;
+    return thread_pool;
+}
+
+auto is_background_rebuild_enabled() -> bool
+{
+    static const bool enabled = []() {
+        bool value{true};
+        auto ini = erhe::configuration::get_ini("erhe.ini", "raytrace");
+        ini->get("bvh_background_rebuild", value);
+        return value;
+    }();
+    return enabled;
+}
+
+[[nodiscard]] auto c_str(const Bvh_quality quality) -> const char*
+{
+    switch (quality) {
+        //using enum Bvh_quality;
+        case Bvh_quality::low:  return "low";
+        case Bvh_quality::high: return "high";
+        default:                return "?";
+    }
+}
+
+[[nodiscard]] auto get_cache_key(const uint64_t content_hash, const Bvh_quality quality) -> uint64_t
+{
+    const uint64_t quality_value = static_cast<uint64_t>(quality);
+    return erhe::hash::xxh64(&quality_value, sizeof(quality_value), content_hash);
+}
+
+[[nodiscard]] auto make_acceleration(Bvh_cache_entry&& entry, const Bvh_quality quality) -> Bvh_acceleration
+{
+    // Nodes are copied because bvh::v2::Bvh owns its node array;
+    // primitive ids and triangles are used directly from the mapping.
+    Bvh_acceleration acceleration;
+    acceleration.quality = quality;
+    acceleration.bvh.nodes.assign(entry.nodes.begin(), entry.nodes.end());
+    acceleration.primitive_ids = entry.primitive_ids;
+    acceleration.triangles     = entry.triangles;
+    acceleration.cache_mapping = std::move(entry.mapping);
+    return acceleration;
+}
+
+// Uses thread pool for build and precompute if given, else runs single threaded
+[[nodiscard]] auto build_acceleration(
+    const Build_input&         input,
+    const Bvh_quality          quality,
+    bvh::v2::ThreadPool* const thread_pool
+) -> Bvh_acceleration
 {
     ERHE_PROFILE_FUNCTION();
 
+    typename bvh::v2::DefaultBuilder<Node>::Config config;
+    config.quality = (quality == Bvh_quality::high)
+        ? bvh::v2::DefaultBuilder<Node>::Quality::High
+        : bvh::v2::DefaultBuilder<Node>::Quality::Low;
+
+    Bvh_acceleration acceleration;
+    acceleration.quality = quality;
     {
-        const Buffer_info* index_buffer_info{nullptr};
-        const Buffer_info* vertex_buffer_info{nullptr};
-        for (const auto& buffer : m_buffer_infos) {
-            if (buffer.type == erhe::raytrace::Buffer_type::BUFFER_TYPE_INDEX) {
-                index_buffer_info = &buffer;
-                continue;
-            }
-            if (buffer.type == erhe::raytrace::Buffer_type::BUFFER_TYPE_VERTEX) {
-                vertex_buffer_info = &buffer;
-                continue;
+        ERHE_PROFILE_SCOPE("bvh build");
+        acceleration.bvh = (thread_pool != nullptr)
+            ? bvh::v2::DefaultBuilder<Node>::build(*thread_pool, input.bboxes, input.centers, config)
+            : bvh::v2::DefaultBuilder<Node>::build(input.bboxes, input.centers, config);
+    }
+
+    // This precomputes some data to speed up traversal further.
+    {
+        ERHE_PROFILE_SCOPE("bvh precompute");
+        acceleration.precomputed_triangles.resize(input.triangles.size());
+        const auto precompute = [&] (const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                auto j = should_permute ? acceleration.bvh.prim_ids[i] : i;
+                acceleration.precomputed_triangles[i] = input.triangles[j];
             }
+        };
+        if (thread_pool != nullptr) {
+            bvh::v2::ParallelExecutor executor{*thread_pool};
+            executor.for_each(0, input.triangles.size(), precompute);
+        } else {
+            precompute(0, input.triangles.size());
         }
-        if (
-            (index_buffer_info == nullptr) ||
-            (vertex_buffer_info == nullptr)
-        ) {
-            return;
-        }
+    }
+    acceleration.primitive_ids = acceleration.bvh.prim_ids;
+    acceleration.triangles     = acceleration.precomputed_triangles;
+    return acceleration;
+}
 
-        if (vertex_buffer_info->format != erhe::raytrace::Format::FORMAT_FLOAT3) {
-            return;
+void store_acceleration(const uint64_t key, const Aabb& bounds, const Bvh_acceleration& acceleration)
+{
+    bvh_cache_store(key, bounds, acceleration.bvh.nodes, acceleration.primitive_ids, acceleration.triangles);
+}
+
+} // anonymous namespace
+
+class Bvh_geometry::Triangle_source
+{
+public:
+    [[nodiscard]] auto get_triangle(const std::size_t triangle) const -> Tri
+    {
+        return Tri{
+            to_bvh(get_position(get_index(triangle, 0))),
+            to_bvh(get_position(get_index(triangle, 1))),
+            to_bvh(get_position(get_index(triangle, 2)))
+        };
+    }
+
+    // Covers buffer layout and raw index and vertex bytes
+    [[nodiscard]] auto get_content_hash() const -> uint64_t
+    {
+        ERHE_PROFILE_FUNCTION();
+
+        const uint64_t layout[] = {c_bvh_cache_key_version, triangle_count, index_stride, vertex_stride};
+        uint64_t hash_code = erhe::hash::xxh64(layout, sizeof(layout));
+        hash_code = erhe::hash::xxh64(index_data,  index_byte_count,  hash_code);
+        hash_code = erhe::hash::xxh64(vertex_data, vertex_byte_count, hash_code);
+        return hash_code;
+    }
+
+    const char* index_data       {nullptr};
+    const char* vertex_data      {nullptr};
+    std::size_t triangle_count   {0};
+    std::size_t index_stride     {0};
+    std::size_t vertex_stride    {0};
+    std::size_t index_byte_count {0};
+    std::size_t vertex_byte_count{0};
+
+private:
+    [[nodiscard]] auto get_index(const std::size_t triangle, const std::size_t corner) const -> uint32_t
+    {
+        uint32_t index;
+        std::memcpy(&index, index_data + triangle * index_stride + corner * sizeof(uint32_t), sizeof(uint32_t));
+        return index;
+    }
+
+    [[nodiscard]] auto get_position(const uint32_t index) const -> glm::vec3
+    {
+        glm::vec3 position;
+        std::memcpy(&position, vertex_data + index * vertex_stride, sizeof(glm::vec3));
+        return position;
+    }
+};
+
+// Shared by geometry and background task. Geometry drops its reference
+// when it is destroyed or committed again, and the result is discarded.
+class Bvh_geometry::Background_build
+{
+public:
+    std::atomic<bool> ready{false};
+    Bvh_acceleration  result;
+};
+
+auto Bvh_geometry::get_triangle_source(Triangle_source& source) const -> bool
+{
+    const Buffer_info* index_buffer_info{nullptr};
+    const Buffer_info* vertex_buffer_info{nullptr};
+    for (const auto& buffer : m_buffer_infos) {
+        if (buffer.type == erhe::raytrace::Buffer_type::BUFFER_TYPE_INDEX) {
+            index_buffer_info = &buffer;
+            continue;
+        }
+        if (buffer.type == erhe::raytrace::Buffer_type::BUFFER_TYPE_VERTEX) {
+            vertex_buffer_info = &buffer;
+            continue;
         }
+    }
+    if (
+        (index_buffer_info == nullptr) ||
+        (vertex_buffer_info == nullptr)
+    ) {
+        return false;
+    }
+
+    if (vertex_buffer_info->format != erhe::raytrace::Format::FORMAT_FLOAT3) {
+        return false;
+    }
+
+    if (index_buffer_info->format != erhe::raytrace::Format::FORMAT_UINT3) {
+        return false;
+    }
+
+    IBuffer* index_buffer  = index_buffer_info->buffer;
+    IBuffer* vertex_buffer = vertex_buffer_info->buffer;
+    if (
+        (index_buffer == nullptr) ||
+        (vertex_buffer == nullptr)
+    ) {
+        return false;
+    }
+
+    source.index_data        = reinterpret_cast<char*>(index_buffer ->span().data()) + index_buffer_info ->byte_offset;
+    source.vertex_data       = reinterpret_cast<char*>(vertex_buffer->span().data()) + vertex_buffer_info->byte_offset;
+    source.triangle_count    = index_buffer_info->item_count;
+    source.index_stride      = index_buffer_info->byte_stride;
+    source.vertex_stride     = vertex_buffer_info->byte_stride;
+    source.index_byte_count  = source.triangle_count * source.index_stride;
+    source.vertex_byte_count = vertex_buffer_info->item_count * source.vertex_stride;
+    ERHE_VERIFY(index_buffer_info ->byte_offset + source.index_byte_count  <= index_buffer ->span().size());
+    ERHE_VERIFY(vertex_buffer_info->byte_offset + source.vertex_byte_count <= vertex_buffer->span().size());
+    return true;
+}
+
+void Bvh_geometry::commit()
+{
+    ERHE_PROFILE_FUNCTION();
+
+    Triangle_source source;
+    if (!get_triangle_source(source)) {
+        return;
+    }
+
+    m_background_build.reset();
+    m_acceleration = Bvh_acceleration{};
 
-        if (index_buffer_info->format != erhe::raytrace::Format::FORMAT_UINT3) {
+    const uint64_t content_hash = source.get_content_hash();
+    log_geometry->trace("BVH hash for {} : {:016x}", debug_label(), content_hash);
+
+    std::optional<Bvh_cache_entry> high_entry = bvh_cache_load(get_cache_key(content_hash, Bvh_quality::high));
+    if (high_entry.has_value()) {
+        m_bounds       = high_entry->bounds;
+        m_acceleration = make_acceleration(std::move(high_entry.value()), Bvh_quality::high);
+        return;
+    }
+
+    const bool background_rebuild = (m_thread_pool != nullptr) && is_background_rebuild_enabled();
+    std::optional<Bvh_cache_entry> low_entry = bvh_cache_load(get_cache_key(content_hash, Bvh_quality::low));
+    if (low_entry.has_value()) {
+        m_bounds       = low_entry->bounds;
+        m_acceleration = make_acceleration(std::move(low_entry.value()), Bvh_quality::low);
+        if (!background_rebuild) {
             return;
         }
+    }
 
-        IBuffer* index_buffer  = index_buffer_info->buffer;
-        IBuffer* vertex_buffer = vertex_buffer_info->buffer;
-        if (
-            (index_buffer == nullptr) ||
-            (vertex_buffer == nullptr)
-        ) {
-            return;
+    Build_input input;
+    input.triangles.reserve(source.triangle_count);
+    input.bboxes   .resize (source.triangle_count);
+    input.centers  .resize (source.triangle_count);
+    m_bounds = Aabb{};
+    {
+        ERHE_PROFILE_SCOPE("collect");
+
+        for (std::size_t i = 0; i < source.triangle_count; ++i) {
+            const Tri triangle = source.get_triangle(i);
+            input.triangles.emplace_back(triangle);
+            input.bboxes [i] = triangle.get_bbox();
+            input.centers[i] = triangle.get_center();
+            m_bounds.extend(from_bvh(input.bboxes[i].min));
+            m_bounds.extend(from_bvh(input.bboxes[i].max));
         }
+    }
 
-        const char* raw_index_ptr  = reinterpret_cast<char*>(index_buffer ->span().data()) + index_buffer_info ->byte_offset;
-        const char* raw_vertex_ptr = reinterpret_cast<char*>(vertex_buffer->span().data()) + vertex_buffer_info->byte_offset;
-        const std::size_t triangle_count = index_buffer_info->item_count;
+    if (m_acceleration.bvh.nodes.empty()) {
+        erhe::time::Timer timer{m_debug_label.c_str()};
 
-        std::vector<Tri> tris;
+        timer.begin();
+        m_acceleration = build_acceleration(input, Bvh_quality::low, &get_bvh_thread_pool());
+        timer.end();
 
-        uint64_t hash_code{0xcbf29ce484222325};
-        std::vector<BBox> bboxes(triangle_count);
-        std::vector<Vec3> centers(triangle_count);
-        {
-            ERHE_PROFILE_SCOPE("collect");
-
-            for (std::size_t i = 0; i < triangle_count; ++i) {
-                const uint32_t i0 = *reinterpret_cast<const uint32_t*>(raw_index_ptr + i * index_buffer_info->byte_stride + 0 * sizeof(uint32_t));
-                const uint32_t i1 = *reinterpret_cast<const uint32_t*>(raw_index_ptr + i * index_buffer_info->byte_stride + 1 * sizeof(uint32_t));
-                const uint32_t i2 = *reinterpret_cast<const uint32_t*>(raw_index_ptr + i * index_buffer_info->byte_stride + 2 * sizeof(uint32_t));
-
-                const float p0_x = *reinterpret_cast<const float*>(raw_vertex_ptr + i0 * index_buffer_info->byte_stride + 0 * sizeof(float));
-                const float p0_y = *reinterpret_cast<const float*>(raw_vertex_ptr + i0 * index_buffer_info->byte_stride + 1 * sizeof(float));
-                const float p0_z = *reinterpret_cast<const float*>(raw_vertex_ptr + i0 * index_buffer_info->byte_stride + 2 * sizeof(float));
-
-                const float p1_x = *reinterpret_cast<const float*>(raw_vertex_ptr + i1 * index_buffer_info->byte_stride + 0 * sizeof(float));
-                const float p1_y = *reinterpret_cast<const float*>(raw_vertex_ptr + i1 * index_buffer_info->byte_stride + 1 * sizeof(float));
-                const float p1_z = *reinterpret_cast<const float*>(raw_vertex_ptr + i1 * index_buffer_info->byte_stride + 2 * sizeof(float));
-
-                const float p2_x = *reinterpret_cast<const float*>(raw_vertex_ptr + i2 * index_buffer_info->byte_stride + 0 * sizeof(float));
-                const float p2_y = *reinterpret_cast<const float*>(raw_vertex_ptr + i2 * index_buffer_info->byte_stride + 1 * sizeof(float));
-                const float p2_z = *reinterpret_cast<const float*>(raw_vertex_ptr + i2 * index_buffer_info->byte_stride + 2 * sizeof(float));
-
-                hash_code = erhe::hash::hash(p0_x, p0_y, p0_z, hash_code);
-                hash_code = erhe::hash::hash(p1_x, p1_y, p1_z, hash_code);
-                hash_code = erhe::hash::hash(p2_x, p2_y, p2_z, hash_code);
-
-                const bvh::v2::Tri<float, 3> triangle{
-                    Vec3{p0_x, p0_y, p0_z},
-                    Vec3{p1_x, p1_y, p1_z},
-                    Vec3{p2_x, p2_y, p2_z}
-                };
-                tris.emplace_back(triangle);
-                bboxes[i] = triangle.get_bbox();
-                centers[i] = triangle.get_center();
-            }
-            log_geometry->trace("BVH hash for {} : {:x}", debug_label(), hash_code);
-        }
+        const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(timer.duration().value()).count();
+        log_geometry->trace("BVH build {} in {} ms", debug_label(), time);
 
-        const bool load_ok = load_bvh(m_bvh, hash_code);
-        if (!load_ok) {
-            typename bvh::v2::DefaultBuilder<Node>::Config config;
-            //config.quality = bvh::v2::DefaultBuilder<Node>::Quality::High;
-            config.quality = bvh::v2::DefaultBuilder<Node>::Quality::Low;
-
-            {
-                ERHE_PROFILE_SCOPE("bvh build");
-                erhe::time::Timer timer{m_debug_label.c_str()};
-
-                timer.begin();
-                m_bvh = bvh::v2::DefaultBuilder<Node>::build(
-                    thread_pool,
-                    bboxes,
-                    centers,
-                    config
-                );
-                timer.end();
-
-                const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(timer.duration().value()).count();
-                log_geometry->trace("BVH build {} in {} ms", debug_label(), time);
-            }
+        store_acceleration(get_cache_key(content_hash, Bvh_quality::low), m_bounds, m_acceleration);
+    }
+
+    if (!background_rebuild) {
+        return;
+    }
 
-            const bool save_ok = save_bvh(m_bvh, hash_code);
-            if (!save_ok) {
-                log_geometry->warn("BVH save failed, hash = {}", hash_code);
+    auto background_build = std::make_shared<Background_build>();
+    m_background_build = background_build;
+    // Each background build is single threaded. No thread waits for tasks of
+    // m_thread_pool (see IGeometry::set_thread_pool()), so only its workers
+    // run the build.
+    m_thread_pool->enqueue(
+        [background_build, input = std::move(input), bounds = m_bounds, content_hash, label = m_debug_label]() {
+            // Skip if geometry was destroyed or committed again before task started
+            if (background_build.use_count() == 1) {
+                return;
             }
+
+            erhe::time::Timer timer{label.c_str()};
+            timer.begin();
+            Bvh_acceleration acceleration = build_acceleration(input, Bvh_quality::high, nullptr);
+            timer.end();
+
+            const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(timer.duration().value()).count();
+            log_geometry->trace("BVH {} build {} in {} ms", c_str(Bvh_quality::high), label, time);
+
+            store_acceleration(get_cache_key(content_hash, Bvh_quality::high), bounds, acceleration);
+            background_build->result = std::move(acceleration);
+            background_build->ready.store(true, std::memory_order_release);
         }
+    );
+}
 
+void Bvh_geometry::refit()
+{
+    ERHE_PROFILE_FUNCTION();
 
-        // This precomputes some data to speed up traversal further.
-        {
-            ERHE_PROFILE_SCOPE("bvh precompute");
-            m_precomputed_triangles.clear();
-            m_precomputed_triangles.resize(tris.size());
-            executor.for_each(
-                0,
-                tris.size(),
-                [&] (const size_t begin, const size_t end) {
-                    for (size_t i = begin; i < end; ++i) {
-                        auto j = should_permute ? m_bvh.prim_ids[i] : i;
-                        m_precomputed_triangles[i] = tris[j];
-                    }
-                }
-            );
+    Triangle_source source;
+    if (
+        m_acceleration.bvh.nodes.empty() ||
+        !get_triangle_source(source) ||
+        (source.triangle_count != m_acceleration.triangles.size())
+    ) {
+        commit();
+        return;
+    }
+
+    // Pending background build used previous vertex positions
+    m_background_build.reset();
+
+    Bvh_acceleration& acceleration = m_acceleration;
+    std::vector<Node>& nodes       = acceleration.bvh.nodes;
+    if (acceleration.bvh.prim_ids.empty()) {
+        // Primitive ids were in memory mapped cache entry
+        acceleration.bvh.prim_ids.assign(acceleration.primitive_ids.begin(), acceleration.primitive_ids.end());
+    }
+    const std::vector<std::size_t>& prim_ids = acceleration.bvh.prim_ids;
+
+    std::vector<BBox> bboxes(source.triangle_count);
+    acceleration.precomputed_triangles.resize(source.triangle_count);
+    m_bounds = Aabb{};
+    for (std::size_t i = 0; i < source.triangle_count; ++i) {
+        const Tri triangle = source.get_triangle(i);
+        bboxes[i] = triangle.get_bbox();
+        acceleration.precomputed_triangles[i] = triangle;
+        m_bounds.extend(from_bvh(bboxes[i].min));
+        m_bounds.extend(from_bvh(bboxes[i].max));
+    }
+    acceleration.cache_mapping.reset();
+    acceleration.primitive_ids = prim_ids;
+    acceleration.triangles     = acceleration.precomputed_triangles;
+
+    // Nodes in reverse pre-order: children are visited before their parent
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> stack{0};
+    order.reserve(nodes.size());
+    while (!stack.empty()) {
+        const std::size_t node_index = stack.back();
+        stack.pop_back();
+        order.push_back(node_index);
+        const Node& node = nodes[node_index];
+        if (!node.is_leaf()) {
+            stack.push_back(node.index.first_id());
+            stack.push_back(node.index.first_id() + 1);
         }
     }
+    for (auto i = order.rbegin(), end = order.rend(); i != end; ++i) {
+        Node& node = nodes[*i];
+        BBox  bbox = BBox::make_empty();
+        const std::size_t first = node.index.first_id();
+        if (node.is_leaf()) {
+            for (std::size_t j = first, j_end = first + node.index.prim_count(); j < j_end; ++j) {
+                bbox.extend(bboxes[should_permute ? j : prim_ids[j]]);
+            }
+        } else {
+            bbox.extend(nodes[first    ].get_bbox());
+            bbox.extend(nodes[first + 1].get_bbox());
+        }
+        node.set_bbox(bbox);
+    }
+}
+
+auto Bvh_geometry::update_acceleration() -> bool
+{
+    if (!m_background_build || !m_background_build->ready.load(std::memory_order_acquire)) {
+        return false;
+    }
+    m_acceleration = std::move(m_background_build->result);
+    m_background_build.reset();
+    log_geometry->trace("BVH {} swapped in for {}", c_str(m_acceleration.quality), debug_label());
+    return true;
+}
 
+auto Bvh_geometry::get_quality() const -> Bvh_quality
+{
+    return m_acceleration.quality;
+}
+
+auto Bvh_geometry::is_rebuild_pending() const -> bool
+{
+    return static_cast<bool>(m_background_build);
 }
 
 void Bvh_geometry::enable()
@@ -297,6 +532,11 @@ void Bvh_geometry::set_user_data(void* ptr)
     m_user_data = ptr;
 }
 
+void Bvh_geometry::set_thread_pool(erhe::concurrency::Thread_pool* thread_pool)
+{
+    m_thread_pool = thread_pool;
+}
+
 auto Bvh_geometry::intersect_instance(
     Ray&          ray,
     Hit&          hit,
@@ -305,7 +545,7 @@ auto Bvh_geometry::intersect_instance(
 {
     ERHE_PROFILE_FUNCTION();
 
-    if (!m_enabled) {
+    if (!m_enabled || m_acceleration.bvh.nodes.empty()) {
         return false;
     }
     if ((ray.mask & m_mask) == 0) {
@@ -332,15 +572,15 @@ auto Bvh_geometry::intersect_instance(
 
     // Traverse the BVH and get the u, v coordinates of the closest intersection.
     bvh::v2::SmallStack<Bvh::Index, stack_size> stack;
-    m_bvh.intersect<false, use_robust_traversal>(
+    m_acceleration.bvh.intersect<false, use_robust_traversal>(
         bvh_ray,
-        m_bvh.get_root().index,
+        m_acceleration.bvh.get_root().index,
         stack,
         [&] (const size_t begin, const size_t end)
         {
             for (size_t i = begin; i < end; ++i) {
-                size_t j = should_permute ? i : m_bvh.prim_ids[i];
-                if (auto hit = m_precomputed_triangles[j].intersect(bvh_ray)) {
+                size_t j = should_permute ? i : m_acceleration.primitive_ids[i];
+                if (auto hit = m_acceleration.triangles[j].intersect(bvh_ray)) {
                     prim_id = i;
                     std::tie(u, v) = *hit;
                 }
@@ -350,8 +590,8 @@ auto Bvh_geometry::intersect_instance(
     );
 
     if (prim_id != invalid_id) {
-        const auto triangle_index = should_permute ? prim_id : m_bvh.prim_ids[prim_id];
-        const auto& triangle = m_precomputed_triangles.at(triangle_index);
+        const auto triangle_index = should_permute ? prim_id : m_acceleration.primitive_ids[prim_id];
+        const auto& triangle = m_acceleration.triangles[triangle_index];
 
         ray.t_far       = bvh_ray.tmax;
         hit.triangle_id = static_cast<unsigned int>(triangle_index);
@@ -364,6 +604,56 @@ auto Bvh_geometry::intersect_instance(
     return false;
 }
 
+auto Bvh_geometry::occluded_instance(
+    Ray&          ray,
+    Bvh_instance* instance
+) -> bool
+{
+    static_cast<void>(instance);
+
+    if (!m_enabled || m_acceleration.bvh.nodes.empty()) {
+        return false;
+    }
+    if ((ray.mask & m_mask) == 0) {
+        return false;
+    }
+
+    bvh::v2::Ray<Scalar, 3> bvh_ray{
+        to_bvh(ray.origin),
+        to_bvh(ray.direction),
+        ray.t_near,
+        ray.t_far
+    };
+
+    static constexpr size_t stack_size = 64;
+    static constexpr bool   use_robust_traversal = false;
+
+    bool is_occluded = false;
+    bvh::v2::SmallStack<Bvh::Index, stack_size> stack;
+    m_acceleration.bvh.intersect<true, use_robust_traversal>(
+        bvh_ray,
+        m_acceleration.bvh.get_root().index,
+        stack,
+        [&] (const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                size_t j = should_permute ? i : m_acceleration.primitive_ids[i];
+                if (m_acceleration.triangles[j].intersect(bvh_ray)) {
+                    is_occluded = true;
+                    return true;
+                }
+            }
+            return false;
+        }
+    );
+    return is_occluded;
+}
+
+auto Bvh_geometry::get_bounds() const -> const Aabb&
+{
+    return m_bounds;
+}
+
 /// auto Bvh_geometry::get_sphere() const -> const erhe::math::Bounding_sphere&
 /// {
 ///     return m_bounding_sphere;
@@ -7,15 +7,23 @@
 #endif
 
 #include "erhe_raytrace/igeometry.hpp"
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
 
 #include <glm/glm.hpp>
 
 #include <bvh/v2/bvh.h>
 #include <bvh/v2/tri.h>
 
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
+namespace erhe::file
+{
+    class Mapped_file;
+}
+
 namespace erhe::raytrace
 {
 
@@ -24,6 +32,31 @@ class Bvh_scene;
 class Ray;
 class Hit;
 
+enum class Bvh_quality : unsigned int {
+    low = 0, // Fast build, used immediately after commit()
+    high     // Sweep SAH with reinsertion optimization, built in background
+};
+
+// Built BVH with its triangle data. Triangles and primitive ids are owned
+// (precomputed_triangles, bvh.prim_ids) when BVH is built, or point to
+// memory mapped BVH cache entry, which is kept alive by cache_mapping.
+class Bvh_acceleration
+{
+public:
+    Bvh_acceleration() = default;
+    Bvh_acceleration(const Bvh_acceleration&) = delete;
+    auto operator=(const Bvh_acceleration&) -> Bvh_acceleration& = delete;
+    Bvh_acceleration(Bvh_acceleration&&) = default;
+    auto operator=(Bvh_acceleration&&) -> Bvh_acceleration& = default;
+
+    Bvh_quality                                     quality{Bvh_quality::low};
+    bvh::v2::Bvh<bvh::v2::Node<float, 3>>           bvh;
+    std::vector<bvh::v2::PrecomputedTri<float>>     precomputed_triangles;
+    std::shared_ptr<erhe::file::Mapped_file>        cache_mapping;
+    std::span<const bvh::v2::PrecomputedTri<float>> triangles;
+    std::span<const std::size_t>                    primitive_ids;
+};
+
 class Bvh_geometry
     : public IGeometry
 {
@@ -54,11 +87,29 @@ public:
     [[nodiscard]] auto get_user_data() const -> void*            override;
     [[nodiscard]] auto is_enabled   () const -> bool             override;
     [[nodiscard]] auto debug_label  () const -> std::string_view override;
+    void refit() override;
+    void set_thread_pool(erhe::concurrency::Thread_pool* thread_pool) override;
 
     // Bvh_geometry public API
     auto intersect_instance(Ray& ray, Hit& hit, Bvh_instance* instance) -> bool;
+    auto occluded_instance (Ray& ray, Bvh_instance* instance) -> bool;
+    [[nodiscard]] auto get_bounds() const -> const Aabb&;
+
+    // commit() builds low quality BVH immediately, and when enabled
+    // (erhe.ini [raytrace] bvh_background_rebuild) and thread pool has been
+    // set, high quality BVH in background. update_acceleration() swaps in completed background BVH,
+    // and returns true if BVH was replaced. It must not run concurrently
+    // with intersect_instance() or occluded_instance().
+    auto update_acceleration() -> bool;
+    [[nodiscard]] auto get_quality       () const -> Bvh_quality;
+    [[nodiscard]] auto is_rebuild_pending() const -> bool;
 
 private:
+    class Background_build;
+    class Triangle_source;
+
+    [[nodiscard]] auto get_triangle_source(Triangle_source& source) const -> bool;
+
     class Buffer_info
     {
     public:
@@ -77,11 +128,13 @@ private:
     std::string  m_debug_label;
     bool         m_enabled    {true};
     unsigned int m_vertex_attribute_count{0};
+    Aabb         m_bounds;
 
     std::vector<Buffer_info> m_buffer_infos;
 
-    std::vector<bvh::v2::PrecomputedTri<float>> m_precomputed_triangles;
-    bvh::v2::Bvh<bvh::v2::Node<float, 3>>       m_bvh;
+    Bvh_acceleration                  m_acceleration;
+    std::shared_ptr<Background_build> m_background_build;
+    erhe::concurrency::Thread_pool*   m_thread_pool{nullptr};
 };
 
 }
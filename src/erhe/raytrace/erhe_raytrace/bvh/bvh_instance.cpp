@@ -34,22 +34,29 @@ Bvh_instance::Bvh_instance(const std::string_view debug_label)
 Bvh_instance::~Bvh_instance() noexcept
 {
     log_instance->trace("Destroyed Bvh_instance {}", m_debug_label);
+    if (m_owner_scene != nullptr) {
+        m_owner_scene->detach(this);
+    }
 }
 
 void Bvh_instance::commit()
 {
+    // Picks up changes to geometry bounds of instanced scene
+    notify_owner_scene();
 }
 
 void Bvh_instance::enable()
 {
     log_instance->trace("Bvh_instance::enable {}", m_debug_label);
     m_enabled = true;
+    notify_owner_scene();
 }
 
 void Bvh_instance::disable()
 {
     log_instance->trace("Bvh_instance::disable {}", m_debug_label);
     m_enabled = false;
+    notify_owner_scene();
 }
 
 auto Bvh_instance::is_enabled() const -> bool
@@ -61,11 +68,13 @@ void Bvh_instance::set_transform(const glm::mat4 transform)
 {
     //log_frame->trace("Bvh_instance::set_transform {}", m_debug_label);
     m_transform = transform;
+    notify_owner_scene();
 }
 
 void Bvh_instance::set_scene(IScene* scene)
 {
     m_scene = scene;
+    notify_owner_scene();
 }
 
 void Bvh_instance::set_mask(const uint32_t mask)
@@ -103,6 +112,44 @@ auto Bvh_instance::intersect(Ray& ray, Hit& hit) -> bool
     return is_hit;
 }
 
+auto Bvh_instance::occluded(Ray& ray) -> bool
+{
+    if (!m_enabled || ((ray.mask & m_mask) == 0)) {
+        return false;
+    }
+
+    Ray   local_ray      = ray.transform(glm::inverse(get_transform()));
+    auto* instance_scene = get_scene();
+    auto* bvh_scene      = reinterpret_cast<Bvh_scene*>(instance_scene);
+    return bvh_scene->occluded_instance(local_ray, this);
+}
+
+auto Bvh_instance::get_world_bounds() const -> Aabb
+{
+    if (!m_enabled || (m_scene == nullptr)) {
+        return Aabb{};
+    }
+    const auto* bvh_scene = reinterpret_cast<const Bvh_scene*>(m_scene);
+    return transform(m_transform, bvh_scene->get_bounds());
+}
+
+void Bvh_instance::set_owner_scene(Bvh_scene* scene)
+{
+    m_owner_scene = scene;
+}
+
+auto Bvh_instance::get_owner_scene() const -> Bvh_scene*
+{
+    return m_owner_scene;
+}
+
+void Bvh_instance::notify_owner_scene()
+{
+    if (m_owner_scene != nullptr) {
+        m_owner_scene->instance_updated(this);
+    }
+}
+
 #if 0
 void Bvh_instance::collect_spheres(
     std::vector<bvh::Sphere<float>>& spheres,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "erhe_raytrace/iinstance.hpp"
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
 
 #include <glm/glm.hpp>
 
@@ -35,13 +36,24 @@ public:
 
     // Bvh_instance public API
     auto intersect(Ray& ray, Hit& hit) -> bool;
+    auto occluded (Ray& ray) -> bool;
+
+    // World space bounds of instanced scene, empty if instance is disabled
+    [[nodiscard]] auto get_world_bounds() const -> Aabb;
+
+    // Scene this instance is attached to; notified when instance changes
+    void set_owner_scene(Bvh_scene* scene);
+    [[nodiscard]] auto get_owner_scene() const -> Bvh_scene*;
 
 private:
+    void notify_owner_scene();
+
     glm::mat4   m_transform{1.0f};
     bool        m_enabled  {true};
     IScene*     m_scene    {nullptr};
     uint32_t    m_mask     {0xffffffffu};
     void*       m_user_data{nullptr};
+    Bvh_scene*  m_owner_scene{nullptr};
     std::string m_debug_label;
 };
 
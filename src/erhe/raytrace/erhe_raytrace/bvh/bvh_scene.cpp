@@ -11,12 +11,22 @@
 #include "erhe_raytrace/iinstance.hpp"
 #include "erhe_raytrace/raytrace_log.hpp"
 #include "erhe_raytrace/ray.hpp"
+#include "erhe_concurrency/parallel.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
+#include <limits>
+
 namespace erhe::raytrace
 {
 
+namespace {
+
+// Multiple of Bvh_tlas::s_packet_size
+constexpr std::size_t s_rays_per_chunk = 64;
+
+}
+
 auto IScene::create(const std::string_view debug_label) -> IScene*
 {
     return new Bvh_scene(debug_label);
@@ -41,6 +51,11 @@ Bvh_scene::Bvh_scene(const std::string_view debug_label)
 Bvh_scene::~Bvh_scene() noexcept
 {
     log_scene->trace("Destroyed Bvh_scene '{}'", m_debug_label);
+    for (Bvh_instance* instance : m_instances) {
+        if (instance->get_owner_scene() == this) {
+            instance->set_owner_scene(nullptr);
+        }
+    }
 }
 
 void Bvh_scene::attach(IGeometry* geometry)
@@ -78,6 +93,8 @@ void Bvh_scene::attach(IInstance* instance)
 #endif
     {
         m_instances.push_back(bvh_instance);
+        bvh_instance->set_owner_scene(this);
+        m_tlas_rebuild_needed = true;
     }
 }
 
@@ -110,12 +127,228 @@ void Bvh_scene::detach(IInstance* instance)
         log_scene->error("raytrace instance not in scene");
     } else {
         m_instances.erase(i, m_instances.end());
+        if (bvh_instance->get_owner_scene() == this) {
+            bvh_instance->set_owner_scene(nullptr);
+        }
+        m_tlas_rebuild_needed = true;
     }
 }
 
 void Bvh_scene::commit()
 {
-    // TODO
+    // Attached geometries may have been committed or refit with new bounds
+    if (!m_instances.empty()) {
+        m_tlas_refit_needed = true;
+    }
+    update();
+}
+
+void Bvh_scene::instance_updated(Bvh_instance* instance)
+{
+    static_cast<void>(instance);
+    m_tlas_refit_needed = true;
+}
+
+void Bvh_scene::update()
+{
+    update_geometries();
+    update_tlas();
+}
+
+void Bvh_scene::update_geometries()
+{
+    for (Bvh_geometry* geometry : m_geometries) {
+        geometry->update_acceleration();
+    }
+    for (Bvh_instance* instance : m_instances) {
+        IScene* scene = instance->get_scene();
+        if ((scene != nullptr) && (scene != this)) {
+            static_cast<Bvh_scene*>(scene)->update_geometries();
+        }
+    }
+}
+
+void Bvh_scene::update_tlas()
+{
+    if (!m_tlas_rebuild_needed && !m_tlas_refit_needed) {
+        return;
+    }
+
+    ERHE_PROFILE_FUNCTION();
+
+    m_instance_bounds.resize(m_instances.size());
+    for (std::size_t i = 0, end = m_instances.size(); i < end; ++i) {
+        m_instance_bounds[i] = m_instances[i]->get_world_bounds();
+    }
+    if (m_tlas_rebuild_needed) {
+        m_tlas.build(m_instance_bounds);
+        log_scene->trace(
+            "Bvh_scene {} TLAS built, instances = {}, nodes = {}",
+            m_debug_label, m_instances.size(), m_tlas.get_node_count()
+        );
+    } else {
+        m_tlas.refit(m_instance_bounds);
+    }
+    m_tlas_rebuild_needed = false;
+    m_tlas_refit_needed   = false;
+}
+
+auto Bvh_scene::get_bounds() const -> Aabb
+{
+    Aabb bounds;
+    for (const Bvh_geometry* geometry : m_geometries) {
+        bounds.extend(geometry->get_bounds());
+    }
+    if (!m_tlas_rebuild_needed && !m_tlas_refit_needed) {
+        bounds.extend(m_tlas.get_bounds());
+    } else {
+        for (const Bvh_instance* instance : m_instances) {
+            bounds.extend(instance->get_world_bounds());
+        }
+    }
+    return bounds;
+}
+
+auto Bvh_scene::intersect_instances(Ray& ray, Hit& hit) -> bool
+{
+    bool is_hit = false;
+    m_tlas.traverse(
+        ray,
+        [&](const uint32_t instance_index) {
+            const bool instance_is_hit = m_instances[instance_index]->intersect(ray, hit);
+            if (instance_is_hit) {
+                is_hit = true;
+            }
+            return false;
+        }
+    );
+    return is_hit;
+}
+
+auto Bvh_scene::occluded_instances(Ray& ray) -> bool
+{
+    bool is_occluded = false;
+    m_tlas.traverse(
+        ray,
+        [&](const uint32_t instance_index) {
+            is_occluded = m_instances[instance_index]->occluded(ray);
+            return is_occluded;
+        }
+    );
+    return is_occluded;
+}
+
+void Bvh_scene::intersect_packet(const std::span<Ray> rays, const std::span<Hit> hits)
+{
+    m_tlas.traverse_packet(
+        rays,
+        [&](const uint32_t instance_index, const std::size_t lane) {
+            m_instances[instance_index]->intersect(rays[lane], hits[lane]);
+            return false;
+        }
+    );
+    for (std::size_t lane = 0, end = rays.size(); lane < end; ++lane) {
+        for (const auto& geometry : m_geometries) {
+            geometry->intersect_instance(rays[lane], hits[lane], nullptr);
+        }
+    }
+}
+
+void Bvh_scene::occluded_packet(const std::span<Ray> rays)
+{
+    uint32_t occluded_mask = 0;
+    m_tlas.traverse_packet(
+        rays,
+        [&](const uint32_t instance_index, const std::size_t lane) {
+            if (m_instances[instance_index]->occluded(rays[lane])) {
+                occluded_mask |= (1u << lane);
+                return true;
+            }
+            return false;
+        }
+    );
+    for (std::size_t lane = 0, end = rays.size(); lane < end; ++lane) {
+        if ((occluded_mask & (1u << lane)) == 0) {
+            for (const auto& geometry : m_geometries) {
+                if (geometry->occluded_instance(rays[lane], nullptr)) {
+                    occluded_mask |= (1u << lane);
+                    break;
+                }
+            }
+        }
+        if ((occluded_mask & (1u << lane)) != 0) {
+            rays[lane].t_far = -std::numeric_limits<float>::infinity();
+        }
+    }
+}
+
+void Bvh_scene::intersect(
+    const std::span<Ray>                  rays,
+    const std::span<Hit>                  hits,
+    erhe::concurrency::Thread_pool* const thread_pool
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(rays.size() == hits.size());
+
+    // Update before dispatch, traversal does not modify scene
+    update();
+
+    const auto intersect_range = [this, rays, hits](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i += Bvh_tlas::s_packet_size) {
+            const std::size_t count = std::min(Bvh_tlas::s_packet_size, end - i);
+            intersect_packet(rays.subspan(i, count), hits.subspan(i, count));
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, rays.size(), s_rays_per_chunk, intersect_range);
+    } else {
+        intersect_range(0, rays.size());
+    }
+}
+
+auto Bvh_scene::occluded(Ray& ray) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    update();
+
+    bool is_occluded = occluded_instances(ray);
+    if (!is_occluded) {
+        for (const auto& geometry : m_geometries) {
+            if (geometry->occluded_instance(ray, nullptr)) {
+                is_occluded = true;
+                break;
+            }
+        }
+    }
+    if (is_occluded) {
+        ray.t_far = -std::numeric_limits<float>::infinity();
+    }
+    return is_occluded;
+}
+
+void Bvh_scene::occluded(
+    const std::span<Ray>                  rays,
+    erhe::concurrency::Thread_pool* const thread_pool
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    update();
+
+    const auto occluded_range = [this, rays](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; i += Bvh_tlas::s_packet_size) {
+            const std::size_t count = std::min(Bvh_tlas::s_packet_size, end - i);
+            occluded_packet(rays.subspan(i, count));
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, rays.size(), s_rays_per_chunk, occluded_range);
+    } else {
+        occluded_range(0, rays.size());
+    }
 }
 
 auto Bvh_scene::intersect(Ray& ray, Hit& hit) -> bool
@@ -127,13 +360,9 @@ auto Bvh_scene::intersect(Ray& ray, Hit& hit) -> bool
 
     ERHE_PROFILE_FUNCTION();
 
-    bool is_hit = false;
-    for (const auto& instance : m_instances) {
-        const bool instance_is_hit = instance->intersect(ray, hit);
-        if (instance_is_hit) {
-            is_hit = true;
-        }
-    }
+    update();
+
+    bool is_hit = intersect_instances(ray, hit);
     for (const auto& geometry : m_geometries) {
         const bool geometry_is_hit = geometry->intersect_instance(ray, hit, nullptr);
         if (geometry_is_hit) {
@@ -147,12 +376,8 @@ auto Bvh_scene::intersect_instance(Ray& ray, Hit& hit, Bvh_instance* in_instance
 {
     bool is_hit = false;
     if (in_instance == nullptr) {
-        for (const auto& instance : m_instances) {
-            const bool instance_is_hit = instance->intersect(ray, hit);
-            if (instance_is_hit) {
-                is_hit = true;
-            }
-        }
+        update();
+        is_hit = intersect_instances(ray, hit);
     } else {
         for (const auto& geometry : m_geometries) {
             const bool geometry_is_hit = geometry->intersect_instance(ray, hit, in_instance);
@@ -164,6 +389,20 @@ auto Bvh_scene::intersect_instance(Ray& ray, Hit& hit, Bvh_instance* in_instance
     return is_hit;
 }
 
+auto Bvh_scene::occluded_instance(Ray& ray, Bvh_instance* in_instance) -> bool
+{
+    if (in_instance == nullptr) {
+        update();
+        return occluded_instances(ray);
+    }
+    for (const auto& geometry : m_geometries) {
+        if (geometry->occluded_instance(ray, in_instance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 auto Bvh_scene::debug_label() const -> std::string_view
 {
     return m_debug_label;
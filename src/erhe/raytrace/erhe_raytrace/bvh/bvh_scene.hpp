@@ -7,6 +7,7 @@
 #endif
 
 #include "erhe_raytrace/iscene.hpp"
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
 
 #include <bvh/v2/bvh.h>
 
@@ -34,14 +35,42 @@ public:
     void detach     (IInstance* geometry)        override;
     void commit     ()                           override;
     auto intersect  (Ray& ray, Hit& hit) -> bool override;
+    void intersect  (std::span<Ray> rays, std::span<Hit> hits, erhe::concurrency::Thread_pool* thread_pool) override;
+    auto occluded   (Ray& ray) -> bool           override;
+    void occluded   (std::span<Ray> rays, erhe::concurrency::Thread_pool* thread_pool) override;
     auto debug_label() const -> std::string_view override;
 
     // Bvh_scene public API
     auto intersect_instance(Ray& ray, Hit& hit, Bvh_instance* instance) -> bool;
+    auto occluded_instance (Ray& ray, Bvh_instance* instance) -> bool;
+
+    // Called by attached instance when its transform, enable state or
+    // instanced scene changes. Top level BVH is refit on next commit() or
+    // intersect().
+    void instance_updated(Bvh_instance* instance);
+
+    // Local space bounds of geometries and instances
+    [[nodiscard]] auto get_bounds() const -> Aabb;
+
+    // Swaps in completed background BVH rebuilds of attached geometries,
+    // and of geometries in instanced scenes. Called by commit() and before
+    // queries, so it never runs during traversal.
+    void update_geometries();
 
 private:
+    void update             ();
+    void update_tlas        ();
+    auto intersect_instances(Ray& ray, Hit& hit) -> bool;
+    auto occluded_instances (Ray& ray) -> bool;
+    void intersect_packet   (std::span<Ray> rays, std::span<Hit> hits);
+    void occluded_packet    (std::span<Ray> rays);
+
     std::vector<Bvh_geometry*> m_geometries;
     std::vector<Bvh_instance*> m_instances;
+    std::vector<Aabb>          m_instance_bounds;
+    Bvh_tlas                   m_tlas;
+    bool                       m_tlas_rebuild_needed{false};
+    bool                       m_tlas_refit_needed  {false};
     std::string                m_debug_label;
 };
 
@@ -0,0 +1,215 @@
+#include "erhe_raytrace/bvh/bvh_tlas.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+#include <numeric>
+
+namespace erhe::raytrace
+{
+
+auto transform(const glm::mat4& matrix, const Aabb& aabb) -> Aabb
+{
+    if (aabb.is_empty()) {
+        return aabb;
+    }
+    const glm::vec3 translation{matrix[3]};
+    Aabb result{translation, translation};
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            const float a = matrix[column][row] * aabb.min[column];
+            const float b = matrix[column][row] * aabb.max[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+namespace {
+
+constexpr std::size_t s_bin_count      = 16;
+constexpr uint32_t    s_max_leaf_count = 2;
+constexpr std::size_t s_max_sah_depth  = 32;
+
+class Bin
+{
+public:
+    Aabb        bounds;
+    std::size_t count{0};
+};
+
+} // anonymous namespace
+
+void Bvh_tlas::clear()
+{
+    m_nodes.clear();
+    m_primitives.clear();
+}
+
+void Bvh_tlas::build(const std::span<const Aabb> primitive_bounds)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    clear();
+    if (primitive_bounds.empty()) {
+        return;
+    }
+
+    const std::size_t primitive_count = primitive_bounds.size();
+    m_primitives.resize(primitive_count);
+    std::iota(m_primitives.begin(), m_primitives.end(), uint32_t{0});
+
+    std::vector<glm::vec3> centers(primitive_count);
+    for (std::size_t i = 0; i < primitive_count; ++i) {
+        centers[i] = primitive_bounds[i].center();
+    }
+
+    class Work_item
+    {
+    public:
+        uint32_t    node;
+        uint32_t    begin;
+        uint32_t    end;
+        std::size_t depth;
+    };
+
+    m_nodes.reserve(2 * primitive_count);
+    m_nodes.push_back(Node{});
+    std::vector<Work_item> work;
+    work.push_back(Work_item{0, 0, static_cast<uint32_t>(primitive_count), 0});
+    while (!work.empty()) {
+        const Work_item item = work.back();
+        work.pop_back();
+
+        Aabb bounds;
+        Aabb center_bounds;
+        for (uint32_t i = item.begin; i < item.end; ++i) {
+            bounds.extend(primitive_bounds[m_primitives[i]]);
+            center_bounds.extend(centers[m_primitives[i]]);
+        }
+        m_nodes[item.node].bounds = bounds;
+
+        const uint32_t count = item.end - item.begin;
+        const auto make_leaf = [&]() {
+            m_nodes[item.node].first = item.begin;
+            m_nodes[item.node].count = count;
+        };
+        if (count <= s_max_leaf_count) {
+            make_leaf();
+            continue;
+        }
+
+        // Pick split with binned surface area heuristic along longest center axis
+        const glm::vec3 extent = center_bounds.max - center_bounds.min;
+        int axis = 0;
+        if (extent.y > extent[axis]) axis = 1;
+        if (extent.z > extent[axis]) axis = 2;
+
+        uint32_t middle = item.begin + count / 2;
+        if ((extent[axis] > 0.0f) && (item.depth < s_max_sah_depth)) {
+            std::array<Bin, s_bin_count> bins;
+            const float scale = static_cast<float>(s_bin_count) / extent[axis];
+            const auto  bin_index = [&](const uint32_t primitive) {
+                const float offset = (centers[primitive][axis] - center_bounds.min[axis]) * scale;
+                return std::min(static_cast<std::size_t>(offset), s_bin_count - 1);
+            };
+            for (uint32_t i = item.begin; i < item.end; ++i) {
+                Bin& bin = bins[bin_index(m_primitives[i])];
+                bin.bounds.extend(primitive_bounds[m_primitives[i]]);
+                ++bin.count;
+            }
+
+            std::array<float, s_bin_count> right_cost{};
+            Aabb        right_bounds;
+            std::size_t right_count{0};
+            for (std::size_t i = s_bin_count - 1; i > 0; --i) {
+                right_bounds.extend(bins[i].bounds);
+                right_count += bins[i].count;
+                right_cost[i] = right_bounds.half_area() * static_cast<float>(right_count);
+            }
+            Aabb        left_bounds;
+            std::size_t left_count{0};
+            float       best_cost = std::numeric_limits<float>::max();
+            std::size_t best_bin  = 0;
+            for (std::size_t i = 1; i < s_bin_count; ++i) {
+                left_bounds.extend(bins[i - 1].bounds);
+                left_count += bins[i - 1].count;
+                const float cost = left_bounds.half_area() * static_cast<float>(left_count) + right_cost[i];
+                if ((left_count > 0) && (left_count < count) && (cost < best_cost)) {
+                    best_cost = cost;
+                    best_bin  = i;
+                }
+            }
+            if (best_bin == 0) {
+                make_leaf();
+                continue;
+            }
+            const auto split = std::partition(
+                m_primitives.begin() + item.begin,
+                m_primitives.begin() + item.end,
+                [&](const uint32_t primitive) { return bin_index(primitive) < best_bin; }
+            );
+            middle = static_cast<uint32_t>(split - m_primitives.begin());
+        } else if (extent[axis] > 0.0f) {
+            // Depth limit reached: median split keeps remaining subtree balanced
+            std::nth_element(
+                m_primitives.begin() + item.begin,
+                m_primitives.begin() + middle,
+                m_primitives.begin() + item.end,
+                [&](const uint32_t lhs, const uint32_t rhs) { return centers[lhs][axis] < centers[rhs][axis]; }
+            );
+        }
+
+        const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+        m_nodes[item.node].first = left;
+        m_nodes[item.node].count = 0;
+        m_nodes.push_back(Node{});
+        m_nodes.push_back(Node{});
+        work.push_back(Work_item{left + 1, middle,     item.end, item.depth + 1});
+        work.push_back(Work_item{left,     item.begin, middle,   item.depth + 1});
+    }
+}
+
+void Bvh_tlas::refit(const std::span<const Aabb> primitive_bounds)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(primitive_bounds.size() == m_primitives.size());
+
+    // Children are always stored after their parent
+    for (std::size_t i = m_nodes.size(); i > 0; --i) {
+        Node& node = m_nodes[i - 1];
+        Aabb  bounds;
+        if (node.count > 0) {
+            for (uint32_t j = node.first, end = node.first + node.count; j < end; ++j) {
+                bounds.extend(primitive_bounds[m_primitives[j]]);
+            }
+        } else {
+            bounds.extend(m_nodes[node.first    ].bounds);
+            bounds.extend(m_nodes[node.first + 1].bounds);
+        }
+        node.bounds = bounds;
+    }
+}
+
+auto Bvh_tlas::is_empty() const -> bool
+{
+    return m_nodes.empty();
+}
+
+auto Bvh_tlas::get_bounds() const -> Aabb
+{
+    return m_nodes.empty() ? Aabb{} : m_nodes.front().bounds;
+}
+
+auto Bvh_tlas::get_node_count() const -> std::size_t
+{
+    return m_nodes.size();
+}
+
+auto Bvh_tlas::get_primitive_count() const -> std::size_t
+{
+    return m_primitives.size();
+}
+
+} // namespace erhe::raytrace
@@ -0,0 +1,386 @@
+#pragma once
+
+#include "erhe_raytrace/ray.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#   define ERHE_RAYTRACE_TLAS_SSE2 1
+#   include <emmintrin.h>
+#endif
+
+namespace erhe::raytrace
+{
+
+class Aabb
+{
+public:
+    [[nodiscard]] auto is_empty() const -> bool
+    {
+        return (min.x > max.x) || (min.y > max.y) || (min.z > max.z);
+    }
+    [[nodiscard]] auto center() const -> glm::vec3
+    {
+        return is_empty() ? glm::vec3{0.0f} : (min + max) * 0.5f;
+    }
+    [[nodiscard]] auto half_area() const -> float
+    {
+        if (is_empty()) {
+            return 0.0f;
+        }
+        const glm::vec3 d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+    void extend(const glm::vec3 point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void extend(const Aabb& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+};
+
+// Bounds of transformed box (Arvo)
+[[nodiscard]] auto transform(const glm::mat4& matrix, const Aabb& aabb) -> Aabb;
+
+// Top level acceleration structure: binary BVH over instance bounds.
+// build() must be called when the set of primitives changes; refit()
+// updates node bounds in place when only primitive bounds change.
+class Bvh_tlas
+{
+public:
+    static constexpr std::size_t s_packet_size = 4;
+
+    void build(std::span<const Aabb> primitive_bounds);
+    void refit(std::span<const Aabb> primitive_bounds);
+    void clear();
+
+    [[nodiscard]] auto is_empty       () const -> bool;
+    [[nodiscard]] auto get_bounds     () const -> Aabb;
+    [[nodiscard]] auto get_node_count () const -> std::size_t;
+    [[nodiscard]] auto get_primitive_count() const -> std::size_t;
+
+    // Visits primitives whose bounds are hit by ray, near to far. callback(primitive)
+    // may shorten ray.t_far; nodes beyond ray.t_far are skipped. Traversal stops
+    // if callback returns true.
+    template <typename Callback>
+    void traverse(const Ray& ray, Callback&& callback) const;
+
+    // Traverses up to s_packet_size rays together, testing node bounds for all
+    // rays of the packet at once (SSE2 when available). callback(primitive, lane)
+    // is called for each ray (lane) hitting primitive bounds and may shorten
+    // rays[lane].t_far. If callback returns true, lane is done and gets no more
+    // callbacks.
+    template <typename Callback>
+    void traverse_packet(std::span<Ray> rays, Callback&& callback) const;
+
+private:
+    class Node
+    {
+    public:
+        Aabb     bounds;
+        uint32_t first{0}; // first primitive for leaf, left child index for interior node (right is first + 1)
+        uint32_t count{0}; // primitive count for leaf, 0 for interior node
+    };
+
+    // Tree depth is at most 32 levels of SAH splits followed by median splits
+    static constexpr std::size_t s_max_depth = 64;
+
+    [[nodiscard]] static auto entry_distance(
+        const Aabb&     bounds,
+        const glm::vec3 origin,
+        const glm::vec3 inverse_direction,
+        float           t_near,
+        float           t_far
+    ) -> float;
+
+    // Rays of a packet in structure of arrays layout
+    class alignas(16) Ray_packet
+    {
+    public:
+        float origin_x[s_packet_size];
+        float origin_y[s_packet_size];
+        float origin_z[s_packet_size];
+        float inverse_direction_x[s_packet_size];
+        float inverse_direction_y[s_packet_size];
+        float inverse_direction_z[s_packet_size];
+        float t_near[s_packet_size];
+        float t_far [s_packet_size];
+    };
+
+    // Returns mask of lanes (from lane_mask) hitting bounds, entry distances to distances
+    [[nodiscard]] static auto packet_entry_distances(
+        const Aabb&       bounds,
+        const Ray_packet& packet,
+        uint32_t          lane_mask,
+        float*            distances
+    ) -> uint32_t;
+
+    [[nodiscard]] static auto safe_inverse(float d) -> float;
+
+    std::vector<Node>     m_nodes;
+    std::vector<uint32_t> m_primitives;
+};
+
+inline auto Bvh_tlas::safe_inverse(const float d) -> float
+{
+    constexpr float tiny = 1.0e-20f;
+    return 1.0f / ((std::abs(d) > tiny) ? d : std::copysign(tiny, d));
+}
+
+inline auto Bvh_tlas::entry_distance(
+    const Aabb&     bounds,
+    const glm::vec3 origin,
+    const glm::vec3 inverse_direction,
+    const float     t_near,
+    const float     t_far
+) -> float
+{
+    if (bounds.is_empty()) {
+        return std::numeric_limits<float>::infinity();
+    }
+    const glm::vec3 t0    = (bounds.min - origin) * inverse_direction;
+    const glm::vec3 t1    = (bounds.max - origin) * inverse_direction;
+    const glm::vec3 t_min = glm::min(t0, t1);
+    const glm::vec3 t_max = glm::max(t0, t1);
+    const float     enter = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, t_near));
+    const float     exit  = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, t_far));
+    return (enter <= exit) ? enter : std::numeric_limits<float>::infinity();
+}
+
+template <typename Callback>
+void Bvh_tlas::traverse(const Ray& ray, Callback&& callback) const
+{
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    const glm::vec3 inverse_direction{
+        safe_inverse(ray.direction.x),
+        safe_inverse(ray.direction.y),
+        safe_inverse(ray.direction.z)
+    };
+
+    class Entry
+    {
+    public:
+        uint32_t node;
+        float    distance;
+    };
+    std::array<Entry, s_max_depth + 2> stack;
+    std::size_t stack_size = 0;
+
+    const float root_distance = entry_distance(m_nodes.front().bounds, ray.origin, inverse_direction, ray.t_near, ray.t_far);
+    if (root_distance == std::numeric_limits<float>::infinity()) {
+        return;
+    }
+    stack[stack_size++] = Entry{0, root_distance};
+    while (stack_size > 0) {
+        const Entry entry = stack[--stack_size];
+        if (entry.distance > ray.t_far) {
+            continue;
+        }
+        const Node& node = m_nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first, end = node.first + node.count; i < end; ++i) {
+                if (callback(m_primitives[i])) {
+                    return;
+                }
+            }
+            continue;
+        }
+        const uint32_t left           = node.first;
+        const uint32_t right          = node.first + 1;
+        const float    left_distance  = entry_distance(m_nodes[left ].bounds, ray.origin, inverse_direction, ray.t_near, ray.t_far);
+        const float    right_distance = entry_distance(m_nodes[right].bounds, ray.origin, inverse_direction, ray.t_near, ray.t_far);
+        const bool     left_hit       = left_distance  != std::numeric_limits<float>::infinity();
+        const bool     right_hit      = right_distance != std::numeric_limits<float>::infinity();
+        // Push far child first so that near child is visited first
+        if (left_hit && right_hit) {
+            if (left_distance <= right_distance) {
+                stack[stack_size++] = Entry{right, right_distance};
+                stack[stack_size++] = Entry{left,  left_distance};
+            } else {
+                stack[stack_size++] = Entry{left,  left_distance};
+                stack[stack_size++] = Entry{right, right_distance};
+            }
+        } else if (left_hit) {
+            stack[stack_size++] = Entry{left, left_distance};
+        } else if (right_hit) {
+            stack[stack_size++] = Entry{right, right_distance};
+        }
+    }
+}
+
+inline auto Bvh_tlas::packet_entry_distances(
+    const Aabb&       bounds,
+    const Ray_packet& packet,
+    const uint32_t    lane_mask,
+    float* const      distances
+) -> uint32_t
+{
+    if (bounds.is_empty() || (lane_mask == 0)) {
+        return 0;
+    }
+#if defined(ERHE_RAYTRACE_TLAS_SSE2)
+    const __m128 t0_x  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.min.x), _mm_load_ps(packet.origin_x)), _mm_load_ps(packet.inverse_direction_x));
+    const __m128 t0_y  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.min.y), _mm_load_ps(packet.origin_y)), _mm_load_ps(packet.inverse_direction_y));
+    const __m128 t0_z  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.min.z), _mm_load_ps(packet.origin_z)), _mm_load_ps(packet.inverse_direction_z));
+    const __m128 t1_x  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.max.x), _mm_load_ps(packet.origin_x)), _mm_load_ps(packet.inverse_direction_x));
+    const __m128 t1_y  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.max.y), _mm_load_ps(packet.origin_y)), _mm_load_ps(packet.inverse_direction_y));
+    const __m128 t1_z  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds.max.z), _mm_load_ps(packet.origin_z)), _mm_load_ps(packet.inverse_direction_z));
+    const __m128 enter = _mm_max_ps(
+        _mm_max_ps(_mm_min_ps(t0_x, t1_x), _mm_min_ps(t0_y, t1_y)),
+        _mm_max_ps(_mm_min_ps(t0_z, t1_z), _mm_load_ps(packet.t_near))
+    );
+    const __m128 exit  = _mm_min_ps(
+        _mm_min_ps(_mm_max_ps(t0_x, t1_x), _mm_max_ps(t0_y, t1_y)),
+        _mm_min_ps(_mm_max_ps(t0_z, t1_z), _mm_load_ps(packet.t_far))
+    );
+    _mm_storeu_ps(distances, enter);
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit))) & lane_mask;
+#else
+    uint32_t hit_mask = 0;
+    for (std::size_t lane = 0; lane < s_packet_size; ++lane) {
+        const float t0_x  = (bounds.min.x - packet.origin_x[lane]) * packet.inverse_direction_x[lane];
+        const float t0_y  = (bounds.min.y - packet.origin_y[lane]) * packet.inverse_direction_y[lane];
+        const float t0_z  = (bounds.min.z - packet.origin_z[lane]) * packet.inverse_direction_z[lane];
+        const float t1_x  = (bounds.max.x - packet.origin_x[lane]) * packet.inverse_direction_x[lane];
+        const float t1_y  = (bounds.max.y - packet.origin_y[lane]) * packet.inverse_direction_y[lane];
+        const float t1_z  = (bounds.max.z - packet.origin_z[lane]) * packet.inverse_direction_z[lane];
+        const float enter = std::max(std::max(std::min(t0_x, t1_x), std::min(t0_y, t1_y)), std::max(std::min(t0_z, t1_z), packet.t_near[lane]));
+        const float exit  = std::min(std::min(std::max(t0_x, t1_x), std::max(t0_y, t1_y)), std::min(std::max(t0_z, t1_z), packet.t_far[lane]));
+        distances[lane] = enter;
+        if (enter <= exit) {
+            hit_mask |= (1u << lane);
+        }
+    }
+    return hit_mask & lane_mask;
+#endif
+}
+
+template <typename Callback>
+void Bvh_tlas::traverse_packet(const std::span<Ray> rays, Callback&& callback) const
+{
+    const std::size_t lane_count = std::min(rays.size(), s_packet_size);
+    if (m_nodes.empty() || (lane_count == 0)) {
+        return;
+    }
+
+    Ray_packet packet;
+    for (std::size_t lane = 0; lane < s_packet_size; ++lane) {
+        // Unused lanes replicate first ray; they are never in lane masks
+        const Ray& ray = rays[(lane < lane_count) ? lane : 0];
+        packet.origin_x           [lane] = ray.origin.x;
+        packet.origin_y           [lane] = ray.origin.y;
+        packet.origin_z           [lane] = ray.origin.z;
+        packet.inverse_direction_x[lane] = safe_inverse(ray.direction.x);
+        packet.inverse_direction_y[lane] = safe_inverse(ray.direction.y);
+        packet.inverse_direction_z[lane] = safe_inverse(ray.direction.z);
+        packet.t_near             [lane] = ray.t_near;
+        packet.t_far              [lane] = ray.t_far;
+    }
+    uint32_t active_mask = (1u << lane_count) - 1u;
+
+    class Entry
+    {
+    public:
+        uint32_t node;
+        uint32_t lane_mask;
+        float    distances[s_packet_size];
+    };
+    std::array<Entry, s_max_depth + 2> stack;
+    std::size_t stack_size = 0;
+
+    const auto min_distance = [](const Entry& entry) {
+        float result = std::numeric_limits<float>::infinity();
+        for (std::size_t lane = 0; lane < s_packet_size; ++lane) {
+            if ((entry.lane_mask & (1u << lane)) != 0) {
+                result = std::min(result, entry.distances[lane]);
+            }
+        }
+        return result;
+    };
+
+    {
+        Entry& root = stack[stack_size];
+        root.node      = 0;
+        root.lane_mask = packet_entry_distances(m_nodes.front().bounds, packet, active_mask, root.distances);
+        if (root.lane_mask == 0) {
+            return;
+        }
+        ++stack_size;
+    }
+    while (stack_size > 0) {
+        const Entry entry = stack[--stack_size];
+
+        // Drop lanes which have found closer hit since entry was pushed
+        uint32_t lane_mask = entry.lane_mask & active_mask;
+        for (std::size_t lane = 0; lane < lane_count; ++lane) {
+            if (entry.distances[lane] > packet.t_far[lane]) {
+                lane_mask &= ~(1u << lane);
+            }
+        }
+        if (lane_mask == 0) {
+            continue;
+        }
+
+        const Node& node = m_nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first, end = node.first + node.count; i < end; ++i) {
+                for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                    const uint32_t lane_bit = 1u << lane;
+                    if ((lane_mask & lane_bit) == 0) {
+                        continue;
+                    }
+                    if (callback(m_primitives[i], lane)) {
+                        lane_mask   &= ~lane_bit;
+                        active_mask &= ~lane_bit;
+                    }
+                    packet.t_far[lane] = rays[lane].t_far;
+                }
+            }
+            if (active_mask == 0) {
+                return;
+            }
+            continue;
+        }
+
+        Entry left;
+        Entry right;
+        left .node      = node.first;
+        right.node      = node.first + 1;
+        left .lane_mask = packet_entry_distances(m_nodes[left .node].bounds, packet, lane_mask, left .distances);
+        right.lane_mask = packet_entry_distances(m_nodes[right.node].bounds, packet, lane_mask, right.distances);
+        // Push far child first so that near child is visited first
+        if ((left.lane_mask != 0) && (right.lane_mask != 0)) {
+            if (min_distance(left) <= min_distance(right)) {
+                stack[stack_size++] = right;
+                stack[stack_size++] = left;
+            } else {
+                stack[stack_size++] = left;
+                stack[stack_size++] = right;
+            }
+        } else if (left.lane_mask != 0) {
+            stack[stack_size++] = left;
+        } else if (right.lane_mask != 0) {
+            stack[stack_size++] = right;
+        }
+    }
+}
+
+} // namespace erhe::raytrace
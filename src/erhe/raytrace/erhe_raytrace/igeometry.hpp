@@ -4,6 +4,11 @@
 #include <memory>
 #include <string_view>
 
+namespace erhe::concurrency
+{
+    class Thread_pool;
+}
+
 namespace erhe::raytrace
 {
 
@@ -158,6 +163,17 @@ public:
     [[nodiscard]] virtual auto is_enabled   () const -> bool             = 0;
     [[nodiscard]] virtual auto debug_label  () const -> std::string_view = 0;
 
+    // Updates acceleration structure after vertex positions have changed,
+    // when topology (index buffer) is unchanged. Default implementation
+    // performs full commit().
+    virtual void refit() { commit(); }
+
+    // Optional pool for work which continues after commit() returns, such
+    // as higher quality acceleration structure builds. Must outlive geometry.
+    // Thread_pool::wait() runs any queued task of the pool, so no thread may
+    // wait for tasks of this pool, or it could stall running a long build.
+    virtual void set_thread_pool(erhe::concurrency::Thread_pool* thread_pool) { static_cast<void>(thread_pool); }
+
     [[nodiscard]] static auto create       (const std::string_view debug_label, const Geometry_type geometry_type) -> IGeometry*;
     [[nodiscard]] static auto create_shared(const std::string_view debug_label, const Geometry_type geometry_type) -> std::shared_ptr<IGeometry>;
     [[nodiscard]] static auto create_unique(const std::string_view debug_label, const Geometry_type geometry_type) -> std::unique_ptr<IGeometry>;
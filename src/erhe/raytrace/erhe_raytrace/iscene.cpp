@@ -0,0 +1,73 @@
+#include "erhe_raytrace/iscene.hpp"
+#include "erhe_raytrace/ray.hpp"
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+#include <limits>
+
+namespace erhe::raytrace
+{
+
+namespace {
+
+constexpr std::size_t s_rays_per_chunk = 64;
+
+}
+
+// Default implementations issue single ray queries; backends may override
+// these with packet traversal.
+
+void IScene::intersect(
+    const std::span<Ray>                  rays,
+    const std::span<Hit>                  hits,
+    erhe::concurrency::Thread_pool* const thread_pool
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(rays.size() == hits.size());
+
+    const auto intersect_range = [this, rays, hits](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            intersect(rays[i], hits[i]);
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, rays.size(), s_rays_per_chunk, intersect_range);
+    } else {
+        intersect_range(0, rays.size());
+    }
+}
+
+auto IScene::occluded(Ray& ray) -> bool
+{
+    Ray ray_copy = ray;
+    Hit hit;
+    if (!intersect(ray_copy, hit)) {
+        return false;
+    }
+    ray.t_far = -std::numeric_limits<float>::infinity();
+    return true;
+}
+
+void IScene::occluded(
+    const std::span<Ray>                  rays,
+    erhe::concurrency::Thread_pool* const thread_pool
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const auto occluded_range = [this, rays](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            occluded(rays[i]);
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(*thread_pool, 0, rays.size(), s_rays_per_chunk, occluded_range);
+    } else {
+        occluded_range(0, rays.size());
+    }
+}
+
+} // namespace erhe::raytrace
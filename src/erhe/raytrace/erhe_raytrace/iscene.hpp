@@ -1,8 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <string_view>
 
+namespace erhe::concurrency
+{
+    class Thread_pool;
+}
+
 namespace erhe::raytrace
 {
 
@@ -22,6 +28,15 @@ public:
     virtual void detach   (IInstance* instance) = 0;
     virtual void commit   () = 0;
     virtual auto intersect(Ray& ray, Hit& hit) -> bool = 0;
+
+    // Batched closest hit queries, rays.size() must match hits.size().
+    // If thread_pool is given, batch is split across its threads.
+    virtual void intersect(std::span<Ray> rays, std::span<Hit> hits, erhe::concurrency::Thread_pool* thread_pool);
+
+    // Any hit queries; occluded rays get t_far = -infinity (as in Embree)
+    virtual auto occluded(Ray& ray) -> bool;
+    virtual void occluded(std::span<Ray> rays, erhe::concurrency::Thread_pool* thread_pool);
+
     [[nodiscard]] virtual auto debug_label() const -> std::string_view = 0;
 
     [[nodiscard]] static auto create       (const std::string_view debug_label) -> IScene*;
@@ -33,9 +33,7 @@ auto Buffer_writer::begin(
     std::size_t                   byte_count
 ) -> gsl::span<std::byte>
 {
-    ERHE_VERIFY(m_buffer == nullptr);
-    m_buffer = buffer;
-    const gl::Buffer_target buffer_target = m_buffer->target();
+    const gl::Buffer_target buffer_target = buffer->target();
 
     switch (buffer_target) {
         //using enum gl::Buffer_target;
@@ -54,6 +52,17 @@ auto Buffer_writer::begin(
         }
     }
 
+    return begin_exact(buffer, byte_count);
+}
+
+auto Buffer_writer::begin_exact(
+    erhe::graphics::Buffer* const buffer,
+    std::size_t                   byte_count
+) -> gsl::span<std::byte>
+{
+    ERHE_VERIFY(m_buffer == nullptr);
+    m_buffer = buffer;
+
     if (byte_count == 0) {
         byte_count = buffer->capacity_byte_count() - write_offset;
     } else {
@@ -77,7 +86,6 @@ auto Buffer_writer::begin(
         m_map = buffer->map().subspan(range.first_byte_offset, byte_count);
         return m_map;
     }
-
 }
 
 auto Buffer_writer::subspan(const std::size_t byte_count) -> gsl::span<std::byte>
@@ -33,6 +33,7 @@ public:
     void shader_storage_align();
     void uniform_align       ();
     auto begin               (erhe::graphics::Buffer* buffer, std::size_t byte_count) -> gsl::span<std::byte>;
+    auto begin_exact         (erhe::graphics::Buffer* buffer, std::size_t byte_count) -> gsl::span<std::byte>; // No alignment of write_offset
     auto subspan             (std::size_t byte_count) -> gsl::span<std::byte>;
     void end                 ();
     void reset               ();
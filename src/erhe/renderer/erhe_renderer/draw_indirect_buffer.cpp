@@ -6,10 +6,13 @@
 #include "erhe_renderer/renderer_log.hpp"
 
 #include "erhe_gl/draw_indirect.hpp"
+#include "erhe_math/math_util.hpp"
 #include "erhe_scene/mesh.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
+#include <cstring>
+
 ////#if defined(ERHE_GUI_LIBRARY_IMGUI)
 ////#   include <imgui/imgui.h>
 ////#endif
@@ -22,8 +25,17 @@ Draw_indirect_buffer::Draw_indirect_buffer(
 )
     : Multi_buffer{graphics_instance, "draw indirect"}
 {
+    int max_persistent_draw_count = -1;
     auto ini = erhe::configuration::get_ini("erhe.ini", "renderer");
-    ini->get("max_draw_count", m_max_draw_count);
+    ini->get("max_draw_count",            m_max_draw_count);
+    ini->get("delta_buffer_updates",      m_delta_updates);
+    ini->get("max_persistent_draw_count", max_persistent_draw_count);
+    if (max_persistent_draw_count < 0) {
+        max_persistent_draw_count = m_max_draw_count;
+    }
+    if (m_delta_updates) {
+        Multi_buffer::reserve_persistent(sizeof(gl::Draw_elements_indirect_command) * max_persistent_draw_count);
+    }
 
     Multi_buffer::allocate(
         gl::Buffer_target::draw_indirect_buffer,
@@ -31,10 +43,161 @@ Draw_indirect_buffer::Draw_indirect_buffer(
     );
 }
 
+void Draw_indirect_buffer::next_frame()
+{
+    Multi_buffer::next_frame();
+    if (m_blocks_generation != persistent_generation()) {
+        // Persistent region was reset - this also drops blocks of keys no longer in use
+        m_persistent_blocks.clear();
+        m_blocks_generation = persistent_generation();
+    }
+    m_write_byte_count = 0;
+}
+
+auto Draw_indirect_buffer::get_write_byte_count() const -> std::size_t
+{
+    return m_write_byte_count;
+}
+
+auto Draw_indirect_buffer::Same_command::operator()(
+    const gl::Draw_elements_indirect_command& lhs,
+    const gl::Draw_elements_indirect_command& rhs
+) const -> bool
+{
+    return std::memcmp(&lhs, &rhs, sizeof(gl::Draw_elements_indirect_command)) == 0;
+}
+
+void Draw_indirect_buffer::gather_commands(
+    const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+    erhe::primitive::Primitive_mode                            primitive_mode,
+    const erhe::Item_filter&                                   filter,
+    const gsl::span<const uint8_t>&                            mesh_visibility
+)
+{
+    ERHE_VERIFY(mesh_visibility.empty() || (mesh_visibility.size() == meshes.size()));
+
+    m_commands.clear();
+    for (std::size_t mesh_index = 0, end = meshes.size(); mesh_index < end; ++mesh_index) {
+        const auto& mesh = meshes[mesh_index];
+        if (!filter(mesh->get_flag_bits())) {
+            continue;
+        }
+        const uint32_t instance_count = (mesh_visibility.empty() || (mesh_visibility[mesh_index] != 0)) ? 1 : 0;
+        for (auto& primitive : mesh->get_primitives()) {
+            const auto& geometry_mesh = primitive.geometry_primitive->gl_geometry_mesh;
+            const auto  index_range   = geometry_mesh.index_range(primitive_mode);
+            if (index_range.index_count == 0) {
+                continue;
+            }
+
+            uint32_t index_count = static_cast<uint32_t>(index_range.index_count);
+            if (m_max_index_count_enable) {
+                index_count = std::min(index_count, static_cast<uint32_t>(m_max_index_count));
+            }
+
+            const uint32_t base_index  = geometry_mesh.base_index();
+            const uint32_t first_index = static_cast<uint32_t>(index_range.first_index + base_index);
+            const uint32_t base_vertex = geometry_mesh.base_vertex();
+            m_commands.push_back(
+                gl::Draw_elements_indirect_command{
+                    index_count,
+                    instance_count,
+                    first_index,
+                    base_vertex,
+                    0  // base instance
+                }
+            );
+        }
+    }
+}
+
+auto Draw_indirect_buffer::update_persistent(
+    const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+    erhe::primitive::Primitive_mode                            primitive_mode,
+    const erhe::Item_filter&                                   filter,
+    const gsl::span<const uint8_t>&                            mesh_visibility,
+    const Persistent_block_key&                                key
+) -> std::optional<Draw_indirect_buffer_range>
+{
+    ERHE_PROFILE_FUNCTION();
+
+    gather_commands(meshes, primitive_mode, filter, mesh_visibility);
+    const std::size_t draw_indirect_count = m_commands.size();
+    if (draw_indirect_count == 0) {
+        return Draw_indirect_buffer_range{};
+    }
+
+    Persistent_block& block      = m_persistent_blocks[key];
+    const uint64_t    frame      = frame_number();
+    const std::size_t entry_size = sizeof(gl::Draw_elements_indirect_command);
+    if (block.used_frame == frame) {
+        // Earlier draw this frame uses the block - share it if commands match, but never overwrite it
+        bool same =
+            (block.primitive_mode  == primitive_mode) &&
+            (block.filter          == filter        ) &&
+            (block.commands.size() == draw_indirect_count);
+        for (std::size_t i = 0; same && (i < draw_indirect_count); ++i) {
+            same = Same_command{}(block.commands[i], m_commands[i]);
+        }
+        if (!same) {
+            return {};
+        }
+        return Draw_indirect_buffer_range{
+            .range = Buffer_range{
+                .first_byte_offset = block.byte_offset,
+                .byte_count        = draw_indirect_count * entry_size
+            },
+            .draw_indirect_count = draw_indirect_count
+        };
+    }
+    block.used_frame = frame;
+
+    if ((block.generation != persistent_generation()) || (block.capacity < draw_indirect_count)) {
+        const std::size_t capacity    = erhe::math::next_power_of_two(static_cast<uint32_t>(draw_indirect_count));
+        const auto        byte_offset = allocate_persistent(capacity * entry_size, sizeof(uint32_t));
+        if (!byte_offset.has_value()) {
+            block = Persistent_block{};
+            return {};
+        }
+        block.byte_offset = byte_offset.value();
+        block.capacity    = capacity;
+        block.generation  = persistent_generation();
+        block.commands.reset_written_frames();
+    }
+
+    block.primitive_mode = primitive_mode;
+    block.filter         = filter;
+    block.commands.resize(draw_indirect_count, frame);
+    for (std::size_t i = 0; i < draw_indirect_count; ++i) {
+        block.commands.update(i, m_commands[i], frame);
+    }
+
+    // Commands are written as one range, including unchanged commands in it
+    const Dirty_range dirty = block.commands.get_dirty_range(current_slot());
+    if (!dirty.empty()) {
+        const std::size_t byte_count = dirty.entry_count() * entry_size;
+        const auto        gpu_data   = begin_persistent_write(block.byte_offset + dirty.first * entry_size, byte_count);
+        erhe::graphics::write(gpu_data, 0, gsl::span<const gl::Draw_elements_indirect_command>{&block.commands[dirty.first], dirty.entry_count()});
+        end_persistent_write(byte_count);
+        m_write_byte_count += byte_count;
+    }
+    block.commands.set_written(current_slot(), frame);
+
+    return Draw_indirect_buffer_range{
+        .range = Buffer_range{
+            .first_byte_offset = block.byte_offset,
+            .byte_count        = draw_indirect_count * entry_size
+        },
+        .draw_indirect_count = draw_indirect_count
+    };
+}
+
 auto Draw_indirect_buffer::update(
     const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
     erhe::primitive::Primitive_mode                            primitive_mode,
-    const erhe::Item_filter&                                   filter
+    const erhe::Item_filter&                                   filter,
+    const gsl::span<const uint8_t>&                            mesh_visibility,
+    const Persistent_block_key&                                key
 ) -> Draw_indirect_buffer_range
 {
     ERHE_PROFILE_FUNCTION();
@@ -46,6 +209,14 @@ auto Draw_indirect_buffer::update(
         m_writer.write_offset
     );
 
+    if (m_delta_updates && (key.owner != nullptr)) {
+        const auto persistent_range = update_persistent(meshes, primitive_mode, filter, mesh_visibility, key);
+        if (persistent_range.has_value()) {
+            return persistent_range.value();
+        }
+        // Persistent region is full, or block is in use - fall back to per frame write
+    }
+
     // Conservative upper limit
     std::size_t primitive_count = 0;
     for (const auto& mesh : meshes) {
@@ -59,14 +230,16 @@ auto Draw_indirect_buffer::update(
     const std::size_t entry_size     = sizeof(gl::Draw_elements_indirect_command);
     const std::size_t max_byte_count = primitive_count * entry_size;
     const auto        gpu_data       = m_writer.begin(&buffer, max_byte_count);
-    uint32_t          instance_count     {1};
     uint32_t          base_instance      {0};
     std::size_t       draw_indirect_count{0};
-    
-    for (const auto& mesh : meshes) {
+    ERHE_VERIFY(mesh_visibility.empty() || (mesh_visibility.size() == meshes.size()));
+
+    for (std::size_t mesh_index = 0, end = meshes.size(); mesh_index < end; ++mesh_index) {
+        const auto& mesh = meshes[mesh_index];
         if (!filter(mesh->get_flag_bits())) {
             continue;
         }
+        const uint32_t instance_count = (mesh_visibility.empty() || (mesh_visibility[mesh_index] != 0)) ? 1 : 0;
 
         if ((m_writer.write_offset + entry_size) > m_writer.write_end) {
             log_render->critical("draw indirect buffer capacity {} exceeded", buffer.capacity_byte_count());
@@ -117,6 +290,7 @@ auto Draw_indirect_buffer::update(
     }
 
     m_writer.end();
+    m_write_byte_count += m_writer.range.byte_count;
 
     SPDLOG_LOGGER_TRACE(log_draw, "wrote {} entries to draw indirect buffer", draw_indirect_count);
     return { m_writer.range, draw_indirect_count };
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "erhe_renderer/multi_buffer.hpp"
+#include "erhe_renderer/persistent_block_entries.hpp"
+#include "erhe_gl/draw_indirect.hpp"
+#include "erhe_item/item.hpp"
 #include "erhe_primitive/enums.hpp"
 
-namespace erhe {
-    class Item_filter;
-}
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace erhe::scene {
     class Mesh;
@@ -29,19 +33,83 @@ public:
         erhe::graphics::Instance& graphics_instance
     );
 
-    // Can discard return value
+    // Can discard return value. When mesh_visibility is given, it has one
+    // entry per mesh; draws of meshes with zero entry get zero instance
+    // count, so draw ids still match primitive buffer entries written for
+    // all meshes. Commands are kept in persistent block of key, if given.
     auto update(
         const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
         erhe::primitive::Primitive_mode                            primitive_mode,
-        const erhe::Item_filter&                            filter
+        const erhe::Item_filter&                                   filter,
+        const gsl::span<const uint8_t>&                            mesh_visibility = {},
+        const Persistent_block_key&                                key             = {}
     ) -> Draw_indirect_buffer_range;
 
+    // Hides Multi_buffer::next_frame()
+    void next_frame();
+
+    // Bytes written to draw indirect buffer since last next_frame()
+    [[nodiscard]] auto get_write_byte_count() const -> std::size_t;
+
     //// void debug_properties_window();
 
 private:
+    // Draw commands of update() calls with the same key. Commands are
+    // rebuilt on CPU each frame, which is cheap, and the range of commands
+    // which differ from what was last written to current frame buffer is
+    // rewritten.
+    class Same_command
+    {
+    public:
+        [[nodiscard]] auto operator()(
+            const gl::Draw_elements_indirect_command& lhs,
+            const gl::Draw_elements_indirect_command& rhs
+        ) const -> bool;
+    };
+
+    class Persistent_block
+    {
+    public:
+        using Commands = Persistent_block_entries<
+            gl::Draw_elements_indirect_command,
+            Multi_buffer::s_frame_resources_count,
+            Same_command
+        >;
+
+        std::size_t                     byte_offset   {0};
+        std::size_t                     capacity      {0}; // in commands
+        uint64_t                        generation    {0}; // Multi_buffer persistent generation
+        uint64_t                        used_frame    {0};
+        erhe::primitive::Primitive_mode primitive_mode{erhe::primitive::Primitive_mode::not_set};
+        erhe::Item_filter               filter;
+        Commands                        commands;
+    };
+
+    void gather_commands(
+        const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+        erhe::primitive::Primitive_mode                            primitive_mode,
+        const erhe::Item_filter&                                   filter,
+        const gsl::span<const uint8_t>&                            mesh_visibility
+    );
+    auto update_persistent(
+        const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+        erhe::primitive::Primitive_mode                            primitive_mode,
+        const erhe::Item_filter&                                   filter,
+        const gsl::span<const uint8_t>&                            mesh_visibility,
+        const Persistent_block_key&                                key
+    ) -> std::optional<Draw_indirect_buffer_range>;
+
     bool m_max_index_count_enable{false};
     int  m_max_index_count       {256};
     int  m_max_draw_count        {8000};
+
+    using Persistent_blocks = std::unordered_map<Persistent_block_key, Persistent_block, Persistent_block_key_hash>;
+
+    bool                                            m_delta_updates{true};
+    Persistent_blocks                               m_persistent_blocks;
+    uint64_t                                        m_blocks_generation{0};
+    std::vector<gl::Draw_elements_indirect_command> m_commands;
+    std::size_t                                     m_write_byte_count {0};
 };
 
 } // namespace erhe::renderer
@@ -18,9 +18,10 @@ Multi_buffer::Multi_buffer(
     erhe::graphics::Instance& graphics_instance,
     const std::string_view    name
 )
-    : m_instance{graphics_instance}
-    , m_writer  {graphics_instance}
-    , m_name    {name}
+    : m_instance         {graphics_instance}
+    , m_writer           {graphics_instance}
+    , m_name             {name}
+    , m_persistent_writer{graphics_instance}
 {
 }
 
@@ -72,18 +73,19 @@ void Multi_buffer::allocate(
     ERHE_VERIFY(gl_helpers::is_indexed(target));
     m_binding_point = binding_point;
 
-    log_multi_buffer->trace("{}: binding point = {} size = {}", m_name, binding_point, size);
+    log_multi_buffer->trace("{}: binding point = {} size = {} persistent size = {}", m_name, binding_point, size, m_persistent_byte_count);
 
     for (std::size_t slot = 0; slot < s_frame_resources_count; ++slot) {
         m_buffers.emplace_back(
             m_instance,
             target,
-            size,
+            m_persistent_byte_count + size,
             storage_mask(m_instance),
             access_mask(m_instance),
             fmt::format("{} {}", m_name, slot)
         );
     }
+    m_writer.write_offset = m_persistent_byte_count;
 }
 
 void Multi_buffer::allocate(
@@ -94,18 +96,19 @@ void Multi_buffer::allocate(
     ERHE_VERIFY(!gl_helpers::is_indexed(target));
     m_binding_point = 0;
 
-    log_multi_buffer->trace("{}: size = {}", m_name, size);
+    log_multi_buffer->trace("{}: size = {} persistent size = {}", m_name, size, m_persistent_byte_count);
 
     for (std::size_t slot = 0; slot < s_frame_resources_count; ++slot) {
         m_buffers.emplace_back(
             m_instance,
             target,
-            size,
+            m_persistent_byte_count + size,
             storage_mask(m_instance),
             access_mask(m_instance),
             fmt::format("{} {}", m_name, slot)
         );
     }
+    m_writer.write_offset = m_persistent_byte_count;
 }
 
 [[nodiscard]] auto Multi_buffer::buffers() -> std::vector<erhe::graphics::Buffer>&
@@ -128,11 +131,75 @@ void Multi_buffer::allocate(
     return m_name;
 }
 
+[[nodiscard]] auto Multi_buffer::current_slot() const -> std::size_t
+{
+    return m_current_slot;
+}
+
+[[nodiscard]] auto Multi_buffer::frame_number() const -> uint64_t
+{
+    return m_frame_number;
+}
+
+void Multi_buffer::reserve_persistent(const std::size_t byte_count)
+{
+    ERHE_VERIFY(m_buffers.empty());
+    m_persistent_byte_count = byte_count;
+}
+
+auto Multi_buffer::allocate_persistent(
+    const std::size_t byte_count,
+    const std::size_t alignment
+) -> std::optional<std::size_t>
+{
+    std::size_t offset = m_persistent_allocated;
+    if ((alignment > 1) && ((offset % alignment) != 0)) {
+        offset += alignment - (offset % alignment);
+    }
+    if (offset + byte_count > m_persistent_byte_count) {
+        log_multi_buffer->debug("{}: persistent region {} bytes full, resetting at next frame", m_name, m_persistent_byte_count);
+        m_persistent_reset_pending = true;
+        return {};
+    }
+    m_persistent_allocated = offset + byte_count;
+    return offset;
+}
+
+auto Multi_buffer::persistent_generation() const -> uint64_t
+{
+    return m_persistent_generation;
+}
+
+auto Multi_buffer::begin_persistent_write(
+    const std::size_t byte_offset,
+    const std::size_t byte_count
+) -> gsl::span<std::byte>
+{
+    ERHE_VERIFY(byte_offset + byte_count <= m_persistent_byte_count);
+    m_persistent_writer.reset();
+    m_persistent_writer.write_offset = byte_offset;
+    return m_persistent_writer.begin_exact(&current_buffer(), byte_count);
+}
+
+void Multi_buffer::end_persistent_write(const std::size_t byte_count)
+{
+    m_persistent_writer.write_offset = byte_count;
+    m_persistent_writer.end();
+}
+
 void Multi_buffer::next_frame()
 {
     m_current_slot = (m_current_slot + 1) % s_frame_resources_count;
+    ++m_frame_number;
 
     m_writer.reset();
+    m_writer.write_offset = m_persistent_byte_count;
+
+    if (m_persistent_reset_pending) {
+        m_persistent_allocated     = 0;
+        m_persistent_reset_pending = false;
+        ++m_persistent_generation;
+    }
 
     SPDLOG_LOGGER_TRACE(
         log_multi_buffer,
@@ -189,6 +256,9 @@ void Multi_buffer::reset()
     m_buffers.clear();
     m_current_slot = 0;
     m_writer.reset();
+    m_persistent_allocated     = 0;
+    m_persistent_reset_pending = false;
+    ++m_persistent_generation;
 }
 
 } // namespace erhe::renderer
@@ -3,11 +3,40 @@
 #include "erhe_renderer/buffer_writer.hpp"
 #include "erhe_graphics/buffer.hpp"
 
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <vector>
 
 namespace erhe::renderer
 {
 
+// Identifies persistent buffer contents over frames by what is drawn, for
+// example owner is render pass or light, view is camera and index is mesh
+// span index. Default key (null owner) means contents have no identity, and
+// are written to the per frame area.
+class Persistent_block_key
+{
+public:
+    const void* owner{nullptr};
+    const void* view {nullptr};
+    std::size_t index{0};
+
+    [[nodiscard]] auto operator==(const Persistent_block_key& other) const -> bool = default;
+};
+
+class Persistent_block_key_hash
+{
+public:
+    [[nodiscard]] auto operator()(const Persistent_block_key& key) const noexcept -> std::size_t
+    {
+        std::size_t hash = std::hash<const void*>{}(key.owner);
+        hash ^= std::hash<const void*>{}(key.view) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<std::size_t>{}(key.index) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
 class Multi_buffer
 {
 public:
@@ -33,11 +62,27 @@ public:
         std::size_t       size
     );
 
+    // Persistent region is kept at start of every frame buffer, before the
+    // per frame write area. Allocations from it have the same offset in all
+    // frame buffers, and contents are not touched by next_frame(), so that
+    // users can update them incrementally. Must be called before allocate().
+    void reserve_persistent(std::size_t byte_count);
+
+    // Returns byte offset, or nullopt if persistent region is full. When the
+    // region gets full, all allocations are dropped at next_frame(), and
+    // persistent_generation() is incremented.
+    [[nodiscard]] auto allocate_persistent   (std::size_t byte_count, std::size_t alignment) -> std::optional<std::size_t>;
+    [[nodiscard]] auto persistent_generation () const -> uint64_t;
+    [[nodiscard]] auto begin_persistent_write(std::size_t byte_offset, std::size_t byte_count) -> gsl::span<std::byte>;
+    void end_persistent_write(std::size_t byte_count);
+
     [[nodiscard]] auto writer        () -> Buffer_writer&;
     [[nodiscard]] auto buffers       () -> std::vector<erhe::graphics::Buffer>&;
     [[nodiscard]] auto buffers       () const -> const std::vector<erhe::graphics::Buffer>&;
     [[nodiscard]] auto current_buffer() -> erhe::graphics::Buffer&;
     [[nodiscard]] auto name          () const -> const std::string&;
+    [[nodiscard]] auto current_slot  () const -> std::size_t;
+    [[nodiscard]] auto frame_number  () const -> uint64_t;
 
 protected:
     erhe::graphics::Instance&           m_instance;
@@ -46,6 +91,12 @@ protected:
     std::size_t                         m_current_slot{0};
     Buffer_writer                       m_writer;
     std::string                         m_name;
+    uint64_t                            m_frame_number            {1};
+    Buffer_writer                       m_persistent_writer;
+    std::size_t                         m_persistent_byte_count   {0};
+    std::size_t                         m_persistent_allocated    {0};
+    uint64_t                            m_persistent_generation   {1};
+    bool                                m_persistent_reset_pending{false};
 };
 
 } // namespace erhe::renderer
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace erhe::renderer
+{
+
+// Entries of a persistent block which changed after the block was last
+// written to a frame buffer. Entries in [first, last] which did not change
+// can be skipped with Persistent_block_entries::is_dirty().
+class Dirty_range
+{
+public:
+    std::size_t first        {0};
+    std::size_t last         {0};
+    std::size_t changed_count{0}; // entries in range which changed
+    uint64_t    written_frame{0}; // when block was last written to frame buffer
+
+    [[nodiscard]] auto empty      () const -> bool        { return changed_count == 0; }
+    [[nodiscard]] auto entry_count() const -> std::size_t { return empty() ? 0 : last - first + 1; }
+};
+
+// Change detection for persistent blocks of Primitive_buffer and
+// Draw_indirect_buffer. Keeps source entries with the frame each last
+// changed, and the frame the block was last written to each of slot_count
+// frame buffers. Does not use GL, so that write byte counts can be measured
+// without a context.
+template <typename Entry, std::size_t slot_count, typename Equal = std::equal_to<Entry>>
+class Persistent_block_entries
+{
+public:
+    void clear()
+    {
+        m_entries.clear();
+        m_changed_frames.clear();
+    }
+
+    // Contents of all frame buffers are lost, for example when the block was
+    // reallocated
+    void reset_written_frames()
+    {
+        m_written_frames.fill(0);
+    }
+
+    // Added entries are default constructed and changed in frame
+    void resize(const std::size_t count, const uint64_t frame)
+    {
+        m_entries.resize(count);
+        m_changed_frames.resize(count, frame);
+    }
+
+    // Replaces entry if source differs from it, returns true if it did
+    auto update(const std::size_t index, const Entry& source, const uint64_t frame) -> bool
+    {
+        if (Equal{}(m_entries[index], source)) {
+            return false;
+        }
+        m_entries[index]        = source;
+        m_changed_frames[index] = frame;
+        return true;
+    }
+
+    [[nodiscard]] auto get_dirty_range(const std::size_t slot) const -> Dirty_range
+    {
+        Dirty_range range{
+            .first         = m_entries.size(),
+            .written_frame = m_written_frames[slot]
+        };
+        for (std::size_t i = 0, end = m_entries.size(); i < end; ++i) {
+            if (m_changed_frames[i] > range.written_frame) {
+                range.first = std::min(range.first, i);
+                range.last  = i;
+                ++range.changed_count;
+            }
+        }
+        if (range.changed_count == 0) {
+            range.first = 0;
+        }
+        return range;
+    }
+
+    [[nodiscard]] auto is_dirty(const std::size_t index, const Dirty_range& range) const -> bool
+    {
+        return m_changed_frames[index] > range.written_frame;
+    }
+
+    void set_written(const std::size_t slot, const uint64_t frame)
+    {
+        m_written_frames[slot] = frame;
+    }
+
+    [[nodiscard]] auto size      ()                        const -> std::size_t  { return m_entries.size(); }
+    [[nodiscard]] auto operator[](const std::size_t index) const -> const Entry& { return m_entries[index]; }
+
+private:
+    std::vector<Entry>               m_entries;
+    std::vector<uint64_t>            m_changed_frames;
+    std::array<uint64_t, slot_count> m_written_frames{};
+};
+
+} // namespace erhe::renderer
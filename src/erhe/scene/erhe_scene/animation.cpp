@@ -2,8 +2,13 @@
 
 #include "erhe_scene/node.hpp"
 #include "erhe_bit/bit_helpers.hpp"
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
+#include <algorithm>
+#include <vector>
+
 namespace erhe::scene
 {
 
@@ -27,6 +32,32 @@ namespace erhe::scene
     }
 }
 
+auto find_keyframe(const std::span<const float> timestamps, const float time, std::size_t cursor) -> std::size_t
+{
+    const std::size_t count = timestamps.size();
+    if (count == 0) {
+        return 0;
+    }
+    if (cursor >= count) {
+        cursor = 0;
+    }
+
+    if (timestamps[cursor] <= time) {
+        if ((cursor + 1 == count) || (time < timestamps[cursor + 1])) {
+            return cursor;
+        }
+        // Forward playback typically advances at most one keyframe
+        if ((cursor + 2 == count) || (time < timestamps[cursor + 2])) {
+            return cursor + 1;
+        }
+    } else if (cursor == 0) {
+        return 0;
+    }
+
+    const auto i = std::upper_bound(timestamps.begin(), timestamps.end(), time);
+    return (i == timestamps.begin()) ? 0 : static_cast<std::size_t>(std::distance(timestamps.begin(), i) - 1);
+}
+
 [[nodiscard]] auto c_str(const Animation_path path) -> const char*
 {
     switch (path) {
@@ -130,34 +161,7 @@ void Animation_sampler::seek(Animation_channel& channel, const float time) const
         return;
     }
 
-    if (timestamps[channel.start_position] == time) {
-        return;
-    }
-
-    while (time < timestamps[channel.start_position]) {
-        if (channel.start_position > 0) {
-            --channel.start_position;
-            continue;
-        }
-        return;
-    }
-
-    if (timestamps[channel.start_position] == time) {
-        return;
-    }
-
-    std::size_t end = timestamps.size();
-    for (;;) {
-        std::size_t next = channel.start_position + 1;
-        if (next == end) {
-            return;
-        }
-        if (time >= timestamps[next]) {
-            channel.start_position = next;
-            continue;
-        }
-        break;
-    }
+    channel.start_position = find_keyframe(timestamps, time, channel.start_position);
 }
 
 auto Animation_sampler::evaluate(
@@ -256,16 +260,13 @@ auto Animation_sampler::evaluate(
     return vec4{0.0f, 0.0f, 0.0f, 0.0f};
 }
 
-void Animation_sampler::apply(
-    Animation_channel& channel,
-    const float        time_current
-) const
-{
-    seek(channel, time_current);
+namespace {
 
-    Trs_transform& target = channel.target->node_data.transforms.parent_from_node;
+constexpr std::size_t s_channels_per_chunk = 256;
 
-    const glm::vec4 value = evaluate(channel, time_current);
+void write_channel_value(Animation_channel& channel, const glm::vec4 value)
+{
+    Trs_transform& target = channel.target->node_data.transforms.parent_from_node;
 
     switch (channel.path) {
         case Animation_path::TRANSLATION: {
@@ -287,6 +288,18 @@ void Animation_sampler::apply(
             break;
         }
     }
+    channel.target->invalidate_world_transforms();
+}
+
+} // anonymous namespace
+
+void Animation_sampler::apply(
+    Animation_channel& channel,
+    const float        time_current
+) const
+{
+    seek(channel, time_current);
+    write_channel_value(channel, evaluate(channel, time_current));
 }
 
 //
@@ -328,11 +341,32 @@ auto Animation::evaluate(
     return value[static_cast<glm::vec4::length_type>(component)];
 }
 
-void Animation::apply(float time_current)
+void Animation::apply(const float time_current, erhe::concurrency::Thread_pool* const thread_pool)
 {
-    for (auto& channel : channels) {
-        auto& sampler = samplers.at(channel.sampler_index);
-        sampler.apply(channel, time_current);
+    ERHE_PROFILE_FUNCTION();
+
+    if ((thread_pool == nullptr) || (channels.size() <= s_channels_per_chunk)) {
+        for (auto& channel : channels) {
+            auto& sampler = samplers.at(channel.sampler_index);
+            sampler.apply(channel, time_current);
+        }
+        return;
+    }
+
+    // Channels which target the same node write to the same Trs_transform
+    std::vector<glm::vec4> values(channels.size());
+    erhe::concurrency::parallel_for(
+        *thread_pool, 0, channels.size(), s_channels_per_chunk,
+        [this, &values, time_current](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                Animation_channel&       channel = channels[i];
+                const Animation_sampler& sampler = samplers.at(channel.sampler_index);
+                values[i] = sampler.evaluate(channel, time_current);
+            }
+        }
+    );
+    for (std::size_t i = 0, end = channels.size(); i < end; ++i) {
+        write_channel_value(channels[i], values[i]);
     }
 }
 
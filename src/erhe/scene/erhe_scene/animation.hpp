@@ -4,8 +4,13 @@
 
 #include <glm/glm.hpp>
 
+#include <span>
 #include <string>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
+
 namespace erhe::scene
 {
 
@@ -31,6 +36,12 @@ enum class Animation_interpolation_mode : int {
 [[nodiscard]] auto c_str(Animation_interpolation_mode interpolation_mode) -> const char*;
 
 [[nodiscard]] auto get_component_count(const Animation_path path) -> std::size_t;
+[[nodiscard]] auto get_key_value_count(Animation_interpolation_mode interpolation_mode) -> std::size_t;
+
+// Returns index of last keyframe with timestamp <= time, or 0 if time is
+// before first keyframe. cursor is previous result; when time has advanced
+// at most one keyframe from it no search is done, otherwise binary search.
+[[nodiscard]] auto find_keyframe(std::span<const float> timestamps, float time, std::size_t cursor) -> std::size_t;
 
 class Animation_channel;
 
@@ -88,7 +99,11 @@ public:
 
     // Public API
     [[nodiscard]] auto evaluate(float time_current, std::size_t channel_index, std::size_t component) -> float;
-    void apply(float time_current);
+
+    // Samples all channels and writes results to target nodes. When thread
+    // pool is given, channels are sampled in parallel; values are always
+    // written to nodes serially.
+    void apply(float time_current, erhe::concurrency::Thread_pool* thread_pool = nullptr);
 
     std::vector<Animation_sampler> samplers;
     std::vector<Animation_channel> channels;
@@ -0,0 +1,433 @@
+#include "erhe_scene/animation_evaluator.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/scene_log.hpp"
+#include "erhe_scene/trs_transform.hpp"
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace erhe::scene
+{
+
+namespace {
+
+constexpr std::size_t s_instances_per_task = 16;
+
+[[nodiscard]] auto get_path_bit(const Animation_path path) -> uint8_t
+{
+    return static_cast<uint8_t>(1u << static_cast<unsigned int>(path));
+}
+
+// Loops below operate on contiguous float rows covering all channels of a
+// group, so that compilers can vectorize them.
+
+void copy_row(const float* const a, float* const out, const std::size_t count)
+{
+    std::copy(a, a + count, out);
+}
+
+void lerp_row(const float* const a, const float* const b, const float t, float* const out, const std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = a[i] + t * (b[i] - a[i]);
+    }
+}
+
+void hermite_row(
+    const float* const start_value,
+    const float* const start_out_tangent,
+    const float* const end_in_tangent,
+    const float* const end_value,
+    const float        t,
+    const float        t_d,
+    float* const       out,
+    const std::size_t  count
+)
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    const float s0 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+    const float s1 = (t3 - 2.0f * t2 + t) * t_d;
+    const float s2 = -2.0f * t3 + 3.0f * t2;
+    const float s3 = (t3 - t2) * t_d;
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = s0 * start_value[i] + s1 * start_out_tangent[i] + s2 * end_value[i] + s3 * end_in_tangent[i];
+    }
+}
+
+// Quaternions are stored x, y, z, w. Matches glm::slerp(): shortest path,
+// and linear interpolation when quaternions are nearly parallel.
+void slerp_row(
+    const float* const a,
+    const float* const b,
+    const float        t,
+    float* const       out,
+    const std::size_t  quaternion_count
+)
+{
+    for (std::size_t q = 0; q < quaternion_count; ++q) {
+        const float* const qa = a + q * 4;
+        const float* const qb = b + q * 4;
+        float cos_theta = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+        float sign      = 1.0f;
+        if (cos_theta < 0.0f) {
+            cos_theta = -cos_theta;
+            sign      = -1.0f;
+        }
+        float wa;
+        float wb;
+        if (cos_theta > 1.0f - std::numeric_limits<float>::epsilon()) {
+            wa = 1.0f - t;
+            wb = t;
+        } else {
+            const float angle     = std::acos(cos_theta);
+            const float sin_angle = std::sin(angle);
+            wa = std::sin((1.0f - t) * angle) / sin_angle;
+            wb = std::sin(t * angle) / sin_angle;
+        }
+        wb *= sign;
+        float* const o = out + q * 4;
+        for (std::size_t i = 0; i < 4; ++i) {
+            o[i] = wa * qa[i] + wb * qb[i];
+        }
+    }
+}
+
+void normalize_quaternions(float* const values, const std::size_t quaternion_count)
+{
+    for (std::size_t q = 0; q < quaternion_count; ++q) {
+        float* const v = values + q * 4;
+        const float length_squared = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3];
+        if (length_squared > 0.0f) {
+            const float scale = 1.0f / std::sqrt(length_squared);
+            for (std::size_t i = 0; i < 4; ++i) {
+                v[i] *= scale;
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+Animation_evaluator::Animation_evaluator(const Animation& animation)
+    : m_channel_count{animation.channels.size()}
+{
+    ERHE_PROFILE_FUNCTION();
+
+    m_default_targets.resize(m_channel_count);
+    for (std::size_t channel_index = 0; channel_index < m_channel_count; ++channel_index) {
+        const Animation_channel& channel = animation.channels[channel_index];
+        m_default_targets[channel_index] = channel.target;
+
+        const std::size_t component_count = get_component_count(channel.path);
+        if ((component_count == 0) || (channel.sampler_index >= animation.samplers.size())) {
+            continue;
+        }
+        const Animation_sampler& sampler         = animation.samplers[channel.sampler_index];
+        const std::size_t        key_value_count = get_key_value_count(sampler.interpolation_mode);
+        const std::size_t        key_count       = sampler.timestamps.size();
+        if (
+            (key_value_count == 0) ||
+            (key_count == 0) ||
+            (sampler.data.size() < key_count * key_value_count * component_count)
+        ) {
+            log->warn(
+                "Animation `{}` channel {} has invalid sampler - channel ignored",
+                animation.get_name(), channel_index
+            );
+            continue;
+        }
+
+        auto i = std::find_if(
+            m_groups.begin(),
+            m_groups.end(),
+            [&](const Channel_group& group) {
+                return
+                    (group.path               == channel.path) &&
+                    (group.interpolation_mode == sampler.interpolation_mode) &&
+                    (
+                        (group.sampler_index == channel.sampler_index) ||
+                        (group.timestamps    == sampler.timestamps)
+                    );
+            }
+        );
+        if (i == m_groups.end()) {
+            m_groups.push_back(
+                Channel_group{
+                    .path               = channel.path,
+                    .interpolation_mode = sampler.interpolation_mode,
+                    .component_count    = component_count,
+                    .key_value_count    = key_value_count,
+                    .sampler_index      = channel.sampler_index,
+                    .timestamps         = sampler.timestamps,
+                    .channels           = {},
+                    .values             = {}
+                }
+            );
+            i = std::prev(m_groups.end());
+        }
+        i->channels.push_back(static_cast<uint32_t>(channel_index));
+    }
+
+    // Repack keyframe values of each group
+    std::size_t slot_offset = 0;
+    for (Channel_group& group : m_groups) {
+        const std::size_t key_count     = group.timestamps.size();
+        const std::size_t channel_count = group.channels.size();
+        const std::size_t stride        = group.key_value_count * group.component_count;
+        group.values.resize(key_count * stride * channel_count);
+        for (std::size_t c = 0; c < channel_count; ++c) {
+            const Animation_channel& channel = animation.channels[group.channels[c]];
+            const Animation_sampler& sampler = animation.samplers[channel.sampler_index];
+            for (std::size_t k = 0; k < key_count; ++k) {
+                for (std::size_t v = 0; v < group.key_value_count; ++v) {
+                    const float* const src = &sampler.data[(k * group.key_value_count + v) * group.component_count];
+                    float* const       dst = &group.values[((k * group.key_value_count + v) * channel_count + c) * group.component_count];
+                    std::copy(src, src + group.component_count, dst);
+                }
+            }
+        }
+        m_group_slot_offsets.push_back(slot_offset);
+        slot_offset += channel_count;
+        m_max_row_size = std::max(m_max_row_size, group.get_row_size());
+        m_shared_values.emplace_back(group.get_row_size());
+    }
+    m_shared_cursors.resize(m_groups.size(), 0);
+
+    log->trace(
+        "Animation `{}`: {} channels in {} groups",
+        animation.get_name(), m_channel_count, m_groups.size()
+    );
+}
+
+Animation_evaluator::~Animation_evaluator() noexcept = default;
+
+auto Animation_evaluator::add_instance(const std::span<const std::shared_ptr<Node>> targets) -> std::size_t
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(targets.size() == m_channel_count);
+
+    Instance instance;
+    instance.cursors.resize(m_groups.size(), 0);
+    instance.scratch.resize(m_max_row_size);
+    for (const Channel_group& group : m_groups) {
+        for (const uint32_t channel_index : group.channels) {
+            const std::shared_ptr<Node>& target = targets[channel_index];
+            if (!target) {
+                instance.slots.push_back(Instance::c_no_slot);
+                continue;
+            }
+            const auto i = std::find(instance.nodes.begin(), instance.nodes.end(), target);
+            const std::size_t slot = static_cast<std::size_t>(std::distance(instance.nodes.begin(), i));
+            if (i == instance.nodes.end()) {
+                instance.nodes.push_back(target);
+                instance.path_masks.push_back(0);
+            }
+            instance.path_masks[slot] |= get_path_bit(group.path);
+            instance.slots.push_back(static_cast<uint32_t>(slot));
+        }
+    }
+    const std::size_t node_count = instance.nodes.size();
+    instance.translations.resize(node_count, glm::vec3{0.0f});
+    instance.rotations   .resize(node_count, glm::quat{1.0f, 0.0f, 0.0f, 0.0f});
+    instance.scales      .resize(node_count, glm::vec3{1.0f});
+
+    m_instances.push_back(std::move(instance));
+    return m_instances.size() - 1;
+}
+
+auto Animation_evaluator::add_instance() -> std::size_t
+{
+    return add_instance(m_default_targets);
+}
+
+auto Animation_evaluator::get_instance_count() const -> std::size_t
+{
+    return m_instances.size();
+}
+
+auto Animation_evaluator::get_group_count() const -> std::size_t
+{
+    return m_groups.size();
+}
+
+auto Animation_evaluator::get_channel_count() const -> std::size_t
+{
+    return m_channel_count;
+}
+
+void Animation_evaluator::evaluate_group(
+    const Channel_group&   group,
+    const float            time,
+    uint32_t&              cursor,
+    const std::span<float> out
+) const
+{
+    const std::size_t key_count     = group.timestamps.size();
+    const std::size_t channel_count = group.channels.size();
+    const std::size_t row_size      = group.get_row_size();
+    const std::size_t key_size      = group.key_value_count * row_size;
+    const std::size_t value_row     = (group.key_value_count == 3) ? 1 : 0; // in tangent, value, out tangent
+    const std::size_t k             = find_keyframe(group.timestamps, time, cursor);
+    cursor = static_cast<uint32_t>(k);
+
+    const float* const start = &group.values[k * key_size];
+    if (
+        (time <= group.timestamps[k]) ||
+        (k + 1 == key_count) ||
+        (group.interpolation_mode == Animation_interpolation_mode::STEP)
+    ) {
+        copy_row(start + value_row * row_size, out.data(), row_size);
+        return;
+    }
+
+    const float  t_start = group.timestamps[k];
+    const float  t_d     = group.timestamps[k + 1] - t_start;
+    const float  t       = (time - t_start) / t_d;
+    const float* next    = start + key_size;
+
+    if (group.interpolation_mode == Animation_interpolation_mode::CUBICSPLINE) {
+        hermite_row(
+            start + 1 * row_size, // start value
+            start + 2 * row_size, // start out tangent
+            next,                 // end in tangent
+            next  + 1 * row_size, // end value
+            t, t_d, out.data(), row_size
+        );
+        if (group.path == Animation_path::ROTATION) {
+            normalize_quaternions(out.data(), channel_count);
+        }
+        return;
+    }
+
+    if (group.path == Animation_path::ROTATION) {
+        slerp_row(start, next, t, out.data(), channel_count);
+    } else {
+        lerp_row(start, next, t, out.data(), row_size);
+    }
+}
+
+void Animation_evaluator::scatter_group(
+    const std::size_t            group_index,
+    const std::span<const float> values,
+    Instance&                    instance
+) const
+{
+    const Channel_group& group         = m_groups[group_index];
+    const std::size_t    channel_count = group.channels.size();
+    const uint32_t*      slots         = &instance.slots[m_group_slot_offsets[group_index]];
+    for (std::size_t c = 0; c < channel_count; ++c) {
+        const uint32_t slot = slots[c];
+        if (slot == Instance::c_no_slot) {
+            continue;
+        }
+        const float* const v = &values[c * group.component_count];
+        switch (group.path) {
+            case Animation_path::TRANSLATION: instance.translations[slot] = glm::vec3{v[0], v[1], v[2]}; break;
+            case Animation_path::ROTATION:    instance.rotations   [slot] = glm::quat{v[3], v[0], v[1], v[2]}; break;
+            case Animation_path::SCALE:       instance.scales      [slot] = glm::vec3{v[0], v[1], v[2]}; break;
+            default: break;
+        }
+    }
+}
+
+void Animation_evaluator::write_instance(Instance& instance) const
+{
+    const uint8_t translation_bit = get_path_bit(Animation_path::TRANSLATION);
+    const uint8_t rotation_bit    = get_path_bit(Animation_path::ROTATION);
+    const uint8_t scale_bit       = get_path_bit(Animation_path::SCALE);
+    for (std::size_t slot = 0, end = instance.nodes.size(); slot < end; ++slot) {
+        Node&          node      = *instance.nodes[slot];
+        Trs_transform& transform = node.node_data.transforms.parent_from_node;
+        const uint8_t  mask      = instance.path_masks[slot];
+        transform.set_trs(
+            ((mask & translation_bit) != 0) ? instance.translations[slot] : transform.get_translation(),
+            ((mask & rotation_bit   ) != 0) ? instance.rotations   [slot] : transform.get_rotation(),
+            ((mask & scale_bit      ) != 0) ? instance.scales      [slot] : transform.get_scale()
+        );
+        if (node.get_scene() != nullptr) {
+            node.invalidate_world_transforms();
+        } else {
+            instance.detached_nodes.push_back(&node);
+        }
+    }
+
+    // Nodes outside scenes are updated immediately, parents before children
+    if (instance.detached_nodes.empty()) {
+        return;
+    }
+    std::sort(
+        instance.detached_nodes.begin(),
+        instance.detached_nodes.end(),
+        [](const Node* lhs, const Node* rhs) {
+            return lhs->get_depth() < rhs->get_depth();
+        }
+    );
+    for (Node* node : instance.detached_nodes) {
+        node->invalidate_world_transforms();
+    }
+    instance.detached_nodes.clear();
+}
+
+void Animation_evaluator::apply(const float time, erhe::concurrency::Thread_pool* const thread_pool)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    for (std::size_t group_index = 0, end = m_groups.size(); group_index < end; ++group_index) {
+        evaluate_group(m_groups[group_index], time, m_shared_cursors[group_index], m_shared_values[group_index]);
+    }
+
+    const auto scatter_instance = [this](const std::size_t instance_index) {
+        Instance& instance = m_instances[instance_index];
+        for (std::size_t group_index = 0, end = m_groups.size(); group_index < end; ++group_index) {
+            scatter_group(group_index, m_shared_values[group_index], instance);
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for_each_index(*thread_pool, 0, m_instances.size(), s_instances_per_task, scatter_instance);
+    } else {
+        for (std::size_t instance_index = 0, end = m_instances.size(); instance_index < end; ++instance_index) {
+            scatter_instance(instance_index);
+        }
+    }
+
+    for (Instance& instance : m_instances) {
+        write_instance(instance);
+    }
+}
+
+void Animation_evaluator::apply(const std::span<const float> times, erhe::concurrency::Thread_pool* const thread_pool)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    ERHE_VERIFY(times.size() == m_instances.size());
+
+    const auto evaluate_instance = [this, times](const std::size_t instance_index) {
+        Instance&   instance = m_instances[instance_index];
+        const float time     = times[instance_index];
+        for (std::size_t group_index = 0, end = m_groups.size(); group_index < end; ++group_index) {
+            const Channel_group&   group  = m_groups[group_index];
+            const std::span<float> values{instance.scratch.data(), group.get_row_size()};
+            evaluate_group(group, time, instance.cursors[group_index], values);
+            scatter_group(group_index, values, instance);
+        }
+    };
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for_each_index(*thread_pool, 0, m_instances.size(), s_instances_per_task, evaluate_instance);
+    } else {
+        for (std::size_t instance_index = 0, end = m_instances.size(); instance_index < end; ++instance_index) {
+            evaluate_instance(instance_index);
+        }
+    }
+
+    for (Instance& instance : m_instances) {
+        write_instance(instance);
+    }
+}
+
+} // namespace erhe::scene
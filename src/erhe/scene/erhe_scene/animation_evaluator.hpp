@@ -0,0 +1,121 @@
+#pragma once
+
+#include "erhe_scene/animation.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace erhe::concurrency
+{
+    class Thread_pool;
+}
+
+namespace erhe::scene
+{
+
+class Node;
+
+// Evaluates one Animation for many instances (sets of target nodes) per call.
+//
+// Channels which share keyframe timestamps, interpolation mode and path are
+// grouped, and their keyframe values are repacked so that values of all
+// channels of a group for one keyframe are contiguous. Each group is then
+// evaluated with a single keyframe search and one interpolation loop over
+// all of its channels. Each instance keeps a keyframe cursor per group, so
+// sequential playback does not search, and random seeks use binary search.
+//
+// Results are gathered per target node, and each node gets a single TRS
+// update per apply(), after which it is marked dirty for
+// Scene::update_node_transforms(). Target nodes which are not in a scene
+// have their world transforms updated by apply().
+class Animation_evaluator
+{
+public:
+    explicit Animation_evaluator(const Animation& animation);
+    ~Animation_evaluator() noexcept;
+
+    // Binds targets of one instance: targets[i] is animated by channel i
+    // of the animation. Channels with nullptr target are skipped.
+    // Returns instance index.
+    auto add_instance(std::span<const std::shared_ptr<Node>> targets) -> std::size_t;
+
+    // Binds channel targets of the animation itself
+    auto add_instance() -> std::size_t;
+
+    [[nodiscard]] auto get_instance_count() const -> std::size_t;
+    [[nodiscard]] auto get_group_count   () const -> std::size_t;
+    [[nodiscard]] auto get_channel_count () const -> std::size_t;
+
+    // Samples all instances at same time. Groups are evaluated once and
+    // results are shared by all instances.
+    void apply(float time, erhe::concurrency::Thread_pool* thread_pool = nullptr);
+
+    // Samples instance i at times[i]. When thread pool is given, instances
+    // are evaluated in parallel; nodes are always updated serially.
+    void apply(std::span<const float> times, erhe::concurrency::Thread_pool* thread_pool = nullptr);
+
+private:
+    class Channel_group
+    {
+    public:
+        [[nodiscard]] auto get_row_size() const -> std::size_t { return channels.size() * component_count; }
+
+        Animation_path               path              {Animation_path::INVALID};
+        Animation_interpolation_mode interpolation_mode{Animation_interpolation_mode::INVALID};
+        std::size_t                  component_count   {0};
+        std::size_t                  key_value_count   {0};
+        std::size_t                  sampler_index     {0};
+        std::vector<float>           timestamps;
+        std::vector<uint32_t>        channels; // channel indices in animation
+
+        // Keyframe k, key value v (in tangent, value, out tangent for cubic
+        // spline), channel c, component i is at
+        // values[((k * key_value_count + v) * channel_count + c) * component_count + i]
+        std::vector<float>           values;
+    };
+
+    class Instance
+    {
+    public:
+        static constexpr uint32_t c_no_slot = 0xffffffffu;
+
+        std::vector<std::shared_ptr<Node>> nodes;       // unique targets
+        std::vector<uint8_t>               path_masks;  // per node, bit per animated Animation_path
+        std::vector<uint32_t>              slots;       // per group channel, in group order: node index
+        std::vector<uint32_t>              cursors;     // per group: keyframe index
+        std::vector<glm::vec3>             translations;
+        std::vector<glm::quat>             rotations;
+        std::vector<glm::vec3>             scales;
+        std::vector<float>                 scratch;     // group evaluation output
+        std::vector<Node*>                 detached_nodes; // not in scene, updated in depth order
+    };
+
+    void evaluate_group(
+        const Channel_group& group,
+        float                time,
+        uint32_t&            cursor,
+        std::span<float>     out
+    ) const;
+    void scatter_group(
+        std::size_t            group_index,
+        std::span<const float> values,
+        Instance&              instance
+    ) const;
+    void write_instance(Instance& instance) const;
+
+    std::vector<Channel_group>         m_groups;
+    std::vector<std::size_t>           m_group_slot_offsets; // first entry of group in Instance::slots
+    std::vector<uint32_t>              m_shared_cursors;     // per group, for apply(float)
+    std::vector<std::vector<float>>    m_shared_values;      // per group, for apply(float)
+    std::vector<std::shared_ptr<Node>> m_default_targets;
+    std::size_t                        m_channel_count{0};
+    std::size_t                        m_max_row_size {0};
+    std::vector<Instance>              m_instances;
+};
+
+} // namespace erhe::scene
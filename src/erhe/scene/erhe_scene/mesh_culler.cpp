@@ -0,0 +1,207 @@
+#include "erhe_scene/mesh_culler.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_concurrency/parallel.hpp"
+#include "erhe_math/math_util.hpp"
+#include "erhe_profile/profile.hpp"
+#include "erhe_verify/verify.hpp"
+
+#include <cmath>
+
+namespace erhe::scene
+{
+
+namespace {
+
+constexpr std::size_t s_meshes_per_task = 256;
+
+enum Mesh_state : uint8_t {
+    mesh_state_filtered  = 0,
+    mesh_state_unbounded = 1,
+    mesh_state_culled    = 2,
+    mesh_state_visible   = 3
+};
+
+}
+
+void Mesh_culler::gather_bounds(
+    const Mesh_span&  meshes,
+    const std::size_t first,
+    const std::size_t begin,
+    const std::size_t end
+)
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        const std::size_t slot = first + i;
+        const Mesh&       mesh = *meshes[i];
+        if (m_state[slot] == mesh_state_filtered) {
+            continue;
+        }
+        if (mesh.skin) {
+            // Skinned vertices may move outside of bind pose bounding box
+            m_state[slot] = mesh_state_unbounded;
+            continue;
+        }
+
+        erhe::math::Bounding_box local_box;
+        for (const auto& primitive : mesh.get_primitives()) {
+            if (!primitive.geometry_primitive) {
+                continue;
+            }
+            const erhe::math::Bounding_box& box = primitive.geometry_primitive->gl_geometry_mesh.bounding_box;
+            local_box.min = glm::min(local_box.min, box.min);
+            local_box.max = glm::max(local_box.max, box.max);
+        }
+        if ((local_box.min.x > local_box.max.x) || (local_box.min.y > local_box.max.y) || (local_box.min.z > local_box.max.z)) {
+            m_state[slot] = mesh_state_unbounded;
+            continue;
+        }
+
+        // World space axis aligned box enclosing transformed local box
+        const glm::mat4 world_from_node = mesh.get_node()->world_from_node();
+        const glm::vec3 center          = local_box.center();
+        const glm::vec3 half_extent     = 0.5f * local_box.diagonal();
+        const glm::vec4 world_center    = world_from_node * glm::vec4{center, 1.0f};
+        glm::vec3 world_extent{0.0f};
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                world_extent[row] += std::abs(world_from_node[column][row]) * half_extent[column];
+            }
+        }
+        m_center_x[slot] = world_center.x;
+        m_center_y[slot] = world_center.y;
+        m_center_z[slot] = world_center.z;
+        m_extent_x[slot] = world_extent.x;
+        m_extent_y[slot] = world_extent.y;
+        m_extent_z[slot] = world_extent.z;
+        m_state   [slot] = mesh_state_visible;
+    }
+}
+
+void Mesh_culler::test_planes(const glm::mat4& clip_from_world, const std::size_t begin, const std::size_t end)
+{
+    const erhe::math::Frustum_planes frustum{clip_from_world};
+
+    const float* const center_x = m_center_x.data();
+    const float* const center_y = m_center_y.data();
+    const float* const center_z = m_center_z.data();
+    const float* const extent_x = m_extent_x.data();
+    const float* const extent_y = m_extent_y.data();
+    const float* const extent_z = m_extent_z.data();
+    uint8_t* const     state    = m_state.data();
+    for (const glm::vec4& plane : frustum.planes) {
+        const float abs_x = std::abs(plane.x);
+        const float abs_y = std::abs(plane.y);
+        const float abs_z = std::abs(plane.z);
+        for (std::size_t i = begin; i < end; ++i) {
+            const float distance = plane.x * center_x[i] + plane.y * center_y[i] + plane.z * center_z[i] + plane.w;
+            const float radius   = abs_x * extent_x[i] + abs_y * extent_y[i] + abs_z * extent_z[i];
+            const bool  outside  = (distance + radius) < 0.0f;
+            state[i] = (outside && (state[i] == mesh_state_visible)) ? uint8_t{mesh_state_culled} : state[i];
+        }
+    }
+}
+
+auto Mesh_culler::cull(
+    const glm::mat4&                      clip_from_world,
+    const std::vector<Mesh_span>&         mesh_spans,
+    const erhe::Item_filter&              filter,
+    erhe::concurrency::Thread_pool* const thread_pool
+) -> const std::vector<Mesh_span>&
+{
+    ERHE_PROFILE_FUNCTION();
+
+    m_statistics = Culling_statistics{};
+
+    std::size_t mesh_count = 0;
+    for (const Mesh_span& meshes : mesh_spans) {
+        mesh_count += meshes.size();
+    }
+    m_center_x.resize(mesh_count);
+    m_center_y.resize(mesh_count);
+    m_center_z.resize(mesh_count);
+    m_extent_x.resize(mesh_count);
+    m_extent_y.resize(mesh_count);
+    m_extent_z.resize(mesh_count);
+    m_state   .resize(mesh_count);
+    m_visibility.resize(mesh_count);
+
+    // Item filter and node attachment checks
+    {
+        std::size_t slot = 0;
+        for (const Mesh_span& meshes : mesh_spans) {
+            for (const std::shared_ptr<Mesh>& mesh : meshes) {
+                const bool accepted = filter(mesh->get_flag_bits()) && (mesh->get_node() != nullptr);
+                m_state[slot++] = accepted ? mesh_state_visible : mesh_state_filtered;
+            }
+        }
+    }
+
+    std::size_t first = 0;
+    for (const Mesh_span& meshes : mesh_spans) {
+        if (thread_pool != nullptr) {
+            erhe::concurrency::parallel_for(
+                *thread_pool, 0, meshes.size(), s_meshes_per_task,
+                [this, &meshes, first](const std::size_t begin, const std::size_t end) {
+                    gather_bounds(meshes, first, begin, end);
+                }
+            );
+        } else {
+            gather_bounds(meshes, first, 0, meshes.size());
+        }
+        first += meshes.size();
+    }
+
+    if (thread_pool != nullptr) {
+        erhe::concurrency::parallel_for(
+            *thread_pool, 0, mesh_count, s_meshes_per_task,
+            [this, &clip_from_world](const std::size_t begin, const std::size_t end) {
+                test_planes(clip_from_world, begin, end);
+            }
+        );
+    } else {
+        test_planes(clip_from_world, 0, mesh_count);
+    }
+
+    // Compact visible lists, keeping input order
+    m_visible_meshes.resize(mesh_spans.size());
+    m_visible_spans.clear();
+    m_span_offsets.clear();
+    std::size_t slot = 0;
+    for (std::size_t span_index = 0, span_end = mesh_spans.size(); span_index < span_end; ++span_index) {
+        std::vector<std::shared_ptr<Mesh>>& visible = m_visible_meshes[span_index];
+        visible.clear();
+        m_span_offsets.push_back(slot);
+        for (const std::shared_ptr<Mesh>& mesh : mesh_spans[span_index]) {
+            const uint8_t state = m_state[slot];
+            switch (state) {
+                case mesh_state_filtered:  ++m_statistics.filtered_mesh_count; break;
+                case mesh_state_culled:    ++m_statistics.culled_mesh_count;   break;
+                case mesh_state_unbounded: ++m_statistics.unbounded_mesh_count; visible.push_back(mesh); break;
+                case mesh_state_visible:   visible.push_back(mesh); break;
+                default: break;
+            }
+            m_visibility[slot++] = ((state == mesh_state_unbounded) || (state == mesh_state_visible)) ? 1 : 0;
+        }
+        m_statistics.visible_mesh_count += visible.size();
+        m_visible_spans.emplace_back(visible);
+    }
+    m_span_offsets.push_back(slot);
+    m_statistics.mesh_count = mesh_count;
+    return m_visible_spans;
+}
+
+auto Mesh_culler::get_visibility(const std::size_t span_index) const -> std::span<const uint8_t>
+{
+    ERHE_VERIFY(span_index + 1 < m_span_offsets.size());
+    const std::size_t begin = m_span_offsets[span_index];
+    const std::size_t end   = m_span_offsets[span_index + 1];
+    return std::span<const uint8_t>{m_visibility.data() + begin, end - begin};
+}
+
+auto Mesh_culler::get_statistics() const -> const Culling_statistics&
+{
+    return m_statistics;
+}
+
+} // namespace erhe::scene
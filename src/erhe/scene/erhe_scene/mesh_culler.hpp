@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace erhe {
+    class Item_filter;
+}
+namespace erhe::concurrency {
+    class Thread_pool;
+}
+
+namespace erhe::scene
+{
+
+class Mesh;
+
+class Culling_statistics
+{
+public:
+    std::size_t mesh_count          {0}; // input meshes
+    std::size_t filtered_mesh_count {0}; // rejected by item filter, or not attached to node
+    std::size_t unbounded_mesh_count{0}; // skinned or without bounding box, not tested and kept
+    std::size_t culled_mesh_count   {0}; // outside view volume
+    std::size_t visible_mesh_count  {0}; // in output lists, including unbounded meshes
+};
+
+// CPU view volume culling of meshes. Mesh local bounding boxes (union of
+// primitive bounding boxes) are transformed to world space, then tested
+// against frustum planes of clip_from_world. Bounds are kept in SoA arrays
+// and tested one plane at a time over all meshes, so that compilers can
+// vectorize the loops. Output lists keep input order, and also apply item
+// filter, so that renderers can pass them directly to primitive and draw
+// indirect buffer updates.
+class Mesh_culler
+{
+public:
+    using Mesh_span = std::span<const std::shared_ptr<Mesh>>;
+
+    // Returns one output span per input span. Output spans remain valid
+    // until next call to cull().
+    auto cull(
+        const glm::mat4&                clip_from_world,
+        const std::vector<Mesh_span>&   mesh_spans,
+        const erhe::Item_filter&        filter,
+        erhe::concurrency::Thread_pool* thread_pool = nullptr
+    ) -> const std::vector<Mesh_span>&;
+
+    // Statistics of last cull() call
+    [[nodiscard]] auto get_statistics() const -> const Culling_statistics&;
+
+    // Per mesh of input span of last cull() call: 1 when mesh is in output
+    // list, 0 when culled or filtered. Lets renderers keep buffers written
+    // for the whole input span and only skip draws of culled meshes.
+    [[nodiscard]] auto get_visibility(std::size_t span_index) const -> std::span<const uint8_t>;
+
+private:
+    void gather_bounds(const Mesh_span& meshes, std::size_t first, std::size_t begin, std::size_t end);
+    void test_planes  (const glm::mat4& clip_from_world, std::size_t begin, std::size_t end);
+
+    // Per mesh, over all input spans
+    std::vector<float>   m_center_x;
+    std::vector<float>   m_center_y;
+    std::vector<float>   m_center_z;
+    std::vector<float>   m_extent_x;
+    std::vector<float>   m_extent_y;
+    std::vector<float>   m_extent_z;
+    std::vector<uint8_t> m_state;
+    std::vector<uint8_t> m_visibility;
+
+    std::vector<std::vector<std::shared_ptr<Mesh>>> m_visible_meshes;
+    std::vector<Mesh_span>                          m_visible_spans;
+    std::vector<std::size_t>                        m_span_offsets; // first mesh of input span, and end
+    Culling_statistics                              m_statistics;
+};
+
+} // namespace erhe::scene
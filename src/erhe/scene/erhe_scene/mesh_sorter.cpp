@@ -0,0 +1,247 @@
+#include "erhe_scene/mesh_sorter.hpp"
+#include "erhe_scene/mesh.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_primitive/material.hpp"
+#include "erhe_profile/profile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace erhe::scene
+{
+
+namespace {
+
+constexpr uint32_t c_no_material        = 0xffffffffu;
+constexpr uint64_t c_material_mask      = 0x7fffu;   // 15 bits
+constexpr uint64_t c_depth_bucket_mask  = 0xffffffu; // 24 bits
+constexpr uint64_t c_translucent_bit    = uint64_t{1} << 63;
+constexpr int      c_radix_bits         = 8;
+constexpr int      c_radix_pass_count   = 64 / c_radix_bits;
+constexpr int      c_radix_bucket_count = 1 << c_radix_bits;
+
+[[nodiscard]] auto get_material_index(const Mesh& mesh) -> uint32_t
+{
+    const auto& primitives = mesh.get_primitives();
+    if (primitives.empty() || !primitives.front().material) {
+        return c_no_material;
+    }
+    return primitives.front().material->material_buffer_index;
+}
+
+}
+
+auto Mesh_sorter::make_sort_key(
+    const bool     translucent,
+    const uint32_t material_index,
+    const float    distance_squared
+) -> uint64_t
+{
+    // Bits of non-negative float compare like the float itself. Low mantissa
+    // bits are dropped so that nearby meshes share depth bucket, and keep
+    // their material order.
+    const uint32_t distance_bits = std::bit_cast<uint32_t>(std::max(distance_squared, 0.0f));
+    const uint64_t depth_bucket  = (distance_bits >> 8) & c_depth_bucket_mask;
+    const uint64_t material      = std::min(static_cast<uint64_t>(material_index), c_material_mask);
+
+    if (translucent) {
+        // | 1 | 24 bits far to near depth | 15 bits material | 24 bits unused |
+        return c_translucent_bit | ((~depth_bucket & c_depth_bucket_mask) << 39) | (material << 24);
+    }
+    // | 0 | 15 bits material | 24 bits near to far depth | 24 bits unused |
+    return (material << 48) | (depth_bucket << 24);
+}
+
+void Mesh_sorter::radix_sort()
+{
+    ERHE_PROFILE_FUNCTION();
+
+    const std::size_t count = m_entries.size();
+    std::array<std::array<uint32_t, c_radix_bucket_count>, c_radix_pass_count> histograms{};
+    for (const Entry& entry : m_entries) {
+        for (int pass = 0; pass < c_radix_pass_count; ++pass) {
+            ++histograms[pass][(entry.key >> (pass * c_radix_bits)) & (c_radix_bucket_count - 1)];
+        }
+    }
+
+    m_scratch.resize(count);
+    for (int pass = 0; pass < c_radix_pass_count; ++pass) {
+        auto& histogram = histograms[pass];
+
+        // All keys have the same digit - pass would not change order
+        const uint64_t first_digit = (m_entries.front().key >> (pass * c_radix_bits)) & (c_radix_bucket_count - 1);
+        if (histogram[first_digit] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            const uint32_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        for (const Entry& entry : m_entries) {
+            const uint64_t digit = (entry.key >> (pass * c_radix_bits)) & (c_radix_bucket_count - 1);
+            m_scratch[histogram[digit]++] = entry;
+        }
+        std::swap(m_entries, m_scratch);
+    }
+}
+
+void Mesh_sorter::set_resort_distance(const float distance)
+{
+    m_resort_distance = distance;
+}
+
+auto Mesh_sorter::get_previous_order_translucent_start(const glm::vec3& view_position) const -> std::optional<std::size_t>
+{
+    if (m_input_meshes != m_previous_input_meshes) {
+        return {};
+    }
+    const glm::vec3 delta = view_position - m_sorted_view_position;
+    if (glm::dot(delta, delta) >= m_resort_distance * m_resort_distance) {
+        return {};
+    }
+
+    // m_entries is in input order. Depth only orders opaque meshes within
+    // material, so it is ignored there.
+    const std::size_t count             = m_previous_order.size();
+    std::size_t       translucent_start = 0;
+    uint64_t          previous_key      = 0;
+    for (; translucent_start < count; ++translucent_start) {
+        const uint64_t key = m_entries[m_previous_order[translucent_start]].key;
+        if ((key & c_translucent_bit) != 0) {
+            break;
+        }
+        const uint64_t material_key = key & ~(c_depth_bucket_mask << 24);
+        if (material_key < previous_key) {
+            return {};
+        }
+        previous_key = material_key;
+    }
+    for (std::size_t i = translucent_start; i < count; ++i) {
+        if ((m_entries[m_previous_order[i]].key & c_translucent_bit) == 0) {
+            return {};
+        }
+    }
+    return translucent_start;
+}
+
+void Mesh_sorter::sort_previous_order_translucent(const std::size_t translucent_start)
+{
+    // Entries are given in previous order, so the stable sort keeps
+    // previous order of equal keys
+    m_scratch.clear();
+    for (std::size_t i = translucent_start, end = m_previous_order.size(); i < end; ++i) {
+        m_scratch.push_back(m_entries[m_previous_order[i]]);
+    }
+    std::swap(m_entries, m_scratch);
+    radix_sort();
+    for (std::size_t i = 0, end = m_entries.size(); i < end; ++i) {
+        const uint32_t index = m_entries[i].index;
+        m_previous_order[translucent_start + i] = index;
+        m_sorted_meshes [translucent_start + i] = *m_meshes[index];
+    }
+}
+
+auto Mesh_sorter::sort(
+    const glm::vec3&              view_position,
+    const std::vector<Mesh_span>& mesh_spans,
+    const erhe::Item_filter&      filter
+) -> Mesh_span
+{
+    ERHE_PROFILE_FUNCTION();
+
+    m_statistics = Mesh_sort_statistics{};
+    m_meshes      .clear();
+    m_materials   .clear();
+    m_entries     .clear();
+    m_input_meshes.clear();
+
+    for (const Mesh_span& meshes : mesh_spans) {
+        bool span_used = false;
+        for (const std::shared_ptr<Mesh>& mesh : meshes) {
+            const Node* node = mesh->get_node();
+            if (!filter(mesh->get_flag_bits()) || (node == nullptr)) {
+                continue;
+            }
+            const uint32_t  material_index   = get_material_index(*mesh);
+            const glm::vec3 position         = glm::vec3{node->position_in_world()};
+            const glm::vec3 delta            = position - view_position;
+            const float     distance_squared = glm::dot(delta, delta);
+            const bool      translucent      = (mesh->get_flag_bits() & erhe::Item_flags::translucent) != 0;
+            if (!m_materials.empty() && (m_materials.back() != material_index)) {
+                ++m_statistics.input_material_changes;
+            }
+            m_entries.push_back(
+                Entry{
+                    .key   = make_sort_key(translucent, material_index, distance_squared),
+                    .index = static_cast<uint32_t>(m_meshes.size())
+                }
+            );
+            m_meshes      .push_back(&mesh);
+            m_materials   .push_back(material_index);
+            m_input_meshes.push_back(mesh.get());
+            span_used = true;
+        }
+        if (span_used) {
+            ++m_statistics.input_range_count;
+        }
+    }
+
+    if (m_entries.empty()) {
+        m_sorted_meshes        .clear();
+        m_previous_input_meshes.clear();
+        m_previous_order       .clear();
+        return {};
+    }
+
+    const std::optional<std::size_t> translucent_start = get_previous_order_translucent_start(view_position);
+    if (translucent_start.has_value()) {
+        const std::size_t start = translucent_start.value();
+        bool back_to_front = true;
+        for (std::size_t i = start + 1, end = m_previous_order.size(); back_to_front && (i < end); ++i) {
+            back_to_front = m_entries[m_previous_order[i - 1]].key <= m_entries[m_previous_order[i]].key;
+        }
+        if (back_to_front) {
+            // m_sorted_meshes is unchanged
+            m_statistics.order_reused = true;
+        } else {
+            sort_previous_order_translucent(start);
+            m_statistics.translucent_resorted = true;
+        }
+    } else {
+        radix_sort();
+
+        m_sorted_meshes .clear();
+        m_previous_order.clear();
+        m_sorted_meshes .reserve(m_entries.size());
+        m_previous_order.reserve(m_entries.size());
+        for (const Entry& entry : m_entries) {
+            m_sorted_meshes .push_back(*m_meshes[entry.index]);
+            m_previous_order.push_back(entry.index);
+        }
+        std::swap(m_previous_input_meshes, m_input_meshes);
+        m_sorted_view_position = view_position;
+    }
+
+    uint32_t previous_material = m_materials[m_previous_order.front()];
+    for (const uint32_t index : m_previous_order) {
+        const uint32_t material_index = m_materials[index];
+        if (material_index != previous_material) {
+            ++m_statistics.output_material_changes;
+            previous_material = material_index;
+        }
+    }
+    m_statistics.mesh_count         = m_sorted_meshes.size();
+    m_statistics.output_range_count = 1;
+    return Mesh_span{m_sorted_meshes};
+}
+
+auto Mesh_sorter::get_statistics() const -> const Mesh_sort_statistics&
+{
+    return m_statistics;
+}
+
+} // namespace erhe::scene
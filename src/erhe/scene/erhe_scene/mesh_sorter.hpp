@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace erhe {
+    class Item_filter;
+}
+
+namespace erhe::scene
+{
+
+class Mesh;
+
+class Mesh_sort_statistics
+{
+public:
+    std::size_t mesh_count             {0}; // meshes in output list
+    std::size_t input_range_count      {0}; // non-empty input spans, each is one multi draw
+    std::size_t input_material_changes {0}; // between consecutive meshes, in input order
+    std::size_t output_range_count     {0};
+    std::size_t output_material_changes{0};
+    bool        order_reused           {false}; // order of previous sort() was kept
+    bool        translucent_resorted   {false}; // only translucent meshes of previous order were sorted
+};
+
+// Merges mesh spans into a single list ordered by 64-bit sort keys, so that
+// renderers can draw all of them with one multi draw indirect call per pass.
+//
+// Opaque meshes are ordered by material, then front to back. Translucent
+// meshes (Item_flags::translucent) are drawn after opaque meshes, back to
+// front, then by material. Distance is squared distance from view position
+// to node origin, and its float bits are used as depth bucket. Material is
+// material_buffer_index of first primitive of the mesh, so materials must
+// be updated before sort(). Keys are sorted with a stable LSD radix sort.
+//
+// Order of previous sort() is kept as long as the same meshes are given in
+// the same order, opaque meshes are still grouped by material, and view
+// position has moved less than resort distance since the order was sorted.
+// Opaque meshes then can be slightly out of front to back order, but
+// renderers see the same list as in previous frame and can keep their
+// persistent buffers. When only translucent meshes are out of back to front
+// order, only they are sorted again, at the end of the list.
+class Mesh_sorter
+{
+public:
+    using Mesh_span = std::span<const std::shared_ptr<Mesh>>;
+
+    // Zero sorts on every call
+    void set_resort_distance(float distance);
+
+    // Meshes rejected by filter, or not attached to node, are dropped.
+    // Returned span remains valid until next call to sort().
+    auto sort(
+        const glm::vec3&              view_position,
+        const std::vector<Mesh_span>& mesh_spans,
+        const erhe::Item_filter&      filter
+    ) -> Mesh_span;
+
+    // Statistics of last sort() call
+    [[nodiscard]] auto get_statistics() const -> const Mesh_sort_statistics&;
+
+    [[nodiscard]] static auto make_sort_key(bool translucent, uint32_t material_index, float distance_squared) -> uint64_t;
+
+private:
+    void radix_sort();
+    // Returns first translucent position of previous order, or nullopt if
+    // previous order can not be kept
+    [[nodiscard]] auto get_previous_order_translucent_start(const glm::vec3& view_position) const -> std::optional<std::size_t>;
+    void sort_previous_order_translucent(std::size_t translucent_start);
+
+    class Entry
+    {
+    public:
+        uint64_t key;
+        uint32_t index; // in m_meshes
+    };
+
+    std::vector<const std::shared_ptr<Mesh>*> m_meshes;
+    std::vector<uint32_t>                     m_materials;
+    std::vector<Entry>                        m_entries;
+    std::vector<Entry>                        m_scratch;
+    std::vector<std::shared_ptr<Mesh>>        m_sorted_meshes;
+    std::vector<const Mesh*>                  m_input_meshes;
+    std::vector<const Mesh*>                  m_previous_input_meshes;
+    std::vector<uint32_t>                     m_previous_order;  // indices to m_previous_input_meshes
+    glm::vec3                                 m_sorted_view_position{0.0f};
+    float                                     m_resort_distance{1.0f};
+    Mesh_sort_statistics                      m_statistics;
+};
+
+} // namespace erhe::scene
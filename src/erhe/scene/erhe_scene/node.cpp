@@ -4,6 +4,7 @@
 #include "erhe_scene/scene_host.hpp"
 #include "erhe_scene/scene_log.hpp"
 #include "erhe_bit/bit_helpers.hpp"
+#include "erhe_concurrency/parallel.hpp"
 #include "erhe_math/math_util.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
@@ -17,16 +18,16 @@ namespace erhe::scene
 
 using namespace erhe;
 
-uint64_t Node_transforms::s_global_update_serial = 0;
+std::atomic<uint64_t> Node_transforms::s_global_update_serial{0};
 
 auto Node_transforms::get_current_serial() -> uint64_t
 {
-    return s_global_update_serial;
+    return s_global_update_serial.load(std::memory_order_relaxed);
 }
 
 auto Node_transforms::get_next_serial() -> uint64_t
 {
-    return ++s_global_update_serial;
+    return s_global_update_serial.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 Node_data::Node_data() = default;
@@ -288,6 +289,13 @@ void Node::handle_parent_update(
     erhe::Item_host* const new_item_host = (new_parent != nullptr) ? new_parent->get_item_host() : nullptr;
     if (old_item_host != new_item_host) {
         handle_item_host_update(old_item_host, new_item_host);
+    } else {
+        // Moved within same scene
+        Scene* scene = get_scene();
+        if (scene != nullptr) {
+            scene->invalidate_transform_hierarchy();
+            scene->mark_node_transform_dirty(*this);
+        }
     }
 
     hierarchy_sanity_check();
@@ -543,8 +551,7 @@ auto Node::transform_direction_from_local_to_world(const glm::vec3 direction) co
 void Node::set_parent_from_node(const glm::mat4 parent_from_node)
 {
     node_data.transforms.parent_from_node.set(parent_from_node);
-    update_world_from_node();
-    handle_transform_update(Node_transforms::get_next_serial());
+    invalidate_world_transforms();
 }
 
 void Node::set_parent_from_node(const Transform& parent_from_node)
@@ -555,8 +562,7 @@ void Node::set_parent_from_node(const Transform& parent_from_node)
         parent_from_node.get_matrix(),
         parent_from_node.get_inverse_matrix()
     );
-    update_world_from_node();
-    handle_transform_update(Node_transforms::get_next_serial());
+    invalidate_world_transforms();
 }
 
 void Node::set_node_from_parent(const glm::mat4 node_from_parent)
@@ -565,8 +571,7 @@ void Node::set_node_from_parent(const glm::mat4 node_from_parent)
         glm::inverse(node_from_parent),
         node_from_parent
     );
-    update_world_from_node();
-    handle_transform_update(Node_transforms::get_next_serial());
+    invalidate_world_transforms();
 }
 
 void Node::set_node_from_parent(const Transform& node_from_parent)
@@ -575,8 +580,7 @@ void Node::set_node_from_parent(const Transform& node_from_parent)
         node_from_parent.get_inverse_matrix(),
         node_from_parent.get_matrix()
     );
-    update_world_from_node();
-    handle_transform_update(Node_transforms::get_next_serial());
+    invalidate_world_transforms();
 }
 
 void Node::set_world_from_node(const glm::mat4 world_from_node)
@@ -614,7 +618,7 @@ void Node::set_node_from_world(const glm::mat4 node_from_world)
     } else {
         node_data.transforms.parent_from_node = node_data.transforms.world_from_node;
     }
-    handle_transform_update(Node_transforms::get_next_serial());
+    invalidate_world_transforms();
 }
 
 void Node::set_node_from_world(const Transform& node_from_world)
@@ -632,6 +636,19 @@ void Node::set_node_from_world(const Transform& node_from_world)
     } else {
         node_data.transforms.parent_from_node = node_data.transforms.world_from_node;
     }
+    invalidate_world_transforms();
+}
+
+void Node::invalidate_world_transforms()
+{
+    Scene* scene = get_scene();
+    if (scene != nullptr) {
+        scene->mark_node_transform_dirty(*this);
+        return;
+    }
+
+    // Not in scene, so no scene update will reach this node
+    update_world_from_node();
     handle_transform_update(Node_transforms::get_next_serial());
 }
 
@@ -645,6 +662,73 @@ auto Node_data::diff_mask(const Node_data& lhs, const Node_data& rhs)
     return mask;
 }
 
+namespace {
+
+constexpr std::size_t s_world_transforms_per_task = 256;
+
+void set_parent_from_nodes(
+    const std::span<const Node_world_transform> transforms,
+    const std::size_t                           begin,
+    const std::size_t                           end,
+    const bool                                  update_world
+)
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        const Node_world_transform& entry          = transforms[i];
+        Node&                       node           = *entry.node;
+        const auto&                 current_parent = node.get_parent_node();
+        node.node_data.transforms.parent_from_node.set(
+            current_parent
+                ? current_parent->node_from_world() * entry.world_from_node
+                : entry.world_from_node
+        );
+        if (update_world) {
+            node.update_world_from_node();
+        }
+    }
+}
+
+}
+
+void set_world_from_nodes(
+    const std::span<const Node_world_transform> transforms,
+    erhe::concurrency::Thread_pool* const       thread_pool
+)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    // Parent world transforms must be up to date before children, so nodes
+    // are processed one depth at a time
+    for (std::size_t begin = 0, count = transforms.size(); begin < count;) {
+        const std::size_t depth = transforms[begin].node->get_depth();
+        std::size_t end = begin + 1;
+        while ((end < count) && (transforms[end].node->get_depth() == depth)) {
+            ++end;
+        }
+        ERHE_VERIFY((end == count) || (transforms[end].node->get_depth() > depth));
+
+        // Deeper entries may be children, which need world transforms of
+        // this depth now. Others are left to invalidate_world_transforms().
+        const bool update_world = (end < count);
+        if ((thread_pool != nullptr) && (end - begin > s_world_transforms_per_task)) {
+            erhe::concurrency::parallel_for(
+                *thread_pool, begin, end, s_world_transforms_per_task,
+                [transforms, update_world](const std::size_t chunk_begin, const std::size_t chunk_end) {
+                    set_parent_from_nodes(transforms, chunk_begin, chunk_end, update_world);
+                }
+            );
+        } else {
+            set_parent_from_nodes(transforms, begin, end, update_world);
+        }
+        begin = end;
+    }
+
+    // Same notification as transform setters
+    for (const Node_world_transform& entry : transforms) {
+        entry.node->invalidate_world_transforms();
+    }
+}
+
 auto is_node(const Item_base* const item) -> bool
 {
     if (item == nullptr) {
@@ -3,8 +3,11 @@
 #include "erhe_item/hierarchy.hpp"
 #include "erhe_scene/trs_transform.hpp"
 
+#include <atomic>
 #include <cstdint>
+#include <limits>
 #include <optional>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -12,6 +15,9 @@
 namespace erhe {
     class Item_host;
 }
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 
 namespace erhe::scene
 {
@@ -26,6 +32,8 @@ class Node_transforms
 public:
     mutable std::uint64_t parent_from_node_serial{0}; // update needed if 0
     mutable std::uint64_t world_from_node_serial {0}; // update needed if 0
+    std::size_t           scene_index{std::numeric_limits<std::size_t>::max()}; // in Scene transform hierarchy
+    mutable bool          world_dirty{false}; // queued for Scene::update_node_transforms()
 
     // One of these is normative, and the other is calculated by update_transform()
     Trs_transform         parent_from_node;
@@ -35,7 +43,7 @@ public:
     static auto get_next_serial   () -> uint64_t;
 
 private:
-    static uint64_t s_global_update_serial;
+    static std::atomic<uint64_t> s_global_update_serial; // scenes may be updated from different threads
 };
 
 class Node_data
@@ -130,9 +138,32 @@ public:
     void set_node_from_world   (const glm::mat4 node_from_world);
     void set_node_from_world   (const Transform& node_from_world);
 
+    // Marks world transforms of this node and its descendants to be updated
+    // by Scene::update_node_transforms(). Transform setters call this; call
+    // it after modifying node_data.transforms directly. Node which is not
+    // in a scene has its world transform updated immediately.
+    void invalidate_world_transforms();
+
     Node_data node_data;
 };
 
+class Node_world_transform
+{
+public:
+    Node*     node;
+    glm::mat4 world_from_node;
+};
+
+// Sets world transforms of many nodes, for example from physics simulation.
+// Entries must be sorted by node depth. Transforms of nodes at same depth are
+// computed in parallel if thread_pool is given. Nodes are then invalidated
+// as transform setters do, so attachments and descendants are updated by
+// Scene::update_node_transforms().
+void set_world_from_nodes(
+    std::span<const Node_world_transform> transforms,
+    erhe::concurrency::Thread_pool*       thread_pool = nullptr
+);
+
 [[nodiscard]] auto is_node(const erhe::Item_base* item) -> bool;
 [[nodiscard]] auto is_node(const std::shared_ptr<erhe::Item_base>& item) -> bool;
 
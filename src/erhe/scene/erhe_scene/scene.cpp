@@ -8,6 +8,7 @@
 #include "erhe_scene/scene_message_bus.hpp"
 #include "erhe_scene/skin.hpp"
 #include "erhe_bit/bit_helpers.hpp"
+#include "erhe_concurrency/parallel.hpp"
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
@@ -16,6 +17,12 @@
 namespace erhe::scene
 {
 
+namespace {
+
+constexpr uint32_t s_transform_nodes_per_task = 512;
+
+}
+
 auto Scene::get_static_type()       -> uint64_t         { return erhe::Item_type::scene; }
 auto Scene::get_type       () const -> uint64_t         { return get_static_type(); }
 auto Scene::get_type_name  () const -> std::string_view { return static_type_name; }
@@ -36,12 +43,8 @@ auto Mesh_layer::get_mesh_by_id(
     const erhe::Unique_id<Node>::id_type mesh_id
 ) const -> std::shared_ptr<Mesh>
 {
-    for (const auto& mesh : meshes) {
-        if (mesh->get_id() == mesh_id) {
-            return mesh;
-        }
-    }
-    return {};
+    const auto i = m_meshes_by_id.find(mesh_id);
+    return (i != m_meshes_by_id.end()) ? i->second : std::shared_ptr<Mesh>{};
 }
 
 auto Mesh_layer::get_name() const -> const std::string&
@@ -53,13 +56,10 @@ void Mesh_layer::add(const std::shared_ptr<Mesh>& mesh)
 {
     ERHE_VERIFY(mesh);
 
-#ifndef NDEBUG
-    const auto i = std::find(meshes.begin(), meshes.end(), mesh);
-    if (i != meshes.end()) {
+    const bool inserted = m_meshes_by_id.emplace(mesh->get_id(), mesh).second;
+    if (!inserted) {
         log->error("mesh {} already in layer meshes", mesh->get_name());
-    } else
-#endif
-    {
+    } else {
         meshes.push_back(mesh);
     }
 }
@@ -75,6 +75,7 @@ void Mesh_layer::remove(
         log->error("mesh {} not in layer meshes", mesh->get_name());
     } else {
         meshes.erase(i, meshes.end());
+        m_meshes_by_id.erase(mesh->get_id());
     }
 }
 
@@ -91,12 +92,8 @@ auto Light_layer::get_light_by_id(
     const erhe::Unique_id<Node>::id_type light_id
 ) const -> std::shared_ptr<Light>
 {
-    for (const auto& light : lights) {
-        if (light->get_id() == light_id) {
-            return light;
-        }
-    }
-    return {};
+    const auto i = m_lights_by_id.find(light_id);
+    return (i != m_lights_by_id.end()) ? i->second : std::shared_ptr<Light>{};
 }
 
 auto Light_layer::get_name() const -> const std::string&
@@ -112,16 +109,11 @@ void Light_layer::add(
 
     log->trace("add_to_light_layer(light = {})", light->get_name());
 
-    {
-#ifndef NDEBUG
-        const auto i = std::find(lights.begin(), lights.end(), light);
-        if (i != lights.end()) {
-            log->error("light {} already in layer lights", light->get_name());
-        } else
-#endif
-        {
-            lights.push_back(light);
-        }
+    const bool inserted = m_lights_by_id.emplace(light->get_id(), light).second;
+    if (!inserted) {
+        log->error("light {} already in layer lights", light->get_name());
+    } else {
+        lights.push_back(light);
     }
 }
 
@@ -139,6 +131,7 @@ void Light_layer::remove(
         log->error("light {} not in layer lights", light->get_name());
     } else {
         lights.erase(i, lights.end());
+        m_lights_by_id.erase(light->get_id());
     }
 }
 
@@ -148,38 +141,24 @@ auto Scene::get_camera_by_id(
     const erhe::Unique_id<Node>::id_type id
 ) const -> std::shared_ptr<Camera>
 {
-    for (const auto& camera : m_cameras) {
-        if (camera->get_id() == id) {
-            return camera;
-        }
-    }
-    return {};
+    const auto i = m_cameras_by_id.find(id);
+    return (i != m_cameras_by_id.end()) ? i->second : std::shared_ptr<Camera>{};
 }
 
 auto Scene::get_mesh_by_id(
     const erhe::Unique_id<Node>::id_type id
 ) const -> std::shared_ptr<Mesh>
 {
-    for (const auto& layer : m_mesh_layers) {
-        const auto& mesh = layer->get_mesh_by_id(id);
-        if (mesh) {
-            return mesh;
-        }
-    }
-    return {};
+    const auto i = m_meshes_by_id.find(id);
+    return (i != m_meshes_by_id.end()) ? i->second : std::shared_ptr<Mesh>{};
 }
 
 auto Scene::get_light_by_id(
     const erhe::Unique_id<Node>::id_type id
 ) const -> std::shared_ptr<Light>
 {
-    for (const auto& layer : m_light_layers) {
-        const auto& light = layer->get_light_by_id(id);
-        if (light) {
-            return light;
-        }
-    }
-    return {};
+    const auto i = m_lights_by_id.find(id);
+    return (i != m_lights_by_id.end()) ? i->second : std::shared_ptr<Light>{};
 }
 
 auto Scene::get_mesh_layer_by_id(
@@ -282,20 +261,202 @@ void Scene::sort_transform_nodes()
     m_nodes_sorted = true;
 }
 
-void Scene::update_node_transforms()
+void Scene::invalidate_transform_hierarchy()
+{
+    m_transform_hierarchy_valid = false;
+}
+
+void Scene::mark_node_transform_dirty(const Node& node)
+{
+    if (node.node_data.transforms.world_dirty) {
+        return;
+    }
+    node.node_data.transforms.world_dirty = true;
+    if (!m_transform_hierarchy_valid) {
+        return; // Collected when hierarchy is rebuilt
+    }
+    const std::size_t index = node.node_data.transforms.scene_index;
+    if ((index < m_transform_nodes.size()) && (m_transform_nodes[index] == &node)) {
+        m_dirty_transform_roots.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+void Scene::build_transform_hierarchy()
 {
     ERHE_PROFILE_FUNCTION();
 
-    if (!m_nodes_sorted) {
-        sort_transform_nodes();
+    m_transform_nodes  .clear();
+    m_transform_parents.clear();
+    m_transform_nodes  .reserve(m_flat_node_vector.size());
+    m_transform_parents.reserve(m_flat_node_vector.size());
+
+    class Entry
+    {
+    public:
+        Node*    node;
+        uint32_t parent;
+    };
+    std::vector<Entry> stack;
+    const auto push_children = [&stack](const Node& node, const uint32_t parent) {
+        const auto& children = node.get_children();
+        for (auto i = children.rbegin(), end = children.rend(); i != end; ++i) {
+            if (is<Node>(i->get())) {
+                stack.push_back(Entry{static_cast<Node*>(i->get()), parent});
+            }
+        }
+    };
+    push_children(*m_root_node.get(), c_no_parent);
+    while (!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        const uint32_t index = static_cast<uint32_t>(m_transform_nodes.size());
+        entry.node->node_data.transforms.scene_index = index;
+        m_transform_nodes  .push_back(entry.node);
+        m_transform_parents.push_back(entry.parent);
+        push_children(*entry.node, index);
     }
 
-    for (auto& node : m_flat_node_vector) {
+    // Descendants follow their ancestor, so one reverse pass finds subtree ends
+    const uint32_t node_count = static_cast<uint32_t>(m_transform_nodes.size());
+    m_transform_subtree_ends.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i) {
+        m_transform_subtree_ends[i] = i + 1;
+    }
+    for (uint32_t i = node_count; i > 0; --i) {
+        const uint32_t parent = m_transform_parents[i - 1];
+        if (parent != c_no_parent) {
+            m_transform_subtree_ends[parent] = std::max(m_transform_subtree_ends[parent], m_transform_subtree_ends[i - 1]);
+        }
+    }
+
+    m_world_from_node.resize(node_count);
+    m_node_from_world.resize(node_count);
+    m_dirty_transform_roots.clear();
+    for (uint32_t i = 0; i < node_count; ++i) {
+        if (m_transform_nodes[i]->node_data.transforms.world_dirty) {
+            m_dirty_transform_roots.push_back(i);
+        }
+    }
+    m_transform_hierarchy_valid = true;
+
+    log->trace("transform hierarchy built, {} nodes, {} in scene", node_count, m_flat_node_vector.size());
+}
+
+void Scene::update_transform_range(const uint32_t begin, const uint32_t end)
+{
+    const glm::mat4 root_world_from_node = m_root_node->world_from_node();
+    const glm::mat4 root_node_from_world = m_root_node->node_from_world();
+    for (uint32_t i = begin; i < end; ++i) {
+        const Node* node = m_transform_nodes[i];
         if (node->is_no_transform_update()) {
+            m_world_from_node[i] = node->world_from_node();
+            m_node_from_world[i] = node->node_from_world();
+            continue;
+        }
+        const uint32_t parent = m_transform_parents[i];
+        if (parent == c_no_parent) {
+            m_world_from_node[i] = root_world_from_node * node->parent_from_node();
+            m_node_from_world[i] = node->node_from_parent() * root_node_from_world;
+        } else {
+            m_world_from_node[i] = m_world_from_node[parent] * node->parent_from_node();
+            m_node_from_world[i] = node->node_from_parent() * m_node_from_world[parent];
+        }
+    }
+}
+
+void Scene::update_node_transforms(erhe::concurrency::Thread_pool* const thread_pool)
+{
+    ERHE_PROFILE_FUNCTION();
+
+    if (!m_transform_hierarchy_valid) {
+        build_transform_hierarchy();
+    }
+    if (m_root_node->node_data.transforms.world_dirty) {
+        m_root_node->node_data.transforms.world_dirty = false;
+        m_root_node->update_world_from_node();
+        m_root_node->handle_transform_update(Node_transforms::get_next_serial());
+        for (uint32_t i = 0, end = static_cast<uint32_t>(m_transform_nodes.size()); i < end; i = m_transform_subtree_ends[i]) {
+            m_dirty_transform_roots.push_back(i);
+        }
+    }
+    if (m_dirty_transform_roots.empty()) {
+        return;
+    }
+
+    // Reduce dirty nodes to roots of disjoint dirty subtrees
+    std::sort(m_dirty_transform_roots.begin(), m_dirty_transform_roots.end());
+    std::size_t root_count  = 0;
+    uint32_t    covered_end = 0;
+    std::size_t dirty_count = 0;
+    for (const uint32_t root : m_dirty_transform_roots) {
+        if (root < covered_end) {
             continue;
         }
-        node->update_transform(0);
+        covered_end = m_transform_subtree_ends[root];
+        dirty_count += covered_end - root;
+        m_dirty_transform_roots[root_count++] = root;
+    }
+    m_dirty_transform_roots.resize(root_count);
+
+    if ((thread_pool != nullptr) && (dirty_count > s_transform_nodes_per_task)) {
+        // Split large subtrees to tasks. Root of split subtree is updated
+        // before tasks for its children.
+        m_transform_ranges.clear();
+        std::vector<uint32_t> stack;
+        for (const uint32_t root : m_dirty_transform_roots) {
+            stack.push_back(root);
+            while (!stack.empty()) {
+                const uint32_t node = stack.back();
+                stack.pop_back();
+                const uint32_t end = m_transform_subtree_ends[node];
+                if (end - node <= s_transform_nodes_per_task) {
+                    m_transform_ranges.push_back(Transform_range{node, end});
+                    continue;
+                }
+                update_transform_range(node, node + 1);
+                for (uint32_t child = node + 1; child < end; child = m_transform_subtree_ends[child]) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        erhe::concurrency::parallel_for_each_index(
+            *thread_pool, 0, m_transform_ranges.size(), 1,
+            [this](const std::size_t i) {
+                update_transform_range(m_transform_ranges[i].begin, m_transform_ranges[i].end);
+            }
+        );
+    } else {
+        for (const uint32_t root : m_dirty_transform_roots) {
+            update_transform_range(root, m_transform_subtree_ends[root]);
+        }
+    }
+
+    // Attachments (such as Frame_controller) may set transforms while they
+    // are notified. Those nodes are marked dirty for next update, so marks
+    // are cleared and roots are moved aside before notifying.
+    std::swap(m_notify_transform_roots, m_dirty_transform_roots);
+    m_dirty_transform_roots.clear();
+    for (const uint32_t root : m_notify_transform_roots) {
+        for (uint32_t i = root, end = m_transform_subtree_ends[root]; i < end; ++i) {
+            Node* node = m_transform_nodes[i];
+            node->node_data.transforms.world_dirty = false;
+            if (!node->is_no_transform_update()) {
+                node->node_data.transforms.world_from_node.set(m_world_from_node[i], m_node_from_world[i]);
+            }
+        }
+    }
+
+    // Attachments are notified serially
+    const uint64_t serial = Node_transforms::get_next_serial();
+    for (const uint32_t root : m_notify_transform_roots) {
+        for (uint32_t i = root, end = m_transform_subtree_ends[root]; i < end; ++i) {
+            const Node* node = m_transform_nodes[i];
+            if (!node->is_no_transform_update()) {
+                node->handle_transform_update(serial);
+            }
+        }
     }
+    m_notify_transform_roots.clear();
 }
 
 Scene::Scene(const Scene& src)
@@ -337,6 +498,9 @@ Scene::~Scene()
     m_mesh_layers.clear();
     m_light_layers.clear();
     m_cameras.clear();
+    m_meshes_by_id.clear();
+    m_lights_by_id.clear();
+    m_cameras_by_id.clear();
     m_root_node.reset();
 }
 
@@ -371,7 +535,9 @@ void Scene::register_node(
         ERHE_VERIFY(node->node_data.host == nullptr);
         node->node_data.host = m_host;
         m_flat_node_vector.push_back(node);
-        m_nodes_sorted = false;
+        m_nodes_sorted              = false;
+        m_transform_hierarchy_valid = false;
+        mark_node_transform_dirty(*node.get());
     }
 
     ERHE_VERIFY(!node->get_parent().expired());
@@ -404,6 +570,7 @@ void Scene::unregister_node(
     } else {
         node->node_data.host = nullptr;
         m_flat_node_vector.erase(i, m_flat_node_vector.end());
+        m_transform_hierarchy_valid = false;
     }
 
     sanity_check();
@@ -421,13 +588,11 @@ void Scene::unregister_node(
 
 void Scene::register_camera(const std::shared_ptr<Camera>& camera)
 {
-#ifndef NDEBUG
-    const auto i = std::find(m_cameras.begin(), m_cameras.end(), camera);
-    if (i != m_cameras.end()) {
+    ERHE_VERIFY(camera);
+    const bool inserted = m_cameras_by_id.emplace(camera->get_id(), camera).second;
+    if (!inserted) {
         log->error("camera {} already in scene cameras", camera->get_name());
-    } else
-#endif
-    {
+    } else {
         m_cameras.push_back(camera);
     }
 }
@@ -440,6 +605,7 @@ void Scene::unregister_camera(const std::shared_ptr<Camera>& camera)
         log->error("camera {} not in scene cameras", camera->get_name());
     } else {
         m_cameras.erase(i, m_cameras.end());
+        m_cameras_by_id.erase(camera->get_id());
     }
 }
 
@@ -449,6 +615,7 @@ void Scene::register_mesh(const std::shared_ptr<Mesh>& mesh)
     auto mesh_layer = get_mesh_layer_by_id(mesh->layer_id);
     if (mesh_layer) {
         mesh_layer->add(mesh);
+        m_meshes_by_id.emplace(mesh->get_id(), mesh);
     } else {
         log->error("mesh {} layer not found", mesh->get_name());
     }
@@ -457,6 +624,7 @@ void Scene::register_mesh(const std::shared_ptr<Mesh>& mesh)
 void Scene::unregister_mesh(const std::shared_ptr<Mesh>& mesh)
 {
     ERHE_VERIFY(mesh);
+    m_meshes_by_id.erase(mesh->get_id());
     auto mesh_layer = get_mesh_layer_by_id(mesh->layer_id);
     if (mesh_layer) {
         mesh_layer->remove(mesh);
@@ -495,6 +663,7 @@ void Scene::register_light(const std::shared_ptr<Light>& light)
     auto light_layer = get_light_layer_by_id(light->layer_id);
     if (light_layer) {
         light_layer->add(light);
+        m_lights_by_id.emplace(light->get_id(), light);
     } else {
         log->error("light {} layer not found", light->get_name());
     }
@@ -503,6 +672,7 @@ void Scene::register_light(const std::shared_ptr<Light>& light)
 void Scene::unregister_light(const std::shared_ptr<Light>& light)
 {
     ERHE_VERIFY(light);
+    m_lights_by_id.erase(light->get_id());
     auto light_layer = get_light_layer_by_id(light->layer_id);
     if (light_layer) {
         light_layer->remove(light);
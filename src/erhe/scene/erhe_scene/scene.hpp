@@ -6,11 +6,18 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
+namespace erhe::concurrency
+{
+    class Thread_pool;
+}
+
 namespace erhe::scene
 {
 
@@ -46,6 +53,9 @@ public:
     std::string                        name;
     uint64_t                           flags{0};
     Layer_id                           id;
+
+private:
+    std::unordered_map<erhe::Unique_id<Node>::id_type, std::shared_ptr<Mesh>> m_meshes_by_id;
 };
 
 class Light_layer
@@ -63,6 +73,9 @@ public:
     glm::vec4                           ambient_light{0.0f, 0.0f, 0.0f, 0.0f};
     std::string                         name;
     Layer_id                            id;
+
+private:
+    std::unordered_map<erhe::Unique_id<Node>::id_type, std::shared_ptr<Light>> m_lights_by_id;
 };
 
 class Scene : public erhe::Item<erhe::Item_base, erhe::Item_base, Scene>
@@ -87,9 +100,20 @@ public:
     auto get_item_host() const -> erhe::Item_host* override;
 
     // Public API
-    void sanity_check          () const;
-    void sort_transform_nodes  ();
-    void update_node_transforms();
+    void sanity_check        () const;
+    void sort_transform_nodes();
+
+    // Updates world transforms of nodes marked dirty, and of their
+    // descendants, since previous update. Other nodes are not visited.
+    // When thread pool is given, large updates compute matrices in
+    // parallel; nodes and attachments are always notified serially.
+    void update_node_transforms(erhe::concurrency::Thread_pool* thread_pool = nullptr);
+
+    // Called by Node when its transform changes, and when it is added to
+    // this scene or moved to different parent within this scene. Marks are
+    // kept over hierarchy rebuild, so only marked subtrees are updated.
+    void mark_node_transform_dirty     (const Node& node);
+    void invalidate_transform_hierarchy();
 
     [[nodiscard]] auto get_mesh_by_id       (erhe::Unique_id<Node>::id_type id) const -> std::shared_ptr<Mesh>;
     [[nodiscard]] auto get_light_by_id      (erhe::Unique_id<Node>::id_type id) const -> std::shared_ptr<Light>;
@@ -123,6 +147,18 @@ public:
     void unregister_light (const std::shared_ptr<Light>& light);
 
 private:
+    class Transform_range
+    {
+    public:
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    static constexpr uint32_t c_no_parent = 0xffffffffu;
+
+    void build_transform_hierarchy();
+    void update_transform_range   (uint32_t begin, uint32_t end);
+
     Scene_message_bus&                        m_message_bus;
     Scene_host*                               m_host       {nullptr};
     std::shared_ptr<erhe::scene::Node>        m_root_node;
@@ -132,6 +168,24 @@ private:
     std::vector<std::shared_ptr<Light_layer>> m_light_layers;
     std::vector<std::shared_ptr<Camera>>      m_cameras;
     bool                                      m_nodes_sorted{false};
+
+    // Maintained by register_*() / unregister_*() for constant time lookup by id
+    std::unordered_map<erhe::Unique_id<Node>::id_type, std::shared_ptr<Mesh>>   m_meshes_by_id;
+    std::unordered_map<erhe::Unique_id<Node>::id_type, std::shared_ptr<Light>>  m_lights_by_id;
+    std::unordered_map<erhe::Unique_id<Node>::id_type, std::shared_ptr<Camera>> m_cameras_by_id;
+
+    // Transform hierarchy in depth first order, in SoA form. Subtree of
+    // node i is range [i, m_transform_subtree_ends[i]). World matrices
+    // are computed here, then copied to nodes.
+    std::vector<Node*>           m_transform_nodes;
+    std::vector<uint32_t>        m_transform_parents;      // c_no_parent for children of root node
+    std::vector<uint32_t>        m_transform_subtree_ends;
+    std::vector<glm::mat4>       m_world_from_node;
+    std::vector<glm::mat4>       m_node_from_world;
+    std::vector<uint32_t>        m_dirty_transform_roots;
+    std::vector<uint32_t>        m_notify_transform_roots; // Roots of previous update, while attachments are notified
+    std::vector<Transform_range> m_transform_ranges;
+    bool                         m_transform_hierarchy_valid{false};
 };
 
 } // namespace erhe::scene
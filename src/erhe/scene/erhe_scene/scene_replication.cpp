@@ -0,0 +1,714 @@
+#include "erhe_scene/scene_replication.hpp"
+#include "erhe_scene/node.hpp"
+#include "erhe_scene/node_attachment.hpp"
+#include "erhe_scene/scene.hpp"
+#include "erhe_scene/scene_log.hpp"
+#include "erhe_scene/trs_transform.hpp"
+#include "erhe_profile/profile.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <unordered_set>
+
+namespace erhe::scene
+{
+
+namespace {
+
+constexpr uint8_t  c_transform_translation = 1u << 0;
+constexpr uint8_t  c_transform_rotation    = 1u << 1;
+constexpr uint8_t  c_transform_scale       = 1u << 2;
+constexpr uint8_t  c_transform_all         = c_transform_translation | c_transform_rotation | c_transform_scale;
+constexpr int      c_rotation_bits         = 15;
+constexpr uint64_t c_rotation_max          = (uint64_t{1} << c_rotation_bits) - 1;
+constexpr int      c_rotation_byte_count   = 6; // 2 bit index + 3 x 15 bits
+constexpr float    c_sqrt_2                = 1.41421356237f;
+
+// Parent relations come from the network, and must not form cycles
+[[nodiscard]] auto is_valid_parent(const Node& node, const Node& parent) -> bool
+{
+    return (&parent != &node) && !parent.is_ancestor(&node);
+}
+
+class Byte_writer
+{
+public:
+    explicit Byte_writer(std::vector<uint8_t>& out) : m_out{out} {}
+
+    void write_u8(const uint8_t value)
+    {
+        m_out.push_back(value);
+    }
+
+    void write_u32(const uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i) {
+            m_out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void write_varint(uint64_t value)
+    {
+        while (value >= 0x80u) {
+            m_out.push_back(static_cast<uint8_t>(value | 0x80u));
+            value >>= 7;
+        }
+        m_out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void write_zigzag(const int64_t value)
+    {
+        write_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void write_string(const std::string_view value)
+    {
+        write_varint(value.size());
+        m_out.insert(m_out.end(), value.begin(), value.end());
+    }
+
+    void write_record(const Scene_delta::Record record, const std::size_t id)
+    {
+        write_u8    (static_cast<uint8_t>(record));
+        write_varint(id);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+// Sets error flag, and returns zeros, on overrun
+class Byte_reader
+{
+public:
+    explicit Byte_reader(const std::span<const uint8_t> data) : m_data{data} {}
+
+    [[nodiscard]] auto at_end() const -> bool { return m_offset >= m_data.size(); }
+    [[nodiscard]] auto error () const -> bool { return m_error; }
+
+    auto read_u8() -> uint8_t
+    {
+        if (m_offset >= m_data.size()) {
+            m_error = true;
+            return 0;
+        }
+        return m_data[m_offset++];
+    }
+
+    auto read_u32() -> uint32_t
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(read_u8()) << (8 * i);
+        }
+        return value;
+    }
+
+    auto read_varint() -> uint64_t
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = read_u8();
+            value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+            if ((byte & 0x80u) == 0) {
+                return value;
+            }
+        }
+        m_error = true;
+        return 0;
+    }
+
+    auto read_zigzag() -> int64_t
+    {
+        const uint64_t value = read_varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1u);
+    }
+
+    auto read_string() -> std::string_view
+    {
+        const uint64_t length = read_varint();
+        if (m_error || (length > m_data.size() - m_offset)) {
+            m_error = true;
+            return {};
+        }
+        const std::string_view value{reinterpret_cast<const char*>(m_data.data() + m_offset), static_cast<std::size_t>(length)};
+        m_offset += static_cast<std::size_t>(length);
+        return value;
+    }
+
+private:
+    std::span<const uint8_t> m_data;
+    std::size_t              m_offset{0};
+    bool                     m_error {false};
+};
+
+[[nodiscard]] auto quantize(const float value) -> int64_t
+{
+    return static_cast<int64_t>(std::llround(static_cast<double>(value) / Scene_delta::c_position_step));
+}
+
+[[nodiscard]] auto dequantize(const int64_t value) -> float
+{
+    return static_cast<float>(static_cast<double>(value) * Scene_delta::c_position_step);
+}
+
+// Smallest three: largest component is dropped, and reconstructed from
+// unit length. Remaining components are in [-1/sqrt(2), 1/sqrt(2)].
+[[nodiscard]] auto pack_rotation(const glm::quat rotation) -> uint64_t
+{
+    const glm::quat q = glm::normalize(rotation);
+    const float components[4]{q.x, q.y, q.z, q.w};
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (std::abs(components[i]) > std::abs(components[largest])) {
+            largest = i;
+        }
+    }
+    const float sign   = (components[largest] < 0.0f) ? -1.0f : 1.0f;
+    uint64_t    packed = static_cast<uint64_t>(largest);
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        const float unit = std::clamp(sign * components[i] * c_sqrt_2 * 0.5f + 0.5f, 0.0f, 1.0f);
+        packed = (packed << c_rotation_bits) | static_cast<uint64_t>(std::lround(unit * static_cast<float>(c_rotation_max)));
+    }
+    return packed;
+}
+
+[[nodiscard]] auto unpack_rotation(uint64_t packed) -> glm::quat
+{
+    float components[4]{};
+    const int largest = static_cast<int>((packed >> (3 * c_rotation_bits)) & 3u);
+    float sum_squares = 0.0f;
+    for (int i = 3; i >= 0; --i) {
+        if (i == largest) {
+            continue;
+        }
+        const float unit = static_cast<float>(packed & c_rotation_max) / static_cast<float>(c_rotation_max);
+        packed >>= c_rotation_bits;
+        components[i] = (unit - 0.5f) * 2.0f / c_sqrt_2;
+        sum_squares += components[i] * components[i];
+    }
+    components[largest] = std::sqrt(std::max(0.0f, 1.0f - sum_squares));
+    return glm::normalize(glm::quat{components[3], components[0], components[1], components[2]});
+}
+
+void write_rotation(Byte_writer& writer, const uint64_t packed)
+{
+    for (int i = 0; i < c_rotation_byte_count; ++i) {
+        writer.write_u8(static_cast<uint8_t>(packed >> (8 * i)));
+    }
+}
+
+[[nodiscard]] auto read_rotation(Byte_reader& reader) -> uint64_t
+{
+    uint64_t packed = 0;
+    for (int i = 0; i < c_rotation_byte_count; ++i) {
+        packed |= static_cast<uint64_t>(reader.read_u8()) << (8 * i);
+    }
+    return packed;
+}
+
+void apply_flag_bits(erhe::Item_base& item, const uint64_t flag_bits)
+{
+    const uint64_t old_bits = item.get_flag_bits() & Scene_delta::replicated_flags;
+    const uint64_t new_bits = flag_bits            & Scene_delta::replicated_flags;
+    if (old_bits == new_bits) {
+        return;
+    }
+    if ((new_bits & ~old_bits) != 0) {
+        item.set_flag_bits(new_bits & ~old_bits, true);
+    }
+    if ((old_bits & ~new_bits) != 0) {
+        item.set_flag_bits(old_bits & ~new_bits, false);
+    }
+}
+
+}
+
+auto Scene_delta::is_delta_frame(const std::span<const uint8_t> data) -> bool
+{
+    Byte_reader reader{data};
+    return (reader.read_u32() == c_magic) && !reader.error();
+}
+
+#pragma region Scene_delta_writer
+auto Scene_delta_writer::write_frame(const Scene& scene, std::vector<uint8_t>& out) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    m_statistics = Scene_delta_statistics{};
+    ++m_frame;
+
+    out.clear();
+    Byte_writer writer{out};
+    writer.write_u32   (Scene_delta::c_magic);
+    writer.write_u8    (Scene_delta::c_version);
+    writer.write_varint(m_frame);
+    const std::size_t header_byte_count = out.size();
+
+    // Depth first, so that parents are created before their children
+    class Entry
+    {
+    public:
+        const Node* node;
+        std::size_t parent_id;
+    };
+    std::vector<Entry> stack;
+    const auto push_children = [&stack](const Node& node, const std::size_t parent_id) {
+        const auto& children = node.get_children();
+        for (auto i = children.rbegin(), end = children.rend(); i != end; ++i) {
+            if (is<Node>(i->get())) {
+                stack.push_back(Entry{static_cast<const Node*>(i->get()), parent_id});
+            }
+        }
+    };
+    const std::shared_ptr<Node> root_node = scene.get_root_node();
+    if (root_node) {
+        push_children(*root_node.get(), 0);
+    }
+
+    while (!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        const Node&       node = *entry.node;
+        const std::size_t id   = node.get_id();
+        push_children(node, id);
+        ++m_statistics.node_count;
+
+        auto [i, is_new] = m_nodes.try_emplace(id);
+        Node_state& state = i->second;
+        state.frame = m_frame;
+
+        if (is_new) {
+            writer.write_record(Scene_delta::Record::node_create, id);
+            writer.write_varint(entry.parent_id);
+            writer.write_string(node.get_name());
+            state.parent_id = entry.parent_id;
+            ++m_statistics.create_count;
+        } else if (state.parent_id != entry.parent_id) {
+            writer.write_record(Scene_delta::Record::node_parent, id);
+            writer.write_varint(entry.parent_id);
+            state.parent_id = entry.parent_id;
+            ++m_statistics.parent_count;
+        }
+
+        // Transform, compared after quantization
+        {
+            const Trs_transform& transform   = node.parent_from_node_transform();
+            const glm::vec3      translation = transform.get_translation();
+            const glm::vec3      scale       = transform.get_scale();
+            const int64_t        new_translation[3]{quantize(translation.x), quantize(translation.y), quantize(translation.z)};
+            const int64_t        new_scale      [3]{quantize(scale.x), quantize(scale.y), quantize(scale.z)};
+            const uint64_t       new_rotation = pack_rotation(transform.get_rotation());
+
+            // New nodes send all components, reader may have bound existing node
+            uint8_t mask = is_new ? c_transform_all : 0;
+            if (!std::equal(std::begin(new_translation), std::end(new_translation), std::begin(state.translation))) {
+                mask |= c_transform_translation;
+            }
+            if (new_rotation != state.rotation) {
+                mask |= c_transform_rotation;
+            }
+            if (!std::equal(std::begin(new_scale), std::end(new_scale), std::begin(state.scale))) {
+                mask |= c_transform_scale;
+            }
+            if (mask != 0) {
+                writer.write_record(Scene_delta::Record::transform, id);
+                writer.write_u8(mask);
+                if ((mask & c_transform_translation) != 0) {
+                    for (int c = 0; c < 3; ++c) {
+                        writer.write_zigzag(new_translation[c] - state.translation[c]);
+                        state.translation[c] = new_translation[c];
+                    }
+                }
+                if ((mask & c_transform_rotation) != 0) {
+                    write_rotation(writer, new_rotation);
+                    state.rotation = new_rotation;
+                }
+                if ((mask & c_transform_scale) != 0) {
+                    for (int c = 0; c < 3; ++c) {
+                        writer.write_zigzag(new_scale[c] - state.scale[c]);
+                        state.scale[c] = new_scale[c];
+                    }
+                }
+                ++m_statistics.transform_count;
+            }
+        }
+
+        const uint64_t flag_bits = node.get_flag_bits() & Scene_delta::replicated_flags;
+        if (is_new || (flag_bits != state.flag_bits)) {
+            writer.write_record(Scene_delta::Record::flags, id);
+            writer.write_varint(flag_bits);
+            state.flag_bits = flag_bits;
+            ++m_statistics.flags_count;
+        }
+
+        // Attachments, and their flags
+        const auto& attachments      = node.get_attachments();
+        const bool  attachments_same = std::equal(
+            attachments.begin(), attachments.end(),
+            state.attachment_ids.begin(), state.attachment_ids.end(),
+            [](const std::shared_ptr<Node_attachment>& attachment, const std::size_t attachment_id) {
+                return attachment->get_id() == attachment_id;
+            }
+        );
+        if (!attachments_same || (is_new && !attachments.empty())) {
+            writer.write_record(Scene_delta::Record::attachments, id);
+            writer.write_varint(attachments.size());
+            state.attachment_ids.clear();
+            for (const auto& attachment : attachments) {
+                writer.write_varint(attachment->get_id());
+                writer.write_varint(attachment->get_type());
+                state.attachment_ids.push_back(attachment->get_id());
+            }
+            state.attachment_flag_bits.assign(attachments.size(), ~uint64_t{0}); // force flags
+            ++m_statistics.attachments_count;
+        }
+        for (std::size_t a = 0, end = attachments.size(); a < end; ++a) {
+            const uint64_t attachment_flag_bits = attachments[a]->get_flag_bits() & Scene_delta::replicated_flags;
+            if (attachment_flag_bits != state.attachment_flag_bits[a]) {
+                writer.write_record(Scene_delta::Record::flags, attachments[a]->get_id());
+                writer.write_varint(attachment_flag_bits);
+                state.attachment_flag_bits[a] = attachment_flag_bits;
+                ++m_statistics.flags_count;
+            }
+        }
+    }
+
+    // Nodes not visited this frame have been removed. Removes come last, so
+    // that children moved away from removed nodes have already been moved.
+    m_removed_ids.clear();
+    for (const auto& [id, state] : m_nodes) {
+        if (state.frame != m_frame) {
+            m_removed_ids.push_back(id);
+        }
+    }
+    for (const std::size_t id : m_removed_ids) {
+        writer.write_record(Scene_delta::Record::node_remove, id);
+        m_nodes.erase(id);
+        ++m_statistics.remove_count;
+    }
+
+    if (out.size() == header_byte_count) {
+        out.clear();
+        return false;
+    }
+    m_statistics.byte_count = out.size();
+    return true;
+}
+
+void Scene_delta_writer::reset()
+{
+    m_nodes.clear();
+}
+
+auto Scene_delta_writer::get_statistics() const -> const Scene_delta_statistics&
+{
+    return m_statistics;
+}
+#pragma endregion Scene_delta_writer
+
+#pragma region Scene_delta_reader
+void Scene_delta_reader::bind_node(const std::size_t remote_id, const std::shared_ptr<Node>& node)
+{
+    m_nodes[remote_id] = Node_entry{.node = node};
+}
+
+void Scene_delta_reader::bind_attachment(const std::size_t remote_id, const std::shared_ptr<Node_attachment>& attachment)
+{
+    m_attachments[remote_id] = attachment;
+    m_bound_attachments.insert(attachment.get());
+}
+
+void Scene_delta_reader::reset()
+{
+    m_nodes.clear();
+    m_attachments.clear();
+    m_bound_attachments.clear();
+}
+
+auto Scene_delta_reader::is_bound_attachment(const Node_attachment* attachment) const -> bool
+{
+    return m_bound_attachments.contains(attachment);
+}
+
+auto Scene_delta_reader::take_unbound_attachment(const Node& node, const uint64_t type) const -> std::shared_ptr<Node_attachment>
+{
+    for (const auto& attachment : node.get_attachments()) {
+        if ((attachment->get_type() == type) && !is_bound_attachment(attachment.get())) {
+            return attachment;
+        }
+    }
+    return {};
+}
+
+auto Scene_delta_reader::get_statistics() const -> const Scene_delta_statistics&
+{
+    return m_statistics;
+}
+
+auto Scene_delta_reader::find_node(Scene& scene, const std::size_t remote_id) -> std::shared_ptr<Node>
+{
+    if (remote_id == 0) {
+        return scene.get_root_node();
+    }
+    const auto i = m_nodes.find(remote_id);
+    if (i == m_nodes.end()) {
+        ++m_statistics.unresolved_id_count;
+        return {};
+    }
+    return i->second.node;
+}
+
+auto Scene_delta_reader::apply_frame(Scene& scene, const std::span<const uint8_t> data) -> bool
+{
+    ERHE_PROFILE_FUNCTION();
+
+    m_statistics = Scene_delta_statistics{};
+    m_statistics.byte_count = data.size();
+
+    Byte_reader reader{data};
+    const uint32_t magic   = reader.read_u32();
+    const uint8_t  version = reader.read_u8();
+    static_cast<void>(reader.read_varint()); // frame
+    if (reader.error() || (magic != Scene_delta::c_magic) || (version != Scene_delta::c_version)) {
+        log->warn("Scene delta frame has bad header");
+        return false;
+    }
+
+    // Children of each parent which are not bound yet, by name. These are
+    // candidates for node_create records. Built on first use in this frame.
+    std::unordered_set<const Node*> bound_nodes;
+    bool                            bound_nodes_valid{false};
+    std::unordered_map<const Node*, std::unordered_multimap<std::string_view, std::shared_ptr<Node>>> unbound_children;
+    const auto take_unbound_child = [&](const Node& parent, const std::string_view name) -> std::shared_ptr<Node> {
+        if (!bound_nodes_valid) {
+            for (const auto& [remote_id, entry] : m_nodes) {
+                bound_nodes.insert(entry.node.get());
+            }
+            bound_nodes_valid = true;
+        }
+        auto [i, is_new] = unbound_children.try_emplace(&parent);
+        auto& by_name = i->second;
+        if (is_new) {
+            for (const auto& child : parent.get_children()) {
+                auto child_node = std::dynamic_pointer_cast<Node>(child);
+                if (child_node && !bound_nodes.contains(child_node.get())) {
+                    by_name.emplace(child_node->get_name(), child_node);
+                }
+            }
+        }
+        const auto match = by_name.find(name);
+        if (match == by_name.end()) {
+            return {};
+        }
+        std::shared_ptr<Node> node = match->second;
+        by_name.erase(match);
+        return node;
+    };
+
+    // Removed descendants are detached from removed nodes before any of
+    // these are released
+    std::vector<std::shared_ptr<Node>> removed_nodes;
+
+    std::vector<std::shared_ptr<Node_attachment>> attachments;
+    bool ok = true;
+    while (ok && !reader.at_end()) {
+        const auto        record = static_cast<Scene_delta::Record>(reader.read_u8());
+        const std::size_t id     = static_cast<std::size_t>(reader.read_varint());
+        switch (record) {
+            case Scene_delta::Record::node_create: {
+                const std::size_t      parent_id = static_cast<std::size_t>(reader.read_varint());
+                const std::string_view name      = reader.read_string();
+                if (reader.error()) {
+                    break;
+                }
+                std::shared_ptr<Node> parent = find_node(scene, parent_id);
+                if (!parent) {
+                    parent = scene.get_root_node();
+                }
+                const auto existing = m_nodes.find(id);
+                if ((existing != m_nodes.end()) && !is_valid_parent(*existing->second.node.get(), *parent.get())) {
+                    log->warn("Scene delta frame would make node {} its own ancestor", id);
+                    ok = false;
+                    break;
+                }
+                Node_entry& entry = m_nodes[id];
+                if (!entry.node) {
+                    entry.node = take_unbound_child(*parent.get(), name);
+                }
+                if (!entry.node) {
+                    entry.node = std::make_shared<Node>(name);
+                }
+                if (bound_nodes_valid) {
+                    bound_nodes.insert(entry.node.get());
+                }
+                // Transform follows, relative to zero
+                std::fill(std::begin(entry.translation), std::end(entry.translation), 0);
+                std::fill(std::begin(entry.scale),       std::end(entry.scale),       0);
+                if (entry.node->get_parent().lock() != parent) {
+                    entry.node->set_parent(parent);
+                }
+                ++m_statistics.create_count;
+                break;
+            }
+
+            case Scene_delta::Record::node_remove: {
+                const auto i = m_nodes.find(id);
+                if (i == m_nodes.end()) {
+                    ++m_statistics.unresolved_id_count;
+                    break;
+                }
+                removed_nodes.push_back(i->second.node);
+                m_nodes.erase(i);
+                ++m_statistics.remove_count;
+                break;
+            }
+
+            case Scene_delta::Record::node_parent: {
+                const std::size_t           parent_id = static_cast<std::size_t>(reader.read_varint());
+                const std::shared_ptr<Node> node      = find_node(scene, id);
+                const std::shared_ptr<Node> parent    = find_node(scene, parent_id);
+                if (!node || !parent) {
+                    break;
+                }
+                if (!is_valid_parent(*node.get(), *parent.get())) {
+                    log->warn("Scene delta frame would make node {} its own ancestor", id);
+                    ok = false;
+                    break;
+                }
+                node->set_parent(parent);
+                ++m_statistics.parent_count;
+                break;
+            }
+
+            case Scene_delta::Record::transform: {
+                const uint8_t mask  = reader.read_u8();
+                const auto    i     = m_nodes.find(id);
+                Node_entry    dummy;
+                Node_entry&   entry = (i != m_nodes.end()) ? i->second : dummy;
+                if ((mask & c_transform_translation) != 0) {
+                    for (int c = 0; c < 3; ++c) {
+                        entry.translation[c] += reader.read_zigzag();
+                    }
+                }
+                const uint64_t packed_rotation = ((mask & c_transform_rotation) != 0) ? read_rotation(reader) : 0;
+                if ((mask & c_transform_scale) != 0) {
+                    for (int c = 0; c < 3; ++c) {
+                        entry.scale[c] += reader.read_zigzag();
+                    }
+                }
+                if (!entry.node) {
+                    ++m_statistics.unresolved_id_count;
+                    break;
+                }
+                // Components are set directly, to avoid matrix decompose
+                Node&          node        = *entry.node.get();
+                Trs_transform& transform   = node.node_data.transforms.parent_from_node;
+                glm::vec3      translation = transform.get_translation();
+                glm::quat      rotation    = transform.get_rotation();
+                glm::vec3      scale       = transform.get_scale();
+                if ((mask & c_transform_translation) != 0) {
+                    translation = glm::vec3{dequantize(entry.translation[0]), dequantize(entry.translation[1]), dequantize(entry.translation[2])};
+                }
+                if ((mask & c_transform_rotation) != 0) {
+                    rotation = unpack_rotation(packed_rotation);
+                }
+                if ((mask & c_transform_scale) != 0) {
+                    scale = glm::vec3{dequantize(entry.scale[0]), dequantize(entry.scale[1]), dequantize(entry.scale[2])};
+                }
+                transform.set_trs(translation, rotation, scale);
+                node.invalidate_world_transforms();
+                ++m_statistics.transform_count;
+                break;
+            }
+
+            case Scene_delta::Record::flags: {
+                const uint64_t flag_bits = reader.read_varint();
+                if (const auto i = m_nodes.find(id); i != m_nodes.end()) {
+                    apply_flag_bits(*i->second.node.get(), flag_bits);
+                } else if (const auto j = m_attachments.find(id); j != m_attachments.end()) {
+                    apply_flag_bits(*j->second.get(), flag_bits);
+                } else {
+                    ++m_statistics.unresolved_id_count;
+                    break;
+                }
+                ++m_statistics.flags_count;
+                break;
+            }
+
+            case Scene_delta::Record::attachments: {
+                const uint64_t attachment_count = reader.read_varint();
+                const auto     i                = m_nodes.find(id);
+                Node*          node_pointer     = (i != m_nodes.end()) ? i->second.node.get() : nullptr;
+                attachments.clear();
+                for (uint64_t a = 0; (a < attachment_count) && !reader.error(); ++a) {
+                    const std::size_t attachment_id   = static_cast<std::size_t>(reader.read_varint());
+                    const uint64_t    attachment_type = reader.read_varint();
+                    const auto        j               = m_attachments.find(attachment_id);
+                    if (j != m_attachments.end()) {
+                        attachments.push_back(j->second);
+                        continue;
+                    }
+                    // Unbound attachment of same type, on node matched by
+                    // name, is taken to be the same attachment
+                    std::shared_ptr<Node_attachment> local_attachment = (node_pointer != nullptr)
+                        ? take_unbound_attachment(*node_pointer, attachment_type)
+                        : std::shared_ptr<Node_attachment>{};
+                    if (!local_attachment) {
+                        ++m_statistics.unresolved_id_count;
+                        continue;
+                    }
+                    bind_attachment(attachment_id, local_attachment);
+                    attachments.push_back(local_attachment);
+                }
+                if (node_pointer == nullptr) {
+                    ++m_statistics.unresolved_id_count;
+                    break;
+                }
+                Node& node = *node_pointer;
+
+                // Only bound attachments are detached, others are local to this scene
+                const std::vector<std::shared_ptr<Node_attachment>> old_attachments = node.get_attachments();
+                for (const auto& old_attachment : old_attachments) {
+                    const bool is_bound = is_bound_attachment(old_attachment.get());
+                    const bool is_kept = std::find(attachments.begin(), attachments.end(), old_attachment) != attachments.end();
+                    if (is_bound && !is_kept) {
+                        node.detach(old_attachment.get());
+                    }
+                }
+                for (const auto& attachment : attachments) {
+                    if (attachment->get_node() != &node) {
+                        node.attach(attachment);
+                    }
+                }
+                ++m_statistics.attachments_count;
+                break;
+            }
+
+            default: {
+                log->warn("Scene delta frame has unknown record {}", static_cast<unsigned int>(record));
+                ok = false;
+                break;
+            }
+        }
+        if (ok && reader.error()) {
+            log->warn("Scene delta frame is truncated");
+            ok = false;
+        }
+    }
+
+    for (const auto& node : removed_nodes) {
+        node->set_parent(std::shared_ptr<erhe::Hierarchy>{});
+    }
+    m_statistics.node_count = m_nodes.size();
+    return ok;
+}
+#pragma endregion Scene_delta_reader
+
+} // namespace erhe::scene
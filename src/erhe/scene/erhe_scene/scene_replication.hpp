@@ -0,0 +1,153 @@
+#pragma once
+
+#include "erhe_item/item.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace erhe::scene
+{
+
+class Node;
+class Node_attachment;
+class Scene;
+
+// Binary delta protocol for replicating nodes of one scene to other scenes,
+// for example over erhe::net. Writer compares scene against what it has sent
+// before, and writes one frame per call, containing only changed nodes:
+//
+// - node create / remove / parent changes, parents before children
+// - parent_from_node translation, rotation and scale
+// - item flag bits of nodes and their attachments (replicated_flags only)
+// - list of attachments of each node
+//
+// Items are keyed by Unique_id of the writer. Translation and scale are
+// quantized to c_position_step and written as varint deltas against the
+// previously sent value, rotation is written with smallest three encoding.
+// Frames must be applied in order, which is what TCP gives.
+//
+// Reader maps writer ids to local items. Nodes are created on first sight,
+// unless an unbound child node with same name exists under same parent -
+// this way editors that have loaded the same scene share their nodes.
+// Attachments cannot be created from the stream. Unbound attachments of
+// matched nodes are bound to writer attachments of same type, in order;
+// others must be bound with bind_attachment() to be attached and get flags.
+class Scene_delta
+{
+public:
+    static constexpr uint32_t c_magic         {0x46445345u}; // "ESDF"
+    static constexpr uint8_t  c_version       {2};
+    static constexpr float    c_position_step {1.0f / 1024.0f};
+    static constexpr uint64_t replicated_flags{
+        Item_flags::show_in_ui             |
+        Item_flags::shadow_cast            |
+        Item_flags::visible                |
+        Item_flags::opaque                 |
+        Item_flags::translucent            |
+        Item_flags::render_wireframe       |
+        Item_flags::render_bounding_volume |
+        Item_flags::content
+    };
+
+    enum class Record : uint8_t {
+        node_create = 1, // id, parent id, name
+        node_remove,     // id
+        node_parent,     // id, parent id
+        transform,       // id, component mask, components
+        flags,           // id, flag bits
+        attachments      // id, attachment count, attachment id and type pairs
+    };
+
+    // Returns true if data starts with frame header
+    [[nodiscard]] static auto is_delta_frame(std::span<const uint8_t> data) -> bool;
+};
+
+class Scene_delta_statistics
+{
+public:
+    std::size_t byte_count          {0};
+    std::size_t node_count          {0}; // visited by writer, or bound by reader
+    std::size_t create_count        {0};
+    std::size_t remove_count        {0};
+    std::size_t parent_count        {0};
+    std::size_t transform_count     {0};
+    std::size_t flags_count         {0};
+    std::size_t attachments_count   {0};
+    std::size_t unresolved_id_count {0}; // reader only
+};
+
+class Scene_delta_writer
+{
+public:
+    // Writes changes since previous frame to out (which is cleared first).
+    // Returns false, and leaves out empty, if nothing has changed.
+    auto write_frame(const Scene& scene, std::vector<uint8_t>& out) -> bool;
+
+    // Forgets sent state, so that next frame contains full scene. Use when
+    // new readers join.
+    void reset();
+
+    [[nodiscard]] auto get_statistics() const -> const Scene_delta_statistics&;
+
+private:
+    class Node_state
+    {
+    public:
+        uint64_t                 frame         {0};
+        std::size_t              parent_id     {0};
+        int64_t                  translation[3]{0, 0, 0};
+        uint64_t                 rotation      {0};
+        int64_t                  scale[3]      {0, 0, 0};
+        uint64_t                 flag_bits     {0};
+        std::vector<std::size_t> attachment_ids;
+        std::vector<uint64_t>    attachment_flag_bits; // parallel to attachment_ids
+    };
+
+    uint64_t                                    m_frame{0};
+    std::unordered_map<std::size_t, Node_state> m_nodes;
+    std::vector<std::size_t>                    m_removed_ids;
+    Scene_delta_statistics                      m_statistics;
+};
+
+class Scene_delta_reader
+{
+public:
+    // Applies one frame written by Scene_delta_writer. Returns false if the
+    // frame is malformed; records before the error have been applied.
+    auto apply_frame(Scene& scene, std::span<const uint8_t> data) -> bool;
+
+    // Maps writer side ids to local items
+    void bind_node      (std::size_t remote_id, const std::shared_ptr<Node>& node);
+    void bind_attachment(std::size_t remote_id, const std::shared_ptr<Node_attachment>& attachment);
+
+    // Forgets all bindings, for example when connection is lost
+    void reset();
+
+    [[nodiscard]] auto get_statistics() const -> const Scene_delta_statistics&;
+
+private:
+    class Node_entry
+    {
+    public:
+        std::shared_ptr<Node> node;
+        int64_t               translation[3]{0, 0, 0};
+        int64_t               scale[3]      {0, 0, 0};
+    };
+
+    [[nodiscard]] auto find_node              (Scene& scene, std::size_t remote_id) -> std::shared_ptr<Node>;
+    [[nodiscard]] auto is_bound_attachment    (const Node_attachment* attachment) const -> bool;
+    [[nodiscard]] auto take_unbound_attachment(const Node& node, uint64_t type) const -> std::shared_ptr<Node_attachment>;
+
+    std::unordered_map<std::size_t, Node_entry>                       m_nodes;
+    std::unordered_map<std::size_t, std::shared_ptr<Node_attachment>> m_attachments;
+    std::unordered_set<const Node_attachment*>                        m_bound_attachments;
+    Scene_delta_statistics                                            m_statistics;
+};
+
+} // namespace erhe::scene
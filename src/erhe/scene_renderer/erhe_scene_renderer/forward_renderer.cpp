@@ -1,5 +1,6 @@
 #include "erhe_scene_renderer/forward_renderer.hpp"
 
+#include "erhe_configuration/configuration.hpp"
 #include "erhe_gl/draw_indirect.hpp"
 #include "erhe_gl/wrapper_functions.hpp"
 #include "erhe_graphics/debug.hpp"
@@ -9,6 +10,7 @@
 #include "erhe_graphics/state/vertex_input_state.hpp"
 #include "erhe_scene/camera.hpp"
 #include "erhe_scene/light.hpp"
+#include "erhe_scene/node.hpp"
 #include "erhe_scene_renderer/scene_renderer_log.hpp"
 #include "erhe_scene_renderer/program_interface.hpp"
 #include "erhe_scene_renderer/shadow_renderer.hpp"
@@ -50,6 +52,11 @@ Forward_renderer::Forward_renderer(
     erhe::graphics::Scoped_debug_group forward_renderer_initialization{c_forward_renderer_initialize_component};
 
     m_dummy_texture = graphics_instance.create_dummy_texture();
+
+    auto ini = erhe::configuration::get_ini("erhe.ini", "renderer");
+    ini->get("frustum_culling", m_frustum_culling);
+    ini->get("sort_draws",           m_sort_draws);
+    ini->get("sort_resort_distance", m_sort_resort_distance);
 }
 
 static constexpr std::string_view c_forward_renderer_render{"Forward_renderer::render()"};
@@ -62,6 +69,25 @@ void Forward_renderer::next_frame()
     m_light_buffers        .next_frame();
     m_material_buffers     .next_frame();
     m_primitive_buffers    .next_frame();
+
+    // Drop sorters of cameras and passes no longer rendered
+    const uint64_t frame = m_primitive_buffers.frame_number();
+    std::erase_if(
+        m_sorters,
+        [frame](const auto& entry) {
+            return entry.second.used_frame + erhe::renderer::Multi_buffer::s_frame_resources_count < frame;
+        }
+    );
+}
+
+auto Forward_renderer::get_culling_statistics() const -> const erhe::scene::Culling_statistics&
+{
+    return m_mesh_culler.get_statistics();
+}
+
+auto Forward_renderer::get_sort_statistics() const -> const erhe::scene::Mesh_sort_statistics&
+{
+    return m_sort_statistics;
 }
 
 namespace {
@@ -161,6 +187,72 @@ void Forward_renderer::render(const Render_parameters& parameters)
         m_graphics_instance.texture_unit_cache_bind(fallback_texture_handle);
     }
 
+    // Culled and sorted mesh lists are shared by all passes
+    const std::vector<gsl::span<const std::shared_ptr<erhe::scene::Mesh>>>* visible_mesh_spans = &mesh_spans;
+    const bool has_view = (camera != nullptr) && (camera->get_node() != nullptr);
+    const bool cull     = m_frustum_culling && has_view;
+    const bool sort     = m_sort_draws && has_view;
+    if (cull || sort) {
+        m_cull_mesh_spans.clear();
+        for (const auto& meshes : mesh_spans) {
+            m_cull_mesh_spans.emplace_back(meshes.data(), meshes.size());
+        }
+        const std::vector<erhe::scene::Mesh_culler::Mesh_span>* input_mesh_spans = &m_cull_mesh_spans;
+
+        if (cull) {
+            ERHE_PROFILE_SCOPE("cull");
+
+            const glm::mat4 clip_from_world =
+                camera->projection()->clip_from_node_transform(viewport).get_matrix() *
+                camera->get_node()->node_from_world();
+
+            input_mesh_spans = &m_mesh_culler.cull(clip_from_world, m_cull_mesh_spans, filter, parameters.thread_pool);
+
+            const auto& statistics = m_mesh_culler.get_statistics();
+            log_render->trace(
+                "culling: {} meshes, {} visible, {} culled, {} filtered, {} unbounded",
+                statistics.mesh_count,
+                statistics.visible_mesh_count,
+                statistics.culled_mesh_count,
+                statistics.filtered_mesh_count,
+                statistics.unbounded_mesh_count
+            );
+        }
+
+        m_visible_mesh_spans.clear();
+        if (sort) {
+            ERHE_PROFILE_SCOPE("sort");
+
+            const glm::vec3 view_position = glm::vec3{camera->get_node()->position_in_world()};
+            const erhe::renderer::Persistent_block_key sorter_key{
+                .owner = passes.empty() ? nullptr : passes.front(),
+                .view  = camera
+            };
+            Sorter& sorter = m_sorters[sorter_key];
+            sorter.used_frame = m_primitive_buffers.frame_number();
+            sorter.mesh_sorter.set_resort_distance(m_sort_resort_distance);
+            const auto sorted_meshes = sorter.mesh_sorter.sort(view_position, *input_mesh_spans, filter);
+            m_visible_mesh_spans.emplace_back(sorted_meshes.data(), sorted_meshes.size());
+
+            m_sort_statistics = sorter.mesh_sorter.get_statistics();
+            const auto& statistics = m_sort_statistics;
+            log_render->trace(
+                "sorting: {} meshes, order {}, draw ranges {} -> {}, material changes {} -> {}",
+                statistics.mesh_count,
+                statistics.order_reused ? "kept" : "sorted",
+                statistics.input_range_count,
+                statistics.output_range_count,
+                statistics.input_material_changes,
+                statistics.output_material_changes
+            );
+        } else {
+            for (const auto& meshes : *input_mesh_spans) {
+                m_visible_mesh_spans.emplace_back(meshes.data(), meshes.size());
+            }
+        }
+        visible_mesh_spans = &m_visible_mesh_spans;
+    }
+
     for (auto& pass : passes) {
         const auto& pipeline = pass->pipeline;
         bool use_override_shader_stages = (parameters.override_shader_stages != nullptr);
@@ -191,15 +283,21 @@ void Forward_renderer::render(const Render_parameters& parameters)
         }
         m_graphics_instance.opengl_state_tracker.execute(pipeline, use_override_shader_stages);
 
-        for (const auto& meshes : mesh_spans) {
+        for (std::size_t span_index = 0, span_end = visible_mesh_spans->size(); span_index < span_end; ++span_index) {
             ERHE_PROFILE_SCOPE("mesh span");
             //ERHE_PROFILE_GPU_SCOPE(c_forward_renderer_render);
+            const auto& meshes = (*visible_mesh_spans)[span_index];
             if (meshes.empty()) {
                 continue;
             }
 
-            const auto primitive_range            = m_primitive_buffers.update(meshes, filter, parameters.primitive_settings);
-            const auto draw_indirect_buffer_range = m_draw_indirect_buffers.update(meshes, primitive_mode, filter);
+            const erhe::renderer::Persistent_block_key key{
+                .owner = pass,
+                .view  = camera,
+                .index = span_index
+            };
+            const auto primitive_range            = m_primitive_buffers.update(meshes, filter, parameters.primitive_settings, false, key);
+            const auto draw_indirect_buffer_range = m_draw_indirect_buffers.update(meshes, primitive_mode, filter, {}, key);
             if (draw_indirect_buffer_range.draw_indirect_count == 0) {
                 continue;
             }
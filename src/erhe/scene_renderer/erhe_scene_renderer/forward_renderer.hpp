@@ -9,15 +9,21 @@
 #include "erhe_scene_renderer/light_buffer.hpp"
 #include "erhe_scene_renderer/material_buffer.hpp"
 #include "erhe_scene_renderer/primitive_buffer.hpp"
+#include "erhe_scene/mesh_culler.hpp"
+#include "erhe_scene/mesh_sorter.hpp"
 
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace erhe {
     class Item_filter;
 }
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::graphics {
     class Instance;
     class Texture;
@@ -69,6 +75,7 @@ public:
         const erhe::graphics::Shader_stages*                               error_shader_stages{nullptr};
         const glm::uvec4&                                                  debug_joint_indices{0, 0, 0, 0};
         const gsl::span<glm::vec4>&                                        debug_joint_colors{};
+        erhe::concurrency::Thread_pool*                                    thread_pool{nullptr}; // for culling
     };
 
     void render(const Render_parameters& parameters);
@@ -80,6 +87,10 @@ public:
 
     void next_frame();
 
+    // Statistics of last render() call which culled / sorted meshes
+    [[nodiscard]] auto get_culling_statistics() const -> const erhe::scene::Culling_statistics&;
+    [[nodiscard]] auto get_sort_statistics   () const -> const erhe::scene::Mesh_sort_statistics&;
+
 private:
     erhe::graphics::Instance& m_graphics_instance;
 
@@ -92,6 +103,33 @@ private:
     Primitive_buffer                         m_primitive_buffers;
     erhe::graphics::Sampler                  m_nearest_sampler;
     std::shared_ptr<erhe::graphics::Texture> m_dummy_texture;
+
+    // Mesh sorter of render() calls with the same first pass and camera,
+    // so that each keeps its own previous order
+    class Sorter
+    {
+    public:
+        erhe::scene::Mesh_sorter mesh_sorter;
+        uint64_t                 used_frame{0};
+    };
+    using Sorters = std::unordered_map<
+        erhe::renderer::Persistent_block_key,
+        Sorter,
+        erhe::renderer::Persistent_block_key_hash
+    >;
+
+    // Meshes outside of camera view volume are skipped before primitive
+    // and draw indirect buffer updates. Remaining meshes are merged to one
+    // list, sorted by material and distance, and drawn with one multi draw
+    // indirect call per pass.
+    bool                                                              m_frustum_culling{true};
+    erhe::scene::Mesh_culler                                          m_mesh_culler;
+    bool                                                              m_sort_draws{true};
+    float                                                             m_sort_resort_distance{1.0f};
+    Sorters                                                           m_sorters;
+    erhe::scene::Mesh_sort_statistics                                 m_sort_statistics;
+    std::vector<erhe::scene::Mesh_culler::Mesh_span>                  m_cull_mesh_spans;
+    std::vector<gsl::span<const std::shared_ptr<erhe::scene::Mesh>>> m_visible_mesh_spans;
 };
 
 } // namespace erhe::scene_renderer
@@ -3,6 +3,7 @@
 #include "erhe_scene_renderer/primitive_buffer.hpp"
 
 #include "erhe_configuration/configuration.hpp"
+#include "erhe_graphics/instance.hpp"
 #include "erhe_primitive/primitive.hpp"
 #include "erhe_primitive/material.hpp"
 #include "erhe_scene/mesh.hpp"
@@ -44,6 +45,14 @@ Primitive_buffer::Primitive_buffer(
     : Multi_buffer         {graphics_instance, "primitive"}
     , m_primitive_interface{primitive_interface}
 {
+    std::size_t max_persistent_primitive_count = m_primitive_interface.max_primitive_count;
+    auto ini = erhe::configuration::get_ini("erhe.ini", "renderer");
+    ini->get("delta_buffer_updates",           m_delta_updates);
+    ini->get("max_persistent_primitive_count", max_persistent_primitive_count);
+    if (m_delta_updates) {
+        Multi_buffer::reserve_persistent(m_primitive_interface.primitive_struct.size_bytes() * max_persistent_primitive_count);
+    }
+
     Multi_buffer::allocate(
         gl::Buffer_target::shader_storage_buffer,
         m_primitive_interface.primitive_block.binding_point(),
@@ -67,11 +76,204 @@ auto Primitive_buffer::id_ranges() const -> const std::vector<Id_range>&
     return m_id_ranges;
 }
 
+void Primitive_buffer::next_frame()
+{
+    Multi_buffer::next_frame();
+    if (m_blocks_generation != persistent_generation()) {
+        // Persistent region was reset - this also drops blocks of keys no longer in use
+        m_persistent_blocks.clear();
+        m_blocks_generation = persistent_generation();
+    }
+    m_write_byte_count = 0;
+}
+
+auto Primitive_buffer::get_write_byte_count() const -> std::size_t
+{
+    return m_write_byte_count;
+}
+
+auto Primitive_buffer::is_persistent_update_possible(
+    const Primitive_interface_settings&         settings,
+    const bool                                  use_id_ranges,
+    const erhe::renderer::Persistent_block_key& key
+) const -> bool
+{
+    // Id offsets are allocated sequentially each frame
+    return
+        m_delta_updates &&
+        (key.owner != nullptr) &&
+        !use_id_ranges &&
+        (settings.color_source != Primitive_color_source::id_offset);
+}
+
+auto Primitive_buffer::make_persistent_entry(
+    const erhe::scene::Mesh&            mesh,
+    const erhe::scene::Node&            node,
+    const std::size_t                   primitive_index,
+    const Primitive_interface_settings& settings
+) const -> Persistent_entry
+{
+    const auto&    skin      = mesh.skin;
+    const auto&    primitive = mesh.get_primitives()[primitive_index];
+    const float    size =
+        (settings.size_source == Primitive_size_source::mesh_point_size) ? mesh.point_size :
+        (settings.size_source == Primitive_size_source::mesh_line_width) ? mesh.line_width :
+                                                                           settings.constant_size;
+    return Persistent_entry{
+        .mesh                   = &mesh,
+        .primitive_index        = primitive_index,
+        .node                   = &node,
+        .world_from_node_serial = node.node_data.transforms.world_from_node_serial,
+        .material_index         = (primitive.material != nullptr) ? primitive.material->material_buffer_index : 0u,
+        .base_joint_index       = skin ? skin->skin_data.joint_buffer_index : 0,
+        .skinning_factor        = skin ? 1.0f : 0.0f,
+        .size                   = size
+    };
+}
+
+auto Primitive_buffer::update_persistent(
+    const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+    const erhe::Item_filter&                                   filter,
+    const Primitive_interface_settings&                        settings,
+    const erhe::renderer::Persistent_block_key&                key
+) -> std::optional<erhe::renderer::Buffer_range>
+{
+    ERHE_PROFILE_FUNCTION();
+
+    std::size_t primitive_count = 0;
+    for (const auto& mesh : meshes) {
+        ERHE_VERIFY(mesh);
+        if (!filter(mesh->get_flag_bits()) || (mesh->get_node() == nullptr)) {
+            continue;
+        }
+        primitive_count += mesh->get_primitives().size();
+    }
+    if (primitive_count == 0) {
+        return erhe::renderer::Buffer_range{};
+    }
+
+    Persistent_block& block      = m_persistent_blocks[key];
+    const uint64_t    frame      = frame_number();
+    const auto        entry_size = m_primitive_interface.primitive_struct.size_bytes();
+
+    if (block.used_frame == frame) {
+        // Earlier draw this frame uses the block - share it if contents match, but never overwrite it
+        bool        same        = (block.filter == filter) && (block.settings == settings) && (block.entries.size() == primitive_count);
+        std::size_t entry_index = 0;
+        for (std::size_t mesh_index = 0, mesh_end = meshes.size(); same && (mesh_index < mesh_end); ++mesh_index) {
+            const auto& mesh = meshes[mesh_index];
+            const auto* node = mesh->get_node();
+            if (!filter(mesh->get_flag_bits()) || (node == nullptr)) {
+                continue;
+            }
+            for (std::size_t primitive_index = 0, end = mesh->get_primitives().size(); same && (primitive_index < end); ++primitive_index) {
+                same = block.entries[entry_index++] == make_persistent_entry(*mesh, *node, primitive_index, settings);
+            }
+        }
+        if (!same) {
+            return {};
+        }
+        return erhe::renderer::Buffer_range{
+            .first_byte_offset = block.byte_offset,
+            .byte_count        = primitive_count * entry_size
+        };
+    }
+    block.used_frame = frame;
+
+    if ((block.generation != persistent_generation()) || (block.capacity < primitive_count)) {
+        const std::size_t capacity    = erhe::math::next_power_of_two(static_cast<uint32_t>(primitive_count));
+        const auto        byte_offset = allocate_persistent(
+            capacity * entry_size,
+            m_instance.implementation_defined.shader_storage_buffer_offset_alignment
+        );
+        if (!byte_offset.has_value()) {
+            block = Persistent_block{};
+            return {};
+        }
+        block.byte_offset = byte_offset.value();
+        block.capacity    = capacity;
+        block.generation  = persistent_generation();
+        block.entries.reset_written_frames();
+        block.entries.clear();
+    }
+    if ((block.filter != filter) || (block.settings != settings)) {
+        block.filter   = filter;
+        block.settings = settings;
+        block.entries.clear();
+    }
+    block.entries.resize(primitive_count, frame);
+
+    // Detect changed entries
+    std::size_t entry_index = 0;
+    for (const auto& mesh : meshes) {
+        const auto* node = mesh->get_node();
+        if (!filter(mesh->get_flag_bits()) || (node == nullptr)) {
+            continue;
+        }
+        for (std::size_t primitive_index = 0, end = mesh->get_primitives().size(); primitive_index < end; ++primitive_index) {
+            block.entries.update(entry_index++, make_persistent_entry(*mesh, *node, primitive_index, settings), frame);
+        }
+    }
+
+    // Rewrite entries which changed after block was last written to current frame buffer
+    const erhe::renderer::Dirty_range dirty = block.entries.get_dirty_range(current_slot());
+    if (!dirty.empty()) {
+        const auto&              offsets          = m_primitive_interface.offsets;
+        const std::size_t        dirty_byte_count = dirty.entry_count() * entry_size;
+        const auto               gpu_data         = begin_persistent_write(block.byte_offset + dirty.first * entry_size, dirty_byte_count);
+        const glm::vec4          wireframe_color  = glm::vec4{1.0f, 1.0f, 1.0f, 1.0f}; //// mesh->get_wireframe_color();
+        const glm::vec4&         color            = (settings.color_source == Primitive_color_source::mesh_wireframe_color) ? wireframe_color : settings.constant_color;
+        const erhe::scene::Node* previous_node    = nullptr;
+        glm::mat4                world_from_node         {1.0f};
+        glm::mat4                world_from_node_cofactor{1.0f};
+        for (std::size_t i = dirty.first; i <= dirty.last; ++i) {
+            if (!block.entries.is_dirty(i, dirty)) {
+                continue;
+            }
+            const Persistent_entry& entry = block.entries[i];
+            if (entry.node != previous_node) {
+                world_from_node          = entry.node->world_from_node();
+                world_from_node_cofactor = erhe::math::compute_cofactor(world_from_node);
+                previous_node            = entry.node;
+            }
+
+            using erhe::graphics::as_span;
+            using erhe::graphics::write;
+            const std::size_t offset = (i - dirty.first) * entry_size;
+            write(gpu_data, offset + offsets.world_from_node,          as_span(world_from_node         ));
+            write(gpu_data, offset + offsets.world_from_node_cofactor, as_span(world_from_node_cofactor));
+            write(gpu_data, offset + offsets.color,                    as_span(color                   ));
+            write(gpu_data, offset + offsets.material_index,           as_span(entry.material_index    ));
+            write(gpu_data, offset + offsets.size,                     as_span(entry.size              ));
+            write(gpu_data, offset + offsets.skinning_factor,          as_span(entry.skinning_factor   ));
+            write(gpu_data, offset + offsets.base_joint_index,         as_span(entry.base_joint_index  ));
+        }
+        end_persistent_write(dirty_byte_count);
+        m_write_byte_count += dirty.changed_count * entry_size;
+    }
+    block.entries.set_written(current_slot(), frame);
+
+    SPDLOG_LOGGER_TRACE(
+        log_render,
+        "persistent block: {} entries, dirty range {}..{}, {} changed",
+        primitive_count,
+        dirty.first,
+        dirty.last,
+        dirty.changed_count
+    );
+
+    return erhe::renderer::Buffer_range{
+        .first_byte_offset = block.byte_offset,
+        .byte_count        = primitive_count * entry_size
+    };
+}
+
 auto Primitive_buffer::update(
     const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
     const erhe::Item_filter&                                   filter,
     const Primitive_interface_settings&                        settings,
-    bool                                                       use_id_ranges
+    bool                                                       use_id_ranges,
+    const erhe::renderer::Persistent_block_key&                key
 ) -> erhe::renderer::Buffer_range
 {
     ERHE_PROFILE_FUNCTION();
@@ -83,6 +285,14 @@ auto Primitive_buffer::update(
         m_writer.write_offset
     );
 
+    if (is_persistent_update_possible(settings, use_id_ranges, key)) {
+        const auto persistent_range = update_persistent(meshes, filter, settings, key);
+        if (persistent_range.has_value()) {
+            return persistent_range.value();
+        }
+        // Persistent region is full, or block is in use - fall back to per frame write
+    }
+
     std::size_t primitive_count = 0;
     std::size_t mesh_index = 0;
     for (const auto& mesh : meshes) {
@@ -206,6 +416,7 @@ auto Primitive_buffer::update(
     }
 
     m_writer.end();
+    m_write_byte_count += m_writer.range.byte_count;
 
     SPDLOG_LOGGER_TRACE(log_draw, "wrote {} entries to primitive buffer", primitive_index);
 
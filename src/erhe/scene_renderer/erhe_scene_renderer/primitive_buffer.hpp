@@ -1,16 +1,19 @@
 #pragma once
 
 #include "erhe_graphics/shader_resource.hpp"
+#include "erhe_item/item.hpp"
 #include "erhe_renderer/multi_buffer.hpp"
+#include "erhe_renderer/persistent_block_entries.hpp"
 
+#include <array>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
-namespace erhe {
-    class Item_filter;
-}
 namespace erhe::scene {
     class Mesh;
     class Mesh_layer;
+    class Node;
 }
 
 namespace erhe::scene_renderer
@@ -91,6 +94,8 @@ public:
         )
     };
 
+    [[nodiscard]] auto operator==(const Primitive_interface_settings& other) const -> bool = default;
+
     Primitive_color_source color_source  {Primitive_color_source::constant_color};
     glm::vec4              constant_color{1.0f, 1.0f, 1.0f, 1.0f};
     Primitive_size_source  size_source   {Primitive_size_source::constant_size};
@@ -108,11 +113,14 @@ public:
 
     using Mesh_layer_collection = std::vector<const erhe::scene::Mesh_layer*>;
 
+    // Entries are kept in persistent block of key, if given, and only
+    // changed entries are rewritten.
     auto update(
         const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
         const erhe::Item_filter&                                   filter,
         const Primitive_interface_settings&                        settings,
-        bool                                                       use_id_ranges = false
+        bool                                                       use_id_ranges = false,
+        const erhe::renderer::Persistent_block_key&                key           = {}
     ) -> erhe::renderer::Buffer_range;
 
     class Id_range
@@ -128,10 +136,79 @@ public:
     [[nodiscard]] auto id_offset() const -> uint32_t;
     [[nodiscard]] auto id_ranges() const -> const std::vector<Id_range>&;
 
+    // Hides Multi_buffer::next_frame()
+    void next_frame();
+
+    // Bytes written to primitive buffer since last next_frame()
+    [[nodiscard]] auto get_write_byte_count() const -> std::size_t;
+
 private:
+    // Persistent primitive entries of update() calls with the same key. Only
+    // entries which changed since the block was last written to current frame
+    // buffer are rewritten.
+    class Persistent_entry
+    {
+    public:
+        const erhe::scene::Mesh* mesh                  {nullptr};
+        std::size_t              primitive_index       {0};
+        const erhe::scene::Node* node                  {nullptr};
+        uint64_t                 world_from_node_serial{0};
+        uint32_t                 material_index        {0};
+        uint32_t                 base_joint_index      {0};
+        float                    skinning_factor       {0.0f};
+        float                    size                  {0.0f};
+
+        [[nodiscard]] auto operator==(const Persistent_entry& other) const -> bool = default;
+    };
+
+    class Persistent_block
+    {
+    public:
+        using Entries = erhe::renderer::Persistent_block_entries<
+            Persistent_entry,
+            erhe::renderer::Multi_buffer::s_frame_resources_count
+        >;
+
+        std::size_t                  byte_offset{0};
+        std::size_t                  capacity   {0}; // in entries
+        uint64_t                     generation {0}; // Multi_buffer persistent generation
+        uint64_t                     used_frame {0};
+        erhe::Item_filter            filter;
+        Primitive_interface_settings settings;
+        Entries                      entries;
+    };
+
+    using Persistent_blocks = std::unordered_map<
+        erhe::renderer::Persistent_block_key,
+        Persistent_block,
+        erhe::renderer::Persistent_block_key_hash
+    >;
+
+    [[nodiscard]] auto is_persistent_update_possible(
+        const Primitive_interface_settings&         settings,
+        bool                                        use_id_ranges,
+        const erhe::renderer::Persistent_block_key& key
+    ) const -> bool;
+    [[nodiscard]] auto make_persistent_entry(
+        const erhe::scene::Mesh&            mesh,
+        const erhe::scene::Node&            node,
+        std::size_t                         primitive_index,
+        const Primitive_interface_settings& settings
+    ) const -> Persistent_entry;
+    auto update_persistent(
+        const gsl::span<const std::shared_ptr<erhe::scene::Mesh>>& meshes,
+        const erhe::Item_filter&                                   filter,
+        const Primitive_interface_settings&                        settings,
+        const erhe::renderer::Persistent_block_key&                key
+    ) -> std::optional<erhe::renderer::Buffer_range>;
+
     Primitive_interface&  m_primitive_interface;
     uint32_t              m_id_offset{0};
     std::vector<Id_range> m_id_ranges;
+    bool                  m_delta_updates    {true};
+    Persistent_blocks     m_persistent_blocks;
+    uint64_t              m_blocks_generation{0};
+    std::size_t           m_write_byte_count {0};
 };
 
 } // namespace erhe::scene_renderer
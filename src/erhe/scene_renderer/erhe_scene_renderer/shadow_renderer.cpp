@@ -19,6 +19,8 @@
 #include "erhe_profile/profile.hpp"
 #include "erhe_verify/verify.hpp"
 
+#include <algorithm>
+
 namespace erhe::scene_renderer
 {
 
@@ -64,6 +66,9 @@ Shadow_renderer::Shadow_renderer(
 {
     ERHE_PROFILE_FUNCTION();
     m_pipeline_cache_entries.resize(8);
+
+    auto ini = erhe::configuration::get_ini("erhe.ini", "renderer");
+    ini->get("frustum_culling", m_frustum_culling);
 }
 
 auto Shadow_renderer::get_pipeline(
@@ -108,6 +113,11 @@ void Shadow_renderer::next_frame()
     m_primitive_buffers    .next_frame();
 }
 
+auto Shadow_renderer::get_culling_statistics() const -> const std::vector<erhe::scene::Culling_statistics>&
+{
+    return m_culling_statistics;
+}
+
 auto Shadow_renderer::render(const Render_parameters& parameters) -> bool
 {
     log_shadow_renderer->trace(
@@ -176,12 +186,162 @@ auto Shadow_renderer::render(const Render_parameters& parameters) -> bool
 
     log_shadow_renderer->trace("Rendering shadow map to '{}'", parameters.texture->debug_label());
 
+    m_culling_statistics.clear();
+    if (m_frustum_culling) {
+        m_cull_mesh_spans.clear();
+        for (const auto& meshes : mesh_spans) {
+            m_cull_mesh_spans.emplace_back(meshes.data(), meshes.size());
+        }
+        const std::size_t span_count = m_cull_mesh_spans.size();
+
+        // All lights are culled first. Primitive buffer is then written once,
+        // for meshes visible to at least one light. Each light writes only
+        // draw indirect commands, with zero instance count for meshes outside
+        // its view volume, so that gl_DrawID still indexes shared primitives.
+        m_shadow_lights.clear();
+        m_light_visibility.clear();
+        m_any_light_visibility.resize(span_count);
+        for (std::size_t span_index = 0; span_index < span_count; ++span_index) {
+            m_any_light_visibility[span_index].assign(m_cull_mesh_spans[span_index].size(), 0);
+        }
+        for (const auto& light : lights) {
+            if (!light->cast_shadow) {
+                continue;
+            }
+
+            auto* light_projection_transform = parameters.light_projections.get_light_projection_transforms_for_light(light.get());
+            if (light_projection_transform == nullptr) {
+                continue;
+            }
+            const std::size_t light_index = light_projection_transform->index;
+            if (light_index >= parameters.framebuffers.size()) {
+                continue;
+            }
+
+            m_mesh_culler.cull(
+                light_projection_transform->clip_from_world.get_matrix(),
+                m_cull_mesh_spans,
+                shadow_filter,
+                parameters.thread_pool
+            );
+            m_culling_statistics.push_back(m_mesh_culler.get_statistics());
+            m_shadow_lights.push_back(Shadow_light{.light = light.get(), .light_index = light_index});
+            for (std::size_t span_index = 0; span_index < span_count; ++span_index) {
+                const std::span<const uint8_t> visibility     = m_mesh_culler.get_visibility(span_index);
+                std::vector<uint8_t>&          any_visibility = m_any_light_visibility[span_index];
+                for (std::size_t i = 0, end = visibility.size(); i < end; ++i) {
+                    any_visibility[i] |= visibility[i];
+                }
+                m_light_visibility.emplace_back(visibility.begin(), visibility.end());
+            }
+        }
+
+        // Meshes visible to any light, and visibility of those for each light
+        m_shadow_meshes.resize(span_count);
+        m_primitive_ranges.clear();
+        for (std::size_t span_index = 0; span_index < span_count; ++span_index) {
+            const erhe::scene::Mesh_culler::Mesh_span& meshes         = m_cull_mesh_spans[span_index];
+            const std::vector<uint8_t>&                any_visibility = m_any_light_visibility[span_index];
+            std::vector<std::shared_ptr<erhe::scene::Mesh>>& shadow_meshes = m_shadow_meshes[span_index];
+            shadow_meshes.clear();
+            for (std::size_t i = 0, end = meshes.size(); i < end; ++i) {
+                if (any_visibility[i] != 0) {
+                    shadow_meshes.push_back(meshes[i]);
+                }
+            }
+            for (std::size_t light_slot = 0, light_end = m_shadow_lights.size(); light_slot < light_end; ++light_slot) {
+                std::vector<uint8_t>& visibility = m_light_visibility[light_slot * span_count + span_index];
+                std::size_t shadow_mesh_index = 0;
+                for (std::size_t i = 0, end = meshes.size(); i < end; ++i) {
+                    if (any_visibility[i] != 0) {
+                        visibility[shadow_mesh_index++] = visibility[i];
+                    }
+                }
+                visibility.resize(shadow_mesh_index);
+            }
+            m_primitive_ranges.push_back(
+                shadow_meshes.empty()
+                    ? erhe::renderer::Buffer_range{}
+                    : m_primitive_buffers.update(
+                        shadow_meshes,
+                        shadow_filter,
+                        Primitive_interface_settings{},
+                        false,
+                        erhe::renderer::Persistent_block_key{.owner = this, .view = parameters.view_camera, .index = span_index}
+                    )
+            );
+        }
+
+        for (std::size_t light_slot = 0, light_end = m_shadow_lights.size(); light_slot < light_end; ++light_slot) {
+            const Shadow_light& shadow_light = m_shadow_lights[light_slot];
+            {
+                ERHE_PROFILE_SCOPE("bind fbo");
+                gl::bind_framebuffer(gl::Framebuffer_target::draw_framebuffer, parameters.framebuffers[shadow_light.light_index]->gl_name());
+            }
+
+            {
+                ERHE_PROFILE_SCOPE("clear fbo");
+                gl::clear_buffer_fv(
+                    gl::Buffer::depth,
+                    0,
+                    m_graphics_instance.depth_clear_value_pointer()
+                );
+            }
+
+            const auto control_range = m_light_buffers.update_control(shadow_light.light_index);
+            m_light_buffers.bind_control_buffer(control_range);
+
+            for (std::size_t span_index = 0; span_index < span_count; ++span_index) {
+                const std::vector<std::shared_ptr<erhe::scene::Mesh>>& shadow_meshes = m_shadow_meshes[span_index];
+                const std::vector<uint8_t>&                            visibility    = m_light_visibility[light_slot * span_count + span_index];
+                if (std::find(visibility.begin(), visibility.end(), uint8_t{1}) == visibility.end()) {
+                    continue;
+                }
+                const auto draw_indirect_buffer_range = m_draw_indirect_buffers.update(
+                    gsl::span<const std::shared_ptr<erhe::scene::Mesh>>{shadow_meshes.data(), shadow_meshes.size()},
+                    erhe::primitive::Primitive_mode::polygon_fill,
+                    shadow_filter,
+                    gsl::span<const uint8_t>{visibility.data(), visibility.size()},
+                    erhe::renderer::Persistent_block_key{.owner = shadow_light.light, .view = parameters.view_camera, .index = span_index}
+                );
+                if (draw_indirect_buffer_range.draw_indirect_count == 0) {
+                    continue;
+                }
+                m_primitive_buffers.bind(m_primitive_ranges[span_index]);
+                m_draw_indirect_buffers.bind(draw_indirect_buffer_range.range);
+
+                ERHE_PROFILE_SCOPE("mdi");
+                gl::multi_draw_elements_indirect(
+                    pipeline.data.input_assembly.primitive_topology,
+                    parameters.index_type,
+                    reinterpret_cast<const void *>(draw_indirect_buffer_range.range.first_byte_offset),
+                    static_cast<GLsizei>(draw_indirect_buffer_range.draw_indirect_count),
+                    static_cast<GLsizei>(sizeof(gl::Draw_elements_indirect_command))
+                );
+            }
+
+            const auto& statistics = m_culling_statistics[light_slot];
+            log_shadow_renderer->trace(
+                "light {} culling: {} meshes, {} visible, {} culled",
+                shadow_light.light->get_name(),
+                statistics.mesh_count,
+                statistics.visible_mesh_count,
+                statistics.culled_mesh_count
+            );
+        }
+        return true;
+    }
+
+    std::size_t span_index = 0;
     for (const auto& meshes : mesh_spans) {
-        const auto primitive_range = m_primitive_buffers.update(meshes, shadow_filter, Primitive_interface_settings{});
+        const erhe::renderer::Persistent_block_key key{.owner = this, .view = parameters.view_camera, .index = span_index++};
+        const auto primitive_range = m_primitive_buffers.update(meshes, shadow_filter, Primitive_interface_settings{}, false, key);
         const auto draw_indirect_buffer_range = m_draw_indirect_buffers.update(
             meshes,
             erhe::primitive::Primitive_mode::polygon_fill,
-            shadow_filter
+            shadow_filter,
+            {},
+            key
         );
         if (draw_indirect_buffer_range.draw_indirect_count > 0) {
             m_primitive_buffers.bind(primitive_range);
@@ -10,9 +10,14 @@
 #include "erhe_scene_renderer/joint_buffer.hpp"
 #include "erhe_scene_renderer/light_buffer.hpp"
 #include "erhe_scene_renderer/primitive_buffer.hpp"
+#include "erhe_scene/mesh_culler.hpp"
 
 #include <initializer_list>
+#include <vector>
 
+namespace erhe::concurrency {
+    class Thread_pool;
+}
 namespace erhe::graphics {
     class Framebuffer;
     class Gpu_timer;
@@ -68,11 +73,15 @@ public:
         const gsl::span<const std::shared_ptr<erhe::scene::Light>> lights;
         const gsl::span<const std::shared_ptr<erhe::scene::Skin>>& skins{};
         Light_projections&                                         light_projections;
+        erhe::concurrency::Thread_pool*                            thread_pool{nullptr}; // for culling
     };
 
     auto render    (const Render_parameters& parameters) -> bool;
     void next_frame();
 
+    // Culling statistics of last render() call, one entry per rendered light
+    [[nodiscard]] auto get_culling_statistics() const -> const std::vector<erhe::scene::Culling_statistics>&;
+
 private:
     class Pipeline_cache_entry
     {
@@ -81,6 +90,13 @@ private:
         erhe::graphics::Pipeline pipeline{};
     };
 
+    class Shadow_light
+    {
+    public:
+        const erhe::scene::Light* light      {nullptr};
+        std::size_t               light_index{0};
+    };
+
     [[nodiscard]] auto get_pipeline(
         const erhe::graphics::Vertex_input_state* vertex_input_state
     ) -> erhe::graphics::Pipeline&;
@@ -96,6 +112,17 @@ private:
     Light_buffer                             m_light_buffers;
     Primitive_buffer                         m_primitive_buffers;
     erhe::graphics::Gpu_timer                m_gpu_timer;
+
+    // When enabled, each light draws only meshes in its view volume
+    bool                                                         m_frustum_culling{true};
+    erhe::scene::Mesh_culler                                     m_mesh_culler;
+    std::vector<erhe::scene::Mesh_culler::Mesh_span>             m_cull_mesh_spans;
+    std::vector<Shadow_light>                                    m_shadow_lights;
+    std::vector<std::vector<uint8_t>>                            m_light_visibility;     // per light and mesh span
+    std::vector<std::vector<uint8_t>>                            m_any_light_visibility; // per mesh span
+    std::vector<std::vector<std::shared_ptr<erhe::scene::Mesh>>> m_shadow_meshes;        // per mesh span, visible to any light
+    std::vector<erhe::renderer::Buffer_range>                    m_primitive_ranges;     // per mesh span, shared by all lights
+    std::vector<erhe::scene::Culling_statistics>                 m_culling_statistics;
 };
 
 
@@ -7,6 +7,7 @@
 #include "mesh_memory.hpp"
 #include "programs.hpp"
 
+#include "erhe_concurrency/thread_pool.hpp"
 #include "erhe_gl/enum_bit_mask_operators.hpp"
 #include "erhe_gl/gl_log.hpp"
 #include "erhe_gl/wrapper_functions.hpp"
@@ -35,6 +36,9 @@
 #include "erhe_window/window_event_handler.hpp"
 #include "erhe_ui/ui_log.hpp"
 
+#include <algorithm>
+#include <thread>
+
 namespace example {
 
 class Example
@@ -50,7 +54,8 @@ public:
         erhe::scene_renderer::Forward_renderer& forward_renderer,
         Parse_context&                          parse_context,
         Mesh_memory&                            mesh_memory,
-        Programs&                               programs
+        Programs&                               programs,
+        erhe::concurrency::Thread_pool&         thread_pool
     )
         : m_window           {window}
         , m_scene            {scene}
@@ -59,6 +64,7 @@ public:
         , m_parse_context    {parse_context}
         , m_mesh_memory      {mesh_memory}
         , m_programs         {programs}
+        , m_thread_pool      {thread_pool}
     {
         m_camera = make_camera(
             "Camera",
@@ -112,7 +118,7 @@ public:
         }
 
         m_camera_controller->update();
-        m_scene.update_node_transforms();
+        m_scene.update_node_transforms(&m_thread_pool);
 
         gl::enable(gl::Enable_cap::framebuffer_srgb);
         gl::clear_color(0.1f, 0.1f, 0.1f, 1.0f);
@@ -182,7 +188,8 @@ public:
                 .shadow_texture         = nullptr,
                 .viewport               = viewport,
                 .filter                 = erhe::Item_filter{},
-                .override_shader_stages = nullptr
+                .override_shader_stages = nullptr,
+                .thread_pool            = &m_thread_pool
             }
         );
 
@@ -346,6 +353,7 @@ private:
     Parse_context&                          m_parse_context;
     Mesh_memory&                            m_mesh_memory;
     Programs&                               m_programs;
+    erhe::concurrency::Thread_pool&         m_thread_pool;
 
     bool                                    m_close_requested{false};
     std::shared_ptr<erhe::scene::Camera>    m_camera;
@@ -408,7 +416,9 @@ void run_example()
     gl::clip_control(gl::Clip_control_origin::lower_left, gl::Clip_control_depth::zero_to_one);
     gl::enable      (gl::Enable_cap::framebuffer_srgb);
 
-    Example example{window, scene, graphics_instance, forward_renderer, parse_context, mesh_memory, programs};
+    erhe::concurrency::Thread_pool thread_pool{std::max(1u, std::thread::hardware_concurrency() - 1)};
+
+    Example example{window, scene, graphics_instance, forward_renderer, parse_context, mesh_memory, programs, thread_pool};
     example.run();
 }
 
@@ -149,6 +149,12 @@ void Frame_controller::handle_node_transform_update()
     if (node == nullptr) {
         return;
     }
+
+    // Scene notifies after world transforms have been updated, also when
+    // transform was set by update()
+    if (node->parent_from_node() == m_parent_from_node) {
+        return;
+    }
     get_transform_from_node(node);
     update();
 }
@@ -181,6 +187,7 @@ void Frame_controller::update()
     // Put translation to column 3
     parent_from_local[3] = vec4{m_position, 1.0f};
 
+    m_parent_from_node = parent_from_local;
     m_transform_update = true;
     node->set_parent_from_node(parent_from_local);
     m_transform_update = false;
@@ -68,6 +68,7 @@ private:
     glm::mat4 m_heading_matrix  {1.0f};
     glm::mat4 m_rotation_matrix {1.0f};
     glm::vec3 m_position        {0.0f};
+    glm::mat4 m_parent_from_node{1.0f}; // Most recently set to node
     bool      m_transform_update{false};
 };
 